@@ -224,31 +224,45 @@
 #include <GLFW/glfw3.h>
 
 #include "src/Animation.h"
+#include "src/BoundingVolume.h"
 #include "src/BumpMapCore.h"
+#include "src/BVH.h"
 #include "src/Camera.h"
 #include "src/CameraController.h"
 #include "src/ColorCore.h"
+#include "src/CompiledScene.h"
 #include "src/Composite.h"
 #include "src/Controller.h"
 #include "src/Core.h"
+#include "src/CullingRenderTraverser.h"
 #include "src/CubeMapCore.h"
+#include "src/GeometryArena.h"
 #include "src/GeometryCore.h"
 #include "src/GeometryCoreFactory.h"
+#include "src/GLStateCache.h"
 #include "src/Group.h"
+#include "src/HardwareOcclusionCuller.h"
+#include "src/IndirectDrawBatch.h"
 #include "src/InfoTraverser.h"
+#include "src/InstancedShape.h"
 #include "src/KeyboardController.h"
 #include "src/Leaf.h"
 #include "src/Light.h"
 #include "src/LightPosition.h"
+#include "src/LOD.h"
 #include "src/MaterialCore.h"
+#include "src/MeshSimplifier.h"
 #include "src/MouseController.h"
 #include "src/Node.h"
+#include "src/OcclusionCuller.h"
 #include "src/OrthographicCamera.h"
 #include "src/PerspectiveCamera.h"
 #include "src/PreTraverser.h"
 #include "src/Renderer.h"
+#include "src/RenderQueue.h"
 #include "src/RenderState.h"
 #include "src/RenderTraverser.h"
+#include "src/RingBuffer.h"
 #include "src/scg_glm.h"
 #include "src/scg_internals.h"
 #include "src/scg_stb_image.h"
@@ -257,12 +271,15 @@
 #include "src/ShaderCoreFactory.h"
 #include "src/Shape.h"
 #include "src/StandardRenderer.h"
+#include "src/StaticBatch.h"
 #include "src/Texture2DCore.h"
 #include "src/TextureCore.h"
 #include "src/TextureCoreFactory.h"
 #include "src/TransformAnimation.h"
 #include "src/Transformation.h"
+#include "src/TriangleBVH.h"
 #include "src/Traverser.h"
+#include "src/VertexQuantizer.h"
 #include "src/Viewer.h"
 #include "src/ViewState.h"
 
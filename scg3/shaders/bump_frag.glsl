@@ -39,9 +39,20 @@ layout(std140) uniform MaterialBlock {
   Material material;
 };
 
-uniform int nLights;
-uniform vec4 globalAmbientLight;
-uniform mat4 colorMatrix;
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 uniform sampler2D texture1;   // normal map
 
 out vec4 fragColor;
@@ -8,7 +8,7 @@
 in vec4 vVertex;
 in vec3 vNormal;
 in vec4 vTexCoord0;
-in vec3 vTangent;
+in vec4 vTangent;     // w: binormal sign if vBinormal is not set
 in vec3 vBinormal;
 
 const int MAX_NUMBER_OF_LIGHTS = 10;
@@ -28,12 +28,20 @@ layout(std140) uniform LightBlock {
   Light lights[MAX_NUMBER_OF_LIGHTS];
 };
 
-uniform int nLights;
-uniform mat4 modelViewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 mvpMatrix;
-uniform mat3 normalMatrix;
-uniform mat4 textureMatrix;
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 
 smooth out vec3 ecVertex;
 smooth out vec4 texCoord0;
@@ -45,8 +53,12 @@ void main() {
   // transform vertex position, normal, tangent, and binormal into eye coordinates 
   ecVertex = (modelViewMatrix * vVertex).xyz;
   vec3 ecNormal = normalMatrix * vNormal;
-  vec3 ecTangent = normalMatrix * vTangent;
-  vec3 ecBinormal = normalMatrix * vBinormal;
+  vec3 ecTangent = normalMatrix * vTangent.xyz;
+  // binormal from its own attribute, or reconstructed from normal and signed tangent
+  // (disabled attributes read as zero)
+  vec3 binormal = (dot(vBinormal, vBinormal) > 0.0) ?
+      vBinormal : cross(vNormal, vTangent.xyz) * (vTangent.w < 0.0 ? -1.0 : 1.0);
+  vec3 ecBinormal = normalMatrix * binormal;
       
   // create transformation to tangent space 
   vec3 ecN = normalize(ecNormal);
@@ -73,6 +85,6 @@ void main() {
   }
   
   // set output values
-  gl_Position = mvpMatrix * vVertex;
+  gl_Position = projectionMatrix * (modelViewMatrix * vVertex);
   texCoord0 = textureMatrix * vTexCoord0;
 }
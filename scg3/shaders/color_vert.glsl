@@ -8,12 +8,19 @@
 in vec4 vVertex;
 in vec4 vColor;
 
-uniform mat4 mvpMatrix;
+// prefixes of the standard uniform blocks, omitting unused members
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+};
 
 smooth out vec4 color;
 
 
 void main() {
-  gl_Position = mvpMatrix * vVertex;
+  gl_Position = projectionMatrix * (modelViewMatrix * vVertex);
   color = vColor;
 }
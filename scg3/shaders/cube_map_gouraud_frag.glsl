@@ -9,7 +9,13 @@ smooth in vec4 emissionAmbientDiffuse;
 smooth in vec4 specular;
 smooth in vec3 texCoord0;
 
-uniform mat4 colorMatrix;
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 uniform samplerCube texture0;
 
 out vec4 fragColor;
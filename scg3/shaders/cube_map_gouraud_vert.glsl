@@ -9,9 +9,20 @@
 in vec4 vVertex;
 in vec3 vNormal;
 
-uniform mat4 modelViewMatrix;
-uniform mat4 mvpMatrix;
-uniform mat3 normalMatrix;
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 uniform mat4 invViewMatrix;
 
 smooth out vec4 emissionAmbientDiffuse;
@@ -42,6 +53,6 @@ void main() {
   vec4 ecReflection = vec4(reflect(normalize(ecVertex), normalize(ecNormal)), 0.);
   
   // set output values
-  gl_Position = mvpMatrix * vVertex;
+  gl_Position = projectionMatrix * (modelViewMatrix * vVertex);
   texCoord0 = (invViewMatrix * ecReflection).stp;
 }
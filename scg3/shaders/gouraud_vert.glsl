@@ -9,11 +9,20 @@ in vec4 vVertex;
 in vec3 vNormal;
 in vec4 vTexCoord0;
 
-uniform mat4 modelViewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 mvpMatrix;
-uniform mat3 normalMatrix;
-uniform mat4 textureMatrix;
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 
 smooth out vec4 emissionAmbientDiffuse;
 smooth out vec4 specular;
@@ -40,6 +49,6 @@ void main() {
   applyLighting(ecVertex, ecNormal, emissionAmbientDiffuse, specular);
   
   // set output values
-  gl_Position = mvpMatrix * vVertex;
+  gl_Position = projectionMatrix * (modelViewMatrix * vVertex);
   texCoord0 = textureMatrix * vTexCoord0;
 }
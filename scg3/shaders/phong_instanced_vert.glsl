@@ -0,0 +1,48 @@
+/**
+ * \file phong_instanced_vert.glsl
+ * \brief Phong vertex shader for instanced rendering (cf. InstancedShape), to be
+ *    combined with phong_instanced_frag.glsl.
+ */
+
+#version 150
+
+in vec4 vVertex;
+in vec3 vNormal;
+in vec4 vTexCoord0;
+in mat4 vInstanceMatrix;
+in vec4 vInstanceColor;
+
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
+
+smooth out vec3 ecVertex;
+smooth out vec3 ecNormal;
+smooth out vec4 texCoord0;
+flat out vec4 instanceColor;
+
+
+void main() {
+  
+  // transform vertex position and normal into eye coordinates, applying the 
+  // instance matrix first
+  vec4 ecVertex4 = modelViewMatrix * (vInstanceMatrix * vVertex);
+  ecVertex = ecVertex4.xyz;
+  ecNormal = normalMatrix * (transpose(inverse(mat3(vInstanceMatrix))) * vNormal);
+      
+  // set output values
+  gl_Position = projectionMatrix * ecVertex4;
+  texCoord0 = textureMatrix * vTexCoord0;
+  instanceColor = vInstanceColor;
+}
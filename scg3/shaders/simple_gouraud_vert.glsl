@@ -8,10 +8,20 @@
 in vec4 vVertex;
 in vec3 vNormal;
 
-uniform mat4 modelViewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 mvpMatrix;
-uniform mat3 normalMatrix;
+layout(std140) uniform FrameBlock {
+  mat4 projectionMatrix;
+  mat4 viewMatrix;
+  vec4 globalAmbientLight;
+  float time;
+};
+
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 
 const int MAX_NUMBER_OF_LIGHTS = 10;
 
@@ -42,8 +52,6 @@ layout(std140) uniform MaterialBlock {
   Material material;
 };
 
-uniform int nLights;
-uniform vec4 globalAmbientLight;
 
 smooth out vec4 color;
 
@@ -67,7 +75,7 @@ void main() {
   applyLighting(ecVertex, ecNormal, color);
   
   // set output values
-  gl_Position = mvpMatrix * vVertex;
+  gl_Position = projectionMatrix * (modelViewMatrix * vVertex);
 }
 
 
@@ -8,7 +8,13 @@
 smooth in vec3 texCoord0;
 
 uniform samplerCube texture0;
-uniform mat4 colorMatrix;
+layout(std140) uniform ObjectBlock {
+  mat4 modelViewMatrix;
+  mat4 textureMatrix;
+  mat4 colorMatrix;
+  mat3 normalMatrix;
+  int nLights;
+};
 
 out vec4 fragColor;
 
@@ -0,0 +1,758 @@
+/**
+ * \file BVH.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include "BVH.h"
+#include "Composite.h"
+#include "GeometryCore.h"
+#include "InstancedShape.h"
+#include "Node.h"
+#include "Shape.h"
+
+namespace scg {
+
+
+namespace {
+
+// number of bins of SAH split
+const int N_SAH_BINS = 16;
+
+AABB merge(const AABB& box0, const AABB& box1) {
+  AABB result(box0);
+  result.extend(box1);
+  return result;
+}
+
+bool isEqual(const AABB& box0, const AABB& box1) {
+  return box0.min == box1.min && box0.max == box1.max;
+}
+
+}
+
+
+BVH::BVH(NodeSP root)
+    : root_(root), isBuilt_(false), syncVersion_(0), rootNode_(-1) {
+  assert(root_);
+}
+
+
+BVH::~BVH() {
+}
+
+
+BVHSP BVH::create(NodeSP root) {
+  return std::make_shared<BVH>(root);
+}
+
+
+NodeSP BVH::getRoot() const {
+  return root_;
+}
+
+
+size_t BVH::getNShapes() const {
+  return items_.size();
+}
+
+
+AABB BVH::getBoundingBox() const {
+  return rootNode_ < 0 ? AABB() : nodes_[rootNode_].box;
+}
+
+
+GLfloat BVH::getCost() const {
+  if (rootNode_ < 0 || nodes_[rootNode_].isLeaf()) {
+    return 0.0f;
+  }
+  GLfloat area = 0.0f;
+  queryStack_.clear();
+  queryStack_.push_back(std::make_pair(rootNode_, 0u));
+  while (!queryStack_.empty()) {
+    const Node_& node = nodes_[queryStack_.back().first];
+    queryStack_.pop_back();
+    if (!node.isLeaf()) {
+      area += node.box.getSurfaceArea();
+      queryStack_.push_back(std::make_pair(node.left, 0u));
+      queryStack_.push_back(std::make_pair(node.right, 0u));
+    }
+  }
+  const GLfloat rootArea = nodes_[rootNode_].box.getSurfaceArea();
+  return rootArea > 0.0f ? area / rootArea : 0.0f;
+}
+
+
+void BVH::sync() {
+  if (isBuilt_ && root_->getSubtreeVersion() < syncVersion_) {
+    return;
+  }
+  const unsigned long stamp = Node::nextVersion();
+  bool isStructureModified = false;
+  addedShapes_.clear();
+  removedShapes_.clear();
+
+  // walk modified sub-trees, update bounding boxes of modified shapes
+  walkStack_.clear();
+  walkStack_.push_back({ &root_, !isBuilt_, true });
+  while (!walkStack_.empty()) {
+    const WalkEntry_ entry = walkStack_.back();
+    walkStack_.pop_back();
+    Node* node = entry.node->get();
+    if (!node || (!entry.isForced && node->subtreeVersion_ < syncVersion_)) {
+      continue;
+    }
+    const bool isForced = entry.isForced || node->version_ >= syncVersion_;
+    const bool isVisible = entry.isVisible && node->isVisible_;
+    if (node->isComposite_) {
+      Composite* composite = static_cast<Composite*>(node);
+      if (composite->getStructureVersion() >= syncVersion_) {
+        isStructureModified = true;
+      }
+      for (auto& child : composite->getChildren()) {
+        walkStack_.push_back({ &child, isForced, isVisible });
+      }
+      continue;
+    }
+    Shape* shape = dynamic_cast<Shape*>(node);
+    if (!shape) {
+      continue;
+    }
+    auto it = itemIndices_.find(shape);
+    if (!isVisible) {
+      if (it != itemIndices_.end()) {
+        removedShapes_.push_back(shape);
+      }
+      continue;
+    }
+    const AABB& box = shape->getWorldBoundingBox();
+    if (it == itemIndices_.end()) {
+      addedShapes_.push_back(std::make_pair(std::static_pointer_cast<Shape>(*entry.node), box));
+      continue;
+    }
+    Item_& item = items_[it->second];
+    item.syncStamp = stamp;
+    if (!isEqual(item.box, box)) {
+      item.box = box;
+      nodes_[item.leaf].box = box;
+      markDirty_(item.leaf);
+    }
+  }
+
+  // find shapes that have been removed from the scene graph
+  if (isBuilt_ && isStructureModified) {
+    std::unordered_map<Node*, bool> reachable;
+    for (auto& item : items_) {
+      if (item.syncStamp != stamp && !isReachable_(item.shape.get(), reachable)) {
+        removedShapes_.push_back(item.shape.get());
+      }
+    }
+  }
+  for (auto shape : removedShapes_) {
+    auto it = itemIndices_.find(shape);
+    if (it != itemIndices_.end()) {
+      removeItem_(it->second);
+    }
+  }
+
+  // refit moved shapes, insert added shapes (or build hierarchy on first call)
+  refitDirty_();
+  for (auto& added : addedShapes_) {
+    addItem_(added.first, added.second, isBuilt_);
+    items_.back().syncStamp = stamp;
+  }
+  addedShapes_.clear();
+  if (!isBuilt_) {
+    rebuild();
+    isBuilt_ = true;
+  }
+  syncVersion_ = stamp;
+}
+
+
+void BVH::rebuild() {
+  nodes_.clear();
+  freeNodes_.clear();
+  rootNode_ = -1;
+  if (items_.empty()) {
+    return;
+  }
+  const size_t nItems = items_.size();
+  buildItems_.resize(nItems);
+  buildCentroids_.resize(nItems);
+  for (size_t i = 0; i < nItems; ++i) {
+    buildItems_[i] = static_cast<int>(i);
+    buildCentroids_[i] = items_[i].box.isEmpty() ? glm::vec3(0.0f) : items_[i].box.getCenter();
+  }
+  nodes_.reserve(2 * nItems - 1);
+
+  // build top-down in depth-first order, i.e., left child follows its parent directly
+  struct Task {
+    int parent;
+    bool isRight;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Task> tasks;
+  tasks.push_back({ -1, false, 0, nItems });
+  while (!tasks.empty()) {
+    const Task task = tasks.back();
+    tasks.pop_back();
+    const int index = static_cast<int>(nodes_.size());
+    nodes_.push_back({ AABB(), task.parent, -1, -1, false });
+    if (task.parent < 0) {
+      rootNode_ = index;
+    }
+    else if (task.isRight) {
+      nodes_[task.parent].right = index;
+    }
+    else {
+      nodes_[task.parent].left = index;
+    }
+    if (task.end - task.begin == 1) {
+      const int item = buildItems_[task.begin];
+      nodes_[index].right = item;
+      nodes_[index].box = items_[item].box;
+      items_[item].leaf = index;
+      continue;
+    }
+    const size_t mid = splitSAH_(task.begin, task.end);
+    tasks.push_back({ index, true, mid, task.end });
+    tasks.push_back({ index, false, task.begin, mid });
+  }
+
+  // compute bounding boxes of inner nodes bottom-up, children follow their parents
+  for (size_t i = nodes_.size(); i-- > 0; ) {
+    Node_& node = nodes_[i];
+    if (!node.isLeaf()) {
+      node.box = merge(nodes_[node.left].box, nodes_[node.right].box);
+    }
+  }
+}
+
+
+void BVH::queryRange(const AABB& box, std::vector<Shape*>& result) const {
+  if (rootNode_ < 0) {
+    return;
+  }
+  queryStack_.clear();
+  queryStack_.push_back(std::make_pair(rootNode_, 0u));
+  while (!queryStack_.empty()) {
+    const Node_& node = nodes_[queryStack_.back().first];
+    queryStack_.pop_back();
+    if (!node.box.overlaps(box)) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      result.push_back(items_[node.right].shape.get());
+    }
+    else {
+      queryStack_.push_back(std::make_pair(node.right, 0u));
+      queryStack_.push_back(std::make_pair(node.left, 0u));
+    }
+  }
+}
+
+
+void BVH::queryFrustum(const ViewFrustum& frustum, std::vector<Shape*>& result) const {
+  if (rootNode_ < 0) {
+    return;
+  }
+  unsigned char lastPlane = 0;
+  queryStack_.clear();
+  queryStack_.push_back(std::make_pair(rootNode_, ViewFrustum::ALL_PLANES));
+  while (!queryStack_.empty()) {
+    const int index = queryStack_.back().first;
+    unsigned int planeMask = queryStack_.back().second;
+    queryStack_.pop_back();
+    const Node_& node = nodes_[index];
+    if (frustum.isOutside(node.box, planeMask, lastPlane)) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      result.push_back(items_[node.right].shape.get());
+    }
+    else if (planeMask == 0) {
+      // completely inside: add sub-tree without further tests
+      appendSubtree_(index, result);
+    }
+    else {
+      queryStack_.push_back(std::make_pair(node.right, planeMask));
+      queryStack_.push_back(std::make_pair(node.left, planeMask));
+    }
+  }
+}
+
+
+void BVH::queryNearest(const glm::vec3& point, size_t k, std::vector<Shape*>& result,
+    std::vector<GLfloat>* distances) const {
+  if (rootNode_ < 0 || k == 0) {
+    return;
+  }
+
+  // best-first search: leaves are popped in order of increasing distance
+  typedef std::pair<GLfloat, int> Entry;
+  const std::greater<Entry> compare;
+  size_t nFound = 0;
+  nearestHeap_.clear();
+  nearestHeap_.push_back(Entry(nodes_[rootNode_].box.getDistance2(point), rootNode_));
+  while (!nearestHeap_.empty() && nFound < k) {
+    std::pop_heap(nearestHeap_.begin(), nearestHeap_.end(), compare);
+    const Entry entry = nearestHeap_.back();
+    nearestHeap_.pop_back();
+    const Node_& node = nodes_[entry.second];
+    if (node.isLeaf()) {
+      result.push_back(items_[node.right].shape.get());
+      if (distances) {
+        distances->push_back(std::sqrt(entry.first));
+      }
+      ++nFound;
+      continue;
+    }
+    for (int child : { node.left, node.right }) {
+      if (!nodes_[child].box.isEmpty()) {
+        nearestHeap_.push_back(Entry(nodes_[child].box.getDistance2(point), child));
+        std::push_heap(nearestHeap_.begin(), nearestHeap_.end(), compare);
+      }
+    }
+  }
+}
+
+
+bool BVH::intersect(const Ray& ray, RayHit& hit) const {
+  if (rootNode_ < 0) {
+    return false;
+  }
+
+  // depth-first traversal, skipping nodes behind the nearest intersection found so far
+  bool isFound = false;
+  GLfloat tNear;
+  queryStack_.clear();
+  queryStack_.push_back(std::make_pair(rootNode_, 0u));
+  while (!queryStack_.empty()) {
+    const Node_& node = nodes_[queryStack_.back().first];
+    queryStack_.pop_back();
+    if (!node.box.intersect(ray, hit.distance, tNear)) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      isFound |= intersectShape_(items_[node.right].shape.get(), &ray, 1, &hit);
+    }
+    else {
+      queryStack_.push_back(std::make_pair(node.right, 0u));
+      queryStack_.push_back(std::make_pair(node.left, 0u));
+    }
+  }
+  return isFound;
+}
+
+
+void BVH::intersect(const Ray* rays, size_t nRays, RayHit* hits) const {
+  if (rootNode_ < 0) {
+    return;
+  }
+  for (size_t first = 0; first < nRays; first += 4) {
+    const size_t nPacketRays = std::min(nRays - first, static_cast<size_t>(4));
+    const Ray* packetRays = rays + first;
+    RayHit* packetHits = hits + first;
+
+    // traverse as long as any ray of the packet intersects the node
+    queryStack_.clear();
+    queryStack_.push_back(std::make_pair(rootNode_, 0u));
+    while (!queryStack_.empty()) {
+      const Node_& node = nodes_[queryStack_.back().first];
+      queryStack_.pop_back();
+      Ray activeRays[4];
+      RayHit activeHits[4];
+      size_t activeIndices[4];
+      size_t nActive = 0;
+      GLfloat tNear;
+      for (size_t i = 0; i < nPacketRays; ++i) {
+        if (node.box.intersect(packetRays[i], packetHits[i].distance, tNear)) {
+          activeRays[nActive] = packetRays[i];
+          activeHits[nActive] = packetHits[i];
+          activeIndices[nActive++] = i;
+        }
+      }
+      if (nActive == 0) {
+        continue;
+      }
+      if (node.isLeaf()) {
+        if (intersectShape_(items_[node.right].shape.get(), activeRays, nActive, activeHits)) {
+          for (size_t i = 0; i < nActive; ++i) {
+            packetHits[activeIndices[i]] = activeHits[i];
+          }
+        }
+      }
+      else {
+        queryStack_.push_back(std::make_pair(node.right, 0u));
+        queryStack_.push_back(std::make_pair(node.left, 0u));
+      }
+    }
+  }
+}
+
+
+int BVH::allocateNode_() {
+  if (!freeNodes_.empty()) {
+    const int index = freeNodes_.back();
+    freeNodes_.pop_back();
+    return index;
+  }
+  nodes_.push_back(Node_());
+  return static_cast<int>(nodes_.size() - 1);
+}
+
+
+void BVH::freeNode_(int index) {
+  nodes_[index].parent = -1;
+  nodes_[index].left = -1;
+  nodes_[index].right = -1;
+  nodes_[index].isDirty = false;
+  freeNodes_.push_back(index);
+}
+
+
+void BVH::addItem_(const ShapeSP& shape, const AABB& box, bool isInsert) {
+  const int item = static_cast<int>(items_.size());
+  items_.push_back({ shape, box, -1, 0 });
+  itemIndices_[shape.get()] = item;
+  if (isInsert) {
+    const int leaf = allocateNode_();
+    nodes_[leaf] = { box, -1, -1, item, false };
+    items_[item].leaf = leaf;
+    insertLeaf_(leaf);
+  }
+}
+
+
+void BVH::removeItem_(int item) {
+  removeLeaf_(items_[item].leaf);
+  freeNode_(items_[item].leaf);
+  itemIndices_.erase(items_[item].shape.get());
+
+  // move last item into empty slot
+  const int last = static_cast<int>(items_.size() - 1);
+  if (item != last) {
+    items_[item] = std::move(items_[last]);
+    nodes_[items_[item].leaf].right = item;
+    itemIndices_[items_[item].shape.get()] = item;
+  }
+  items_.pop_back();
+}
+
+
+void BVH::insertLeaf_(int leaf) {
+  if (rootNode_ < 0) {
+    rootNode_ = leaf;
+    nodes_[leaf].parent = -1;
+    return;
+  }
+
+  // descend to sibling with least surface area increase (cf. Catto, Box2D)
+  const AABB box = nodes_[leaf].box;
+  int index = rootNode_;
+  while (!nodes_[index].isLeaf()) {
+    const Node_& node = nodes_[index];
+    const GLfloat area = node.box.getSurfaceArea();
+    const GLfloat mergedArea = merge(node.box, box).getSurfaceArea();
+    const GLfloat cost = 2.0f * mergedArea;                     // new parent of node and leaf
+    const GLfloat inheritedCost = 2.0f * (mergedArea - area);   // increase of ancestors
+    GLfloat childCosts[2];
+    const int children[2] = { node.left, node.right };
+    for (int i = 0; i < 2; ++i) {
+      const Node_& child = nodes_[children[i]];
+      const GLfloat childArea = merge(child.box, box).getSurfaceArea();
+      childCosts[i] = (child.isLeaf() ? childArea : childArea - child.box.getSurfaceArea())
+          + inheritedCost;
+    }
+    if (cost < childCosts[0] && cost < childCosts[1]) {
+      break;
+    }
+    index = childCosts[0] <= childCosts[1] ? children[0] : children[1];
+  }
+
+  // create new parent of sibling and leaf
+  const int sibling = index;
+  const int oldParent = nodes_[sibling].parent;
+  const int newParent = allocateNode_();
+  nodes_[newParent] = { merge(nodes_[sibling].box, box), oldParent, sibling, leaf, false };
+  nodes_[sibling].parent = newParent;
+  nodes_[leaf].parent = newParent;
+  if (oldParent < 0) {
+    rootNode_ = newParent;
+  }
+  else {
+    if (nodes_[oldParent].left == sibling) {
+      nodes_[oldParent].left = newParent;
+    }
+    else {
+      nodes_[oldParent].right = newParent;
+    }
+    refitUpwards_(oldParent);
+  }
+}
+
+
+void BVH::removeLeaf_(int leaf) {
+  if (leaf == rootNode_) {
+    rootNode_ = -1;
+    return;
+  }
+  const int parent = nodes_[leaf].parent;
+  const int grandParent = nodes_[parent].parent;
+  const int sibling = nodes_[parent].left == leaf ? nodes_[parent].right : nodes_[parent].left;
+  nodes_[sibling].parent = grandParent;
+  if (grandParent < 0) {
+    rootNode_ = sibling;
+  }
+  else {
+    if (nodes_[grandParent].left == parent) {
+      nodes_[grandParent].left = sibling;
+    }
+    else {
+      nodes_[grandParent].right = sibling;
+    }
+    refitUpwards_(grandParent);
+  }
+  freeNode_(parent);
+}
+
+
+void BVH::refitUpwards_(int index) {
+  for (; index >= 0; index = nodes_[index].parent) {
+    Node_& node = nodes_[index];
+    node.box = merge(nodes_[node.left].box, nodes_[node.right].box);
+  }
+}
+
+
+void BVH::markDirty_(int index) {
+  // ancestors of a dirty node are dirty already
+  for (; index >= 0 && !nodes_[index].isDirty; index = nodes_[index].parent) {
+    nodes_[index].isDirty = true;
+  }
+}
+
+
+void BVH::refitDirty_() {
+  if (rootNode_ < 0 || !nodes_[rootNode_].isDirty) {
+    return;
+  }
+
+  // post-order walk of dirty nodes, second element marks expanded nodes
+  queryStack_.clear();
+  queryStack_.push_back(std::make_pair(rootNode_, 0u));
+  while (!queryStack_.empty()) {
+    Node_& node = nodes_[queryStack_.back().first];
+    if (node.isLeaf()) {
+      node.isDirty = false;
+      queryStack_.pop_back();
+    }
+    else if (queryStack_.back().second == 0) {
+      queryStack_.back().second = 1;
+      if (nodes_[node.left].isDirty) {
+        queryStack_.push_back(std::make_pair(node.left, 0u));
+      }
+      if (nodes_[node.right].isDirty) {
+        queryStack_.push_back(std::make_pair(node.right, 0u));
+      }
+    }
+    else {
+      node.box = merge(nodes_[node.left].box, nodes_[node.right].box);
+      node.isDirty = false;
+      queryStack_.pop_back();
+    }
+  }
+}
+
+
+size_t BVH::splitSAH_(size_t begin, size_t end) {
+  // choose axis of largest extent of centroids
+  AABB centroidBox;
+  for (size_t i = begin; i < end; ++i) {
+    centroidBox.extend(buildCentroids_[buildItems_[i]]);
+  }
+  const glm::vec3 extent = centroidBox.max - centroidBox.min;
+  const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+  const size_t half = begin + (end - begin) / 2;
+  if (extent[axis] <= 0.0f) {
+    return half;
+  }
+
+  // bin items by centroid
+  const GLfloat scale = N_SAH_BINS / extent[axis];
+  const GLfloat origin = centroidBox.min[axis];
+  auto getBin = [&](int item) {
+    return std::min(static_cast<int>((buildCentroids_[item][axis] - origin) * scale), N_SAH_BINS - 1);
+  };
+  AABB binBoxes[N_SAH_BINS];
+  size_t binCounts[N_SAH_BINS] = { 0 };
+  for (size_t i = begin; i < end; ++i) {
+    const int bin = getBin(buildItems_[i]);
+    binBoxes[bin].extend(items_[buildItems_[i]].box);
+    ++binCounts[bin];
+  }
+
+  // evaluate SAH cost of splits between bins, sweeping from right to left and back
+  GLfloat rightCosts[N_SAH_BINS];
+  AABB box;
+  size_t count = 0;
+  for (int bin = N_SAH_BINS - 1; bin > 0; --bin) {
+    box.extend(binBoxes[bin]);
+    count += binCounts[bin];
+    rightCosts[bin - 1] = box.getSurfaceArea() * count;
+  }
+  int bestBin = -1;
+  GLfloat bestCost = FLT_MAX;
+  box = AABB();
+  count = 0;
+  for (int bin = 0; bin < N_SAH_BINS - 1; ++bin) {
+    box.extend(binBoxes[bin]);
+    count += binCounts[bin];
+    const GLfloat cost = box.getSurfaceArea() * count + rightCosts[bin];
+    if (count > 0 && count < end - begin && cost < bestCost) {
+      bestCost = cost;
+      bestBin = bin;
+    }
+  }
+  if (bestBin < 0) {
+    return half;
+  }
+  auto mid = std::partition(buildItems_.begin() + begin, buildItems_.begin() + end,
+      [&](int item) { return getBin(item) <= bestBin; });
+  return static_cast<size_t>(mid - buildItems_.begin());
+}
+
+
+bool BVH::isReachable_(Node* node, std::unordered_map<Node*, bool>& cache) {
+  // walk up to the root node or to a node whose result is known
+  bool result = false;
+  reachPath_.clear();
+  for (; node; node = node->parent_) {
+    auto it = cache.find(node);
+    if (it != cache.end()) {
+      result = it->second;
+      break;
+    }
+    reachPath_.push_back(node);
+    if (!node->isVisible_) {
+      break;
+    }
+    if (node == root_.get()) {
+      result = true;
+      break;
+    }
+  }
+  for (auto pathNode : reachPath_) {
+    cache[pathNode] = result;
+  }
+  return result;
+}
+
+
+bool BVH::intersectShape_(Shape* shape, const Ray* rays, size_t nRays, RayHit* hits) {
+  assert(nRays <= 4);
+  const glm::mat4 invWorld = glm::inverse(shape->getWorldMatrix());
+  Ray localRays[4];
+  for (size_t i = 0; i < nRays; ++i) {
+    localRays[i] = rays[i].transform(invWorld);
+  }
+  InstancedShape* instancedShape = dynamic_cast<InstancedShape*>(shape);
+  if (!instancedShape) {
+    return intersectCores_(shape, -1, localRays, nRays, hits);
+  }
+
+  // test instances whose bounding boxes are hit before the current nearest intersections
+  bool isFound = false;
+  for (size_t instance = 0; instance < instancedShape->getNInstances(); ++instance) {
+    const AABB& box = instancedShape->getInstanceBoundingBox(instance);
+    bool isBoxHit = false;
+    for (size_t i = 0; i < nRays && !isBoxHit; ++i) {
+      GLfloat tNear;
+      isBoxHit = box.intersect(localRays[i], hits[i].distance, tNear);
+    }
+    if (!isBoxHit) {
+      continue;
+    }
+    const glm::mat4 invInstance = glm::inverse(instancedShape->getInstanceMatrix(instance));
+    Ray instanceRays[4];
+    for (size_t i = 0; i < nRays; ++i) {
+      instanceRays[i] = localRays[i].transform(invInstance);
+    }
+    isFound |= intersectCores_(shape, static_cast<int>(instance), instanceRays, nRays, hits);
+  }
+  return isFound;
+}
+
+
+bool BVH::intersectCores_(Shape* shape, int instance, const Ray* rays, size_t nRays, RayHit* hits) {
+  bool isFound = false;
+  for (auto& core : shape->cores_) {
+    GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+    TriangleBVH* triangleBVH = geometryCore ? geometryCore->getTriangleBVH() : nullptr;
+    if (!triangleBVH) {
+      continue;
+    }
+    GLfloat distances[4];
+    for (size_t i = 0; i < nRays; ++i) {
+      distances[i] = hits[i].distance;
+    }
+    if (nRays == 1) {
+      triangleBVH->intersect(rays[0], hits[0]);
+    }
+    else {
+      triangleBVH->intersect(rays, nRays, hits);
+    }
+    for (size_t i = 0; i < nRays; ++i) {
+      if (hits[i].distance < distances[i]) {
+        hits[i].shape = shape;
+        hits[i].instance = instance;
+        isFound = true;
+      }
+    }
+  }
+  return isFound;
+}
+
+
+void BVH::appendSubtree_(int index, std::vector<Shape*>& result) const {
+  const size_t base = queryStack_.size();
+  queryStack_.push_back(std::make_pair(index, 0u));
+  while (queryStack_.size() > base) {
+    const Node_& node = nodes_[queryStack_.back().first];
+    queryStack_.pop_back();
+    if (node.isLeaf()) {
+      result.push_back(items_[node.right].shape.get());
+    }
+    else {
+      queryStack_.push_back(std::make_pair(node.right, 0u));
+      queryStack_.push_back(std::make_pair(node.left, 0u));
+    }
+  }
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,295 @@
+/**
+ * \file BVH.h
+ * \brief A dynamic bounding volume hierarchy over the shapes of a scene graph,
+ *    to be used for spatial queries.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "BoundingVolume.h"
+#include "TriangleBVH.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief A dynamic bounding volume hierarchy over the shapes of a scene graph,
+ *    to be used for spatial queries.
+ *
+ * The hierarchy is a binary tree of axis-aligned bounding boxes whose leaves contain
+ * the world bounding boxes of the visible shapes (cf. Node::getWorldBoundingBox()).
+ * The tree nodes are stored in a contiguous array and are addressed by indices.
+ *
+ * sync() keeps the hierarchy up to date with the scene graph, using the version stamps
+ * of the nodes (cf. Node::getVersion()) to skip unmodified sub-trees:
+ * - the leaves of moved shapes are updated and their ancestors are refitted in a single
+ *   bottom-up pass,
+ * - added shapes are inserted incrementally at the position of least surface area increase,
+ * - removed or hidden shapes are removed from the hierarchy.
+ *
+ * Incremental updates degrade the quality of the hierarchy over time. rebuild() builds
+ * the hierarchy from scratch using the surface area heuristic (SAH) and stores the nodes
+ * in depth-first order, such that the left child directly follows its parent.
+ * The first call of sync() builds the hierarchy this way.
+ *
+ * Rays are intersected with the triangles of the shapes' pickable geometry cores
+ * (cf. GeometryCore::getTriangleBVH()), transformed into the model coordinates
+ * of each shape whose bounding box is hit.
+ *
+ * Query results are appended to the given vectors. The shapes are kept alive by the
+ * hierarchy until they are removed by sync().
+ */
+class BVH {
+
+public:
+
+  /**
+   * Constructor with root node of the scene graph.
+   */
+  BVH(NodeSP root);
+
+  /**
+   * Destructor.
+   */
+  virtual ~BVH();
+
+  /**
+   * Create shared pointer.
+   */
+  static BVHSP create(NodeSP root);
+
+  /**
+   * Get root node.
+   */
+  NodeSP getRoot() const;
+
+  /**
+   * Get number of shapes.
+   */
+  size_t getNShapes() const;
+
+  /**
+   * Get bounding box of all shapes.
+   */
+  AABB getBoundingBox() const;
+
+  /**
+   * Get SAH cost of the hierarchy, i.e., the sum of the surface areas of the inner nodes
+   * relative to the surface area of the root node, to decide when to call rebuild().
+   */
+  GLfloat getCost() const;
+
+  /**
+   * Synchronize hierarchy with the scene graph, i.e., build the hierarchy on first call
+   * and update modified, added, and removed shapes afterwards.
+   */
+  void sync();
+
+  /**
+   * Rebuild hierarchy of the current shapes using the surface area heuristic.
+   */
+  void rebuild();
+
+  /**
+   * Find shapes whose bounding boxes overlap the given box.
+   */
+  void queryRange(const AABB& box, std::vector<Shape*>& result) const;
+
+  /**
+   * Find shapes whose bounding boxes are not completely outside of the given frustum
+   * (cf. ViewFrustum::isOutside()).
+   */
+  void queryFrustum(const ViewFrustum& frustum, std::vector<Shape*>& result) const;
+
+  /**
+   * Find the k shapes whose bounding boxes are nearest to the given point, sorted by
+   * increasing distance.
+   * \param point query point
+   * \param k maximum number of shapes to be found
+   * \param result shapes found
+   * \param distances if not null, distances of the shapes found
+   */
+  void queryNearest(const glm::vec3& point, size_t k, std::vector<Shape*>& result,
+      std::vector<GLfloat>* distances = nullptr) const;
+
+  /**
+   * Find nearest intersection of ray with the triangles of the shapes that is closer
+   * than hit.distance.
+   * \param ray ray in world coordinates, parameters are distances if direction is normalized
+   * \param hit updated if a closer intersection has been found
+   * \return true if a closer intersection has been found
+   */
+  bool intersect(const Ray& ray, RayHit& hit) const;
+
+  /**
+   * Find nearest intersections of a batch of rays, processed in packets of four rays
+   * (cf. TriangleBVH::intersect()).
+   * \param rays rays in world coordinates
+   * \param nRays number of rays
+   * \param hits updated if closer intersections have been found
+   */
+  void intersect(const Ray* rays, size_t nRays, RayHit* hits) const;
+
+protected:
+
+  /**
+   * \brief Tree node, leaf if left < 0.
+   */
+  struct Node_ {
+    AABB box;
+    int parent;       // -1 for root node
+    int left;         // -1 for leaf
+    int right;        // item index for leaf
+    bool isDirty;     // bounding box has to be refitted
+
+    bool isLeaf() const {
+      return left < 0;
+    }
+  };
+
+  /**
+   * \brief Indexed shape.
+   */
+  struct Item_ {
+    ShapeSP shape;
+    AABB box;
+    int leaf;
+    unsigned long syncStamp;    // last sync() that found the shape
+  };
+
+  /**
+   * Allocate tree node from free list or at end of node array.
+   */
+  int allocateNode_();
+
+  /**
+   * Return tree node to free list.
+   */
+  void freeNode_(int index);
+
+  /**
+   * Add item for shape.
+   * \param shape shape to be added
+   * \param box world bounding box of shape
+   * \param isInsert if true, insert leaf into the tree, otherwise rebuild() has to be called
+   */
+  void addItem_(const ShapeSP& shape, const AABB& box, bool isInsert);
+
+  /**
+   * Remove leaf from the tree and remove item.
+   */
+  void removeItem_(int item);
+
+  /**
+   * Partition build items by a binned SAH split.
+   * \return index of first item of right partition
+   */
+  size_t splitSAH_(size_t begin, size_t end);
+
+  /**
+   * Insert leaf at the position of least surface area increase.
+   */
+  void insertLeaf_(int leaf);
+
+  /**
+   * Remove leaf from the tree, replacing its parent by its sibling.
+   */
+  void removeLeaf_(int leaf);
+
+  /**
+   * Recompute bounding boxes from given node up to the root node.
+   */
+  void refitUpwards_(int index);
+
+  /**
+   * Mark given node and its ancestors for refitting.
+   */
+  void markDirty_(int index);
+
+  /**
+   * Refit bounding boxes of all dirty nodes in a single bottom-up pass.
+   */
+  void refitDirty_();
+
+  /**
+   * Check if shape is still part of the scene graph and visible.
+   */
+  bool isReachable_(Node* node, std::unordered_map<Node*, bool>& cache);
+
+  /**
+   * Intersect rays with triangles of shape, transforming them into model coordinates.
+   * \param shape shape to be tested
+   * \param rays rays in world coordinates
+   * \param nRays number of rays, at most four
+   * \param hits updated if closer intersections have been found
+   * \return true if a closer intersection has been found
+   */
+  static bool intersectShape_(Shape* shape, const Ray* rays, size_t nRays, RayHit* hits);
+
+  /**
+   * Intersect rays in model coordinates with triangles of the geometry cores of shape.
+   * \param instance index of instance of InstancedShape, -1 otherwise
+   * \return true if a closer intersection has been found
+   */
+  static bool intersectCores_(Shape* shape, int instance, const Ray* rays, size_t nRays, RayHit* hits);
+
+  /**
+   * Append shapes of all leaves of the sub-tree of the given tree node.
+   */
+  void appendSubtree_(int index, std::vector<Shape*>& result) const;
+
+protected:
+
+  NodeSP root_;
+  bool isBuilt_;
+  unsigned long syncVersion_;     // modifications with this or a later version are not synchronized yet
+  std::vector<Node_> nodes_;
+  std::vector<int> freeNodes_;
+  int rootNode_;                  // -1 for empty hierarchy
+  std::vector<Item_> items_;
+  std::unordered_map<Shape*, int> itemIndices_;
+  // temporary data, reused between calls
+  struct WalkEntry_ {
+    const NodeSP* node;
+    bool isForced;    // node or ancestor modified, sub-tree has to be updated
+    bool isVisible;
+  };
+  std::vector<WalkEntry_> walkStack_;
+  std::vector<std::pair<ShapeSP, AABB> > addedShapes_;
+  std::vector<Shape*> removedShapes_;
+  std::vector<Node*> reachPath_;
+  std::vector<int> buildItems_;
+  std::vector<glm::vec3> buildCentroids_;
+  mutable std::vector<std::pair<int, unsigned int> > queryStack_;   // node index and plane mask
+  mutable std::vector<std::pair<GLfloat, int> > nearestHeap_;       // squared distance and node index
+
+};
+
+
+} /* namespace scg */
+
+#endif /* BVH_H_ */
@@ -0,0 +1,240 @@
+/**
+ * \file BoundingVolume.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "BoundingVolume.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCG_BOUNDS_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace scg {
+
+
+AABB::AABB()
+    : min(FLT_MAX), max(-FLT_MAX) {
+}
+
+
+bool AABB::intersect(const Ray& ray, GLfloat tMax, GLfloat& tNear) const {
+  if (isEmpty()) {
+    return false;
+  }
+
+  // intersect ray with slabs of all three dimensions (cf. Kay & Kajiya, 1986)
+  const glm::vec3 invDirection = 1.0f / ray.direction;
+  const glm::vec3 t0 = (min - ray.origin) * invDirection;
+  const glm::vec3 t1 = (max - ray.origin) * invDirection;
+  const glm::vec3 tMin = glm::min(t0, t1);
+  const glm::vec3 tMaxSlab = glm::max(t0, t1);
+  tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+  const GLfloat tFar = std::min(std::min(tMaxSlab.x, tMaxSlab.y), std::min(tMaxSlab.z, tMax));
+  return tNear <= tFar;
+}
+
+
+AABB AABB::transform(const glm::mat4& matrix) const {
+  if (isEmpty()) {
+    return *this;
+  }
+
+  // transform center and half extent separately (cf. Arvo, Graphics Gems, 1990)
+  const glm::vec3 center(matrix * glm::vec4(getCenter(), 1.0f));
+  const glm::vec3 halfExtent = getHalfExtent();
+  glm::vec3 newHalfExtent(0.0f);
+  for (int i = 0; i < 3; ++i) {
+    newHalfExtent += glm::abs(glm::vec3(matrix[i])) * halfExtent[i];
+  }
+  return AABB(center - newHalfExtent, center + newHalfExtent);
+}
+
+
+AABB AABB::fromPoints(const GLfloat* data, size_t nPoints, GLint dim) {
+  AABB box;
+  if (!data || nPoints == 0 || dim <= 0) {
+    return box;
+  }
+  size_t i = 0;
+
+#ifdef SCG_BOUNDS_USE_SSE
+  if (dim >= 3) {
+    // load 4 floats per point (4th one is ignored), except for the last point
+    // to avoid reading beyond the end of the array; two accumulators for
+    // instruction-level parallelism
+    __m128 min0 = _mm_set1_ps(FLT_MAX);
+    __m128 max0 = _mm_set1_ps(-FLT_MAX);
+    __m128 min1 = min0;
+    __m128 max1 = max0;
+    for (; i + 2 < nPoints; i += 2) {
+      const __m128 p0 = _mm_loadu_ps(data + i * dim);
+      const __m128 p1 = _mm_loadu_ps(data + (i + 1) * dim);
+      min0 = _mm_min_ps(min0, p0);
+      max0 = _mm_max_ps(max0, p0);
+      min1 = _mm_min_ps(min1, p1);
+      max1 = _mm_max_ps(max1, p1);
+    }
+    alignas(16) GLfloat result[4];
+    _mm_store_ps(result, _mm_min_ps(min0, min1));
+    box.min = glm::vec3(result[0], result[1], result[2]);
+    _mm_store_ps(result, _mm_max_ps(max0, max1));
+    box.max = glm::vec3(result[0], result[1], result[2]);
+  }
+#endif
+
+  // process remaining points
+  for (; i < nPoints; ++i) {
+    const GLfloat* p = data + i * dim;
+    box.extend(glm::vec3(p[0], dim > 1 ? p[1] : 0.0f, dim > 2 ? p[2] : 0.0f));
+  }
+  return box;
+}
+
+
+BoundingSphere::BoundingSphere(const AABB& box)
+    : center(box.getCenter()),
+      radius(box.isEmpty() ? -1.0f : glm::length(box.getHalfExtent())) {
+}
+
+
+void BoundingSphere::extend(const BoundingSphere& sphere) {
+  if (sphere.isEmpty()) {
+    return;
+  }
+  if (isEmpty()) {
+    *this = sphere;
+    return;
+  }
+  const glm::vec3 diff = sphere.center - center;
+  const GLfloat dist = glm::length(diff);
+  if (dist + sphere.radius <= radius) {
+    return;   // sphere is contained in this sphere
+  }
+  if (dist + radius <= sphere.radius) {
+    *this = sphere;   // this sphere is contained in sphere
+    return;
+  }
+  const GLfloat newRadius = 0.5f * (dist + radius + sphere.radius);
+  center += ((newRadius - radius) / dist) * diff;
+  radius = newRadius;
+}
+
+
+BoundingSphere BoundingSphere::transform(const glm::mat4& matrix) const {
+  if (isEmpty()) {
+    return *this;
+  }
+  const GLfloat scale2 = std::max(std::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+      glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+      glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2])));
+  return BoundingSphere(glm::vec3(matrix * glm::vec4(center, 1.0f)), std::sqrt(scale2) * radius);
+}
+
+
+BoundingSphere BoundingSphere::fromPoints(const GLfloat* data, size_t nPoints, GLint dim, const AABB& box) {
+  if (!data || nPoints == 0 || dim <= 0 || box.isEmpty()) {
+    return BoundingSphere();
+  }
+  const glm::vec3 center = box.getCenter();
+  GLfloat maxDist2 = 0.0f;
+  for (size_t i = 0; i < nPoints; ++i) {
+    const GLfloat* p = data + i * dim;
+    const glm::vec3 diff = glm::vec3(p[0], dim > 1 ? p[1] : 0.0f, dim > 2 ? p[2] : 0.0f) - center;
+    maxDist2 = std::max(maxDist2, glm::dot(diff, diff));
+  }
+  return BoundingSphere(center, std::sqrt(maxDist2));
+}
+
+
+ViewFrustum::ViewFrustum() {
+  for (auto& plane : planes) {
+    plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  }
+}
+
+
+ViewFrustum::ViewFrustum(const glm::mat4& matrix) {
+  // extract planes from rows of matrix (cf. Gribb & Hartmann, 2001)
+  const glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+  const glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+  const glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+  const glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+  planes[0] = row3 + row0;    // left
+  planes[1] = row3 - row0;    // right
+  planes[2] = row3 + row1;    // bottom
+  planes[3] = row3 - row1;    // top
+  planes[4] = row3 + row2;    // near
+  planes[5] = row3 - row2;    // far
+  for (auto& plane : planes) {
+    const GLfloat length = glm::length(glm::vec3(plane));
+    if (length > 0.0f) {
+      plane /= length;
+    }
+  }
+}
+
+
+ViewFrustum ViewFrustum::transform(const glm::mat4& matrix, unsigned int planeMask) const {
+  ViewFrustum result(*this);
+  for (int i = 0; i < N_PLANES; ++i) {
+    if (planeMask & (1u << i)) {
+      result.planes[i] = planes[i] * matrix;
+    }
+  }
+  return result;
+}
+
+
+bool ViewFrustum::isOutside(const AABB& box, unsigned int& planeMask, unsigned char& lastPlane) const {
+  if (box.isEmpty()) {
+    return false;
+  }
+  const glm::vec3 center = box.getCenter();
+  const glm::vec3 halfExtent = box.getHalfExtent();
+
+  // start with the plane the box has been outside of last time (plane coherency)
+  int plane = lastPlane < N_PLANES ? lastPlane : 0;
+  for (int i = 0; i < N_PLANES; ++i, plane = (plane + 1 == N_PLANES) ? 0 : plane + 1) {
+    const unsigned int bit = 1u << plane;
+    if (!(planeMask & bit)) {
+      continue;
+    }
+    // signed distance of center and projected radius of box w.r.t. plane normal
+    const glm::vec3 normal(planes[plane]);
+    const GLfloat dist = glm::dot(normal, center) + planes[plane].w;
+    const GLfloat radius = glm::dot(glm::abs(normal), halfExtent);
+    if (dist + radius < 0.0f) {
+      lastPlane = static_cast<unsigned char>(plane);
+      return true;
+    }
+    if (dist - radius >= 0.0f) {
+      planeMask &= ~bit;
+    }
+  }
+  return false;
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,296 @@
+/**
+ * \file BoundingVolume.h
+ * \brief Bounding volumes to describe the spatial extent of geometry and sub-trees.
+ *
+ * Defines structs:
+ *   Ray, AABB, BoundingSphere, ViewFrustum
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BOUNDINGVOLUME_H_
+#define BOUNDINGVOLUME_H_
+
+#include <cfloat>
+#include <cstddef>
+#include "scg_glew.h"
+#include "scg_glm.h"
+
+namespace scg {
+
+
+/**
+ * \brief Ray with origin and direction, points are given by origin + t * direction.
+ */
+struct Ray {
+
+  Ray()
+      : origin(0.0f), direction(0.0f, 0.0f, -1.0f) {
+  }
+
+  Ray(const glm::vec3& origin0, const glm::vec3& direction0)
+      : origin(origin0), direction(direction0) {
+  }
+
+  glm::vec3 getPoint(GLfloat t) const {
+    return origin + t * direction;
+  }
+
+  /**
+   * Get ray transformed by the given (affine) matrix. The direction is not normalized,
+   * such that ray parameters t are preserved.
+   */
+  Ray transform(const glm::mat4& matrix) const {
+    return Ray(glm::vec3(matrix * glm::vec4(origin, 1.0f)), glm::vec3(matrix * glm::vec4(direction, 0.0f)));
+  }
+
+  glm::vec3 origin;
+  glm::vec3 direction;
+
+};
+
+
+/**
+ * \brief Axis-aligned bounding box, empty if min > max in any dimension.
+ */
+struct AABB {
+
+  /**
+   * Constructor, creates empty bounding box.
+   */
+  AABB();
+
+  AABB(const glm::vec3& min0, const glm::vec3& max0)
+      : min(min0), max(max0) {
+  }
+
+  /**
+   * Check if bounding box is empty, i.e., does not contain any point.
+   */
+  bool isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  glm::vec3 getCenter() const {
+    return 0.5f * (min + max);
+  }
+
+  /**
+   * Get half extent, i.e., half of the edge lengths.
+   */
+  glm::vec3 getHalfExtent() const {
+    return 0.5f * (max - min);
+  }
+
+  /**
+   * Get surface area, 0 if empty.
+   */
+  GLfloat getSurfaceArea() const {
+    if (isEmpty()) {
+      return 0.0f;
+    }
+    const glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+
+  /**
+   * Check if bounding box overlaps given bounding box.
+   */
+  bool overlaps(const AABB& box) const {
+    return min.x <= box.max.x && box.min.x <= max.x
+        && min.y <= box.max.y && box.min.y <= max.y
+        && min.z <= box.max.z && box.min.z <= max.z
+        && !isEmpty() && !box.isEmpty();
+  }
+
+  /**
+   * Get squared distance of point to bounding box, 0 if point is inside,
+   * FLT_MAX if box is empty.
+   */
+  GLfloat getDistance2(const glm::vec3& point) const {
+    if (isEmpty()) {
+      return FLT_MAX;
+    }
+    const glm::vec3 diff = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+    return glm::dot(diff, diff);
+  }
+
+  /**
+   * Extend bounding box to contain given point.
+   */
+  void extend(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+
+  /**
+   * Extend bounding box to contain given bounding box.
+   */
+  void extend(const AABB& box) {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+  }
+
+  /**
+   * Check if ray intersects bounding box within parameter range [0, tMax]
+   * (slab test).
+   * \param ray ray to be tested
+   * \param tMax maximum ray parameter
+   * \param tNear ray parameter of entry point (0 if origin is inside)
+   * \return true if ray intersects bounding box
+   */
+  bool intersect(const Ray& ray, GLfloat tMax, GLfloat& tNear) const;
+
+  /**
+   * Get bounding box of this bounding box transformed by the given (affine) matrix.
+   */
+  AABB transform(const glm::mat4& matrix) const;
+
+  /**
+   * Compute bounding box of xyz coordinates of an array of points, using SSE
+   * instructions if available.
+   * \param data point coordinates
+   * \param nPoints number of points
+   * \param dim number of coordinates per point, missing yz coordinates are set to 0
+   */
+  static AABB fromPoints(const GLfloat* data, size_t nPoints, GLint dim);
+
+  glm::vec3 min;
+  glm::vec3 max;
+
+};
+
+
+/**
+ * \brief Bounding sphere, empty if radius < 0.
+ */
+struct BoundingSphere {
+
+  /**
+   * Constructor, creates empty bounding sphere.
+   */
+  BoundingSphere()
+      : center(0.0f), radius(-1.0f) {
+  }
+
+  BoundingSphere(const glm::vec3& center0, GLfloat radius0)
+      : center(center0), radius(radius0) {
+  }
+
+  /**
+   * Create bounding sphere enclosing given bounding box.
+   */
+  explicit BoundingSphere(const AABB& box);
+
+  bool isEmpty() const {
+    return radius < 0.0f;
+  }
+
+  /**
+   * Extend bounding sphere to contain given bounding sphere.
+   */
+  void extend(const BoundingSphere& sphere);
+
+  /**
+   * Get bounding sphere of this bounding sphere transformed by the given (affine) matrix,
+   * using the maximum scale factor of the matrix.
+   */
+  BoundingSphere transform(const glm::mat4& matrix) const;
+
+  /**
+   * Compute bounding sphere of xyz coordinates of an array of points, centered at
+   * the center of the given bounding box of the points.
+   * \param data point coordinates
+   * \param nPoints number of points
+   * \param dim number of coordinates per point, missing yz coordinates are set to 0
+   * \param box bounding box of the points
+   */
+  static BoundingSphere fromPoints(const GLfloat* data, size_t nPoints, GLint dim, const AABB& box);
+
+  glm::vec3 center;
+  GLfloat radius;
+
+};
+
+
+/**
+ * \brief View frustum defined by six planes (left, right, bottom, top, near, far)
+ *    whose normal vectors point inwards.
+ *
+ * The planes are stored as vectors (a, b, c, d), such that a point p is inside the
+ * half-space of a plane if a * p.x + b * p.y + c * p.z + d >= 0.
+ */
+struct ViewFrustum {
+
+  static const int N_PLANES = 6;
+
+  /**
+   * Bit mask of all planes, cf. isOutside().
+   */
+  static const unsigned int ALL_PLANES = (1u << N_PLANES) - 1;
+
+  /**
+   * Constructor, creates frustum that contains all points.
+   */
+  ViewFrustum();
+
+  /**
+   * Constructor with matrix that maps the coordinate system of the frustum to clip
+   * coordinates, e.g., projection * view transformation for world coordinates.
+   */
+  explicit ViewFrustum(const glm::mat4& matrix);
+
+  /**
+   * Get frustum transformed into the source coordinate system of the given matrix,
+   * e.g., the local coordinate system of a Transformation. Only planes in the plane mask
+   * are transformed.
+   */
+  ViewFrustum transform(const glm::mat4& matrix, unsigned int planeMask = ALL_PLANES) const;
+
+  /**
+   * Check if bounding box is completely outside of the frustum, testing only planes
+   * in the plane mask.
+   * Empty bounding boxes are not considered to be outside.
+   * \param box bounding box to be tested
+   * \param planeMask planes to be tested, planes the box is completely inside of
+   *    are removed from the mask
+   * \param lastPlane index of the plane that is tested first (plane coherency),
+   *    updated to the plane the box is outside of
+   * \return true if box is completely outside of one of the planes
+   */
+  bool isOutside(const AABB& box, unsigned int& planeMask, unsigned char& lastPlane) const;
+
+  /**
+   * Check if bounding box is completely outside of the frustum.
+   */
+  bool isOutside(const AABB& box) const {
+    unsigned int planeMask = ALL_PLANES;
+    unsigned char lastPlane = 0;
+    return isOutside(box, planeMask, lastPlane);
+  }
+
+  glm::vec4 planes[N_PLANES];
+
+};
+
+
+} /* namespace scg */
+
+#endif /* BOUNDINGVOLUME_H_ */
@@ -22,6 +22,7 @@
  */
 
 #include "BumpMapCore.h"
+#include "RenderState.h"
 #include "scg_utilities.h"
 
 namespace scg {
@@ -34,6 +35,7 @@ BumpMapCore::BumpMapCore()
 
 BumpMapCore::~BumpMapCore() {
   if (isGLContextActive()) {
+    RenderState::glState.removeTexture(texNormal_);
     glDeleteTextures(1, &texNormal_);
   }
 }
@@ -46,11 +48,12 @@ BumpMapCoreSP BumpMapCore::create() {
 
 void BumpMapCore::setNormalMap(GLsizei width, GLsizei height, const unsigned char* rgbaData,
     GLenum wrapModeS, GLenum wrapModeT, GLenum minFilter, GLenum magFilter) {
-  glActiveTexture(GL_TEXTURE1);
+  RenderState::glState.activeTexture(1);
   assert(rgbaData);
+  RenderState::glState.removeTexture(texNormal_);
   glDeleteTextures(1, &texNormal_);
   glGenTextures(1, &texNormal_);
-  glBindTexture(GL_TEXTURE_2D, texNormal_);
+  RenderState::glState.bindTexture(GL_TEXTURE_2D, texNormal_);
   assert(glIsTexture(texNormal_));
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapModeS);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapModeT);
@@ -68,8 +71,8 @@ void BumpMapCore::setNormalMap(GLsizei width, GLsizei height, const unsigned cha
       minFilter == GL_LINEAR_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_LINEAR) {
     glGenerateMipmap(GL_TEXTURE_2D);
   }
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glActiveTexture(GL_TEXTURE0);
+  RenderState::glState.bindTexture(GL_TEXTURE_2D, 0);
+  RenderState::glState.activeTexture(0);
 
   assert(!checkGLError());
 }
@@ -81,21 +84,21 @@ void BumpMapCore::render(RenderState* renderState) {
 
   if (tex_ != 0) {
     // save texture binding
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texOld_);
+    texOld_ = static_cast<GLint>(renderState->glState.getTexture(GL_TEXTURE_2D));
 
     // bind texture
     assert(glIsTexture(tex_));
-    glBindTexture(GL_TEXTURE_2D, tex_);
+    renderState->glState.bindTexture(GL_TEXTURE_2D, tex_);
   }
 
   // save normal map binding
-  glActiveTexture(GL_TEXTURE1);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &texNormalOld_);
+  renderState->glState.activeTexture(1);
+  texNormalOld_ = static_cast<GLint>(renderState->glState.getTexture(GL_TEXTURE_2D));
 
   // bind normal map
   assert(glIsTexture(texNormal_));
-  glBindTexture(GL_TEXTURE_2D, texNormal_);
-  glActiveTexture(GL_TEXTURE0);
+  renderState->glState.bindTexture(GL_TEXTURE_2D, texNormal_);
+  renderState->glState.activeTexture(0);
 
   assert(!checkGLError());
 }
@@ -104,13 +107,13 @@ void BumpMapCore::render(RenderState* renderState) {
 void BumpMapCore::renderPost(RenderState* renderState) {
   // restore texture binding
   if (tex_ != 0) {
-    glBindTexture(GL_TEXTURE_2D, texOld_);
+    renderState->glState.bindTexture(GL_TEXTURE_2D, texOld_);
   }
 
   // restore normal map binding
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, texNormalOld_);
-  glActiveTexture(GL_TEXTURE0);
+  renderState->glState.activeTexture(1);
+  renderState->glState.bindTexture(GL_TEXTURE_2D, texNormalOld_);
+  renderState->glState.activeTexture(0);
 
   // restore texture matrix
   TextureCore::renderPost(renderState);
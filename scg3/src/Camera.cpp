@@ -33,7 +33,7 @@ namespace scg {
 
 
 Camera::Camera()
-    : projection_(1.0f), viewTransform_(1.0f), eyePt_(0.0f), centerDist_(1.0f),
+    : projection_(1.0f), viewTransform_(1.0f), viewTransformStamp_(0), eyePt_(0.0f), centerDist_(1.0f),
       orientation_(1.0f, glm::vec3(0.0f)), isDrawCenter_(false) {
   // initialize direction vectors (viewDir_, upDir_, rightDir_, centerPt_) and transformation matrix (matrix_)
   update_();
@@ -56,7 +56,12 @@ const glm::mat4& Camera::getProjection() {
 
 
 const glm::mat4& Camera::getViewTransform(RenderState* renderState) {
-  viewTransform_ = glm::inverse(renderState->modelViewStack.getMatrix());
+  // invert model-view matrix only if it has changed since the last call
+  const unsigned long stamp = renderState->modelViewStack.getStamp();
+  if (stamp != viewTransformStamp_) {
+    viewTransform_ = glm::inverse(renderState->modelViewStack.getMatrix());
+    viewTransformStamp_ = stamp;
+  }
   return viewTransform_;
 }
 
@@ -237,6 +242,7 @@ void Camera::update_() {
   // update transformation matrix and camera
   matrix_ = glm::mat4(glm::vec4(rightDir_, 0.f), glm::vec4(upDir_, 0.f),
       glm::vec4(-viewDir_, 0.f), glm::vec4(eyePt_, 1.f));
+  markMatrixModified_();
 }
 
 
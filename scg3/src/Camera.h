@@ -68,7 +68,9 @@ public:
   virtual const glm::mat4& getProjection();
 
   /**
-   * Get view transformation matrix according to camera position and orientation.
+   * Get view transformation matrix according to camera position and orientation,
+   * i.e., the inverse of the current model-view matrix. The inverse is only recomputed
+   * if the model-view matrix has changed (cf. MatrixStack::getStamp()).
    */
   virtual const glm::mat4& getViewTransform(RenderState* renderState);
 
@@ -272,6 +274,7 @@ protected:
 
   glm::mat4 projection_;
   glm::mat4 viewTransform_;
+  unsigned long viewTransformStamp_;  // model-view matrix stamp that viewTransform_ has been computed for
   glm::vec3 eyePt_;
   glm::vec3 centerPt_;
   GLfloat centerDist_;
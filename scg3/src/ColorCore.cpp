@@ -55,6 +55,16 @@ ColorCore* ColorCore::setColor(glm::vec4 color) {
 }
 
 
+bool ColorCore::isColorSet() const {
+  return isColorSet_;
+}
+
+
+const glm::vec4& ColorCore::getColor() const {
+  return color_;
+}
+
+
 ColorCore* ColorCore::setMatrix(glm::mat4 matrix) {
   matrix_ = matrix;
   return this;
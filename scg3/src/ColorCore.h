@@ -63,6 +63,16 @@ public:
    */
   ColorCore* setColor(glm::vec4 color);
 
+  /**
+   * Check if vertex color is set.
+   */
+  bool isColorSet() const;
+
+  /**
+   * Get vertex color, only valid if set (cf. isColorSet()).
+   */
+  const glm::vec4& getColor() const;
+
   /**
    * Set color matrix.
    * \return this pointer for method chaining
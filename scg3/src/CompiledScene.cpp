@@ -0,0 +1,441 @@
+/**
+ * \file CompiledScene.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <typeinfo>
+#include "Camera.h"
+#include "CompiledScene.h"
+#include "Composite.h"
+#include "Core.h"
+#include "Group.h"
+#include "Light.h"
+#include "LightPosition.h"
+#include "LOD.h"
+#include "RenderState.h"
+#include "Shape.h"
+#include "StaticBatch.h"
+#include "TransformAnimation.h"
+#include "Transformation.h"
+#include "Traverser.h"
+
+namespace scg {
+
+
+namespace {
+
+/**
+ * Replace elements [begin, end) of vector by all elements of source vector.
+ */
+template <typename Vector>
+void replaceRange(Vector& vec, size_t begin, size_t end, const Vector& source) {
+  const size_t oldCount = end - begin;
+  if (source.size() == oldCount) {
+    std::copy(source.begin(), source.end(), vec.begin() + begin);
+  }
+  else {
+    vec.erase(vec.begin() + begin, vec.begin() + end);
+    vec.insert(vec.begin() + begin, source.begin(), source.end());
+  }
+}
+
+} /* namespace */
+
+
+void CompiledScene::Records_::clear() {
+  nodes.clear();
+  types.clear();
+  parents.clear();
+  subtreeEnds.clear();
+  visible.clear();
+  coreBegins.clear();
+  coreCounts.clear();
+  cores.clear();
+}
+
+
+CompiledScene::CompiledScene(NodeSP root)
+    : root_(root), isCompiled_(false), syncVersion_(0) {
+  assert(root_);
+}
+
+
+CompiledScene::~CompiledScene() {
+}
+
+
+CompiledSceneSP CompiledScene::create(NodeSP root) {
+  return std::make_shared<CompiledScene>(root);
+}
+
+
+NodeSP CompiledScene::getRoot() const {
+  return root_;
+}
+
+
+size_t CompiledScene::getNNodes() const {
+  return records_.size();
+}
+
+
+void CompiledScene::sync() {
+  if (!isCompiled_ || (root_->isComposite_ &&
+      static_cast<Composite*>(root_.get())->structureVersion_ >= syncVersion_)) {
+    // compile whole scene graph
+    records_.clear();
+    compileSubtree_(root_.get(), -1, records_);
+    isCompiled_ = true;
+  }
+  else if (root_->subtreeVersion_ >= syncVersion_) {
+    // update modified records, skipping unmodified sub-trees
+    size_t i = 0;
+    while (i < records_.size()) {
+      Node* node = records_.nodes[i];
+      if (node->subtreeVersion_ < syncVersion_) {
+        i = records_.subtreeEnds[i];
+      }
+      else if (node->isComposite_ &&
+          static_cast<Composite*>(node)->structureVersion_ >= syncVersion_) {
+        i = recompileSubtree_(i);
+      }
+      else {
+        if (node->version_ >= syncVersion_) {
+          updateRecord_(i);
+        }
+        ++i;
+      }
+    }
+  }
+
+  // subsequent modifications will be synchronized by next call
+  syncVersion_ = Node::nextVersion();
+}
+
+
+CompiledNodeType CompiledScene::getType_(Node* node) {
+  // use fast paths only for node types whose rendering semantics are known
+  const std::type_info& type = typeid(*node);
+  if (type == typeid(Shape)) {
+    return CompiledNodeType::SHAPE;
+  }
+  if (type == typeid(Transformation) || type == typeid(TransformAnimation)) {
+    return CompiledNodeType::TRANSFORMATION;
+  }
+  if (type == typeid(Group)) {
+    return CompiledNodeType::GROUP;
+  }
+  if (type == typeid(Light)) {
+    return CompiledNodeType::LIGHT;
+  }
+  if (type == typeid(LightPosition)) {
+    return CompiledNodeType::LIGHT_POSITION;
+  }
+  if (type == typeid(LOD)) {
+    return CompiledNodeType::LOD;
+  }
+  if (dynamic_cast<Camera*>(node)) {
+    return CompiledNodeType::CAMERA;
+  }
+  return CompiledNodeType::OTHER;
+}
+
+
+void CompiledScene::appendRecord_(Node* node, int parent, Records_& records) {
+  const CompiledNodeType type = getType_(node);
+  records.nodes.push_back(node);
+  records.types.push_back(type);
+  records.parents.push_back(parent);
+  records.subtreeEnds.push_back(records.nodes.size());
+  records.visible.push_back(node->isVisible_);
+  records.coreBegins.push_back(records.cores.size());
+  if (type == CompiledNodeType::GROUP || type == CompiledNodeType::SHAPE) {
+    records.coreCounts.push_back(node->cores_.size());
+    for (auto& core : node->cores_) {
+      records.cores.push_back(core.get());
+    }
+  }
+  else {
+    records.coreCounts.push_back(0);
+  }
+}
+
+
+void CompiledScene::compileSubtree_(Node* node, int parent, Records_& records) {
+  assert(node);
+  const size_t rootIndex = records.size();
+  appendRecord_(node, parent, records);
+  if (!node->isComposite_) {
+    return;
+  }
+
+  // append records in depth-first pre-order, using an explicit stack
+  compileStack_.clear();
+  compileStack_.push_back(std::make_pair(rootIndex, static_cast<size_t>(0)));
+  while (!compileStack_.empty()) {
+    const size_t index = compileStack_.back().first;
+    const size_t nextChild = compileStack_.back().second;
+    const std::vector<NodeSP>& children =
+        static_cast<Composite*>(records.nodes[index])->getChildren();
+    if (nextChild < children.size()) {
+      ++compileStack_.back().second;
+      Node* child = children[nextChild].get();
+      const size_t childIndex = records.size();
+      appendRecord_(child, static_cast<int>(index), records);
+      if (child->isComposite_) {
+        compileStack_.push_back(std::make_pair(childIndex, static_cast<size_t>(0)));
+      }
+    }
+    else {
+      records.subtreeEnds[index] = records.size();
+      compileStack_.pop_back();
+    }
+  }
+}
+
+
+size_t CompiledScene::recompileSubtree_(size_t index) {
+  Records_& rec = records_;
+  Records_& temp = tempRecords_;
+  temp.clear();
+  compileSubtree_(rec.nodes[index], -1, temp);
+
+  // determine old record and core ranges, and size differences
+  const size_t oldEnd = rec.subtreeEnds[index];
+  const size_t coreBegin = rec.coreBegins[index];
+  const size_t oldCoreEnd = (oldEnd < rec.size()) ? rec.coreBegins[oldEnd] : rec.cores.size();
+  const size_t delta = temp.size() - (oldEnd - index);                  // modulo arithmetic
+  const size_t coreDelta = temp.cores.size() - (oldCoreEnd - coreBegin);
+
+  // shift indices of enclosing and following records
+  for (size_t i = 0; i < index; ++i) {
+    if (rec.subtreeEnds[i] > index) {
+      rec.subtreeEnds[i] += delta;
+    }
+  }
+  for (size_t i = oldEnd; i < rec.size(); ++i) {
+    rec.subtreeEnds[i] += delta;
+    if (rec.parents[i] >= static_cast<int>(oldEnd)) {
+      rec.parents[i] += static_cast<int>(delta);
+    }
+    rec.coreBegins[i] += coreDelta;
+  }
+
+  // relocate new records
+  temp.parents[0] = rec.parents[index];
+  for (size_t i = 0; i < temp.size(); ++i) {
+    if (i > 0) {
+      temp.parents[i] += static_cast<int>(index);
+    }
+    temp.subtreeEnds[i] += index;
+    temp.coreBegins[i] += coreBegin;
+  }
+
+  // replace old records
+  replaceRange(rec.nodes, index, oldEnd, temp.nodes);
+  replaceRange(rec.types, index, oldEnd, temp.types);
+  replaceRange(rec.parents, index, oldEnd, temp.parents);
+  replaceRange(rec.subtreeEnds, index, oldEnd, temp.subtreeEnds);
+  replaceRange(rec.visible, index, oldEnd, temp.visible);
+  replaceRange(rec.coreBegins, index, oldEnd, temp.coreBegins);
+  replaceRange(rec.coreCounts, index, oldEnd, temp.coreCounts);
+  replaceRange(rec.cores, coreBegin, oldCoreEnd, temp.cores);
+
+  return rec.subtreeEnds[index];
+}
+
+
+void CompiledScene::updateRecord_(size_t index) {
+  Records_& rec = records_;
+  Node* node = rec.nodes[index];
+  rec.visible[index] = node->isVisible_;
+  switch (rec.types[index]) {
+  case CompiledNodeType::GROUP:
+  case CompiledNodeType::SHAPE: {
+    // resize core range if cores have been added, shift following ranges
+    const size_t coreBegin = rec.coreBegins[index];
+    const size_t nCores = node->cores_.size();
+    if (nCores != rec.coreCounts[index]) {
+      const size_t coreDelta = nCores - rec.coreCounts[index];   // modulo arithmetic
+      rec.cores.insert(rec.cores.begin() + coreBegin + rec.coreCounts[index], coreDelta, nullptr);
+      rec.coreCounts[index] = nCores;
+      for (size_t i = index + 1; i < rec.size(); ++i) {
+        rec.coreBegins[i] += coreDelta;
+      }
+    }
+    for (size_t i = 0; i < nCores; ++i) {
+      rec.cores[coreBegin + i] = node->cores_[i].get();
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+
+void CompiledScene::processNode_(size_t index, RenderState* renderState, Traverser* traverser) {
+  const Records_& rec = records_;
+  Node* node = rec.nodes[index];
+  switch (rec.types[index]) {
+  case CompiledNodeType::TRANSFORMATION:
+    static_cast<Transformation*>(node)->Transformation::render(renderState);
+    break;
+  case CompiledNodeType::GROUP: {
+    Core* const* cores = rec.cores.data() + rec.coreBegins[index];
+    for (size_t i = 0, n = rec.coreCounts[index]; i < n; ++i) {
+      cores[i]->render(renderState);
+    }
+    StaticBatch* batch = static_cast<Group*>(node)->getBatch();
+    if (batch) {
+      batch->render(renderState);
+    }
+    break;
+  }
+  case CompiledNodeType::SHAPE: {
+    // process cores, then restore render state (material, texture, etc.)
+    Core* const* cores = rec.cores.data() + rec.coreBegins[index];
+    const size_t n = rec.coreCounts[index];
+    for (size_t i = 0; i < n; ++i) {
+      cores[i]->render(renderState);
+    }
+    for (size_t i = n; i > 0; --i) {
+      cores[i - 1]->renderPost(renderState);
+    }
+    break;
+  }
+  case CompiledNodeType::CAMERA:
+  case CompiledNodeType::LIGHT:
+    node->render(renderState);
+    break;
+  case CompiledNodeType::LOD:
+    static_cast<LOD*>(node)->selectLevel(renderState);
+    break;
+  case CompiledNodeType::OTHER:
+    node->accept(traverser);
+    break;
+  default:
+    break;
+  }
+}
+
+
+void CompiledScene::postProcessNode_(size_t index, RenderState* renderState,
+    Traverser* traverser) {
+  const Records_& rec = records_;
+  Node* node = rec.nodes[index];
+  switch (rec.types[index]) {
+  case CompiledNodeType::TRANSFORMATION:
+    renderState->modelViewStack.popMatrix();
+    break;
+  case CompiledNodeType::CAMERA:
+    static_cast<Camera*>(node)->renderPost(renderState);
+    break;
+  case CompiledNodeType::GROUP: {
+    Core* const* cores = rec.cores.data() + rec.coreBegins[index];
+    for (size_t i = rec.coreCounts[index]; i > 0; --i) {
+      cores[i - 1]->renderPost(renderState);
+    }
+    break;
+  }
+  case CompiledNodeType::LIGHT:
+    static_cast<Light*>(node)->renderPost(renderState);
+    break;
+  case CompiledNodeType::LOD:
+    // render previous level being faded out (if any)
+    static_cast<LOD*>(node)->acceptPost(traverser);
+    break;
+  case CompiledNodeType::OTHER:
+    static_cast<Composite*>(node)->acceptPost(traverser);
+    break;
+  default:
+    break;
+  }
+}
+
+
+void CompiledScene::render(RenderState* renderState, Traverser* traverser) {
+  assert(isCompiled_);
+  const Records_& rec = records_;
+  const size_t nRecords = rec.size();
+  walkStack_.clear();
+  lodJumps_.clear();
+  size_t i = 0;
+  while (i < nRecords) {
+    // skip levels of LOD nodes following the selected level
+    while (!lodJumps_.empty() && lodJumps_.back().first == i) {
+      i = lodJumps_.back().second;
+      lodJumps_.pop_back();
+    }
+    if (i >= nRecords) {
+      break;
+    }
+
+    // post-process composite nodes whose sub-trees have been completed
+    while (!walkStack_.empty() && rec.subtreeEnds[walkStack_.back()] <= i) {
+      postProcessNode_(walkStack_.back(), renderState, traverser);
+      walkStack_.pop_back();
+    }
+
+    // skip invisible sub-trees
+    if (!rec.visible[i]) {
+      i = rec.subtreeEnds[i];
+      continue;
+    }
+
+    processNode_(i, renderState, traverser);
+    if (rec.nodes[i]->isComposite_) {
+      walkStack_.push_back(i);
+    }
+    if (rec.types[i] == CompiledNodeType::LOD) {
+      // walk sub-tree of selected level only
+      const size_t level = static_cast<LOD*>(rec.nodes[i])->getLevel();
+      const size_t end = rec.subtreeEnds[i];
+      size_t child = i + 1;
+      for (size_t k = 0; k < level && child < end; ++k) {
+        child = rec.subtreeEnds[child];
+      }
+      if (child < end) {
+        lodJumps_.push_back(std::make_pair(rec.subtreeEnds[child], end));
+        i = child;
+      }
+      else {
+        i = end;
+      }
+      continue;
+    }
+    if (rec.types[i] == CompiledNodeType::GROUP
+        && static_cast<Group*>(rec.nodes[i])->isBatched()) {
+      // static batches have been rendered instead of the sub-tree
+      i = rec.subtreeEnds[i];
+      continue;
+    }
+    ++i;
+  }
+  while (!walkStack_.empty()) {
+    postProcessNode_(walkStack_.back(), renderState, traverser);
+    walkStack_.pop_back();
+  }
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,190 @@
+/**
+ * \file CompiledScene.h
+ * \brief A flattened representation of a scene graph to be processed by linear walks.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPILEDSCENE_H_
+#define COMPILEDSCENE_H_
+
+#include <utility>
+#include <vector>
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Node types distinguished by CompiledScene.
+ *
+ * Nodes of other types, including classes derived from Group, Shape, or
+ * Transformation, are processed by the fallback traverser via accept().
+ */
+enum class CompiledNodeType: unsigned char {
+  GROUP,
+  TRANSFORMATION,
+  CAMERA,
+  LIGHT,
+  LIGHT_POSITION,
+  LOD,
+  SHAPE,
+  OTHER
+};
+
+
+/**
+ * \brief A flattened representation of a scene graph to be processed by linear walks.
+ *
+ * The nodes of the sub-tree are stored as records in depth-first pre-order, using a
+ * structure-of-arrays layout: node pointer, node type, parent index, index one past the
+ * end of the sub-tree, visibility, and range of cores within a common core array.
+ * Transformations are applied via Transformation::render() to share the cached
+ * model-view matrices with the traversers.
+ * render() walks these arrays linearly and applies the same semantics as
+ * RenderTraverser, without virtual accept()/visit*() double dispatch
+ * for the standard node types. For LOD nodes, render() walks the selected level only.
+ *
+ * Modifications of the scene graph are detected by the version stamps of the nodes
+ * (cf. Node::getVersion()). sync() skips unmodified sub-trees, updates the records of
+ * modified nodes, and recompiles only those sub-trees whose child arrays have changed.
+ * sync() has to be called before walking the records whenever the scene graph may have
+ * been modified, since records of removed nodes are not valid anymore.
+ */
+class CompiledScene {
+
+public:
+
+  /**
+   * Constructor with root node of the scene graph to be compiled.
+   */
+  CompiledScene(NodeSP root);
+
+  /**
+   * Destructor.
+   */
+  virtual ~CompiledScene();
+
+  /**
+   * Create shared pointer.
+   */
+  static CompiledSceneSP create(NodeSP root);
+
+  /**
+   * Get root node.
+   */
+  NodeSP getRoot() const;
+
+  /**
+   * Get number of node records.
+   */
+  size_t getNNodes() const;
+
+  /**
+   * Synchronize node records with the scene graph, i.e., compile the scene graph
+   * on first call and update modified records afterwards.
+   */
+  void sync();
+
+  /**
+   * Walk node records to render the scene (cf. RenderTraverser).
+   * \param renderState render state to be used
+   * \param traverser traverser to be applied to nodes of type CompiledNodeType::OTHER
+   */
+  void render(RenderState* renderState, Traverser* traverser);
+
+protected:
+
+  /**
+   * \brief Node records in structure-of-arrays layout.
+   */
+  struct Records_ {
+    std::vector<Node*> nodes;
+    std::vector<CompiledNodeType> types;
+    std::vector<int> parents;         // -1 for root node
+    std::vector<size_t> subtreeEnds;  // index one past the end of the sub-tree
+    std::vector<unsigned char> visible;
+    std::vector<size_t> coreBegins;
+    std::vector<size_t> coreCounts;
+    std::vector<Core*> cores;
+
+    size_t size() const {
+      return nodes.size();
+    }
+
+    void clear();
+  };
+
+  /**
+   * Determine node type.
+   */
+  static CompiledNodeType getType_(Node* node);
+
+  /**
+   * Append record of given node without sub-tree.
+   */
+  static void appendRecord_(Node* node, int parent, Records_& records);
+
+  /**
+   * Compile sub-tree of given node (iteratively) and append its records.
+   * \param node root node of sub-tree
+   * \param parent parent index of root node
+   * \param records records to append to
+   */
+  void compileSubtree_(Node* node, int parent, Records_& records);
+
+  /**
+   * Replace records of sub-tree starting at given index by a recompiled sub-tree.
+   * \return index one past the end of the new sub-tree
+   */
+  size_t recompileSubtree_(size_t index);
+
+  /**
+   * Update record at given index from its node (visibility, cores).
+   */
+  void updateRecord_(size_t index);
+
+  /**
+   * Process node record before its sub-tree.
+   */
+  void processNode_(size_t index, RenderState* renderState, Traverser* traverser);
+
+  /**
+   * Process node record after its sub-tree.
+   */
+  void postProcessNode_(size_t index, RenderState* renderState, Traverser* traverser);
+
+protected:
+
+  NodeSP root_;
+  bool isCompiled_;
+  unsigned long syncVersion_;       // modifications with this or a later version are not synchronized yet
+  Records_ records_;
+  Records_ tempRecords_;            // reused for recompiled sub-trees
+  std::vector<std::pair<size_t, size_t> > compileStack_;  // record index and next child index
+  std::vector<size_t> walkStack_;   // indices of composite nodes to be post-processed
+  std::vector<std::pair<size_t, size_t> > lodJumps_;  // end of selected LOD level and end of LOD sub-tree
+
+};
+
+
+} /* namespace scg */
+
+#endif /* COMPILEDSCENE_H_ */
@@ -22,28 +22,72 @@
  */
 
 #include <cassert>
+#include <utility>
 #include "Composite.h"
 
 namespace scg {
 
 
-Composite::Composite() {
+Composite::Composite()
+    : nRemovedChildren_(0), structureVersion_(currentVersion_) {
+  isComposite_ = true;
 }
 
 
 Composite::~Composite() {
+  // release sub-tree iteratively to avoid deep recursion of destructors,
+  // descending only into nodes that are not referenced elsewhere
+  std::vector<NodeSP> nodes;
+  nodes.swap(children_);
+  for (auto& child : nodes) {
+    if (child && child->parent_ == this) {
+      child->parent_ = nullptr;
+    }
+  }
+  while (!nodes.empty()) {
+    NodeSP node = std::move(nodes.back());
+    nodes.pop_back();
+    if (node && node.use_count() == 1) {
+      Composite* composite = dynamic_cast<Composite*>(node.get());
+      if (composite) {
+        for (auto& child : composite->children_) {
+          if (child) {
+            child->parent_ = nullptr;
+            nodes.push_back(std::move(child));
+          }
+        }
+        composite->children_.clear();
+      }
+    }
+  }
 }
 
 
 void Composite::destroy() {
-  // destroy children (if any)
-  if (leftChild_) {
-    leftChild_->destroy();
+  // destroy sub-tree iteratively, using an explicit stack instead of recursion
+  std::vector<NodeSP> nodes;
+  nodes.swap(children_);
+  nRemovedChildren_ = 0;
+  markStructureModified_();
+  while (!nodes.empty()) {
+    NodeSP node = std::move(nodes.back());
+    nodes.pop_back();
+    if (node) {
+      // detach node, push its children (if any)
+      node->parent_ = nullptr;
+      Composite* composite = dynamic_cast<Composite*>(node.get());
+      if (composite) {
+        for (auto& child : composite->children_) {
+          nodes.push_back(std::move(child));
+        }
+        composite->children_.clear();
+        composite->nRemovedChildren_ = 0;
+      }
+      // destroy node without sub-tree
+      node->destroy();
+    }
   }
 
-  // clear smart pointer
-  leftChild_.reset();
-
   // destroy node
   Node::destroy();
 }
@@ -51,34 +95,75 @@ void Composite::destroy() {
 
 Composite* Composite::addChild(NodeSP child) {
   assert(child);
-  if (!leftChild_) {
-    // no left child yet, add left child
-    leftChild_ = child;
-    child->parent_ = this;
-  }
-  else {
-    // add new sibling to left child (recursively)
-    leftChild_->addSibling_(child);
+  assert(!child->parent_);
+  child->parent_ = this;
+  child->childIndex_ = children_.size();
+  children_.push_back(child);
+  child->markModified_();     // invalidate world matrices and bounds of sub-tree
+  markStructureModified_();
+  return this;
+}
+
+
+Composite* Composite::addChildren(const std::vector<NodeSP>& children) {
+  children_.reserve(children_.size() + children.size());
+  for (auto& child : children) {
+    addChild(child);
   }
   return this;
 }
 
 
+Composite* Composite::reserveChildren(size_t nChildren) {
+  children_.reserve(nChildren + nRemovedChildren_);
+  return this;
+}
+
+
+size_t Composite::getNChildren() const {
+  return children_.size() - nRemovedChildren_;
+}
+
+
+const std::vector<NodeSP>& Composite::getChildren() {
+  compactChildren_();
+  return children_;
+}
+
+
+unsigned long Composite::getStructureVersion() const {
+  return structureVersion_;
+}
+
+
 Composite* Composite::removeChild(Node* node, bool& result) {
   assert(node);
   result = false;
-  if (leftChild_) {
-    // check if node to remove is left child
-    if (node == leftChild_.get()) {
-      // remove left child
-      leftChild_ = node->rightSibling_;
-      node->rightSibling_ = nullptr;
-      result = true;
+  // find child via stored index
+  if (node->parent_ == this && node->childIndex_ < children_.size()
+      && children_[node->childIndex_].get() == node) {
+    const size_t index = node->childIndex_;
+    node->parent_ = nullptr;
+    node->childIndex_ = 0;
+    node->markModified_();    // invalidate world matrices and bounds of sub-tree
+    if (index + 1 == children_.size()) {
+      // last child: shrink array, including empty slots before it
+      children_.pop_back();
+      while (!children_.empty() && !children_.back()) {
+        children_.pop_back();
+        --nRemovedChildren_;
+      }
     }
     else {
-      // search siblings of left child for node to remove (recursively)
-      leftChild_->removeSibling_(node, result);
+      // leave empty slot, compact array if more than half of the slots are empty
+      children_[index].reset();
+      ++nRemovedChildren_;
+      if (2 * nRemovedChildren_ > children_.size()) {
+        compactChildren_();
+      }
     }
+    markStructureModified_();
+    result = true;
   }
   return this;
 }
@@ -90,25 +175,29 @@ Composite* Composite::removeChild(Node* node) {
 }
 
 
-void Composite::traverse(Traverser* traverser) {
-  // check if node and its sub-tree are visible
-  if (isVisible_) {
-    // process node
-    accept(traverser);
-
-    // recursively traverse children (if any)
-    if (leftChild_) {
-      leftChild_->traverse(traverser);
-    }
-
-    // post-process node
-    acceptPost(traverser);
+const AABB& Composite::getBoundingBox() {
+  if (subtreeVersion_ < boundsVersion_) {
+    return boundingBox_;
   }
 
-  // recursively traverse siblings (if any)
-  if (rightSibling_) {
-    rightSibling_->traverse(traverser);
+  // update invalid bounding volumes in post-order, using an explicit stack
+  const unsigned long version = nextVersion();
+  std::vector<std::pair<Composite*, size_t> > boundsStack;
+  boundsStack.push_back(std::make_pair(this, static_cast<size_t>(0)));
+  while (!boundsStack.empty()) {
+    Composite* node = boundsStack.back().first;
+    if (boundsStack.back().second < node->children_.size()) {
+      Node* child = node->children_[boundsStack.back().second++].get();
+      if (child && child->isComposite_ && child->subtreeVersion_ >= child->boundsVersion_) {
+        boundsStack.push_back(std::make_pair(static_cast<Composite*>(child), static_cast<size_t>(0)));
+      }
+    }
+    else {
+      node->updateBounds_(version);
+      boundsStack.pop_back();
+    }
   }
+  return boundingBox_;
 }
 
 
@@ -122,4 +211,56 @@ void Composite::renderPost(RenderState* renderState) {
 }
 
 
+void Composite::markStructureModified_() {
+  structureVersion_ = modificationVersion_();
+  markSubtreeModified_();
+}
+
+
+void Composite::updateBounds_(unsigned long version) {
+  AABB box;
+  BoundingSphere sphere;
+  for (auto& child : children_) {
+    if (child) {
+      box.extend(child->getBoundingBox());
+      sphere.extend(child->boundingSphere_);
+    }
+  }
+  transformBounds_(box, sphere);
+
+  // use sphere enclosing the bounding box if it is smaller
+  BoundingSphere boxSphere(box);
+  if (sphere.isEmpty() || boxSphere.radius < sphere.radius) {
+    sphere = boxSphere;
+  }
+  boundingBox_ = box;
+  boundingSphere_ = sphere;
+  boundsVersion_ = version;
+}
+
+
+void Composite::transformBounds_(AABB&, BoundingSphere&) const {
+  // do nothing by default
+}
+
+
+void Composite::compactChildren_() {
+  if (nRemovedChildren_ == 0) {
+    return;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < children_.size(); ++i) {
+    if (children_[i]) {
+      children_[i]->childIndex_ = count;
+      if (i != count) {
+        children_[count] = std::move(children_[i]);
+      }
+      ++count;
+    }
+  }
+  children_.resize(count);
+  nRemovedChildren_ = 0;
+}
+
+
 } /* namespace scg */
@@ -25,6 +25,7 @@
 #ifndef COMPOSITE_H_
 #define COMPOSITE_H_
 
+#include <vector>
 #include "Node.h"
 #include "scg_internals.h"
 
@@ -33,9 +34,18 @@ namespace scg {
 
 /**
  * \brief Base class for all composite nodes, i.e., nodes with children (composite pattern, abstract).
+ *
+ * The children are stored in a contiguous array in the order they have been added.
+ * Appending a child takes constant (amortized) time. Removing a child leaves an empty
+ * slot that is skipped by traversers; the array is compacted as soon as more than half
+ * of the slots are empty, such that removal takes constant (amortized) time as well.
  */
 class Composite: public Node {
 
+  friend class CompiledScene;
+  friend class StaticBatch;
+  friend class Traverser;
+
 public:
 
   /**
@@ -59,6 +69,36 @@ public:
    */
   Composite* addChild(NodeSP child);
 
+  /**
+   * Add children to composite node, reserving memory for all of them at once.
+   * \return this pointer for method chaining
+   */
+  Composite* addChildren(const std::vector<NodeSP>& children);
+
+  /**
+   * Reserve memory for the given total number of children, e.g., before
+   * adding a large number of children via addChild().
+   * \return this pointer for method chaining
+   */
+  Composite* reserveChildren(size_t nChildren);
+
+  /**
+   * Get number of children.
+   */
+  size_t getNChildren() const;
+
+  /**
+   * Get children in the order they have been added, compacting the child array
+   * if necessary.
+   */
+  const std::vector<NodeSP>& getChildren();
+
+  /**
+   * Get version stamp of the last modification of the child array, i.e.,
+   * the last time a child has been added or removed.
+   */
+  unsigned long getStructureVersion() const;
+
   /**
    * Remove child from composite node.
    * \param node pointer to node to be removed
@@ -74,9 +114,10 @@ public:
   Composite* removeChild(Node* node);
 
   /**
-   * Traverse node tree (depth-first, pre-order) with given traverser.
+   * Get axis-aligned bounding box of the sub-tree in the coordinate system of the
+   * parent node, recomputing invalid bounding volumes of the sub-tree iteratively.
    */
-  virtual void traverse(Traverser* traverser);
+  virtual const AABB& getBoundingBox();
 
   /**
    * Accept traverser after traversing sub-tree (visitor pattern).
@@ -90,7 +131,33 @@ public:
 
 protected:
 
-  NodeSP leftChild_;
+  /**
+   * Mark child array as modified, i.e., update version stamps of node and ancestors.
+   */
+  void markStructureModified_();
+
+  /**
+   * Remove empty slots from the child array and update the child indices.
+   */
+  void compactChildren_();
+
+  /**
+   * Recompute bounding volumes from the (valid) bounding volumes of the children.
+   * \param version version stamp to be assigned to the bounding volumes
+   */
+  void updateBounds_(unsigned long version);
+
+  /**
+   * Transform bounding volumes of the children into the coordinate system of the parent
+   * node, called by updateBounds_(). Does nothing by default.
+   */
+  virtual void transformBounds_(AABB& box, BoundingSphere& sphere) const;
+
+protected:
+
+  std::vector<NodeSP> children_;
+  size_t nRemovedChildren_;   // number of empty slots in children_
+  unsigned long structureVersion_;
 
 };
 
@@ -32,12 +32,13 @@ namespace scg {
 
 
 CubeMapCore::CubeMapCore()
-    : TextureCore() {
+    : TextureCore(), uniformProgram_(0) {
 }
 
 
 CubeMapCore::~CubeMapCore() {
   if (isGLContextActive()) {
+    RenderState::glState.removeTexture(tex_);
     glDeleteTextures(1, &tex_);
   }
 }
@@ -50,9 +51,10 @@ CubeMapCoreSP CubeMapCore::create() {
 
 void CubeMapCore::setCubeMap(GLsizei width, GLsizei height, const std::vector<unsigned char*>& rgbaData) {
   assert(rgbaData.size() == 6);
+  RenderState::glState.removeTexture(tex_);
   glDeleteTextures(1, &tex_);
   glGenTextures(1, &tex_);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, tex_);
+  RenderState::glState.bindTexture(GL_TEXTURE_CUBE_MAP, tex_);
   assert(glIsTexture(tex_));
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -75,7 +77,7 @@ void CubeMapCore::setCubeMap(GLsizei width, GLsizei height, const std::vector<un
     assert(rgbaData[i]);
     glTexImage2D(cubeMapTexNames[i], 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaData[i]);
   }
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+  RenderState::glState.bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
   assert(!checkGLError());
 }
@@ -86,19 +88,26 @@ void CubeMapCore::render(RenderState* renderState) {
   TextureCore::render(renderState);
 
   // save texture binding
-  glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &texOld_);
+  texOld_ = static_cast<GLint>(renderState->glState.getTexture(GL_TEXTURE_CUBE_MAP));
 
   // bind texture
   assert(glIsTexture(tex_));
-  glBindTexture(GL_TEXTURE_CUBE_MAP, tex_);
+  renderState->glState.bindTexture(GL_TEXTURE_CUBE_MAP, tex_);
 
   // pass inverse view matrix and skybox matrix (i.e., model-view-projection matrix
   // without camera translation) to shader program
+  // (look up uniform handles only when the shader program changes)
+  ShaderCore* shader = renderState->getShader();
+  if (shader->getProgram() != uniformProgram_) {
+    uniformProgram_ = shader->getProgram();
+    invViewMatrixUniform_ = shader->getUniformHandle("invViewMatrix");
+    skyboxMatrixUniform_ = shader->getUniformHandle("skyboxMatrix");
+  }
   glm::mat4 viewMatrix = renderState->getViewTransform();
-  renderState->getShader()->setUniformMatrix4fv("invViewMatrix", 1, glm::value_ptr(glm::inverse(viewMatrix)));
+  shader->setUniformMatrix4fv(invViewMatrixUniform_, 1, glm::value_ptr(glm::inverse(viewMatrix)));
   viewMatrix[3] = glm::vec4(0.f, 0.f, 0.f, 1.f);
   glm::mat4 skyboxMatrix = renderState->projectionStack.getMatrix() * viewMatrix * renderState->getModelMatrix();
-  renderState->getShader()->setUniformMatrix4fv("skyboxMatrix", 1, glm::value_ptr(skyboxMatrix));
+  shader->setUniformMatrix4fv(skyboxMatrixUniform_, 1, glm::value_ptr(skyboxMatrix));
 
   assert(!checkGLError());
 }
@@ -106,7 +115,7 @@ void CubeMapCore::render(RenderState* renderState) {
 
 void CubeMapCore::renderPost(RenderState* renderState) {
   // restore texture binding
-  glBindTexture(GL_TEXTURE_CUBE_MAP, texOld_);
+  renderState->glState.bindTexture(GL_TEXTURE_CUBE_MAP, texOld_);
 
   // restore texture matrix
   TextureCore::renderPost(renderState);
@@ -27,6 +27,7 @@
 
 #include <vector>
 #include "scg_internals.h"
+#include "ShaderCore.h"
 #include "TextureCore.h"
 
 namespace scg {
@@ -80,6 +81,12 @@ public:
    */
   virtual void renderPost(RenderState* renderState);
 
+protected:
+
+  GLuint uniformProgram_;                 // program of the uniform handles below
+  UniformHandle invViewMatrixUniform_;
+  UniformHandle skyboxMatrixUniform_;
+
 };
 
 
@@ -0,0 +1,264 @@
+/**
+ * \file CullingRenderTraverser.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Camera.h"
+#include "CullingRenderTraverser.h"
+#include "Group.h"
+#include "HardwareOcclusionCuller.h"
+#include "LOD.h"
+#include "Light.h"
+#include "Node.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "RenderState.h"
+#include "Shape.h"
+#include "StaticBatch.h"
+#include "Transformation.h"
+
+namespace scg {
+
+
+CullingRenderTraverser::CullingRenderTraverser(RenderState* renderState)
+    : RenderTraverser(renderState), visibleMark_(0), occlusionCuller_(nullptr),
+      hardwareOcclusionCuller_(nullptr), renderQueue_(nullptr), isImmediate_(false) {
+  isCullingEnabled_ = true;
+  frustumStack_.reserve(INITIAL_STACK_CAPACITY);
+  frustumStack_.push_back(ViewFrustum());
+}
+
+
+CullingRenderTraverser::~CullingRenderTraverser() {
+}
+
+
+bool CullingRenderTraverser::isCulling() const {
+  return isCullingEnabled_;
+}
+
+
+void CullingRenderTraverser::setCulling(bool isCulling) {
+  isCullingEnabled_ = isCulling;
+}
+
+
+const CullingStats& CullingRenderTraverser::getStats() const {
+  return stats_;
+}
+
+
+const ViewFrustum& CullingRenderTraverser::getFrustum() const {
+  return frustumStack_.front();
+}
+
+
+void CullingRenderTraverser::updateFrustum() {
+  frustumStack_.clear();
+  frustumStack_.push_back(ViewFrustum(renderState_->getProjection() * renderState_->getViewTransform()));
+  stats_ = CullingStats();
+  visibleMark_ = 0;
+}
+
+
+void CullingRenderTraverser::setVisibleShapes(const std::vector<Shape*>& shapes) {
+  // mark shapes and their ancestors, stop at nodes marked already
+  visibleMark_ = Node::nextVersion();
+  for (auto shape : shapes) {
+    for (Node* node = shape; node && node->cullMark_ != visibleMark_; node = node->parent_) {
+      node->cullMark_ = visibleMark_;
+    }
+  }
+}
+
+
+void CullingRenderTraverser::setOcclusionCuller(OcclusionCuller* occlusionCuller) {
+  occlusionCuller_ = occlusionCuller;
+}
+
+
+void CullingRenderTraverser::setHardwareOcclusionCuller(HardwareOcclusionCuller* hardwareOcclusionCuller) {
+  hardwareOcclusionCuller_ = hardwareOcclusionCuller;
+}
+
+
+void CullingRenderTraverser::setRenderQueue(RenderQueue* renderQueue) {
+  renderQueue_ = renderQueue;
+}
+
+
+void CullingRenderTraverser::visitShape(Shape* node) {
+  if (hardwareOcclusionCuller_) {
+    // occlusion query has to enclose the draw calls of the shape
+    if (isQueueing_()) {
+      renderQueue_->applyPath(renderState_);
+    }
+    hardwareOcclusionCuller_->beginShape(node);
+    RenderTraverser::visitShape(node);
+    hardwareOcclusionCuller_->endShape(node);
+    if (isQueueing_()) {
+      renderQueue_->applyPathPost(renderState_);
+    }
+  }
+  else if (isQueueing_()) {
+    renderQueue_->addShape(node, renderState_);
+  }
+  else {
+    RenderTraverser::visitShape(node);
+  }
+  ++stats_.nDrawn;
+}
+
+
+void CullingRenderTraverser::visitCamera(Camera* node) {
+  RenderTraverser::visitCamera(node);
+  pushFrustum_(node->getMatrix());
+}
+
+
+void CullingRenderTraverser::visitPostCamera(Camera* node) {
+  frustumStack_.pop_back();
+  RenderTraverser::visitPostCamera(node);
+}
+
+
+void CullingRenderTraverser::visitGroup(Group* node) {
+  if (isQueueing_()) {
+    renderQueue_->pushCores(node);
+  }
+  else {
+    node->render(renderState_);
+  }
+  StaticBatch* batch = node->getBatch();
+  if (batch) {
+    if (isQueueing_()) {
+      renderQueue_->applyPath(renderState_);
+    }
+    // planes that are not in the cull mask contain the whole group
+    batch->render(renderState_, frustumStack_.back(), isCullingEnabled_ ? cullMask_ : 0);
+    stats_.nDrawn += batch->getNDrawnObjects();
+    selectChild_(node->getNChildren());   // skip sub-tree
+    if (isQueueing_()) {
+      renderQueue_->applyPathPost(renderState_);
+    }
+  }
+}
+
+
+void CullingRenderTraverser::visitPostGroup(Group* node) {
+  if (isQueueing_()) {
+    renderQueue_->popCores();
+  }
+  else {
+    node->renderPost(renderState_);
+  }
+}
+
+
+void CullingRenderTraverser::visitPostLOD(LOD* node) {
+  if (isQueueing_() && node->getFadeLevel() < node->getNLevels()) {
+    renderQueue_->applyPath(renderState_);
+    isImmediate_ = true;
+    RenderTraverser::visitPostLOD(node);
+    isImmediate_ = false;
+    renderQueue_->applyPathPost(renderState_);
+  }
+  else {
+    RenderTraverser::visitPostLOD(node);
+  }
+}
+
+
+void CullingRenderTraverser::visitLight(Light* node) {
+  // shapes queued so far must not be lit by this light
+  if (isQueueing_()) {
+    renderQueue_->submit(renderState_);
+  }
+  RenderTraverser::visitLight(node);
+}
+
+
+void CullingRenderTraverser::visitPostLight(Light* node) {
+  if (isQueueing_()) {
+    renderQueue_->submit(renderState_);
+  }
+  RenderTraverser::visitPostLight(node);
+}
+
+
+void CullingRenderTraverser::visitTransformation(Transformation* node) {
+  RenderTraverser::visitTransformation(node);
+  pushFrustum_(node->getMatrix());
+}
+
+
+void CullingRenderTraverser::visitPostTransformation(Transformation* node) {
+  frustumStack_.pop_back();
+  RenderTraverser::visitPostTransformation(node);
+}
+
+
+bool CullingRenderTraverser::cull_(Node* node, unsigned int& cullMask) {
+  ++stats_.nTested;
+  if (visibleMark_ != 0) {
+    if (node->cullMark_ != visibleMark_ && !node->getBoundingBox().isEmpty()) {
+      ++stats_.nCulled;
+      return true;
+    }
+  }
+  else if (frustumStack_.back().isOutside(node->getBoundingBox(), cullMask, node->cullPlane_)) {
+    ++stats_.nCulled;
+    return true;
+  }
+  if (!node->isOccludee_) {
+    if (!occlusionCuller_ && !hardwareOcclusionCuller_) {
+      cullMask &= ~OCCLUSION_BIT;
+    }
+    return false;
+  }
+
+  // bounding box is given in the coordinate system of the current model-view matrix,
+  // occluders are not tested against themselves
+  if ((occlusionCuller_ && !node->isOccluder_
+      && occlusionCuller_->isOccluded(node->getBoundingBox(), renderState_->getMVPMatrix()))
+      || (hardwareOcclusionCuller_
+      && hardwareOcclusionCuller_->isOccluded(node, node->getBoundingBox(), renderState_))) {
+    ++stats_.nCulled;
+    ++stats_.nOccluded;
+    return true;
+  }
+  if (!hardwareOcclusionCuller_ && (!occlusionCuller_ || node->isOccluder_)) {
+    cullMask &= ~OCCLUSION_BIT;
+  }
+  return false;
+}
+
+
+void CullingRenderTraverser::pushFrustum_(const glm::mat4& matrix) {
+  // planes that are not in the cull mask will not be tested in the sub-tree
+  const ViewFrustum frustum = (isCullingEnabled_ && cullMask_ != 0) ?
+      frustumStack_.back().transform(matrix, cullMask_) : frustumStack_.back();
+  frustumStack_.push_back(frustum);
+}
+
+
+} /* namespace scg */
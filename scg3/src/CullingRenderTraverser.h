@@ -0,0 +1,260 @@
+/**
+ * \file CullingRenderTraverser.h
+ * \brief A traverser that renders the scene graph, skipping sub-trees outside of the
+ *    view frustum (visitor pattern).
+ *
+ * Defines struct:
+ *   CullingStats
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CULLINGRENDERTRAVERSER_H_
+#define CULLINGRENDERTRAVERSER_H_
+
+#include <vector>
+#include "BoundingVolume.h"
+#include "RenderTraverser.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Counters of CullingRenderTraverser for the last traversal.
+ */
+struct CullingStats {
+
+  CullingStats()
+      : nTested(0), nCulled(0), nOccluded(0), nDrawn(0) {
+  }
+
+  size_t nTested;   // number of nodes tested against the view frustum
+  size_t nCulled;   // number of nodes skipped together with their sub-trees
+  size_t nOccluded; // number of culled nodes found to be occluded (cf. OcclusionCuller,
+                    //   HardwareOcclusionCuller)
+  size_t nDrawn;    // number of shapes rendered
+
+};
+
+
+/**
+ * \brief A traverser that renders the scene graph, skipping sub-trees outside of the
+ *    view frustum (visitor pattern).
+ *
+ * The frustum planes are derived from the projection and view transformation of the
+ * render state (cf. RenderState::getProjection(), RenderState::getViewTransform()) by
+ * updateFrustum(), which has to be called before each traversal.
+ * Each node is tested by its bounding box in the coordinate system of its parent node
+ * (cf. Node::getBoundingBox()), such that the planes are transformed only when
+ * descending into a transformation instead of transforming the bounding boxes.
+ *
+ * Planes that a node is completely inside of are not tested again for its sub-tree,
+ * i.e., sub-trees completely inside of the frustum are rendered without further tests.
+ * The plane a node has been outside of is tested first in the next frame
+ * (plane coherency).
+ *
+ * Alternatively, the shapes to be rendered can be determined in advance by a spatial
+ * index (cf. setVisibleShapes()), such that nodes are culled by a mark instead.
+ *
+ * Nodes passing these tests can additionally be tested against the depth buffer of an
+ * OcclusionCuller (cf. setOcclusionCuller()), except for occluders and their sub-trees
+ * and nodes excluded as occludees (cf. Node::setOccluder(), Node::setOccludee()),
+ * and by hardware occlusion queries (cf. setHardwareOcclusionCuller()).
+ *
+ * If a RenderQueue is set (cf. setRenderQueue()), shapes are added to the queue instead
+ * of being rendered, and group cores are recorded on the path of the queue instead of
+ * being applied. The queue is submitted before and after the sub-tree of each light.
+ * Static batches, the fading level of LOD nodes, and shapes tested by hardware occlusion
+ * queries are rendered in graph order with the state of their path applied.
+ */
+class CullingRenderTraverser: public RenderTraverser {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  CullingRenderTraverser(RenderState* renderState);
+
+  /**
+   * Destructor.
+   */
+  virtual ~CullingRenderTraverser();
+
+  /**
+   * Check if frustum culling is enabled.
+   */
+  bool isCulling() const;
+
+  /**
+   * Enable or disable frustum culling, default: enabled.
+   */
+  void setCulling(bool isCulling);
+
+  /**
+   * Get counters of last traversal.
+   */
+  const CullingStats& getStats() const;
+
+  /**
+   * Get view frustum in world coordinates, as determined by updateFrustum().
+   */
+  const ViewFrustum& getFrustum() const;
+
+  /**
+   * Update view frustum from current projection and view transformation of the
+   * render state, reset counters, to be called before each traversal.
+   */
+  void updateFrustum();
+
+  /**
+   * Restrict the next traversal to the given shapes (e.g., found by BVH::queryFrustum())
+   * and their ancestors, instead of testing the nodes against the view frustum.
+   * Nodes with empty bounding boxes are not culled. Reset by updateFrustum().
+   */
+  void setVisibleShapes(const std::vector<Shape*>& shapes);
+
+  /**
+   * Set occlusion culler whose occluders have been rendered for the current frame
+   * (cf. OcclusionCuller::renderOccluders()), nullptr to disable occlusion culling
+   * (default).
+   */
+  void setOcclusionCuller(OcclusionCuller* occlusionCuller);
+
+  /**
+   * Set hardware occlusion culler to test nodes tagged as occludees by occlusion queries,
+   * nullptr to disable (default). HardwareOcclusionCuller::beginFrame() has to be called
+   * before each traversal.
+   */
+  void setHardwareOcclusionCuller(HardwareOcclusionCuller* hardwareOcclusionCuller);
+
+  /**
+   * Set render queue to collect shapes to be sorted by state and depth, nullptr to
+   * render shapes in graph order (default). RenderQueue::reset() has to be called before
+   * and RenderQueue::submit() after each traversal.
+   */
+  void setRenderQueue(RenderQueue* renderQueue);
+
+  // leaf nodes
+
+  /**
+   * Visit Shape node: render cores inside of an occlusion query or conditional rendering
+   * if required by the hardware occlusion culler, or add shape to the render queue,
+   * count shape.
+   */
+  virtual void visitShape(Shape* node);
+
+  // composite nodes
+
+  /**
+   * Visit Camera node: apply camera transformation, transform view frustum.
+   */
+  virtual void visitCamera(Camera* node);
+
+  /**
+   * Visit Camera node after traversing sub-tree: restore view frustum.
+   */
+  virtual void visitPostCamera(Camera* node);
+
+  /**
+   * Visit Group node: render cores (or append them to the path of the render queue),
+   * render static batches instead of traversing the sub-tree if the group is batched,
+   * testing the objects of the batches against the view frustum.
+   */
+  virtual void visitGroup(Group* node);
+
+  /**
+   * Visit Group node after traversing sub-tree: restore render state (or path of the
+   * render queue).
+   */
+  virtual void visitPostGroup(Group* node);
+
+  /**
+   * Visit LOD node after traversing selected level: blend fading level over selected
+   * level in graph order.
+   */
+  virtual void visitPostLOD(LOD* node);
+
+  /**
+   * Visit Light node: submit render queue, add light to render state.
+   */
+  virtual void visitLight(Light* node);
+
+  /**
+   * Visit Light node after traversing sub-tree: submit render queue, remove light
+   * from render state.
+   */
+  virtual void visitPostLight(Light* node);
+
+  /**
+   * Visit Transformation node: update model-view matrix, transform view frustum.
+   */
+  virtual void visitTransformation(Transformation* node);
+
+  /**
+   * Visit Transformation node after traversing sub-tree: restore model-view matrix
+   * and view frustum.
+   */
+  virtual void visitPostTransformation(Transformation* node);
+
+protected:
+
+  /**
+   * Cull mask bit that keeps cull_() being called for sub-trees completely inside of the
+   * view frustum while occlusion culling is enabled.
+   */
+  static const unsigned int OCCLUSION_BIT = 1u << 31;
+
+  /**
+   * Test bounding box of node against the planes in the cull mask, or check the mark
+   * of setVisibleShapes(), then test it against the occlusion cullers.
+   */
+  virtual bool cull_(Node* node, unsigned int& cullMask);
+
+  /**
+   * Push view frustum transformed into the local coordinate system of a transformation.
+   */
+  void pushFrustum_(const glm::mat4& matrix);
+
+  /**
+   * Check if shapes and group cores go to the render queue.
+   */
+  bool isQueueing_() const {
+    return renderQueue_ && !isImmediate_;
+  }
+
+protected:
+
+  std::vector<ViewFrustum> frustumStack_;
+  CullingStats stats_;
+  unsigned long visibleMark_;   // mark of visible shapes and their ancestors, 0 if not used
+  OcclusionCuller* occlusionCuller_;
+  HardwareOcclusionCuller* hardwareOcclusionCuller_;
+  RenderQueue* renderQueue_;
+  bool isImmediate_;            // rendering a sub-tree in graph order despite render queue
+
+};
+
+
+} /* namespace scg */
+
+#endif /* CULLINGRENDERTRAVERSER_H_ */
@@ -0,0 +1,254 @@
+/**
+ * \file GLStateCache.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLStateCache.h"
+
+namespace scg {
+
+
+namespace {
+
+const GLenum CAPS[] = { GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_POLYGON_OFFSET_FILL,
+    GL_SCISSOR_TEST, GL_STENCIL_TEST };
+
+}
+
+
+GLStateCache::GLStateCache() {
+  invalidate();
+}
+
+
+void GLStateCache::invalidate() {
+  program_ = UNKNOWN_;
+  vao_ = UNKNOWN_;
+  activeTexture_ = UNKNOWN_;
+  for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+    textures2D_[i] = UNKNOWN_;
+    texturesCubeMap_[i] = UNKNOWN_;
+  }
+  for (GLuint i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; ++i) {
+    uniformBuffers_[i] = UNKNOWN_;
+    uniformBufferOffsets_[i] = 0;
+    uniformBufferSizes_[i] = 0;
+  }
+  isViewportKnown_ = false;
+  for (int i = 0; i < N_CAPS_; ++i) {
+    caps_[i] = -1;
+  }
+  depthMask_ = -1;
+  isBlendFuncKnown_ = false;
+}
+
+
+GLuint GLStateCache::getTexture(GLenum target) {
+  GLuint* binding = getTextureBinding_(target);
+  if (binding && *binding != UNKNOWN_) {
+    return *binding;
+  }
+  const GLuint texture = static_cast<GLuint>(query_(
+      (target == GL_TEXTURE_CUBE_MAP) ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D));
+  if (binding) {
+    *binding = texture;
+  }
+  return texture;
+}
+
+
+GLuint GLStateCache::getUniformBuffer(GLuint bindingPoint) {
+  if (bindingPoint < MAX_UNIFORM_BUFFER_BINDINGS && uniformBuffers_[bindingPoint] != UNKNOWN_) {
+    return uniformBuffers_[bindingPoint];
+  }
+  GLint buffer;
+  glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, bindingPoint, &buffer);
+  ++stats_.nQueries;
+  if (bindingPoint < MAX_UNIFORM_BUFFER_BINDINGS) {
+    // the bound range is not queried, such that the next binding is always passed to OpenGL
+    uniformBuffers_[bindingPoint] = static_cast<GLuint>(buffer);
+    uniformBufferOffsets_[bindingPoint] = -1;
+    uniformBufferSizes_[bindingPoint] = 0;
+  }
+  return static_cast<GLuint>(buffer);
+}
+
+
+void GLStateCache::getViewport(GLint* viewport) {
+  if (!isViewportKnown_) {
+    glGetIntegerv(GL_VIEWPORT, viewport_);
+    ++stats_.nQueries;
+    isViewportKnown_ = true;
+  }
+  for (int i = 0; i < 4; ++i) {
+    viewport[i] = viewport_[i];
+  }
+}
+
+
+void GLStateCache::setViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (isViewportKnown_ && viewport_[0] == x && viewport_[1] == y
+      && viewport_[2] == width && viewport_[3] == height) {
+    ++stats_.nRedundant;
+    return;
+  }
+  glViewport(x, y, width, height);
+  viewport_[0] = x;
+  viewport_[1] = y;
+  viewport_[2] = width;
+  viewport_[3] = height;
+  isViewportKnown_ = true;
+  ++stats_.nCalls;
+}
+
+
+bool GLStateCache::isEnabled(GLenum cap) {
+  const int index = getCapIndex_(cap);
+  if (index < 0) {
+    ++stats_.nQueries;
+    return glIsEnabled(cap) == GL_TRUE;
+  }
+  if (caps_[index] < 0) {
+    caps_[index] = (glIsEnabled(cap) == GL_TRUE) ? 1 : 0;
+    ++stats_.nQueries;
+  }
+  return caps_[index] != 0;
+}
+
+
+void GLStateCache::setEnabled(GLenum cap, bool isEnabled) {
+  const int index = getCapIndex_(cap);
+  if (index >= 0 && caps_[index] == (isEnabled ? 1 : 0)) {
+    ++stats_.nRedundant;
+    return;
+  }
+  if (isEnabled) {
+    glEnable(cap);
+  }
+  else {
+    glDisable(cap);
+  }
+  if (index >= 0) {
+    caps_[index] = isEnabled ? 1 : 0;
+  }
+  ++stats_.nCalls;
+}
+
+
+bool GLStateCache::getDepthMask() {
+  if (depthMask_ < 0) {
+    depthMask_ = query_(GL_DEPTH_WRITEMASK) ? 1 : 0;
+  }
+  return depthMask_ != 0;
+}
+
+
+void GLStateCache::setDepthMask(bool isDepthMask) {
+  if (depthMask_ == (isDepthMask ? 1 : 0)) {
+    ++stats_.nRedundant;
+    return;
+  }
+  glDepthMask(isDepthMask ? GL_TRUE : GL_FALSE);
+  depthMask_ = isDepthMask ? 1 : 0;
+  ++stats_.nCalls;
+}
+
+
+void GLStateCache::getBlendFunc(GLint* blendFunc) {
+  if (!isBlendFuncKnown_) {
+    blendFunc_[0] = query_(GL_BLEND_SRC_RGB);
+    blendFunc_[1] = query_(GL_BLEND_DST_RGB);
+    blendFunc_[2] = query_(GL_BLEND_SRC_ALPHA);
+    blendFunc_[3] = query_(GL_BLEND_DST_ALPHA);
+    isBlendFuncKnown_ = true;
+  }
+  for (int i = 0; i < 4; ++i) {
+    blendFunc[i] = blendFunc_[i];
+  }
+}
+
+
+void GLStateCache::setBlendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+  const GLint blendFunc[4] = { static_cast<GLint>(srcRGB), static_cast<GLint>(dstRGB),
+      static_cast<GLint>(srcAlpha), static_cast<GLint>(dstAlpha) };
+  if (isBlendFuncKnown_ && blendFunc_[0] == blendFunc[0] && blendFunc_[1] == blendFunc[1]
+      && blendFunc_[2] == blendFunc[2] && blendFunc_[3] == blendFunc[3]) {
+    ++stats_.nRedundant;
+    return;
+  }
+  glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+  for (int i = 0; i < 4; ++i) {
+    blendFunc_[i] = blendFunc[i];
+  }
+  isBlendFuncKnown_ = true;
+  ++stats_.nCalls;
+}
+
+
+void GLStateCache::removeTexture(GLuint texture) {
+  // OpenGL reverts the bindings of a deleted texture to 0
+  for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+    if (textures2D_[i] == texture) {
+      textures2D_[i] = 0;
+    }
+    if (texturesCubeMap_[i] == texture) {
+      texturesCubeMap_[i] = 0;
+    }
+  }
+}
+
+
+void GLStateCache::removeVertexArray(GLuint vao) {
+  if (vao_ == vao) {
+    vao_ = 0;
+  }
+}
+
+
+void GLStateCache::removeBuffer(GLuint buffer) {
+  // indexed bindings of a deleted buffer are not reset consistently by all drivers
+  for (GLuint i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; ++i) {
+    if (uniformBuffers_[i] == buffer) {
+      uniformBuffers_[i] = UNKNOWN_;
+    }
+  }
+}
+
+
+GLint GLStateCache::query_(GLenum pname) {
+  GLint value;
+  glGetIntegerv(pname, &value);
+  ++stats_.nQueries;
+  return value;
+}
+
+
+int GLStateCache::getCapIndex_(GLenum cap) {
+  for (int i = 0; i < N_CAPS_; ++i) {
+    if (CAPS[i] == cap) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,337 @@
+/**
+ * \file GLStateCache.h
+ * \brief A shadow copy of OpenGL state that filters out redundant state changes
+ *    and avoids querying the driver (cf. RenderState::glState).
+ *
+ * Defines struct:
+ *   GLStateStats
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLSTATECACHE_H_
+#define GLSTATECACHE_H_
+
+#include "scg_glew.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Counters of GLStateCache since the last reset.
+ */
+struct GLStateStats {
+
+  GLStateStats()
+      : nCalls(0), nRedundant(0), nQueries(0) {
+  }
+
+  size_t nCalls;      // number of state changes passed to OpenGL
+  size_t nRedundant;  // number of state changes skipped because the state was set already
+  size_t nQueries;    // number of state queries (glGet) for unknown state
+
+};
+
+
+/**
+ * \brief A shadow copy of OpenGL state that filters out redundant state changes
+ *    and avoids querying the driver (cf. RenderState::glState).
+ *
+ * Tracks the current shader program, vertex array object, active texture unit,
+ * 2D and cube map textures per unit, uniform buffer binding points (including ranges), viewport,
+ * depth mask, blend function, and the enable flags GL_BLEND, GL_CULL_FACE,
+ * GL_DEPTH_TEST, GL_POLYGON_OFFSET_FILL, GL_SCISSOR_TEST, and GL_STENCIL_TEST.
+ *
+ * State is unknown initially and after invalidate(). Unknown state is queried from
+ * OpenGL once when it is read, and always set when it is changed. All state changes
+ * of scg3 go through this cache; applications that change the tracked state directly
+ * have to call invalidate() afterwards. Objects have to be passed to removeTexture(),
+ * removeVertexArray(), or removeBuffer() before they are deleted, since OpenGL
+ * resets bindings of deleted objects.
+ */
+class GLStateCache {
+
+public:
+
+  static const GLuint MAX_TEXTURE_UNITS = 16;
+  static const GLuint MAX_UNIFORM_BUFFER_BINDINGS = 16;
+
+  /**
+   * Constructor, all state unknown.
+   */
+  GLStateCache();
+
+  /**
+   * Mark all state as unknown, e.g., after OpenGL calls bypassing the cache.
+   */
+  void invalidate();
+
+  /**
+   * Get counters since last resetStats().
+   */
+  const GLStateStats& getStats() const {
+    return stats_;
+  }
+
+  /**
+   * Reset counters.
+   */
+  void resetStats() {
+    stats_ = GLStateStats();
+  }
+
+  /**
+   * Get current shader program.
+   */
+  GLuint getProgram() {
+    if (program_ == UNKNOWN_) {
+      program_ = static_cast<GLuint>(query_(GL_CURRENT_PROGRAM));
+    }
+    return program_;
+  }
+
+  /**
+   * Use shader program (cf. glUseProgram()).
+   */
+  void useProgram(GLuint program) {
+    if (program == program_) {
+      ++stats_.nRedundant;
+      return;
+    }
+    glUseProgram(program);
+    program_ = program;
+    ++stats_.nCalls;
+  }
+
+  /**
+   * Bind vertex array object (cf. glBindVertexArray()).
+   */
+  void bindVertexArray(GLuint vao) {
+    if (vao == vao_) {
+      ++stats_.nRedundant;
+      return;
+    }
+    glBindVertexArray(vao);
+    vao_ = vao;
+    ++stats_.nCalls;
+  }
+
+  /**
+   * Get active texture unit, starting at 0 for GL_TEXTURE0.
+   */
+  GLuint getActiveTexture() {
+    if (activeTexture_ == UNKNOWN_) {
+      activeTexture_ = static_cast<GLuint>(query_(GL_ACTIVE_TEXTURE)) - GL_TEXTURE0;
+    }
+    return activeTexture_;
+  }
+
+  /**
+   * Select active texture unit, starting at 0 for GL_TEXTURE0 (cf. glActiveTexture()).
+   */
+  void activeTexture(GLuint unit) {
+    if (unit == activeTexture_) {
+      ++stats_.nRedundant;
+      return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    activeTexture_ = unit;
+    ++stats_.nCalls;
+  }
+
+  /**
+   * Get texture bound to target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP of the active
+   * texture unit.
+   */
+  GLuint getTexture(GLenum target);
+
+  /**
+   * Bind texture to target of the active texture unit (cf. glBindTexture()).
+   * Only targets GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP are tracked.
+   */
+  void bindTexture(GLenum target, GLuint texture) {
+    GLuint* binding = getTextureBinding_(target);
+    if (binding && texture == *binding) {
+      ++stats_.nRedundant;
+      return;
+    }
+    glBindTexture(target, texture);
+    if (binding) {
+      *binding = texture;
+    }
+    ++stats_.nCalls;
+  }
+
+  /**
+   * Get buffer bound to uniform buffer binding point.
+   */
+  GLuint getUniformBuffer(GLuint bindingPoint);
+
+  /**
+   * Bind buffer to uniform buffer binding point (cf. glBindBufferBase()).
+   */
+  void bindUniformBuffer(GLuint bindingPoint, GLuint buffer) {
+    bindUniformBufferRange(bindingPoint, buffer, 0, 0);
+  }
+
+  /**
+   * Bind range of buffer to uniform buffer binding point (cf. glBindBufferRange()),
+   * size 0 binds the whole buffer (cf. glBindBufferBase()).
+   */
+  void bindUniformBufferRange(GLuint bindingPoint, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (bindingPoint < MAX_UNIFORM_BUFFER_BINDINGS && buffer == uniformBuffers_[bindingPoint]
+        && offset == uniformBufferOffsets_[bindingPoint] && size == uniformBufferSizes_[bindingPoint]) {
+      ++stats_.nRedundant;
+      return;
+    }
+    if (size == 0) {
+      glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+    }
+    else {
+      glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer, offset, size);
+    }
+    if (bindingPoint < MAX_UNIFORM_BUFFER_BINDINGS) {
+      uniformBuffers_[bindingPoint] = buffer;
+      uniformBufferOffsets_[bindingPoint] = offset;
+      uniformBufferSizes_[bindingPoint] = size;
+    }
+    ++stats_.nCalls;
+  }
+
+  /**
+   * Get viewport (x, y, width, height).
+   */
+  void getViewport(GLint* viewport);
+
+  /**
+   * Set viewport (cf. glViewport()).
+   */
+  void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+  /**
+   * Check if capability is enabled (cf. glIsEnabled()).
+   */
+  bool isEnabled(GLenum cap);
+
+  /**
+   * Enable or disable capability (cf. glEnable(), glDisable()).
+   */
+  void setEnabled(GLenum cap, bool isEnabled);
+
+  /**
+   * Get depth mask.
+   */
+  bool getDepthMask();
+
+  /**
+   * Enable or disable writing into the depth buffer (cf. glDepthMask()).
+   */
+  void setDepthMask(bool isDepthMask);
+
+  /**
+   * Get blend function (source RGB, destination RGB, source alpha, destination alpha).
+   */
+  void getBlendFunc(GLint* blendFunc);
+
+  /**
+   * Set blend function (cf. glBlendFuncSeparate()).
+   */
+  void setBlendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+
+  /**
+   * Set blend function for RGB and alpha (cf. glBlendFunc()).
+   */
+  void setBlendFunc(GLenum src, GLenum dst) {
+    setBlendFunc(src, dst, src, dst);
+  }
+
+  /**
+   * Reset bindings of texture to be deleted.
+   */
+  void removeTexture(GLuint texture);
+
+  /**
+   * Reset binding of vertex array object to be deleted.
+   */
+  void removeVertexArray(GLuint vao);
+
+  /**
+   * Reset bindings of buffer to be deleted.
+   */
+  void removeBuffer(GLuint buffer);
+
+protected:
+
+  static const GLuint UNKNOWN_ = 0xFFFFFFFFu;
+  static const int N_CAPS_ = 6;
+
+  /**
+   * Query integer state (glGetIntegerv()), count query.
+   */
+  GLint query_(GLenum pname);
+
+  /**
+   * Get cached binding of texture target of the active unit, null if not tracked.
+   */
+  GLuint* getTextureBinding_(GLenum target) {
+    const GLuint unit = getActiveTexture();
+    if (unit >= MAX_TEXTURE_UNITS) {
+      return nullptr;
+    }
+    switch (target) {
+    case GL_TEXTURE_2D:
+      return &textures2D_[unit];
+    case GL_TEXTURE_CUBE_MAP:
+      return &texturesCubeMap_[unit];
+    default:
+      return nullptr;
+    }
+  }
+
+  /**
+   * Get index of capability, -1 if not tracked.
+   */
+  static int getCapIndex_(GLenum cap);
+
+protected:
+
+  GLStateStats stats_;
+  GLuint program_;
+  GLuint vao_;
+  GLuint activeTexture_;
+  GLuint textures2D_[MAX_TEXTURE_UNITS];
+  GLuint texturesCubeMap_[MAX_TEXTURE_UNITS];
+  GLuint uniformBuffers_[MAX_UNIFORM_BUFFER_BINDINGS];
+  GLintptr uniformBufferOffsets_[MAX_UNIFORM_BUFFER_BINDINGS];
+  GLsizeiptr uniformBufferSizes_[MAX_UNIFORM_BUFFER_BINDINGS];   // 0: whole buffer
+  GLint viewport_[4];
+  bool isViewportKnown_;
+  signed char caps_[N_CAPS_];   // -1: unknown, 0: disabled, 1: enabled
+  signed char depthMask_;       // -1: unknown
+  GLint blendFunc_[4];
+  bool isBlendFuncKnown_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* GLSTATECACHE_H_ */
@@ -0,0 +1,379 @@
+/**
+ * \file GeometryArena.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+#include "GeometryArena.h"
+#include "RenderState.h"
+#include "scg_utilities.h"
+
+namespace scg {
+
+
+namespace {
+
+// Copy blocks (offset and size) from the buffer bound to GL_COPY_READ_BUFFER to the
+// beginning of the buffer bound to GL_COPY_WRITE_BUFFER, in the given order, and update
+// their offsets. Adjacent blocks are copied by a single call. Returns the total size.
+template <class TOffset>
+GLint compactBlocks(const std::vector<std::pair<TOffset*, GLsizei>>& blocks, GLsizeiptr unitSize) {
+  GLint size = 0;
+  GLint runSource = 0;
+  GLint runTarget = 0;
+  GLint runSize = 0;
+  auto copyRun = [&]() {
+    if (runSize > 0) {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, runSource * unitSize,
+          runTarget * unitSize, runSize * unitSize);
+    }
+    runSize = 0;
+  };
+  for (auto& block : blocks) {
+    const GLint offset = static_cast<GLint>(*block.first);
+    if (block.second > 0) {
+      if (runSize > 0 && runSource + runSize != offset) {
+        copyRun();
+      }
+      if (runSize == 0) {
+        runSource = offset;
+        runTarget = size;
+      }
+      runSize += block.second;
+    }
+    *block.first = static_cast<TOffset>(size);
+    size += block.second;
+  }
+  copyRun();
+  return size;
+}
+
+}
+
+
+GeometryArena::GeometryArena(GLsizei stride, const std::vector<VertexAttribute>& attributes,
+    GLsizei vertexCapacity, GLsizei indexCapacity)
+    : stride_(stride), attributes_(attributes), vao_(0), vbo_(0), ibo_(0), nRanges_(0) {
+  assert(stride > 0 && vertexCapacity > 0 && indexCapacity >= 0);
+  glGenVertexArrays(1, &vao_);
+  rebuild_(vertexCapacity, indexCapacity);
+}
+
+
+GeometryArena::~GeometryArena() {
+  if (isGLContextActive()) {
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ibo_);
+    RenderState::glState.removeVertexArray(vao_);
+    glDeleteVertexArrays(1, &vao_);
+  }
+}
+
+
+GeometryArenaSP GeometryArena::create(GLsizei stride, const std::vector<VertexAttribute>& attributes,
+    GLsizei vertexCapacity, GLsizei indexCapacity) {
+  return std::make_shared<GeometryArena>(stride, attributes, vertexCapacity, indexCapacity);
+}
+
+
+GLsizei GeometryArena::getStride() const {
+  return stride_;
+}
+
+
+const std::vector<VertexAttribute>& GeometryArena::getAttributes() const {
+  return attributes_;
+}
+
+
+bool GeometryArena::isCompatible(GLsizei stride, const std::vector<VertexAttribute>& attributes) const {
+  if (stride != stride_ || attributes.size() != attributes_.size()) {
+    return false;
+  }
+  for (auto& attribute : attributes) {
+    auto it = std::find_if(attributes_.begin(), attributes_.end(),
+        [&attribute](const VertexAttribute& a) {
+          return a.location == attribute.location && a.dim == attribute.dim
+              && a.offset == attribute.offset && a.format == attribute.format;
+        });
+    if (it == attributes_.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+GLuint GeometryArena::getVertexArray() const {
+  return vao_;
+}
+
+
+GLuint GeometryArena::getVertexBuffer() const {
+  return vbo_;
+}
+
+
+GLuint GeometryArena::getIndexBuffer() const {
+  return ibo_;
+}
+
+
+GLsizei GeometryArena::getVertexCapacity() const {
+  return freeVertices_.capacity;
+}
+
+
+GLsizei GeometryArena::getIndexCapacity() const {
+  return freeIndices_.capacity;
+}
+
+
+GLsizei GeometryArena::getNFreeVertices() const {
+  return freeVertices_.nFree;
+}
+
+
+GLsizei GeometryArena::getNFreeIndices() const {
+  return freeIndices_.nFree;
+}
+
+
+size_t GeometryArena::getNRanges() const {
+  return nRanges_;
+}
+
+
+float GeometryArena::getFragmentation() const {
+  auto fragmentation = [](const FreeList_& freeList) {
+    return (freeList.nFree > 0) ?
+        1.0f - static_cast<float>(getLargestBlock_(freeList)) / freeList.nFree : 0.0f;
+  };
+  return std::max(fragmentation(freeVertices_), fragmentation(freeIndices_));
+}
+
+
+size_t GeometryArena::allocate(GLsizei nVertices, GLsizei nIndices) {
+  assert(nVertices > 0 && nIndices >= 0);
+  GLint baseVertex = allocateBlock_(freeVertices_, nVertices);
+  GLint firstIndex = (nIndices > 0) ? allocateBlock_(freeIndices_, nIndices) : 0;
+  if (baseVertex < 0 || firstIndex < 0) {
+    // undo partial allocation, compact buffers and grow them by doubling if necessary
+    if (baseVertex >= 0) {
+      releaseBlock_(freeVertices_, baseVertex, nVertices);
+    }
+    if (nIndices > 0 && firstIndex >= 0) {
+      releaseBlock_(freeIndices_, firstIndex, nIndices);
+    }
+    const GLint nUsedVertices = freeVertices_.capacity - freeVertices_.nFree;
+    const GLint nUsedIndices = freeIndices_.capacity - freeIndices_.nFree;
+    GLint vertexCapacity = std::max(freeVertices_.capacity, 1);
+    while (vertexCapacity < nUsedVertices + nVertices) {
+      vertexCapacity *= 2;
+    }
+    GLint indexCapacity = std::max(freeIndices_.capacity, 1);
+    while (indexCapacity < nUsedIndices + nIndices) {
+      indexCapacity *= 2;
+    }
+    rebuild_(vertexCapacity, indexCapacity);
+    baseVertex = allocateBlock_(freeVertices_, nVertices);
+    firstIndex = (nIndices > 0) ? allocateBlock_(freeIndices_, nIndices) : 0;
+    assert(baseVertex >= 0 && firstIndex >= 0);
+  }
+
+  // reuse entry of a released range
+  const Range range = { baseVertex, nVertices, static_cast<GLuint>(firstIndex), nIndices };
+  size_t index;
+  if (!freeRanges_.empty()) {
+    index = freeRanges_.back();
+    freeRanges_.pop_back();
+    ranges_[index] = range;
+    isRangeUsed_[index] = true;
+  }
+  else {
+    index = ranges_.size();
+    ranges_.push_back(range);
+    isRangeUsed_.push_back(true);
+  }
+  ++nRanges_;
+  return index;
+}
+
+
+void GeometryArena::release(size_t range) {
+  assert(range < ranges_.size() && isRangeUsed_[range]);
+  const Range& r = ranges_[range];
+  releaseBlock_(freeVertices_, r.baseVertex, r.nVertices);
+  if (r.nIndices > 0) {
+    releaseBlock_(freeIndices_, static_cast<GLint>(r.firstIndex), r.nIndices);
+  }
+  isRangeUsed_[range] = false;
+  freeRanges_.push_back(range);
+  --nRanges_;
+}
+
+
+const GeometryArena::Range& GeometryArena::getRange(size_t range) const {
+  assert(range < ranges_.size() && isRangeUsed_[range]);
+  return ranges_[range];
+}
+
+
+void GeometryArena::defragment() {
+  rebuild_(freeVertices_.capacity, freeIndices_.capacity);
+}
+
+
+GLint GeometryArena::allocateBlock_(FreeList_& freeList, GLint size) {
+  assert(size > 0);
+  auto best = freeList.blocks.end();
+  for (auto it = freeList.blocks.begin(); it != freeList.blocks.end(); ++it) {
+    if (it->second >= size && (best == freeList.blocks.end() || it->second < best->second)) {
+      best = it;
+      if (it->second == size) {
+        break;
+      }
+    }
+  }
+  if (best == freeList.blocks.end()) {
+    return -1;
+  }
+  const GLint offset = best->first;
+  const GLint rest = best->second - size;
+  freeList.blocks.erase(best);
+  if (rest > 0) {
+    freeList.blocks[offset + size] = rest;
+  }
+  freeList.nFree -= size;
+  return offset;
+}
+
+
+void GeometryArena::releaseBlock_(FreeList_& freeList, GLint offset, GLint size) {
+  GLint begin = offset;
+  GLint end = offset + size;
+  auto next = freeList.blocks.lower_bound(offset);
+  assert(next == freeList.blocks.end() || next->first >= end);
+  if (next != freeList.blocks.begin()) {
+    auto prev = std::prev(next);
+    assert(prev->first + prev->second <= begin);
+    if (prev->first + prev->second == begin) {
+      begin = prev->first;
+      freeList.blocks.erase(prev);
+    }
+  }
+  if (next != freeList.blocks.end() && next->first == end) {
+    end += next->second;
+    freeList.blocks.erase(next);
+  }
+  freeList.blocks[begin] = end - begin;
+  freeList.nFree += size;
+}
+
+
+GLint GeometryArena::getLargestBlock_(const FreeList_& freeList) {
+  GLint result = 0;
+  for (auto& block : freeList.blocks) {
+    result = std::max(result, block.second);
+  }
+  return result;
+}
+
+
+void GeometryArena::rebuild_(GLint vertexCapacity, GLint indexCapacity) {
+  // allocated ranges in order of their vertex and element index offsets
+  std::vector<std::pair<GLint*, GLsizei>> vertexBlocks;
+  std::vector<std::pair<GLuint*, GLsizei>> indexBlocks;
+  for (size_t i = 0; i < ranges_.size(); ++i) {
+    if (isRangeUsed_[i]) {
+      vertexBlocks.push_back(std::make_pair(&ranges_[i].baseVertex, ranges_[i].nVertices));
+      indexBlocks.push_back(std::make_pair(&ranges_[i].firstIndex, ranges_[i].nIndices));
+    }
+  }
+  std::sort(vertexBlocks.begin(), vertexBlocks.end(),
+      [](const std::pair<GLint*, GLsizei>& a, const std::pair<GLint*, GLsizei>& b) {
+        return *a.first < *b.first;
+      });
+  std::sort(indexBlocks.begin(), indexBlocks.end(),
+      [](const std::pair<GLuint*, GLsizei>& a, const std::pair<GLuint*, GLsizei>& b) {
+        return *a.first < *b.first;
+      });
+
+  // copy ranges into new buffers, element indices stay relative to their base vertex
+  auto replace = [](GLuint& buffer, GLsizeiptr size) {
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    return newBuffer;
+  };
+  GLuint vbo = replace(vbo_, static_cast<GLsizeiptr>(vertexCapacity) * stride_);
+  const GLint nVertices = compactBlocks(vertexBlocks, stride_);
+  GLuint ibo = replace(ibo_, static_cast<GLsizeiptr>(indexCapacity) * sizeof(GLuint));
+  const GLint nIndices = compactBlocks(indexBlocks, sizeof(GLuint));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &vbo_);
+  glDeleteBuffers(1, &ibo_);
+  vbo_ = vbo;
+  ibo_ = ibo;
+
+  // free space forms a single block at the end
+  auto reset = [](FreeList_& freeList, GLint capacity, GLint size) {
+    assert(size <= capacity);
+    freeList.blocks.clear();
+    if (size < capacity) {
+      freeList.blocks[size] = capacity - size;
+    }
+    freeList.capacity = capacity;
+    freeList.nFree = capacity - size;
+  };
+  reset(freeVertices_, vertexCapacity, nVertices);
+  reset(freeIndices_, indexCapacity, nIndices);
+  bindVertexArray_();
+
+  assert(!checkGLError());
+}
+
+
+void GeometryArena::bindVertexArray_() {
+  RenderState::glState.bindVertexArray(vao_);
+  assert(glIsVertexArray(vao_));
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  for (auto& attribute : attributes_) {
+    glVertexAttribPointer(attribute.location,
+        VertexQuantizer::getNComponents(attribute.format, attribute.dim),
+        VertexQuantizer::getType(attribute.format), VertexQuantizer::isNormalized(attribute.format),
+        stride_, reinterpret_cast<const GLvoid*>(static_cast<GLintptr>(attribute.offset)));
+    glEnableVertexAttribArray(attribute.location);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // Note: GL_ELEMENT_ARRAY_BUFFER has to be kept bound
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+  RenderState::glState.bindVertexArray(0);
+}
+
+
+} /* namespace scg */
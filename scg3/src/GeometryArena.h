@@ -0,0 +1,251 @@
+/**
+ * \file GeometryArena.h
+ * \brief Shared vertex and element index buffers of many geometry cores with the same
+ *    vertex layout, sub-allocated by a free-list allocator (cf. GeometryCore::moveToArena()).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GEOMETRYARENA_H_
+#define GEOMETRYARENA_H_
+
+#include <map>
+#include <vector>
+#include "scg_glew.h"
+#include "GeometryCore.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Shared vertex and element index buffers of many geometry cores with the same
+ *    vertex layout, sub-allocated by a free-list allocator (cf. GeometryCore::moveToArena()).
+ *
+ * An arena consists of a single vertex buffer object with interleaved vertices of a fixed
+ * layout (stride and attributes, cf. GeometryCore::setVertexData()), an element index
+ * buffer, and a vertex array object. Geometry cores placed into the arena keep a range of
+ * vertices and element indices (cf. allocate(), getRange()) and are drawn from the shared
+ * vertex array object with base-vertex draw calls (glDrawElementsBaseVertex()), since
+ * their element indices remain relative to their first vertex. Thus, consecutive draws
+ * of geometry cores of the same arena do not switch vertex array objects, and the ranges
+ * can be drawn by a single multi-draw call.
+ *
+ * Vertices and element indices are allocated separately from a list of free blocks
+ * (best fit), released blocks are merged with their free neighbors. If an allocation
+ * does not fit into a free block, the buffers are rebuilt: the ranges are compacted to
+ * the beginning of new buffer objects on the GPU (glCopyBufferSubData()), which grow by
+ * doubling if necessary. defragment() compacts the buffers on demand, e.g., when
+ * getFragmentation() reports that the free space is scattered over many small blocks.
+ * Range indices stay valid when the buffers are rebuilt, buffer objects do not.
+ */
+class GeometryArena {
+
+public:
+
+  /**
+   * \brief Vertex and element index range of a geometry core within the arena.
+   */
+  struct Range {
+    GLint baseVertex;       // index of first vertex
+    GLsizei nVertices;
+    GLuint firstIndex;      // index of first element index
+    GLsizei nIndices;
+  };
+
+  /**
+   * Default initial number of vertices.
+   */
+  static const GLsizei DEFAULT_VERTEX_CAPACITY = 65536;
+
+  /**
+   * Default initial number of element indices.
+   */
+  static const GLsizei DEFAULT_INDEX_CAPACITY = 196608;
+
+  /**
+   * Constructor, to be called with an active OpenGL context.
+   * \param stride size of a vertex in bytes
+   * \param attributes attributes of a vertex
+   * \param vertexCapacity initial number of vertices
+   * \param indexCapacity initial number of element indices
+   */
+  GeometryArena(GLsizei stride, const std::vector<VertexAttribute>& attributes,
+      GLsizei vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+      GLsizei indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+  /**
+   * Destructor.
+   */
+  virtual ~GeometryArena();
+
+  /**
+   * Create shared pointer.
+   */
+  static GeometryArenaSP create(GLsizei stride, const std::vector<VertexAttribute>& attributes,
+      GLsizei vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+      GLsizei indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+  /**
+   * Get size of a vertex in bytes.
+   */
+  GLsizei getStride() const;
+
+  /**
+   * Get attributes of a vertex.
+   */
+  const std::vector<VertexAttribute>& getAttributes() const;
+
+  /**
+   * Check if interleaved vertices of the given layout can be placed into the arena,
+   * i.e., if the stride and the attributes match in any order.
+   */
+  bool isCompatible(GLsizei stride, const std::vector<VertexAttribute>& attributes) const;
+
+  /**
+   * Get vertex array object, binding all vertex attributes and the element index buffer.
+   */
+  GLuint getVertexArray() const;
+
+  /**
+   * Get vertex buffer object, replaced whenever the buffers are rebuilt.
+   */
+  GLuint getVertexBuffer() const;
+
+  /**
+   * Get element index buffer object, replaced whenever the buffers are rebuilt.
+   */
+  GLuint getIndexBuffer() const;
+
+  /**
+   * Get number of vertices the vertex buffer object can hold.
+   */
+  GLsizei getVertexCapacity() const;
+
+  /**
+   * Get number of element indices the element index buffer object can hold.
+   */
+  GLsizei getIndexCapacity() const;
+
+  /**
+   * Get number of vertices that are not allocated.
+   */
+  GLsizei getNFreeVertices() const;
+
+  /**
+   * Get number of element indices that are not allocated.
+   */
+  GLsizei getNFreeIndices() const;
+
+  /**
+   * Get number of allocated ranges.
+   */
+  size_t getNRanges() const;
+
+  /**
+   * Get fragmentation of the free space, i.e., 1 - (largest free block) / (free space)
+   * of the vertices or element indices, whichever is larger; 0 if the free space is
+   * contiguous.
+   */
+  float getFragmentation() const;
+
+  /**
+   * Allocate ranges of vertices and element indices, rebuilding the buffers if there is
+   * no free block large enough.
+   * \param nVertices number of vertices
+   * \param nIndices number of element indices, may be 0
+   * \return index of the range (cf. getRange())
+   */
+  size_t allocate(GLsizei nVertices, GLsizei nIndices);
+
+  /**
+   * Release range allocated by allocate().
+   */
+  void release(size_t range);
+
+  /**
+   * Get allocated range. The offsets may change whenever the buffers are rebuilt.
+   */
+  const Range& getRange(size_t range) const;
+
+  /**
+   * Compact all ranges to the beginning of the buffers, such that the free space forms
+   * a single block at their end.
+   */
+  void defragment();
+
+protected:
+
+  /**
+   * \brief Free blocks of a buffer, in units of vertices or element indices.
+   */
+  struct FreeList_ {
+    std::map<GLint, GLint> blocks;    // size per offset, without adjacent blocks
+    GLint capacity;
+    GLint nFree;
+  };
+
+  /**
+   * Allocate block from free list (best fit).
+   * \return offset of the block, -1 if there is no free block large enough
+   */
+  static GLint allocateBlock_(FreeList_& freeList, GLint size);
+
+  /**
+   * Return block to free list, merging it with adjacent free blocks.
+   */
+  static void releaseBlock_(FreeList_& freeList, GLint offset, GLint size);
+
+  /**
+   * Get size of the largest free block.
+   */
+  static GLint getLargestBlock_(const FreeList_& freeList);
+
+  /**
+   * Replace buffer objects by new ones of the given capacities and copy the allocated
+   * ranges to their beginning, in the order of their offsets.
+   */
+  void rebuild_(GLint vertexCapacity, GLint indexCapacity);
+
+  /**
+   * Set vertex attribute and element index bindings of the vertex array object.
+   */
+  void bindVertexArray_();
+
+protected:
+
+  GLsizei stride_;
+  std::vector<VertexAttribute> attributes_;
+  GLuint vao_;
+  GLuint vbo_;
+  GLuint ibo_;
+  FreeList_ freeVertices_;
+  FreeList_ freeIndices_;
+  std::vector<Range> ranges_;
+  std::vector<bool> isRangeUsed_;
+  std::vector<size_t> freeRanges_;    // unused entries of ranges_
+  size_t nRanges_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* GEOMETRYARENA_H_ */
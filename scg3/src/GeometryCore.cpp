@@ -21,29 +21,39 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include "GeometryArena.h"
 #include "GeometryCore.h"
+#include "TriangleBVH.h"
 #include "RenderState.h"
 #include "scg_utilities.h"
 
 namespace scg {
 
 
+namespace {
+
+// byte offsets of element index ranges, reused by GeometryCore::renderRanges()
+std::vector<const GLvoid*> rangeOffsets;
+
+// first vertices or base vertices of ranges within a geometry arena, reused by
+// GeometryCore::renderRanges()
+std::vector<GLint> rangeVertices;
+
+} /* namespace */
+
+
+bool GeometryCore::isDefaultPickable_ = false;
+unsigned long GeometryCore::nextDataVersion_ = 0;
+
+
 GeometryCore::GeometryCore(GLenum primitiveType, DrawMode drawMode)
-    : primitiveType_(primitiveType), drawMode_(drawMode), vao_(0),
-      vboIndex_(0), nElements_(0) {
-  switch(drawMode_) {
-  case DrawMode::ARRAYS:
-    drawFunc_ = std::bind(&glDrawArrays, std::placeholders::_1, 0, std::placeholders::_2);
-    break;
-  case DrawMode::ELEMENTS:
-    drawFunc_ = std::bind(&glDrawElements, std::placeholders::_1, std::placeholders::_2,
-        GL_UNSIGNED_INT, static_cast<const GLvoid*>(nullptr));
-    break;
-  default:
-    assert(!"Unknown drawMode [GeometryCore::GeometryCore()]");
-    break;
-  }
+    : primitiveType_(primitiveType), drawMode_(drawMode), vao_(0), positionVao_(0),
+      positionVbo_(0), vboIndex_(0), nElements_(0), arenaRange_(0),
+      isPickable_(isDefaultPickable_), dataVersion_(++nextDataVersion_) {
+  updateDrawFunc_();
   glGenVertexArrays(1, &vao_);
 
   assert(!checkGLError());
@@ -52,10 +62,9 @@ GeometryCore::GeometryCore(GLenum primitiveType, DrawMode drawMode)
 
 GeometryCore::~GeometryCore() {
   if (isGLContextActive()) {
-    for (auto vbo : vboAttributes_) {
-      glDeleteBuffers(1, &vbo);
-    }
+    clearAttributes_();
     glDeleteBuffers(1, &vboIndex_);
+    RenderState::glState.removeVertexArray(vao_);
     glDeleteVertexArrays(1, &vao_);
   }
 }
@@ -66,46 +75,350 @@ GeometryCoreSP GeometryCore::create(GLenum primitiveType, DrawMode drawMode) {
 }
 
 
+GLenum GeometryCore::getPrimitiveType() const {
+  return primitiveType_;
+}
+
+
+DrawMode GeometryCore::getDrawMode() const {
+  return drawMode_;
+}
+
+
+GLsizei GeometryCore::getNElements() const {
+  return nElements_;
+}
+
+
+const std::vector<GLuint>& GeometryCore::getAttributeLocations() const {
+  return attributeLocations_;
+}
+
+
+bool GeometryCore::getAttributeData(GLuint location, std::vector<GLfloat>& data, GLint& dim) const {
+  for (size_t i = 0; i < attributeLocations_.size(); ++i) {
+    if (attributeLocations_[i] == location) {
+      std::vector<GLubyte> bytes;
+      GLintptr bufferOffset = 0;
+      GLsizei nBufferVertices = 0;
+      const GLuint buffer = getVertexBuffer_(i, bufferOffset, nBufferVertices);
+      readBuffer_(buffer, bufferOffset, arena_ ?
+          static_cast<GLsizeiptr>(nBufferVertices) * attributeStrides_[i] : -1, bytes);
+      // gather values of interleaved vertices, converted from their vertex format
+      dim = attributeDims_[i];
+      const size_t valueSize = VertexQuantizer::getSize(attributeFormats_[i], dim);
+      const size_t stride = attributeStrides_[i];
+      const size_t offset = attributeOffsets_[i];
+      const size_t nVertices = (bytes.size() >= offset + valueSize) ?
+          (bytes.size() - offset - valueSize) / stride + 1 : 0;
+      data.resize(nVertices * dim);
+      if (nVertices > 0) {
+        VertexQuantizer::dequantize(attributeFormats_[i], bytes.data() + offset,
+            static_cast<GLsizei>(stride), dim, nVertices, data.data());
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+
+VertexFormat GeometryCore::getAttributeFormat(GLuint location) const {
+  for (size_t i = 0; i < attributeLocations_.size(); ++i) {
+    if (attributeLocations_[i] == location) {
+      return attributeFormats_[i];
+    }
+  }
+  return VertexFormat::FLOAT;
+}
+
+
+bool GeometryCore::getElementIndexData(std::vector<GLuint>& data) const {
+  GLintptr offset = 0;
+  GLsizei nIndices = 0;
+  const GLuint buffer = getIndexBuffer_(offset, nIndices);
+  if (!buffer) {
+    return false;
+  }
+  std::vector<GLubyte> bytes;
+  readBuffer_(buffer, offset, static_cast<GLsizeiptr>(nIndices) * sizeof(GLuint), bytes);
+  data.resize(bytes.size() / sizeof(GLuint));
+  if (!data.empty()) {
+    memcpy(data.data(), bytes.data(), data.size() * sizeof(GLuint));
+  }
+  return true;
+}
+
+
 GeometryCore* GeometryCore::addAttributeData(GLuint location, const GLfloat* data, GLsizeiptr size, GLint dim, GLenum usage) {
-  glBindVertexArray(vao_);
-  assert(glIsVertexArray(vao_));
+  leaveArena_();
   GLuint vbo = 0;
   glGenBuffers(1, &vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   assert(glIsBuffer(vbo));
-  vboAttributes_.push_back(vbo);
   glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  addAttribute_(location, vbo, dim, dim * sizeof(GLfloat), 0, VertexFormat::FLOAT);
+  dataVersion_ = ++nextDataVersion_;
   if (drawMode_ == DrawMode::ARRAYS && nElements_ == 0) {
     nElements_ = size / (dim * sizeof(GLfloat));
   }
-  glVertexAttribPointer(location, dim, GL_FLOAT, GL_FALSE, 0, static_cast<const GLvoid*>(0));
-  glEnableVertexAttribArray(location);
+  if (location == OGLConstants::VERTEX.location && data) {
+    updatePositions_(data, size / (dim * sizeof(GLfloat)), dim);
+  }
+
+  assert(!checkGLError());
+  return this;
+}
+
+
+GeometryCore* GeometryCore::setVertexData(const GLvoid* data, GLsizeiptr size, GLsizei stride,
+    const std::vector<VertexAttribute>& attributes, GLenum usage, bool hasPositionStream) {
+  assert(stride > 0);
+  leaveArena_();
+  clearAttributes_();
+  const size_t nVertices = size / stride;
+
+  // single VBO shared by all attributes
+  GLuint vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  assert(glIsBuffer(vbo));
+  glBufferData(GL_ARRAY_BUFFER, size, data, usage);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  for (auto& attribute : attributes) {
+    assert(attribute.offset + VertexQuantizer::getSize(attribute.format, attribute.dim) <= stride);
+    addAttribute_(attribute.location, vbo, attribute.dim, stride, attribute.offset, attribute.format);
+  }
+  dataVersion_ = ++nextDataVersion_;
+  if (drawMode_ == DrawMode::ARRAYS) {
+    nElements_ = static_cast<GLsizei>(nVertices);
+  }
+
+  // gather positions for bounding volumes, picking, and position stream
+  for (auto& attribute : attributes) {
+    if (attribute.location == OGLConstants::VERTEX.location && data) {
+      const GLubyte* bytes = static_cast<const GLubyte*>(data) + attribute.offset;
+      std::vector<GLfloat> positions(nVertices * attribute.dim);
+      VertexQuantizer::dequantize(attribute.format, bytes, stride, attribute.dim, nVertices,
+          positions.data());
+      updatePositions_(positions.data(), nVertices, attribute.dim);
+      if (hasPositionStream) {
+        // positions in their vertex format without the other attributes
+        const GLsizei size = VertexQuantizer::getSize(attribute.format, attribute.dim);
+        std::vector<GLubyte> positionData(nVertices * size);
+        for (size_t i = 0; i < nVertices; ++i) {
+          memcpy(positionData.data() + i * size, bytes + i * stride, size);
+        }
+        glGenVertexArrays(1, &positionVao_);
+        glGenBuffers(1, &positionVbo_);
+        RenderState::glState.bindVertexArray(positionVao_);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVbo_);
+        glBufferData(GL_ARRAY_BUFFER, positionData.size(), positionData.data(), usage);
+        glVertexAttribPointer(attribute.location,
+            VertexQuantizer::getNComponents(attribute.format, attribute.dim),
+            VertexQuantizer::getType(attribute.format), VertexQuantizer::isNormalized(attribute.format),
+            0, static_cast<const GLvoid*>(0));
+        glEnableVertexAttribArray(attribute.location);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // Note: GL_ELEMENT_ARRAY_BUFFER has to be kept bound
+        if (vboIndex_) {
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndex_);
+        }
+        RenderState::glState.bindVertexArray(0);
+      }
+    }
+  }
 
   assert(!checkGLError());
   return this;
 }
 
 
+GeometryCore* GeometryCore::setVertexStreams(const std::vector<VertexAttributeStream>& streams,
+    GLsizei nVertices, GLenum usage, bool hasPositionStream) {
+  // interleave streams in the given order, each padded to a multiple of 4 bytes
+  std::vector<VertexAttribute> attributes;
+  GLsizei stride = 0;
+  for (auto& stream : streams) {
+    const VertexFormat format = VertexQuantizer::isSupported(stream.format) ?
+        stream.format : VertexFormat::FLOAT;
+    attributes.push_back(VertexAttribute(stream.location, stream.dim, stride, format));
+    stride += VertexQuantizer::getSize(format, stream.dim);
+  }
+  std::vector<GLubyte> vertices(nVertices * stride);
+  for (size_t i = 0; i < streams.size(); ++i) {
+    VertexQuantizer::quantize(attributes[i].format, streams[i].data, streams[i].dim, nVertices,
+        vertices.data() + attributes[i].offset, stride);
+  }
+  return setVertexData(vertices.data(), vertices.size(), stride, attributes, usage,
+      hasPositionStream);
+}
+
+
 GeometryCore* GeometryCore::setElementIndexData(const GLuint* data, GLsizeiptr size, GLenum usage) {
-  glBindVertexArray(vao_);
+  leaveArena_();
+  RenderState::glState.bindVertexArray(vao_);
   assert(glIsVertexArray(vao_));
   glGenBuffers(1, &vboIndex_);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndex_);
   assert(glIsBuffer(vboIndex_));
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+  dataVersion_ = ++nextDataVersion_;
   if (drawMode_ == DrawMode::ELEMENTS) {
     nElements_ = size / sizeof(GLuint);
   }
+  if (isPickable_ && data) {
+    pickingIndices_.assign(data, data + size / sizeof(GLuint));
+    triangleBVH_.reset();
+  }
   // Note: GL_ELEMENT_ARRAY_BUFFER has to be kept bound
-  glBindVertexArray(0);
+  if (positionVao_) {
+    RenderState::glState.bindVertexArray(positionVao_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndex_);
+  }
+  RenderState::glState.bindVertexArray(0);
 
   assert(!checkGLError());
   return this;
 }
 
 
+bool GeometryCore::hasPositionStream() const {
+  return positionVao_ != 0;
+}
+
+
+bool GeometryCore::getVertexLayout(GLsizei& stride, std::vector<VertexAttribute>& attributes) const {
+  if (vboAttributes_.empty()
+      || std::count(vboAttributes_.begin(), vboAttributes_.end(), vboAttributes_[0])
+          != static_cast<std::ptrdiff_t>(vboAttributes_.size())) {
+    return false;
+  }
+  stride = attributeStrides_[0];
+  attributes.clear();
+  for (size_t i = 0; i < attributeLocations_.size(); ++i) {
+    attributes.push_back(VertexAttribute(attributeLocations_[i], attributeDims_[i],
+        static_cast<GLsizei>(attributeOffsets_[i]), attributeFormats_[i]));
+  }
+  return true;
+}
+
+
+bool GeometryCore::moveToArena(GeometryArenaSP arena) {
+  assert(arena);
+  if (arena == arena_) {
+    return true;
+  }
+  GLsizei stride = 0;
+  std::vector<VertexAttribute> attributes;
+  if (!getVertexLayout(stride, attributes) || !arena->isCompatible(stride, attributes)) {
+    return false;
+  }
+  leaveArena_();
+  GLintptr offset = 0;
+  GLsizei nVertices = 0;
+  GLsizei nIndices = 0;
+  getVertexBuffer_(0, offset, nVertices);
+  getIndexBuffer_(offset, nIndices);
+  if (nVertices == 0 || (drawMode_ == DrawMode::ELEMENTS && nIndices == 0)) {
+    return false;
+  }
+
+  // copy vertices and element indices into the ranges of the arena
+  arenaRange_ = arena->allocate(nVertices, nIndices);
+  const GeometryArena::Range& range = arena->getRange(arenaRange_);
+  glBindBuffer(GL_COPY_READ_BUFFER, vboAttributes_[0]);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, arena->getVertexBuffer());
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+      static_cast<GLintptr>(range.baseVertex) * stride, static_cast<GLsizeiptr>(nVertices) * stride);
+  if (nIndices > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, vboIndex_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena->getIndexBuffer());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+        range.firstIndex * sizeof(GLuint), nIndices * sizeof(GLuint));
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  // release own buffers, replacing the vertex array object that still refers to them
+  glDeleteBuffers(1, &vboAttributes_[0]);
+  std::fill(vboAttributes_.begin(), vboAttributes_.end(), 0);
+  glDeleteBuffers(1, &vboIndex_);
+  vboIndex_ = 0;
+  RenderState::glState.removeVertexArray(vao_);
+  glDeleteVertexArrays(1, &vao_);
+  glGenVertexArrays(1, &vao_);
+  if (positionVao_) {
+    glDeleteBuffers(1, &positionVbo_);
+    RenderState::glState.removeVertexArray(positionVao_);
+    glDeleteVertexArrays(1, &positionVao_);
+    positionVbo_ = 0;
+    positionVao_ = 0;
+  }
+  arena_ = arena;
+  updateDrawFunc_();
+
+  assert(!checkGLError());
+  return true;
+}
+
+
+GeometryArena* GeometryCore::getArena() const {
+  return arena_.get();
+}
+
+
+bool GeometryCore::isDefaultPickable() {
+  return isDefaultPickable_;
+}
+
+
+void GeometryCore::setDefaultPickable(bool isPickable) {
+  isDefaultPickable_ = isPickable;
+}
+
+
+bool GeometryCore::isPickable() const {
+  return isPickable_;
+}
+
+
+void GeometryCore::setPickable(bool isPickable) {
+  if (isPickable && !isPickable_) {
+    isPickable_ = true;
+    // read back vertex positions and element indices that have been set before
+    std::vector<GLfloat> positions;
+    GLint dim = 0;
+    if (getAttributeData(OGLConstants::VERTEX.location, positions, dim) && dim > 0) {
+      updatePositions_(positions.data(), positions.size() / dim, dim);
+    }
+    if (drawMode_ == DrawMode::ELEMENTS) {
+      getElementIndexData(pickingIndices_);
+    }
+    triangleBVH_.reset();
+  }
+  else if (!isPickable) {
+    isPickable_ = false;
+    std::vector<glm::vec3>().swap(pickingPositions_);
+    std::vector<GLuint>().swap(pickingIndices_);
+    triangleBVH_.reset();
+  }
+}
+
+
+TriangleBVH* GeometryCore::getTriangleBVH() {
+  if (!triangleBVH_ && isPickable_ && !pickingPositions_.empty()
+      && getNTriangles() > 0) {
+    // element indices are only used in DrawMode::ELEMENTS
+    static const std::vector<GLuint> noIndices;
+    triangleBVH_ = TriangleBVH::create(pickingPositions_,
+        drawMode_ == DrawMode::ELEMENTS ? pickingIndices_ : noIndices, primitiveType_);
+  }
+  return triangleBVH_.get();
+}
+
+
 int GeometryCore::getNTriangles() const {
   int result;
   switch (primitiveType_) {
@@ -124,16 +437,346 @@ int GeometryCore::getNTriangles() const {
 }
 
 
+const AABB& GeometryCore::getBoundingBox() const {
+  return boundingBox_;
+}
+
+
+const BoundingSphere& GeometryCore::getBoundingSphere() const {
+  return boundingSphere_;
+}
+
+
 void GeometryCore::render(RenderState* renderState) {
   // pass matrices and other state variables to shader
   renderState->passToShader();
 
-  // draw primitives
-  glBindVertexArray(vao_);
-  assert(glIsVertexArray(vao_));
+  // draw primitives, vertex array object is kept bound for subsequent draw calls
+  if (arena_) {
+    renderState->glState.bindVertexArray(arena_->getVertexArray());
+  }
+  else {
+    renderState->glState.bindVertexArray(vao_);
+    assert(glIsVertexArray(vao_));
+  }
+  assert(drawFunc_ != nullptr);
+  drawFunc_(primitiveType_, nElements_);
+
+  assert(!checkGLError());
+}
+
+
+void GeometryCore::renderInstanced(RenderState* renderState, GLuint instanceBuffer, GLsizei nInstances) {
+  // pass matrices and other state variables to shader
+  renderState->passToShader();
+
+  // bind per-instance attributes, advancing once per instance
+  const GLsizei stride = 20 * sizeof(GLfloat);
+  const GLuint colorLocation = OGLConstants::INSTANCE_COLOR.location;
+  const GLuint matrixLocation = OGLConstants::INSTANCE_MATRIX.location;
+  const GeometryArena::Range* range = arena_ ? &arena_->getRange(arenaRange_) : nullptr;
+  renderState->glState.bindVertexArray(arena_ ? arena_->getVertexArray() : vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  for (GLuint i = 0; i < 4; ++i) {
+    glVertexAttribPointer(matrixLocation + i, 4, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<const GLvoid*>(4 * i * sizeof(GLfloat)));
+    glVertexAttribDivisor(matrixLocation + i, 1);
+    glEnableVertexAttribArray(matrixLocation + i);
+  }
+  glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, stride,
+      reinterpret_cast<const GLvoid*>(16 * sizeof(GLfloat)));
+  glVertexAttribDivisor(colorLocation, 1);
+  glEnableVertexAttribArray(colorLocation);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // draw primitives, from the range of the geometry arena if any
+  if (drawMode_ == DrawMode::ELEMENTS) {
+    if (range) {
+      glDrawElementsInstancedBaseVertex(primitiveType_, nElements_, GL_UNSIGNED_INT,
+          reinterpret_cast<const GLvoid*>(range->firstIndex * sizeof(GLuint)), nInstances,
+          range->baseVertex);
+    }
+    else {
+      glDrawElementsInstanced(primitiveType_, nElements_, GL_UNSIGNED_INT,
+          static_cast<const GLvoid*>(nullptr), nInstances);
+    }
+  }
+  else {
+    glDrawArraysInstanced(primitiveType_, range ? range->baseVertex : 0, nElements_, nInstances);
+  }
+
+  // disable per-instance attributes for non-instanced rendering of this core
+  for (GLuint i = 0; i < 4; ++i) {
+    glDisableVertexAttribArray(matrixLocation + i);
+  }
+  glDisableVertexAttribArray(colorLocation);
+
+  assert(!checkGLError());
+}
+
+
+void GeometryCore::renderRanges(RenderState* renderState, const GLint* firsts, const GLsizei* counts,
+    GLsizei nRanges) {
+  // pass matrices and other state variables to shader
+  renderState->passToShader();
+
+  // draw primitives, offset by the range of the geometry arena if any
+  const GeometryArena::Range* range = arena_ ? &arena_->getRange(arenaRange_) : nullptr;
+  renderState->glState.bindVertexArray(arena_ ? arena_->getVertexArray() : vao_);
+  if (drawMode_ == DrawMode::ELEMENTS) {
+    const GLuint firstIndex = range ? range->firstIndex : 0;
+    rangeOffsets.resize(nRanges);
+    for (GLsizei i = 0; i < nRanges; ++i) {
+      rangeOffsets[i] = reinterpret_cast<const GLvoid*>((firstIndex + firsts[i]) * sizeof(GLuint));
+    }
+    if (range) {
+      rangeVertices.assign(nRanges, range->baseVertex);
+      glMultiDrawElementsBaseVertex(primitiveType_, const_cast<GLsizei*>(counts), GL_UNSIGNED_INT,
+          const_cast<GLvoid**>(rangeOffsets.data()), nRanges, rangeVertices.data());
+    }
+    else {
+      glMultiDrawElements(primitiveType_, counts, GL_UNSIGNED_INT, rangeOffsets.data(), nRanges);
+    }
+  }
+  else if (range) {
+    rangeVertices.resize(nRanges);
+    for (GLsizei i = 0; i < nRanges; ++i) {
+      rangeVertices[i] = range->baseVertex + firsts[i];
+    }
+    glMultiDrawArrays(primitiveType_, rangeVertices.data(), counts, nRanges);
+  }
+  else {
+    glMultiDrawArrays(primitiveType_, firsts, counts, nRanges);
+  }
+
+  assert(!checkGLError());
+}
+
+
+void GeometryCore::renderPositions(RenderState* renderState) {
+  if (!positionVao_) {
+    render(renderState);
+    return;
+  }
+
+  // pass matrices and other state variables to shader
+  renderState->passToShader();
+
+  // draw primitives from position stream
+  renderState->glState.bindVertexArray(positionVao_);
   assert(drawFunc_ != nullptr);
   drawFunc_(primitiveType_, nElements_);
-  glBindVertexArray(0);
+
+  assert(!checkGLError());
+}
+
+
+void GeometryCore::addAttribute_(GLuint location, GLuint vbo, GLint dim, GLsizei stride, GLintptr offset,
+    VertexFormat format) {
+  RenderState::glState.bindVertexArray(vao_);
+  assert(glIsVertexArray(vao_));
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glVertexAttribPointer(location, VertexQuantizer::getNComponents(format, dim),
+      VertexQuantizer::getType(format), VertexQuantizer::isNormalized(format), stride,
+      reinterpret_cast<const GLvoid*>(offset));
+  glEnableVertexAttribArray(location);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  RenderState::glState.bindVertexArray(0);
+  vboAttributes_.push_back(vbo);
+  attributeLocations_.push_back(location);
+  attributeDims_.push_back(dim);
+  attributeStrides_.push_back(stride);
+  attributeOffsets_.push_back(offset);
+  attributeFormats_.push_back(format);
+}
+
+
+void GeometryCore::updatePositions_(const GLfloat* data, size_t nVertices, GLint dim) {
+  boundingBox_ = AABB::fromPoints(data, nVertices, dim);
+  boundingSphere_ = BoundingSphere::fromPoints(data, nVertices, dim, boundingBox_);
+  if (isPickable_) {
+    pickingPositions_.resize(nVertices);
+    for (size_t i = 0; i < nVertices; ++i) {
+      const GLfloat* p = data + i * dim;
+      pickingPositions_[i] = glm::vec3(p[0], dim > 1 ? p[1] : 0.0f, dim > 2 ? p[2] : 0.0f);
+    }
+    triangleBVH_.reset();
+  }
+}
+
+
+void GeometryCore::clearAttributes_() {
+  if (arena_) {
+    arena_->release(arenaRange_);
+    arena_.reset();
+    updateDrawFunc_();
+  }
+  if (!attributeLocations_.empty()) {
+    RenderState::glState.bindVertexArray(vao_);
+    for (auto location : attributeLocations_) {
+      glDisableVertexAttribArray(location);
+    }
+    RenderState::glState.bindVertexArray(0);
+  }
+  // interleaved attributes share their VBO
+  std::vector<GLuint> vbos(vboAttributes_);
+  std::sort(vbos.begin(), vbos.end());
+  vbos.erase(std::unique(vbos.begin(), vbos.end()), vbos.end());
+  glDeleteBuffers(static_cast<GLsizei>(vbos.size()), vbos.data());
+  vboAttributes_.clear();
+  attributeLocations_.clear();
+  attributeDims_.clear();
+  attributeStrides_.clear();
+  attributeOffsets_.clear();
+  attributeFormats_.clear();
+  if (positionVao_) {
+    glDeleteBuffers(1, &positionVbo_);
+    RenderState::glState.removeVertexArray(positionVao_);
+    glDeleteVertexArrays(1, &positionVao_);
+    positionVbo_ = 0;
+    positionVao_ = 0;
+  }
+}
+
+
+void GeometryCore::updateDrawFunc_() {
+  switch(drawMode_) {
+  case DrawMode::ARRAYS:
+    if (arena_) {
+      drawFunc_ = [this](GLenum primitiveType, GLsizei count) {
+        glDrawArrays(primitiveType, arena_->getRange(arenaRange_).baseVertex, count);
+      };
+    }
+    else {
+      drawFunc_ = std::bind(&glDrawArrays, std::placeholders::_1, 0, std::placeholders::_2);
+    }
+    break;
+  case DrawMode::ELEMENTS:
+    if (arena_) {
+      // element indices are relative to the first vertex of the range
+      drawFunc_ = [this](GLenum primitiveType, GLsizei count) {
+        const GeometryArena::Range& range = arena_->getRange(arenaRange_);
+        glDrawElementsBaseVertex(primitiveType, count, GL_UNSIGNED_INT,
+            reinterpret_cast<GLvoid*>(range.firstIndex * sizeof(GLuint)), range.baseVertex);
+      };
+    }
+    else {
+      drawFunc_ = std::bind(&glDrawElements, std::placeholders::_1, std::placeholders::_2,
+          GL_UNSIGNED_INT, static_cast<const GLvoid*>(nullptr));
+    }
+    break;
+  default:
+    assert(!"Unknown drawMode [GeometryCore::updateDrawFunc_()]");
+    break;
+  }
+}
+
+
+void GeometryCore::leaveArena_() {
+  if (!arena_) {
+    return;
+  }
+
+  // copy vertices and element indices into own buffers
+  const GeometryArena::Range& range = arena_->getRange(arenaRange_);
+  const GLsizei stride = arena_->getStride();
+  const GLsizeiptr vertexSize = static_cast<GLsizeiptr>(range.nVertices) * stride;
+  GLuint vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+  glBufferData(GL_COPY_WRITE_BUFFER, vertexSize, nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_READ_BUFFER, arena_->getVertexBuffer());
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+      static_cast<GLintptr>(range.baseVertex) * stride, 0, vertexSize);
+  if (range.nIndices > 0) {
+    const GLsizeiptr indexSize = range.nIndices * sizeof(GLuint);
+    glGenBuffers(1, &vboIndex_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vboIndex_);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, arena_->getIndexBuffer());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        range.firstIndex * sizeof(GLuint), 0, indexSize);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  // restore attribute and element index bindings of the own vertex array object
+  RenderState::glState.bindVertexArray(vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  for (size_t i = 0; i < attributeLocations_.size(); ++i) {
+    glVertexAttribPointer(attributeLocations_[i],
+        VertexQuantizer::getNComponents(attributeFormats_[i], attributeDims_[i]),
+        VertexQuantizer::getType(attributeFormats_[i]),
+        VertexQuantizer::isNormalized(attributeFormats_[i]), stride,
+        reinterpret_cast<const GLvoid*>(attributeOffsets_[i]));
+    glEnableVertexAttribArray(attributeLocations_[i]);
+    vboAttributes_[i] = vbo;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // Note: GL_ELEMENT_ARRAY_BUFFER has to be kept bound
+  if (vboIndex_) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndex_);
+  }
+  RenderState::glState.bindVertexArray(0);
+  arena_->release(arenaRange_);
+  arena_.reset();
+  updateDrawFunc_();
+
+  assert(!checkGLError());
+}
+
+
+GLuint GeometryCore::getVertexBuffer_(size_t attribute, GLintptr& offset, GLsizei& nVertices) const {
+  assert(attribute < vboAttributes_.size());
+  if (arena_) {
+    const GeometryArena::Range& range = arena_->getRange(arenaRange_);
+    offset = static_cast<GLintptr>(range.baseVertex) * arena_->getStride();
+    nVertices = range.nVertices;
+    return arena_->getVertexBuffer();
+  }
+  GLint size = 0;
+  glBindBuffer(GL_COPY_READ_BUFFER, vboAttributes_[attribute]);
+  glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  offset = 0;
+  nVertices = size / attributeStrides_[attribute];
+  return vboAttributes_[attribute];
+}
+
+
+GLuint GeometryCore::getIndexBuffer_(GLintptr& offset, GLsizei& nIndices) const {
+  if (arena_) {
+    const GeometryArena::Range& range = arena_->getRange(arenaRange_);
+    offset = range.firstIndex * sizeof(GLuint);
+    nIndices = range.nIndices;
+    return (nIndices > 0) ? arena_->getIndexBuffer() : 0;
+  }
+  GLint size = 0;
+  if (vboIndex_) {
+    glBindBuffer(GL_COPY_READ_BUFFER, vboIndex_);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+  offset = 0;
+  nIndices = size / sizeof(GLuint);
+  return vboIndex_;
+}
+
+
+void GeometryCore::readBuffer_(GLuint buffer, GLintptr offset, GLsizeiptr size,
+    std::vector<GLubyte>& data) {
+  // use copy-read binding point to leave array and element array bindings untouched
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  if (size < 0) {
+    GLint bufferSize = 0;
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+    size = std::max(bufferSize - static_cast<GLsizeiptr>(offset), static_cast<GLsizeiptr>(0));
+  }
+  data.resize(size);
+  if (size > 0) {
+    glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, data.data());
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
 
   assert(!checkGLError());
 }
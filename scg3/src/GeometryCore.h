@@ -2,6 +2,9 @@
  * \file GeometryCore.h
  * \brief A core that contains geometry information to be rendered.
  *
+ * Defines structs:
+ *   VertexAttribute, VertexAttributeStream
+ *
  * \author Volker Ahlers\n
  *         volker.ahlers@hs-hannover.de
  */
@@ -28,7 +31,9 @@
 #include <functional>
 #include <vector>
 #include "scg_glew.h"
+#include "BoundingVolume.h"
 #include "Core.h"
+#include "VertexQuantizer.h"
 #include "scg_internals.h"
 
 namespace scg {
@@ -43,15 +48,74 @@ enum class DrawMode {
 };
 
 
+/**
+ * \brief Vertex attribute within an interleaved vertex (cf. GeometryCore::setVertexData()).
+ */
+struct VertexAttribute {
+
+  VertexAttribute(GLuint location0, GLint dim0, GLsizei offset0,
+      VertexFormat format0 = VertexFormat::FLOAT)
+      : location(location0), dim(dim0), offset(offset0), format(format0) {
+  }
+
+  GLuint location;      // attribute location, e.g., OGLConstants::VERTEX.location
+  GLint dim;            // number of components
+  GLsizei offset;       // byte offset within the vertex
+  VertexFormat format;  // storage format of the components
+
+};
+
+
+/**
+ * \brief Float vertex attribute values of all vertices, to be interleaved with other
+ *    streams and converted into their vertex format (cf. GeometryCore::setVertexStreams()).
+ */
+struct VertexAttributeStream {
+
+  VertexAttributeStream(GLuint location0, const GLfloat* data0, GLint dim0,
+      VertexFormat format0 = VertexFormat::FLOAT)
+      : location(location0), data(data0), dim(dim0), format(format0) {
+  }
+
+  GLuint location;      // attribute location, e.g., OGLConstants::VERTEX.location
+  const GLfloat* data;  // dim values per vertex
+  GLint dim;            // number of components
+  VertexFormat format;  // storage format, VertexFormat::FLOAT if not supported
+
+};
+
+
 /**
  * \brief A core that contains geometry information to be rendered.
  *
  * Vertices and indices are stored in vertex buffer objects (VBOs).
  * Each geometry core has its own vertex array object (VAO) that is used to
  * store attribute and element index bindings.
+ *
+ * Vertex attributes are either stored in a single VBO with interleaved vertices
+ * (cf. setVertexData(), setVertexStreams()), which keeps the attributes of a vertex
+ * together for vertex fetching, or each in its own VBO (cf. addAttributeData()).
+ * With interleaved vertices, the positions can additionally be stored in a separate
+ * position stream that is read by position-only passes (cf. renderPositions()).
+ * Interleaved attributes may be stored in compressed vertex formats (cf. VertexFormat),
+ * e.g., half-float positions and texture coordinates, 10-10-10-2 normals, and tangents
+ * with the binormal sign (cf. VertexQuantizer::computeSignedTangents()).
+ *
+ * Geometry cores with interleaved vertices may be moved into a GeometryArena that
+ * shares its buffers and vertex array object with other geometry cores of the same
+ * vertex layout (cf. moveToArena()). They are drawn by base-vertex draw calls then.
+ *
+ * A bounding box and a bounding sphere in model coordinates are computed when vertex
+ * data (OGLConstants::VERTEX) is added.
+ *
+ * For picking, a copy of the vertex positions and element indices may be kept in main memory
+ * (cf. setPickable(), setDefaultPickable()), and a TriangleBVH is built on demand by getTriangleBVH().
+ * The hierarchy is shared by all shapes that use the geometry core.
  */
 class GeometryCore: public Core {
 
+  friend class IndirectDrawBatch;
+
 public:
 
   /**
@@ -73,8 +137,52 @@ public:
    */
   static GeometryCoreSP create(GLenum primitiveType, DrawMode drawMode);
 
+  /**
+   * Get primitive type, e.g., GL_TRIANGLES.
+   */
+  GLenum getPrimitiveType() const;
+
+  /**
+   * Get draw mode.
+   */
+  DrawMode getDrawMode() const;
+
+  /**
+   * Get number of vertices (DrawMode::ARRAYS) or element indices (DrawMode::ELEMENTS)
+   * to be drawn.
+   */
+  GLsizei getNElements() const;
+
+  /**
+   * Get attribute locations of the vertex buffer objects, in the order they have been added.
+   */
+  const std::vector<GLuint>& getAttributeLocations() const;
+
+  /**
+   * Read vertex attribute data back from its vertex buffer object, e.g., to merge
+   * several geometry cores (cf. StaticBatch).
+   * \param location attribute location the VBO is bound to
+   * \param data attribute data
+   * \param dim dimension of each attribute value
+   * \return false if there is no attribute data for the location
+   */
+  bool getAttributeData(GLuint location, std::vector<GLfloat>& data, GLint& dim) const;
+
+  /**
+   * Get vertex format of the attribute bound to a location,
+   * VertexFormat::FLOAT if there is no attribute data for the location.
+   */
+  VertexFormat getAttributeFormat(GLuint location) const;
+
+  /**
+   * Read element index data back from its vertex buffer object.
+   * \return false if there is no element index data
+   */
+  bool getElementIndexData(std::vector<GLuint>& data) const;
+
   /**
    * Add vertex attribute data that is stored in its own vertex buffer object (VBO).
+   * For OGLConstants::VERTEX data, the bounding volumes are updated.
    * \param location attribute location the VBO is bound to
    * \param data attribute data
    * \param size buffer size in bytes
@@ -84,6 +192,53 @@ public:
    */
   GeometryCore* addAttributeData(GLuint location, const GLfloat* data, GLsizeiptr size, GLint dim, GLenum usage);
 
+  /**
+   * Set interleaved vertex data that is stored in a single vertex buffer object (VBO),
+   * replacing all vertex attributes set or added before.
+   * For OGLConstants::VERTEX data, the bounding volumes are updated from the positions
+   * as read from their vertex format.
+   * \param data interleaved vertex data
+   * \param size buffer size in bytes
+   * \param stride size of a vertex in bytes
+   * \param attributes attributes of a vertex
+   * \param usage GL_STATIC_DRAW, GL_DYNAMIC_DRAW, or GL_STREAM_DRAW
+   * \param hasPositionStream true if the OGLConstants::VERTEX values shall additionally be
+   *    stored in a position stream (cf. renderPositions())
+   * \return this pointer for method chaining
+   */
+  GeometryCore* setVertexData(const GLvoid* data, GLsizeiptr size, GLsizei stride,
+      const std::vector<VertexAttribute>& attributes, GLenum usage, bool hasPositionStream = false);
+
+  /**
+   * Set interleaved vertex data from a vector of vertex structures (cf. setVertexData()).
+   * \param vertices vertex structures, e.g., struct { glm::vec3 position; glm::vec3 normal; }
+   * \param attributes attributes of a vertex, with offsets within the vertex structure
+   * \param usage GL_STATIC_DRAW, GL_DYNAMIC_DRAW, or GL_STREAM_DRAW
+   * \param hasPositionStream true if the OGLConstants::VERTEX values shall additionally be
+   *    stored in a position stream (cf. renderPositions())
+   * \return this pointer for method chaining
+   */
+  template <class TVertex>
+  GeometryCore* setVertexData(const std::vector<TVertex>& vertices,
+      const std::vector<VertexAttribute>& attributes, GLenum usage, bool hasPositionStream = false) {
+    return setVertexData(vertices.data(), vertices.size() * sizeof(TVertex), sizeof(TVertex),
+        attributes, usage, hasPositionStream);
+  }
+
+  /**
+   * Set vertex data given as separate streams per attribute, which are converted into
+   * their vertex formats (cf. VertexQuantizer::quantize()), interleaved, and stored in
+   * a single vertex buffer object (cf. setVertexData()).
+   * \param streams attribute values
+   * \param nVertices number of vertices of each stream
+   * \param usage GL_STATIC_DRAW, GL_DYNAMIC_DRAW, or GL_STREAM_DRAW
+   * \param hasPositionStream true if the OGLConstants::VERTEX values shall additionally be
+   *    stored in a position stream (cf. renderPositions())
+   * \return this pointer for method chaining
+   */
+  GeometryCore* setVertexStreams(const std::vector<VertexAttributeStream>& streams,
+      GLsizei nVertices, GLenum usage, bool hasPositionStream = false);
+
   /**
    * Set element index data that is stored in its own vertex buffer object (VBO).
    *
@@ -94,25 +249,195 @@ public:
    */
   GeometryCore* setElementIndexData(const GLuint* data, GLsizeiptr size, GLenum usage);
 
+  /**
+   * Check if the vertex positions are stored in a separate position stream
+   * (cf. setVertexData()).
+   */
+  bool hasPositionStream() const;
+
+  /**
+   * Get vertex layout of interleaved vertex data (cf. setVertexData()).
+   * \param stride returns size of a vertex in bytes
+   * \param attributes returns attributes of a vertex
+   * \return false if the vertex attributes are not stored in a single vertex buffer object
+   */
+  bool getVertexLayout(GLsizei& stride, std::vector<VertexAttribute>& attributes) const;
+
+  /**
+   * Move vertices and element indices into ranges of a geometry arena of the same vertex
+   * layout (cf. GeometryArena::isCompatible()), releasing the own buffer objects and the
+   * position stream. Subsequent modifications of the vertex or element index data move
+   * them back into own buffer objects first.
+   * \param arena geometry arena
+   * \return false if the vertex layout does not match the arena or there is no data
+   */
+  bool moveToArena(GeometryArenaSP arena);
+
+  /**
+   * Get geometry arena holding the vertices and element indices, null if none.
+   */
+  GeometryArena* getArena() const;
+
+  /**
+   * Check if geometry cores created subsequently keep a copy of their vertex positions
+   * and element indices for picking.
+   */
+  static bool isDefaultPickable();
+
+  /**
+   * Enable or disable keeping a copy of vertex positions and element indices for picking,
+   * for geometry cores created subsequently (including models created by
+   * GeometryCoreFactory), default: disabled.
+   */
+  static void setDefaultPickable(bool isPickable);
+
+  /**
+   * Check if the geometry core keeps a copy of its vertex positions and element indices
+   * for picking.
+   */
+  bool isPickable() const;
+
+  /**
+   * Enable or disable keeping a copy of vertex positions and element indices for picking.
+   * Enabling reads back vertex positions and element indices that have been set before
+   * (requires OpenGL context), disabling releases the copy and the triangle hierarchy.
+   */
+  void setPickable(bool isPickable);
+
+  /**
+   * Get bounding volume hierarchy over the triangles in model coordinates, built on
+   * first call. Returns null if the geometry core is not pickable or does not contain
+   * triangles.
+   */
+  TriangleBVH* getTriangleBVH();
+
   /**
    * Get approximate number of triangles, called by Shape::getNTriangles().
    */
   int getNTriangles() const;
 
   /**
-   * Render geometry.
+   * Get axis-aligned bounding box of vertices in model coordinates.
+   */
+  const AABB& getBoundingBox() const;
+
+  /**
+   * Get bounding sphere of vertices in model coordinates.
+   */
+  const BoundingSphere& getBoundingSphere() const;
+
+  /**
+   * Render geometry. The vertex array object is kept bound to avoid redundant binds
+   * (cf. GLStateCache::bindVertexArray()).
    */
   virtual void render(RenderState* renderState);
 
+  /**
+   * Render several instances of the geometry in a single draw call, called by
+   * InstancedShape::render(). Per-instance attributes are read from the given buffer,
+   * consisting of a model matrix (16 floats, column-major) followed by a color (4 floats)
+   * per instance, and passed to the shader as OGLConstants::INSTANCE_MATRIX and
+   * OGLConstants::INSTANCE_COLOR. Requires OpenGL 3.3 or ARB_instanced_arrays.
+   * \param renderState current render state
+   * \param instanceBuffer vertex buffer object containing the instance attributes
+   * \param nInstances number of instances to be drawn
+   */
+  void renderInstanced(RenderState* renderState, GLuint instanceBuffer, GLsizei nInstances);
+
+  /**
+   * Render several ranges of vertices (DrawMode::ARRAYS) or element indices
+   * (DrawMode::ELEMENTS) in a single draw call (glMultiDraw*()), e.g., the visible
+   * objects of a StaticBatch.
+   * \param renderState current render state
+   * \param firsts index of first vertex or element index of each range
+   * \param counts number of vertices or element indices of each range
+   * \param nRanges number of ranges
+   */
+  void renderRanges(RenderState* renderState, const GLint* firsts, const GLsizei* counts, GLsizei nRanges);
+
+  /**
+   * Render geometry with vertex positions only, e.g., in depth-only or shadow passes
+   * with a shader that reads only OGLConstants::VERTEX. The position stream is used
+   * if available (cf. setVertexData()), the interleaved vertices otherwise.
+   */
+  void renderPositions(RenderState* renderState);
+
+protected:
+
+  /**
+   * Bind vertex buffer object to attribute location of the vertex array object
+   * and record it.
+   */
+  void addAttribute_(GLuint location, GLuint vbo, GLint dim, GLsizei stride, GLintptr offset,
+      VertexFormat format);
+
+  /**
+   * Update bounding volumes and picking copy from vertex positions.
+   */
+  void updatePositions_(const GLfloat* data, size_t nVertices, GLint dim);
+
+  /**
+   * Delete vertex buffer objects of all attributes and the position stream.
+   */
+  void clearAttributes_();
+
+  /**
+   * Set draw function for the draw mode, drawing the range of the geometry arena if any.
+   */
+  void updateDrawFunc_();
+
+  /**
+   * Move vertices and element indices from the geometry arena back into own buffer
+   * objects, if the geometry core is in an arena.
+   */
+  void leaveArena_();
+
+  /**
+   * Get vertex buffer object of an attribute, the byte offset of the first vertex within
+   * it, and the number of vertices, taking the geometry arena into account.
+   */
+  GLuint getVertexBuffer_(size_t attribute, GLintptr& offset, GLsizei& nVertices) const;
+
+  /**
+   * Get element index buffer object, the byte offset of the first index within it,
+   * and the number of element indices, taking the geometry arena into account.
+   */
+  GLuint getIndexBuffer_(GLintptr& offset, GLsizei& nIndices) const;
+
+  /**
+   * Read data of given buffer object, from offset to the end if size is negative.
+   */
+  static void readBuffer_(GLuint buffer, GLintptr offset, GLsizeiptr size,
+      std::vector<GLubyte>& data);
+
 protected:
 
   GLenum primitiveType_;
   DrawMode drawMode_;
   std::function<void(GLenum, GLsizei)> drawFunc_;
   GLuint vao_;
-  std::vector<GLuint> vboAttributes_;
+  std::vector<GLuint> vboAttributes_;       // per attribute, shared by interleaved attributes
+  std::vector<GLuint> attributeLocations_;
+  std::vector<GLint> attributeDims_;
+  std::vector<GLsizei> attributeStrides_;   // bytes between the values of consecutive vertices
+  std::vector<GLintptr> attributeOffsets_;  // bytes from buffer start to first value
+  std::vector<VertexFormat> attributeFormats_;
+  GLuint positionVao_;                      // position stream, 0 if none
+  GLuint positionVbo_;
   GLuint vboIndex_;
   GLsizei nElements_;
+  GeometryArenaSP arena_;                   // null if the own buffers are used
+  size_t arenaRange_;
+  AABB boundingBox_;
+  BoundingSphere boundingSphere_;
+  bool isPickable_;
+  std::vector<glm::vec3> pickingPositions_;
+  std::vector<GLuint> pickingIndices_;
+  TriangleBVHSP triangleBVH_;
+  unsigned long dataVersion_;   // unique among all geometry cores, changed by each modification
+
+  static bool isDefaultPickable_;
+  static unsigned long nextDataVersion_;
 
 };
 
@@ -28,6 +28,8 @@
 #include <string>
 #include <vector>
 #include "scg_glew.h"
+#include "GeometryCore.h"
+#include "MeshSimplifier.h"
 #include "scg_glm.h"
 #include "scg_internals.h"
 
@@ -36,6 +38,13 @@ namespace scg {
 
 /**
  * \brief A factory to create geometry cores.
+ *
+ * By default, the vertex attributes of created geometry cores are interleaved in a single
+ * vertex buffer object (cf. setInterleaved(), GeometryCore::setVertexData()).
+ * Interleaved attributes can be stored in compressed vertex formats (cf. setCompressed()),
+ * and geometry cores of the same vertex layout can share their buffers
+ * (cf. setSharingBuffers()). Created geometry cores keep a copy of their vertices for
+ * picking if enabled (cf. setPickable(), GeometryCore::setDefaultPickable()).
  */
 class GeometryCoreFactory {
 
@@ -67,6 +76,78 @@ public:
    */
   void addFilePath(const std::string& filePath);
 
+  /**
+   * Check if the vertex attributes of created geometry cores are interleaved.
+   */
+  bool isInterleaved() const;
+
+  /**
+   * Enable or disable interleaved vertex attributes of created geometry cores,
+   * default: enabled. If disabled, each attribute is stored in its own vertex buffer
+   * object (cf. GeometryCore::addAttributeData()).
+   */
+  void setInterleaved(bool isInterleaved);
+
+  /**
+   * Check if created geometry cores store their vertex positions in a separate
+   * position stream.
+   */
+  bool hasPositionStream() const;
+
+  /**
+   * Enable or disable a separate position stream of created geometry cores for
+   * position-only passes (cf. GeometryCore::renderPositions()), default: disabled.
+   * Ignored if vertex attributes are not interleaved.
+   */
+  void setPositionStream(bool hasPositionStream);
+
+  /**
+   * Check if created geometry cores use compressed vertex formats.
+   */
+  bool isCompressed() const;
+
+  /**
+   * Enable or disable compressed vertex formats of created geometry cores, default: disabled.
+   * If enabled, positions and texture coordinates are stored as half floats, normals
+   * and tangents as signed normalized 10-10-10-2 values, and colors as unsigned normalized
+   * bytes (cf. VertexFormat); binormals are replaced by the binormal sign as fourth
+   * tangent component (cf. VertexQuantizer::computeSignedTangents()), to be reconstructed
+   * by the shader (e.g., bump_vert.glsl).
+   * Ignored if vertex attributes are not interleaved.
+   */
+  void setCompressed(bool isCompressed);
+
+  /**
+   * Check if created geometry cores share their buffers.
+   */
+  bool isSharingBuffers() const;
+
+  /**
+   * Enable or disable sharing of buffers by created geometry cores, default: disabled.
+   * If enabled, each geometry core is moved into a geometry arena of its vertex layout
+   * (cf. GeometryCore::moveToArena()), which is created on first use and shared by all
+   * subsequent geometry cores of the same layout; the position stream is not kept.
+   * Ignored if vertex attributes are not interleaved.
+   */
+  void setSharingBuffers(bool isSharingBuffers);
+
+  /**
+   * Check if created geometry cores are pickable.
+   */
+  bool isPickable() const;
+
+  /**
+   * Enable or disable picking of created geometry cores (cf. GeometryCore::setPickable()),
+   * default: disabled. If disabled, GeometryCore::isDefaultPickable() applies.
+   */
+  void setPickable(bool isPickable);
+
+  /**
+   * Get geometry arenas created for shared buffers, e.g., to defragment them
+   * (cf. GeometryArena::defragment()).
+   */
+  const std::vector<GeometryArenaSP>& getArenas() const;
+
   /**
    * Load model from OBJ Wavefront file.
    *
@@ -78,6 +159,37 @@ public:
    */
   GeometryCoreSP createModelFromOBJFile(const std::string& fileName);
 
+  /**
+   * Load indexed triangle mesh from OBJ Wavefront file, e.g., to be simplified by
+   * MeshSimplifier. Face corners with identical vertex, texture coordinate, and normal
+   * indices share a mesh vertex.
+   *
+   * If the file does not define normals, the normals of the mesh are left empty
+   * (cf. createModelFromMesh()). Face corners without normal in a file defining normals
+   * get the face normal.
+   *
+   * \param fileName file name to be searched for in known file paths
+   */
+  TriangleMesh loadMeshFromOBJFile(const std::string& fileName);
+
+  /**
+   * Create indexed geometry core from triangle mesh.
+   * If the mesh does not contain normals, smooth vertex normals are computed
+   * (cf. TriangleMesh::computeNormals()).
+   */
+  GeometryCoreSP createModelFromMesh(const TriangleMesh& mesh);
+
+  /**
+   * Load model from OBJ Wavefront file and create levels of detail by mesh
+   * simplification (cf. loadMeshFromOBJFile(), MeshSimplifier::createLODs(), LOD).
+   *
+   * \param fileName file name to be searched for in known file paths
+   * \param nLevels maximum number of levels, including the original model
+   * \param reduction number of triangles of each level relative to the previous level
+   */
+  std::vector<GeometryCoreSP> createModelLODsFromOBJFile(const std::string& fileName,
+      int nLevels, GLfloat reduction = 0.5f);
+
   /**
    * Create rectangle in xy plane with normals, tangents, binormals, and
    * texture coordinates (2 triangles).
@@ -113,6 +225,18 @@ public:
    */
   GeometryCoreSP createSphere(GLfloat radius, int nSlices, int nStacks);
 
+  /**
+   * Create levels of detail of a sphere (cf. createSphere(), LOD), halving the numbers of
+   * slices and stacks from level to level (at least 3 slices and 2 stacks).
+   *
+   * \param radius sphere radius
+   * \param nSlices number of slices of the first level
+   * \param nStacks number of stacks of the first level
+   * \param nLevels maximum number of levels, fewer levels are created if the minimum
+   *    numbers of slices and stacks are reached
+   */
+  std::vector<GeometryCoreSP> createSphereLODs(GLfloat radius, int nSlices, int nStacks, int nLevels);
+
   /**
    * Create cone along z axis and centered at origin with normals, tangents,
    * binormals, and texture coordinates
@@ -127,6 +251,16 @@ public:
   GeometryCoreSP createCone(GLfloat radius, GLfloat height,
       int nSlices, int nStacks, bool hasCap = true);
 
+  /**
+   * Create levels of detail of a cone (cf. createCone(), LOD), halving the numbers of
+   * slices and stacks from level to level (at least 3 slices and 1 stack).
+   *
+   * \param nLevels maximum number of levels, fewer levels are created if the minimum
+   *    numbers of slices and stacks are reached
+   */
+  std::vector<GeometryCoreSP> createConeLODs(GLfloat radius, GLfloat height,
+      int nSlices, int nStacks, int nLevels, bool hasCap = true);
+
   /**
    * Create cylinder along z axis and centered at origin with normals, tangents,
    * binormals, and texture coordinates
@@ -141,6 +275,16 @@ public:
   GeometryCoreSP createCylinder(GLfloat radius, GLfloat height,
       int nSlices, int nStacks, bool hasCaps = true);
 
+  /**
+   * Create levels of detail of a cylinder (cf. createCylinder(), LOD), halving the numbers
+   * of slices and stacks from level to level (at least 3 slices and 1 stack).
+   *
+   * \param nLevels maximum number of levels, fewer levels are created if the minimum
+   *    numbers of slices and stacks are reached
+   */
+  std::vector<GeometryCoreSP> createCylinderLODs(GLfloat radius, GLfloat height,
+      int nSlices, int nStacks, int nLevels, bool hasCaps = true);
+
   /**
    * Create conical frustum (or cylinder for baseRadius = topRadius) along z axis and
    * centered at origin with normals, tangents, binormals, and texture coordinates
@@ -243,9 +387,36 @@ protected:
    */
   int loadOBJFile_(const std::string& fileName, OBJModel& model) const;
 
+  /**
+   * Halve numbers of slices and stacks for the next level of detail, respecting the
+   * given minimum numbers.
+   * \return false if neither number could be reduced
+   */
+  static bool reduceResolution_(int& nSlices, int minSlices, int& nStacks, int minStacks);
+
+  /**
+   * Set vertex data of a geometry core, either interleaved or with one vertex buffer
+   * object per attribute (cf. setInterleaved()), in compressed vertex formats if enabled
+   * (cf. setCompressed()).
+   */
+  void setVertexStreams_(GeometryCore* core, const std::vector<VertexAttributeStream>& streams,
+      GLsizei nVertices) const;
+
+  /**
+   * Move geometry core into the geometry arena of its vertex layout if buffers are shared
+   * (cf. setSharingBuffers()), creating the arena on first use.
+   */
+  void moveToArena_(GeometryCore* core);
+
 protected:
 
   std::vector<std::string> filePaths_;
+  bool isInterleaved_;
+  bool hasPositionStream_;
+  bool isCompressed_;
+  bool isSharingBuffers_;
+  bool isPickable_;
+  std::vector<GeometryArenaSP> arenas_;
 
 };
 
@@ -27,6 +27,7 @@
 #include "Group.h"
 #include "MaterialCore.h"
 #include "ShaderCore.h"
+#include "StaticBatch.h"
 #include "TextureCore.h"
 #include "Traverser.h"
 
@@ -52,9 +53,40 @@ Group* Group::addCore(CoreSP core) {
     throw std::runtime_error("Disallowed core type GeometryCore [Group::addCore()]");
   }
   cores_.push_back(core);
+  markModified_();
   return this;
 }
 
+
+bool Group::batch() {
+  batch_.reset();
+  auto batch = StaticBatch::create();
+  if (!batch->build(this)) {
+    return false;
+  }
+  batch_ = batch;
+  return true;
+}
+
+
+void Group::unbatch() {
+  batch_.reset();
+}
+
+
+bool Group::isBatched() {
+  return getBatch() != nullptr;
+}
+
+
+StaticBatch* Group::getBatch() {
+  if (batch_ && !batch_->update()) {
+    batch_.reset();
+  }
+  return batch_.get();
+}
+
+
 void Group::accept(Traverser* traverser) {
   traverser->visitGroup(this);
 }
@@ -35,6 +35,11 @@ namespace scg {
  *
  * Allowed core types: ColorCore, MaterialCore, ShaderCore, TextureCore.
  *
+ * A sub-tree of static shapes may be merged into a few combined geometry cores by
+ * batch() (cf. StaticBatch), which are rendered instead of traversing the sub-tree.
+ * The group is unbatched automatically if its sub-tree is modified, except for
+ * visibility changes.
+ *
  * Note: When the node is rendered, its cores are procesed in the order they
  * have been added to the node.
  */
@@ -69,6 +74,33 @@ public:
    */
   Group* addCore(CoreSP core);
 
+  /**
+   * Merge the shapes of the sub-tree into static batches, i.e., pre-transformed geometry
+   * cores that share the same shader, material, texture, etc. (cf. StaticBatch).
+   * Renderers draw the batches instead of traversing the sub-tree, until the group is
+   * unbatched explicitly or by a modification of the sub-tree (except for visibility
+   * changes). Requires an OpenGL context.
+   * \return false if the sub-tree cannot be batched, i.e., contains nodes other than
+   *    Group, Transformation, and Shape
+   */
+  bool batch();
+
+  /**
+   * Discard static batches, i.e., render sub-tree by traversal again.
+   */
+  void unbatch();
+
+  /**
+   * Check if the group is batched, unbatching it if its sub-tree has been modified.
+   */
+  bool isBatched();
+
+  /**
+   * Get static batches, unbatching the group if its sub-tree has been modified.
+   * \return static batches or nullptr if the group is not batched
+   */
+  StaticBatch* getBatch();
+
   /**
    * Accept traverser (visitor pattern).
    */
@@ -90,6 +122,10 @@ public:
    */
   virtual void renderPost(RenderState* renderState);
 
+protected:
+
+  StaticBatchSP batch_;
+
 };
 
 
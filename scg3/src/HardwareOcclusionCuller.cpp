@@ -0,0 +1,269 @@
+/**
+ * \file HardwareOcclusionCuller.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include "Composite.h"
+#include "GeometryCore.h"
+#include "HardwareOcclusionCuller.h"
+#include "RenderState.h"
+#include "ShaderCore.h"
+#include "ShaderCoreFactory.h"
+#include "Shape.h"
+#include "scg_utilities.h"
+
+namespace scg {
+
+
+namespace {
+
+/**
+ * Check if bounding box reaches the near plane or behind the eye.
+ */
+bool isNearPlaneCrossed(const AABB& box, const glm::mat4& mvpMatrix) {
+  for (int i = 0; i < 8; ++i) {
+    const glm::vec4 clip = mvpMatrix * glm::vec4((i & 1) ? box.max.x : box.min.x,
+        (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z, 1.0f);
+    if (clip.w <= 0.0f || clip.z < -clip.w) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+
+HardwareOcclusionCuller::HardwareOcclusionCuller()
+    : queryTarget_((GLEW_VERSION_3_3 || GLEW_ARB_occlusion_query2) ? GL_ANY_SAMPLES_PASSED : GL_SAMPLES_PASSED),
+      isConditionalRenderingSupported_(GLEW_VERSION_3_0 != 0),
+      isConditionalRendering_(true), groupSize_(4), frame_(0),
+      shape_(nullptr), shapeQuery_(nullptr), isShapeConditional_(false) {
+  ShaderCoreFactory shaderFactory;
+  shaderCore_ = shaderFactory.createColorShader();
+
+  // unit cube [-1, 1]^3, transformed to the bounding boxes
+  const GLfloat vertices[] = {
+      -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f, 1.0f, -1.0f,   -1.0f, 1.0f, -1.0f,
+      -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,   1.0f, 1.0f,  1.0f,   -1.0f, 1.0f,  1.0f
+  };
+  const GLuint indices[] = {
+      0, 2, 1,   0, 3, 2,   4, 5, 6,   4, 6, 7,   0, 1, 5,   0, 5, 4,
+      3, 6, 2,   3, 7, 6,   0, 4, 7,   0, 7, 3,   1, 2, 6,   1, 6, 5
+  };
+  boxCore_ = GeometryCore::create(GL_TRIANGLES, DrawMode::ELEMENTS);
+  boxCore_->addAttributeData(OGLConstants::VERTEX.location, vertices, sizeof(vertices), 3, GL_STATIC_DRAW);
+  boxCore_->setElementIndexData(indices, sizeof(indices), GL_STATIC_DRAW);
+}
+
+
+HardwareOcclusionCuller::~HardwareOcclusionCuller() {
+  for (auto& entry : queries_) {
+    glDeleteQueries(1, &entry.second.query);
+  }
+}
+
+
+HardwareOcclusionCullerSP HardwareOcclusionCuller::create() {
+  return std::make_shared<HardwareOcclusionCuller>();
+}
+
+
+bool HardwareOcclusionCuller::isConditionalRendering() const {
+  return isConditionalRendering_;
+}
+
+
+void HardwareOcclusionCuller::setConditionalRendering(bool isConditionalRendering) {
+  isConditionalRendering_ = isConditionalRendering;
+}
+
+
+size_t HardwareOcclusionCuller::getGroupSize() const {
+  return groupSize_;
+}
+
+
+void HardwareOcclusionCuller::setGroupSize(size_t groupSize) {
+  groupSize_ = groupSize;
+}
+
+
+const OcclusionQueryStats& HardwareOcclusionCuller::getStats() const {
+  return stats_;
+}
+
+
+void HardwareOcclusionCuller::beginFrame() {
+  stats_ = OcclusionQueryStats();
+  shape_ = nullptr;
+  shapeQuery_ = nullptr;
+  ++frame_;
+
+  // delete queries of removed nodes or nodes outside of the view frustum
+  if (frame_ % PURGE_INTERVAL == 0) {
+    for (auto it = queries_.begin(); it != queries_.end(); ) {
+      if (frame_ - it->second.frame > PURGE_INTERVAL) {
+        glDeleteQueries(1, &it->second.query);
+        it = queries_.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+}
+
+
+bool HardwareOcclusionCuller::isOccluded(Node* node, const AABB& box, RenderState* renderState) {
+  Shape* shape = nullptr;
+  if (node->isComposite_) {
+    if (static_cast<Composite*>(node)->getNChildren() < groupSize_) {
+      return false;
+    }
+  }
+  else {
+    shape = dynamic_cast<Shape*>(node);
+    if (!shape) {
+      return false;
+    }
+  }
+  if (box.isEmpty()) {
+    return false;
+  }
+
+  // get query state, visible by default
+  auto it = queries_.find(node);
+  if (it == queries_.end()) {
+    Query_ newQuery = { 0, true, false, 0 };
+    glGenQueries(1, &newQuery.query);
+    it = queries_.insert(std::make_pair(node, newQuery)).first;
+  }
+  Query_& query = it->second;
+  query.frame = frame_;
+  if (query.isPending) {
+    updateResult_(query);
+  }
+
+  // boxes containing the eye cannot be tested
+  if (isNearPlaneCrossed(box, renderState->getMVPMatrix())) {
+    query.isVisible = true;
+  }
+  else if (query.isVisible) {
+    // visible shapes are tested by their geometry, composites by their boxes
+    if (!query.isPending) {
+      if (shape) {
+        shape_ = shape;
+        shapeQuery_ = &query;
+        isShapeConditional_ = false;
+      }
+      else {
+        queryBox_(query, box, renderState);
+      }
+    }
+  }
+  else {
+    // occluded nodes are tested again by their boxes
+    if (!query.isPending) {
+      queryBox_(query, box, renderState);
+      if (shape && isConditionalRendering_ && isConditionalRenderingSupported_) {
+        shape_ = shape;
+        shapeQuery_ = &query;
+        isShapeConditional_ = true;
+        ++stats_.nConditional;
+        return false;
+      }
+    }
+    ++stats_.nSkipped;
+    return true;
+  }
+  return false;
+}
+
+
+void HardwareOcclusionCuller::beginShape(Shape* shape) {
+  if (shape != shape_) {
+    return;
+  }
+  if (isShapeConditional_) {
+    glBeginConditionalRender(shapeQuery_->query, GL_QUERY_NO_WAIT);
+  }
+  else {
+    glBeginQuery(queryTarget_, shapeQuery_->query);
+    shapeQuery_->isPending = true;
+    ++stats_.nQueries;
+  }
+}
+
+
+void HardwareOcclusionCuller::endShape(Shape* shape) {
+  if (shape != shape_) {
+    return;
+  }
+  if (isShapeConditional_) {
+    glEndConditionalRender();
+  }
+  else {
+    glEndQuery(queryTarget_);
+  }
+  shape_ = nullptr;
+  shapeQuery_ = nullptr;
+}
+
+
+void HardwareOcclusionCuller::updateResult_(Query_& query) {
+  GLuint isAvailable = GL_FALSE;
+  glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+  if (isAvailable) {
+    GLuint result = 0;
+    glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &result);
+    query.isVisible = (result != 0);
+    query.isPending = false;
+    ++stats_.nResults;
+  }
+}
+
+
+void HardwareOcclusionCuller::queryBox_(Query_& query, const AABB& box, RenderState* renderState) {
+  // render box without color and depth writes and without face culling
+  const bool isCullFace = renderState->glState.isEnabled(GL_CULL_FACE);
+  renderState->glState.setEnabled(GL_CULL_FACE, false);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  renderState->glState.setDepthMask(false);
+  renderState->modelViewStack.pushMatrix();
+  renderState->modelViewStack.multMatrix(glm::scale(glm::translate(glm::mat4(1.0f), box.getCenter()),
+      glm::max(box.getHalfExtent(), glm::vec3(1e-6f))));
+  shaderCore_->render(renderState);
+  glBeginQuery(queryTarget_, query.query);
+  boxCore_->render(renderState);
+  glEndQuery(queryTarget_);
+  shaderCore_->renderPost(renderState);
+  renderState->modelViewStack.popMatrix();
+  renderState->glState.setDepthMask(true);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  renderState->glState.setEnabled(GL_CULL_FACE, isCullFace);
+  query.isPending = true;
+  ++stats_.nQueries;
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,199 @@
+/**
+ * \file HardwareOcclusionCuller.h
+ * \brief Occlusion culling by hardware occlusion queries on bounding boxes, using the
+ *    results of previous frames.
+ *
+ * Defines struct:
+ *   OcclusionQueryStats
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWAREOCCLUSIONCULLER_H_
+#define HARDWAREOCCLUSIONCULLER_H_
+
+#include <unordered_map>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Counters of HardwareOcclusionCuller for the last frame.
+ */
+struct OcclusionQueryStats {
+
+  OcclusionQueryStats()
+      : nQueries(0), nResults(0), nSkipped(0), nConditional(0) {
+  }
+
+  size_t nQueries;      // number of occlusion queries issued
+  size_t nResults;      // number of query results read (without waiting)
+  size_t nSkipped;      // number of nodes skipped together with their sub-trees
+  size_t nConditional;  // number of shapes rendered conditionally on a query
+
+};
+
+
+/**
+ * \brief Occlusion culling by hardware occlusion queries on bounding boxes, using the
+ *    results of previous frames.
+ *
+ * Tested are shapes and composite nodes with at least getGroupSize() children,
+ * whose bounding boxes are tested as a group before their children.
+ * The traversal never waits for query results (cf. coherent hierarchical culling,
+ * Bittner et al., 2004): the visibility of a node is taken from the latest query
+ * result that is available, i.e., usually from the previous frame.
+ * - Visible shapes are rendered inside of an occlusion query, such that the rendered
+ *   geometry itself determines whether they are still visible.
+ * - Visible composite nodes issue a query on their bounding box before their children
+ *   are rendered.
+ * - Occluded nodes issue a query on their bounding box and are skipped. Occluded shapes
+ *   are rendered conditionally on this query instead if conditional rendering is
+ *   enabled (cf. setConditionalRendering()), such that the GPU skips them if the query
+ *   fails and no shapes appear one frame late.
+ *
+ * Bounding boxes are rendered without color and depth writes, so the queries test
+ * against the geometry rendered before, i.e., rendering the scene graph roughly in
+ * front-to-back order improves the culling rate.
+ * Uses GL_ANY_SAMPLES_PASSED queries if available (OpenGL 3.3), GL_SAMPLES_PASSED
+ * otherwise. Requires an OpenGL context.
+ */
+class HardwareOcclusionCuller {
+
+public:
+
+  /**
+   * Constructor, creates shader and box geometry.
+   */
+  HardwareOcclusionCuller();
+
+  /**
+   * Destructor, deletes query objects.
+   */
+  virtual ~HardwareOcclusionCuller();
+
+  /**
+   * Create shared pointer.
+   */
+  static HardwareOcclusionCullerSP create();
+
+  /**
+   * Check if occluded shapes are rendered conditionally on their box query.
+   */
+  bool isConditionalRendering() const;
+
+  /**
+   * Enable or disable rendering occluded shapes conditionally on their box query
+   * instead of skipping them, default: enabled.
+   */
+  void setConditionalRendering(bool isConditionalRendering);
+
+  /**
+   * Get minimum number of children of composite nodes tested as a group.
+   */
+  size_t getGroupSize() const;
+
+  /**
+   * Set minimum number of children of composite nodes tested as a group, default: 4.
+   */
+  void setGroupSize(size_t groupSize);
+
+  /**
+   * Get counters of last frame.
+   */
+  const OcclusionQueryStats& getStats() const;
+
+  /**
+   * Start new frame, reset counters, delete queries of nodes that have not been
+   * tested for a while.
+   */
+  void beginFrame();
+
+  /**
+   * Determine visibility of node from the latest available query result and issue
+   * a new query if necessary, called by CullingRenderTraverser.
+   * \param node node to be tested
+   * \param box bounding box of node in the coordinate system of the current
+   *    model-view matrix
+   * \param renderState render state with current model-view and projection matrices
+   * \return true if node is to be skipped together with its sub-tree
+   */
+  bool isOccluded(Node* node, const AABB& box, RenderState* renderState);
+
+  /**
+   * Begin query or conditional rendering of shape as determined by isOccluded(),
+   * to be called before rendering the shape.
+   */
+  void beginShape(Shape* shape);
+
+  /**
+   * End query or conditional rendering of shape, to be called after rendering the shape.
+   */
+  void endShape(Shape* shape);
+
+protected:
+
+  /**
+   * \brief Query state of a node.
+   */
+  struct Query_ {
+    GLuint query;
+    bool isVisible;
+    bool isPending;       // query issued, result not read yet
+    unsigned long frame;  // last frame the node has been tested
+  };
+
+  static const unsigned long PURGE_INTERVAL = 64;
+
+  /**
+   * Read query result if available.
+   */
+  void updateResult_(Query_& query);
+
+  /**
+   * Issue query on bounding box.
+   */
+  void queryBox_(Query_& query, const AABB& box, RenderState* renderState);
+
+protected:
+
+  GLenum queryTarget_;
+  bool isConditionalRenderingSupported_;
+  bool isConditionalRendering_;
+  size_t groupSize_;
+  unsigned long frame_;
+  std::unordered_map<Node*, Query_> queries_;
+  ShaderCoreSP shaderCore_;
+  GeometryCoreSP boxCore_;
+  Shape* shape_;            // shape to be wrapped by beginShape() and endShape()
+  Query_* shapeQuery_;
+  bool isShapeConditional_;
+  OcclusionQueryStats stats_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* HARDWAREOCCLUSIONCULLER_H_ */
@@ -0,0 +1,379 @@
+/**
+ * \file IndirectDrawBatch.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "GeometryCore.h"
+#include "IndirectDrawBatch.h"
+#include "RenderState.h"
+#include "RingBuffer.h"
+#include "scg_utilities.h"
+
+namespace scg {
+
+
+namespace {
+
+// initial capacity of the buffers of a geometry pool
+const GLint MIN_VERTEX_CAPACITY = 4096;
+const GLuint MIN_INDEX_CAPACITY = 16384;
+
+// initial section size of the ring buffer for draw commands and per-draw data
+const GLsizeiptr MIN_RING_BUFFER_SIZE = 1 << 18;
+
+// per-draw data: model-view matrix (16 floats) and color (4 floats), cf. InstancedShape
+const size_t DRAW_DATA_SIZE = 20;
+
+}
+
+
+IndirectDrawBatch::IndirectDrawBatch()
+    : commandOffset_(0) {
+  ringBuffer_ = RingBuffer::create(MIN_RING_BUFFER_SIZE);
+}
+
+
+IndirectDrawBatch::~IndirectDrawBatch() {
+  if (isGLContextActive()) {
+    clear();
+  }
+}
+
+
+IndirectDrawBatchSP IndirectDrawBatch::create() {
+  return std::make_shared<IndirectDrawBatch>();
+}
+
+
+bool IndirectDrawBatch::isSupported() {
+  return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+
+size_t IndirectDrawBatch::getNDraws() const {
+  return commands_.size();
+}
+
+
+void IndirectDrawBatch::reset() {
+  commands_.clear();
+  drawData_.clear();
+
+  // rebuild pools if copies of modified geometry cores take up too much space
+  for (auto& pool : pools_) {
+    if (2 * pool.nOutdatedVertices > pool.nVertices) {
+      clear();
+      break;
+    }
+  }
+}
+
+
+int IndirectDrawBatch::addGeometry(GeometryCore* geometryCore) {
+  assert(geometryCore);
+  auto it = ranges_.find(geometryCore);
+  if (it != ranges_.end()) {
+    if (it->second.dataVersion == geometryCore->dataVersion_) {
+      return it->second.pool;
+    }
+    if (it->second.pool >= 0) {
+      pools_[it->second.pool].nOutdatedVertices += it->second.nVertices;
+    }
+  }
+  Range_ range = { -1, 0, 0, 0, 0, geometryCore->dataVersion_ };
+
+  // attribute layout in ascending order of locations, buffers in order of their first
+  // attribute, vertex count from buffer sizes or the range of the geometry arena
+  const GeometryCore& core = *geometryCore;
+  GLintptr indexOffset = 0;
+  GLsizei nIndices = 0;
+  const GLuint ibo = core.getIndexBuffer_(indexOffset, nIndices);
+  bool isDrawable = core.drawMode_ == DrawMode::ELEMENTS && ibo != 0
+      && core.nElements_ > 0 && !core.vboAttributes_.empty();
+  std::vector<size_t> order(core.attributeLocations_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&core](size_t a, size_t b) {
+    return core.attributeLocations_[a] < core.attributeLocations_[b];
+  });
+  Pool_ layout;
+  layout.primitiveType = core.primitiveType_;
+  std::vector<GLuint> sources;        // vertex buffer of the geometry core per pool buffer
+  std::vector<GLintptr> sourceOffsets;
+  GLint nVertices = -1;
+  for (size_t i = 0; isDrawable && i < order.size(); ++i) {
+    const GLuint location = core.attributeLocations_[order[i]];
+    GLintptr sourceOffset = 0;
+    GLsizei n = 0;
+    const GLuint vbo = core.getVertexBuffer_(order[i], sourceOffset, n);
+    const GLsizei stride = core.attributeStrides_[order[i]];
+    const size_t buffer = std::find(sources.begin(), sources.end(), vbo) - sources.begin();
+    if (buffer == sources.size()) {
+      isDrawable = (nVertices < 0 || n == nVertices);
+      nVertices = n;
+      sources.push_back(vbo);
+      sourceOffsets.push_back(sourceOffset);
+      layout.strides.push_back(stride);
+    }
+    // per-draw data occupies the instance attribute locations
+    isDrawable = isDrawable && stride == layout.strides[buffer]
+        && (layout.locations.empty() || location != layout.locations.back())
+        && (location < OGLConstants::INSTANCE_COLOR.location
+            || location >= OGLConstants::INSTANCE_MATRIX.location + 4);
+    layout.locations.push_back(location);
+    layout.dims.push_back(core.attributeDims_[order[i]]);
+    layout.formats.push_back(core.attributeFormats_[order[i]]);
+    layout.offsets.push_back(core.attributeOffsets_[order[i]]);
+    layout.buffers.push_back(buffer);
+  }
+
+  if (isDrawable && nVertices > 0) {
+    // copy vertex buffers and element indices at the end of the pool
+    const int poolIndex = getPool_(layout);
+    Pool_& pool = pools_[poolIndex];
+    reserve_(pool, pool.nVertices + nVertices, pool.nIndices + core.nElements_);
+    for (size_t i = 0; i < sources.size(); ++i) {
+      const GLsizeiptr vertexSize = pool.strides[i];
+      glBindBuffer(GL_COPY_READ_BUFFER, sources[i]);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vbos[i]);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffsets[i],
+          pool.nVertices * vertexSize, nVertices * vertexSize);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.ibo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, indexOffset,
+        pool.nIndices * sizeof(GLuint), core.nElements_ * sizeof(GLuint));
+    range.pool = poolIndex;
+    range.baseVertex = pool.nVertices;
+    range.firstIndex = pool.nIndices;
+    range.count = core.nElements_;
+    range.nVertices = nVertices;
+    pool.nVertices += nVertices;
+    pool.nIndices += core.nElements_;
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  ranges_[geometryCore] = range;
+
+  assert(!checkGLError());
+  return range.pool;
+}
+
+
+size_t IndirectDrawBatch::addDraw(GeometryCore* geometryCore, const glm::mat4& modelView) {
+  auto it = ranges_.find(geometryCore);
+  assert(it != ranges_.end() && it->second.pool >= 0);
+  const Range_& range = it->second;
+  const size_t index = commands_.size();
+  DrawElementsIndirectCommand_ command = { range.count, 1, range.firstIndex, range.baseVertex,
+      static_cast<GLuint>(index) };
+  commands_.push_back(command);
+  const GLfloat* matrix = glm::value_ptr(modelView);
+  drawData_.insert(drawData_.end(), matrix, matrix + 16);
+  drawData_.insert(drawData_.end(), 4, 1.0f);
+  return index;
+}
+
+
+void IndirectDrawBatch::upload() {
+  if (commands_.empty()) {
+    return;
+  }
+  const GLsizeiptr stride = DRAW_DATA_SIZE * sizeof(GLfloat);
+  const GLsizeiptr commandSize = commands_.size() * sizeof(DrawElementsIndirectCommand_);
+  const GLsizeiptr drawDataSize = drawData_.size() * sizeof(GLfloat);
+
+  // replace ring buffer by a larger one if the data does not fit into a single section,
+  // the previous buffer object is released by OpenGL when the GPU has finished reading it
+  const GLsizeiptr size = drawDataSize + stride + commandSize + sizeof(GLuint);
+  if (size > ringBuffer_->getSectionSize()) {
+    ringBuffer_ = RingBuffer::create(std::max(2 * ringBuffer_->getSectionSize(), 2 * size));
+    for (auto& pool : pools_) {
+      bindPool_(pool);
+    }
+  }
+
+  // start a new section, fencing the draw calls of the previous upload
+  ringBuffer_->endFrame();
+
+  // per-draw data is aligned to its stride, such that the base instances of the commands
+  // can be offset to the position of the data within the ring buffer
+  const GLintptr drawDataOffset = ringBuffer_->write(drawData_.data(), drawDataSize, stride);
+  const GLuint baseInstance = static_cast<GLuint>(drawDataOffset / stride);
+  DrawElementsIndirectCommand_* commands = reinterpret_cast<DrawElementsIndirectCommand_*>(
+      ringBuffer_->map(commandSize, sizeof(GLuint), commandOffset_));
+  for (size_t i = 0; i < commands_.size(); ++i) {
+    commands[i] = commands_[i];
+    commands[i].baseInstance += baseInstance;
+  }
+  ringBuffer_->unmap();
+
+  assert(!checkGLError());
+}
+
+
+void IndirectDrawBatch::render(RenderState* renderState, int pool, size_t firstDraw, size_t nDraws) {
+  assert(pool >= 0 && static_cast<size_t>(pool) < pools_.size());
+  assert(firstDraw + nDraws <= commands_.size());
+
+  // per-draw model-view matrices replace the one of the render state
+  renderState->modelViewStack.pushMatrix();
+  renderState->modelViewStack.setIdentity();
+  renderState->passToShader();
+  renderState->modelViewStack.popMatrix();
+
+  // draw primitives, vertex array object is kept bound for subsequent draw calls
+  renderState->glState.bindVertexArray(pools_[pool].vao);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ringBuffer_->getBuffer());
+  glMultiDrawElementsIndirect(pools_[pool].primitiveType, GL_UNSIGNED_INT,
+      reinterpret_cast<const GLvoid*>(commandOffset_
+          + firstDraw * sizeof(DrawElementsIndirectCommand_)),
+      static_cast<GLsizei>(nDraws), 0);
+
+  assert(!checkGLError());
+}
+
+
+void IndirectDrawBatch::clear() {
+  for (auto& pool : pools_) {
+    glDeleteBuffers(static_cast<GLsizei>(pool.vbos.size()), pool.vbos.data());
+    glDeleteBuffers(1, &pool.ibo);
+    RenderState::glState.removeVertexArray(pool.vao);
+    glDeleteVertexArrays(1, &pool.vao);
+  }
+  pools_.clear();
+  ranges_.clear();
+}
+
+
+int IndirectDrawBatch::getPool_(const Pool_& layout) {
+  for (size_t i = 0; i < pools_.size(); ++i) {
+    const Pool_& pool = pools_[i];
+    if (pool.primitiveType == layout.primitiveType && pool.locations == layout.locations
+        && pool.dims == layout.dims && pool.formats == layout.formats
+        && pool.offsets == layout.offsets
+        && pool.buffers == layout.buffers && pool.strides == layout.strides) {
+      return static_cast<int>(i);
+    }
+  }
+  Pool_ pool;
+  pool.primitiveType = layout.primitiveType;
+  pool.locations = layout.locations;
+  pool.dims = layout.dims;
+  pool.formats = layout.formats;
+  pool.offsets = layout.offsets;
+  pool.buffers = layout.buffers;
+  pool.strides = layout.strides;
+  pool.vbos.assign(layout.strides.size(), 0);
+  glGenVertexArrays(1, &pool.vao);
+  pool.ibo = 0;
+  pool.nVertices = 0;
+  pool.vertexCapacity = 0;
+  pool.nIndices = 0;
+  pool.indexCapacity = 0;
+  pool.nOutdatedVertices = 0;
+  pools_.push_back(pool);
+  return static_cast<int>(pools_.size() - 1);
+}
+
+
+void IndirectDrawBatch::reserve_(Pool_& pool, GLint nVertices, GLuint nIndices) {
+  // replace buffers by larger ones, copying their contents
+  auto grow = [](GLuint& buffer, GLsizeiptr oldSize, GLsizeiptr newSize) {
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+    if (buffer) {
+      if (oldSize > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+      }
+      glDeleteBuffers(1, &buffer);
+    }
+    buffer = newBuffer;
+  };
+  bool isGrown = false;
+  if (nVertices > pool.vertexCapacity) {
+    const GLint capacity = std::max(std::max(nVertices, 2 * pool.vertexCapacity),
+        MIN_VERTEX_CAPACITY);
+    for (size_t i = 0; i < pool.vbos.size(); ++i) {
+      const GLsizeiptr vertexSize = pool.strides[i];
+      grow(pool.vbos[i], pool.nVertices * vertexSize, capacity * vertexSize);
+    }
+    pool.vertexCapacity = capacity;
+    isGrown = true;
+  }
+  if (nIndices > pool.indexCapacity) {
+    const GLuint capacity = std::max(std::max(nIndices, 2 * pool.indexCapacity),
+        MIN_INDEX_CAPACITY);
+    grow(pool.ibo, pool.nIndices * sizeof(GLuint), capacity * sizeof(GLuint));
+    pool.indexCapacity = capacity;
+    isGrown = true;
+  }
+  if (isGrown) {
+    bindPool_(pool);
+  }
+}
+
+
+void IndirectDrawBatch::bindPool_(Pool_& pool) {
+  RenderState::glState.bindVertexArray(pool.vao);
+
+  // vertex attributes of the geometry cores
+  for (size_t i = 0; i < pool.locations.size(); ++i) {
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vbos[pool.buffers[i]]);
+    const VertexFormat format = pool.formats[i];
+    glVertexAttribPointer(pool.locations[i], VertexQuantizer::getNComponents(format, pool.dims[i]),
+        VertexQuantizer::getType(format), VertexQuantizer::isNormalized(format),
+        pool.strides[pool.buffers[i]], reinterpret_cast<const GLvoid*>(pool.offsets[i]));
+    glEnableVertexAttribArray(pool.locations[i]);
+  }
+
+  // per-draw attributes, selected by the base instance of each command
+  const GLsizei stride = DRAW_DATA_SIZE * sizeof(GLfloat);
+  const GLuint matrixLocation = OGLConstants::INSTANCE_MATRIX.location;
+  const GLuint colorLocation = OGLConstants::INSTANCE_COLOR.location;
+  glBindBuffer(GL_ARRAY_BUFFER, ringBuffer_->getBuffer());
+  for (GLuint i = 0; i < 4; ++i) {
+    glVertexAttribPointer(matrixLocation + i, 4, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<const GLvoid*>(4 * i * sizeof(GLfloat)));
+    glVertexAttribDivisor(matrixLocation + i, 1);
+    glEnableVertexAttribArray(matrixLocation + i);
+  }
+  glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, stride,
+      reinterpret_cast<const GLvoid*>(16 * sizeof(GLfloat)));
+  glVertexAttribDivisor(colorLocation, 1);
+  glEnableVertexAttribArray(colorLocation);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Note: GL_ELEMENT_ARRAY_BUFFER has to be kept bound
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ibo);
+  RenderState::glState.bindVertexArray(0);
+
+  assert(!checkGLError());
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,214 @@
+/**
+ * \file IndirectDrawBatch.h
+ * \brief Dynamic batching: draw items submitted by glMultiDrawElementsIndirect() over
+ *    shared vertex and index buffers (cf. RenderQueue::setIndirectDrawing()).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDIRECTDRAWBATCH_H_
+#define INDIRECTDRAWBATCH_H_
+
+#include <unordered_map>
+#include <vector>
+#include "scg_glew.h"
+#include "VertexQuantizer.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Dynamic batching: draw items submitted by glMultiDrawElementsIndirect() over
+ *    shared vertex and index buffers (cf. RenderQueue::setIndirectDrawing()).
+ *
+ * Geometry cores are copied into geometry pools on first use (addGeometry()), one pool
+ * per primitive type and vertex attribute layout. A pool consists of one vertex buffer
+ * object per vertex buffer of the geometry cores (i.e., with interleaved or separate
+ * attributes, cf. GeometryCore::setVertexData()), an element index buffer, and a vertex
+ * array object; the data is copied on the GPU (glCopyBufferSubData()) and the pools grow
+ * by doubling. Geometry cores in a GeometryArena are copied from their ranges.
+ *
+ * For each frame, draws are added as DrawElementsIndirectCommand structures with the
+ * model-view matrix of the draw as per-draw data (addDraw()), written once into a
+ * RingBuffer (upload()), and submitted in ranges of consecutive commands of the same
+ * pool (render()). The ring buffer is replaced by a larger one when the draws of a frame
+ * exceed its section size.
+ * The per-draw data is passed to the shader as instanced attributes
+ * OGLConstants::INSTANCE_MATRIX (the model-view matrix) and OGLConstants::INSTANCE_COLOR
+ * (white), and the base instance of each command selects the data of its draw. Thus,
+ * shaders written for InstancedShape (e.g., phong_instanced_vert.glsl) can be used;
+ * render() sets the model-view matrix of the render state to identity.
+ *
+ * Only geometry cores with DrawMode::ELEMENTS can be drawn indirectly. Modifications of
+ * geometry cores after they have been added are detected, the space of their previous
+ * copies is reclaimed by rebuilding the pools when it exceeds half of the pool.
+ * Requires OpenGL 4.3 or the extensions ARB_multi_draw_indirect and ARB_base_instance
+ * (cf. isSupported()).
+ */
+class IndirectDrawBatch {
+
+public:
+
+  /**
+   * Constructor, to be called with an active OpenGL context.
+   */
+  IndirectDrawBatch();
+
+  /**
+   * Destructor.
+   */
+  virtual ~IndirectDrawBatch();
+
+  /**
+   * Create shared pointer.
+   */
+  static IndirectDrawBatchSP create();
+
+  /**
+   * Check if the current OpenGL context supports indirect drawing.
+   */
+  static bool isSupported();
+
+  /**
+   * Get number of draw commands added since the last reset().
+   */
+  size_t getNDraws() const;
+
+  /**
+   * Remove draw commands of the previous frame, to be called before adding draws.
+   * Rebuilds the geometry pools if they contain too many outdated copies.
+   */
+  void reset();
+
+  /**
+   * Copy geometry core into a geometry pool unless it is there already.
+   * \return index of the pool holding the geometry core, -1 if the geometry core
+   *    cannot be drawn indirectly
+   */
+  int addGeometry(GeometryCore* geometryCore);
+
+  /**
+   * Add draw command for a geometry core that has been added by addGeometry() before.
+   * \return index of the draw command
+   */
+  size_t addDraw(GeometryCore* geometryCore, const glm::mat4& modelView);
+
+  /**
+   * Upload draw commands and per-draw data added since the last reset(), starting a
+   * new frame of the ring buffer.
+   */
+  void upload();
+
+  /**
+   * Draw a range of uploaded draw commands by a single glMultiDrawElementsIndirect() call,
+   * applying the render state with the model-view matrix set to identity.
+   * \param renderState current render state
+   * \param pool index of the geometry pool of all commands of the range
+   * \param firstDraw index of first draw command
+   * \param nDraws number of draw commands
+   */
+  void render(RenderState* renderState, int pool, size_t firstDraw, size_t nDraws);
+
+  /**
+   * Release geometry pools, such that geometry cores are copied again.
+   */
+  void clear();
+
+protected:
+
+  /**
+   * \brief Indirect draw command as expected by glMultiDrawElementsIndirect().
+   */
+  struct DrawElementsIndirectCommand_ {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+  };
+
+  /**
+   * \brief Vertex and element index buffers shared by geometry cores of the same
+   *    primitive type and vertex attribute layout.
+   */
+  struct Pool_ {
+    GLenum primitiveType;
+    std::vector<GLuint> locations;    // in ascending order
+    std::vector<GLint> dims;
+    std::vector<VertexFormat> formats;
+    std::vector<GLintptr> offsets;    // within vertex of buffer
+    std::vector<size_t> buffers;      // index of buffer of each attribute
+    std::vector<GLsizei> strides;     // vertex size of each buffer
+    std::vector<GLuint> vbos;         // per buffer
+    GLuint vao;
+    GLuint ibo;
+    GLint nVertices;
+    GLint vertexCapacity;
+    GLuint nIndices;
+    GLuint indexCapacity;
+    GLint nOutdatedVertices;          // vertices of modified geometry cores
+  };
+
+  /**
+   * \brief Range of a geometry core within a pool.
+   */
+  struct Range_ {
+    int pool;                         // -1 if not drawable indirectly
+    GLint baseVertex;
+    GLuint firstIndex;
+    GLuint count;
+    GLint nVertices;
+    unsigned long dataVersion;        // of the geometry core when copied
+  };
+
+  /**
+   * Find or create pool for the layout (primitive type and attribute layout) of the
+   * given pool.
+   */
+  int getPool_(const Pool_& layout);
+
+  /**
+   * Enlarge buffers of pool to hold at least the given number of vertices and indices,
+   * keeping their contents.
+   */
+  void reserve_(Pool_& pool, GLint nVertices, GLuint nIndices);
+
+  /**
+   * Set vertex attribute and element index bindings of the vertex array object of a pool.
+   */
+  void bindPool_(Pool_& pool);
+
+protected:
+
+  std::vector<Pool_> pools_;
+  std::unordered_map<GeometryCore*, Range_> ranges_;
+  std::vector<DrawElementsIndirectCommand_> commands_;
+  std::vector<GLfloat> drawData_;     // model-view matrix and color per draw
+  RingBufferSP ringBuffer_;           // draw commands and per-draw data
+  GLintptr commandOffset_;            // of the uploaded draw commands within the ring buffer
+
+};
+
+
+} /* namespace scg */
+
+#endif /* INDIRECTDRAWBATCH_H_ */
@@ -0,0 +1,321 @@
+/**
+ * \file InstancedShape.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "GeometryCore.h"
+#include "InstancedShape.h"
+#include "RenderState.h"
+#include "scg_utilities.h"
+
+namespace scg {
+
+
+InstancedShape::InstancedShape()
+    : instancesVersion_(1), dirtyBegin_(0), dirtyEnd_(0), vbo_(0), vboCapacity_(0),
+      boxDirtyBegin_(0), boxDirtyEnd_(0), isInstanceCulling_(true), nVisibleInstances_(0),
+      visibleInstancesVersion_(0), vboVisible_(0), vboVisibleCapacity_(0) {
+}
+
+
+InstancedShape::InstancedShape(GeometryCoreSP geometryCore)
+    : InstancedShape() {
+  addCore(geometryCore);
+}
+
+
+InstancedShape::~InstancedShape() {
+  if (isGLContextActive()) {
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &vboVisible_);
+  }
+}
+
+
+InstancedShapeSP InstancedShape::create() {
+  return std::make_shared<InstancedShape>();
+}
+
+
+InstancedShapeSP InstancedShape::create(GeometryCoreSP geometryCore) {
+  return std::make_shared<InstancedShape>(geometryCore);
+}
+
+
+size_t InstancedShape::getNInstances() const {
+  return instances_.size();
+}
+
+
+size_t InstancedShape::addInstance(const glm::mat4& matrix, const glm::vec4& color) {
+  InstanceData_ instance;
+  instance.matrix = matrix;
+  instance.color = color;
+  instances_.push_back(instance);
+  markInstancesModified_(instances_.size() - 1, instances_.size(), true);
+  return instances_.size() - 1;
+}
+
+
+void InstancedShape::removeInstance(size_t index) {
+  assert(index < instances_.size());
+  instances_[index] = instances_.back();
+  instances_.pop_back();
+  markInstancesModified_(index, std::min(index + 1, instances_.size()), true);
+}
+
+
+void InstancedShape::clearInstances() {
+  instances_.clear();
+  markInstancesModified_(0, 0, true);
+}
+
+
+const glm::mat4& InstancedShape::getInstanceMatrix(size_t index) const {
+  assert(index < instances_.size());
+  return instances_[index].matrix;
+}
+
+
+void InstancedShape::setInstanceMatrix(size_t index, const glm::mat4& matrix) {
+  assert(index < instances_.size());
+  instances_[index].matrix = matrix;
+  markInstancesModified_(index, index + 1, true);
+}
+
+
+const glm::vec4& InstancedShape::getInstanceColor(size_t index) const {
+  assert(index < instances_.size());
+  return instances_[index].color;
+}
+
+
+void InstancedShape::setInstanceColor(size_t index, const glm::vec4& color) {
+  assert(index < instances_.size());
+  instances_[index].color = color;
+  markInstancesModified_(index, index + 1, false);
+}
+
+
+void InstancedShape::setInstances(size_t first, size_t count, const glm::mat4* matrices,
+    const glm::vec4* colors) {
+  if (first + count > instances_.size()) {
+    InstanceData_ instance;
+    instance.color = glm::vec4(1.0f);
+    instances_.resize(first + count, instance);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    instances_[first + i].matrix = matrices[i];
+    if (colors) {
+      instances_[first + i].color = colors[i];
+    }
+  }
+  markInstancesModified_(first, first + count, true);
+}
+
+
+bool InstancedShape::isInstanceCulling() const {
+  return isInstanceCulling_;
+}
+
+
+void InstancedShape::setInstanceCulling(bool isInstanceCulling) {
+  isInstanceCulling_ = isInstanceCulling;
+}
+
+
+size_t InstancedShape::getNVisibleInstances() const {
+  return nVisibleInstances_;
+}
+
+
+const AABB& InstancedShape::getInstanceBoundingBox(size_t index) {
+  assert(index < instances_.size());
+  getBoundingBox();
+  return instanceBoxes_[index];
+}
+
+
+const AABB& InstancedShape::getBoundingBox() {
+  if (version_ >= boundsVersion_) {
+    updateInstanceBoxes_();
+    boundingBox_ = AABB();
+    for (auto& box : instanceBoxes_) {
+      boundingBox_.extend(box);
+    }
+    boundingSphere_ = BoundingSphere(boundingBox_);
+    boundsVersion_ = nextVersion();
+  }
+  return boundingBox_;
+}
+
+
+void InstancedShape::render(RenderState* renderState) {
+  if (instances_.empty()) {
+    nVisibleInstances_ = 0;
+    return;
+  }
+  updateBuffer_();
+
+  // skip instances outside of the view frustum
+  GLuint buffer = vbo_;
+  nVisibleInstances_ = instances_.size();
+  if (isInstanceCulling_) {
+    nVisibleInstances_ = cullInstances_(renderState);
+    if (nVisibleInstances_ == 0) {
+      return;
+    }
+    if (nVisibleInstances_ < instances_.size()) {
+      buffer = vboVisible_;
+    }
+  }
+
+  // process cores, drawing all instances of the geometry cores at once
+  for (auto& core : cores_) {
+    GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+    if (geometryCore) {
+      geometryCore->renderInstanced(renderState, buffer, static_cast<GLsizei>(nVisibleInstances_));
+    }
+    else {
+      core->render(renderState);
+    }
+  }
+
+  // restore render state (material, texture, etc.)
+  postProcessCores_(renderState);
+}
+
+
+void InstancedShape::markInstancesModified_(size_t begin, size_t end, bool isMatrixModified) {
+  ++instancesVersion_;
+  if (begin < end) {
+    dirtyBegin_ = (dirtyBegin_ < dirtyEnd_) ? std::min(dirtyBegin_, begin) : begin;
+    dirtyEnd_ = std::max(dirtyEnd_, end);
+  }
+  if (isMatrixModified) {
+    if (begin < end) {
+      boxDirtyBegin_ = (boxDirtyBegin_ < boxDirtyEnd_) ? std::min(boxDirtyBegin_, begin) : begin;
+      boxDirtyEnd_ = std::max(boxDirtyEnd_, end);
+    }
+    markModified_();
+  }
+}
+
+
+void InstancedShape::updateInstanceBoxes_() {
+  // bounding box of the geometry cores, all instances are affected if it has changed
+  AABB geometryBox;
+  for (auto& core : cores_) {
+    GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+    if (geometryCore) {
+      geometryBox.extend(geometryCore->getBoundingBox());
+    }
+  }
+  if (geometryBox.min != geometryBox_.min || geometryBox.max != geometryBox_.max) {
+    geometryBox_ = geometryBox;
+    boxDirtyBegin_ = 0;
+    boxDirtyEnd_ = instances_.size();
+  }
+
+  instanceBoxes_.resize(instances_.size());
+  lastPlanes_.resize(instances_.size(), 0);
+  const size_t end = std::min(boxDirtyEnd_, instances_.size());
+  for (size_t i = boxDirtyBegin_; i < end; ++i) {
+    instanceBoxes_[i] = geometryBox_.transform(instances_[i].matrix);
+  }
+  boxDirtyBegin_ = boxDirtyEnd_ = 0;
+}
+
+
+void InstancedShape::updateBuffer_() {
+  if (!vbo_) {
+    glGenBuffers(1, &vbo_);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  if (instances_.size() > vboCapacity_) {
+    // reallocate with spare capacity for subsequently added instances
+    vboCapacity_ = std::max(instances_.size(), 2 * vboCapacity_);
+    glBufferData(GL_ARRAY_BUFFER, vboCapacity_ * sizeof(InstanceData_), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances_.size() * sizeof(InstanceData_), instances_.data());
+  }
+  else {
+    const size_t end = std::min(dirtyEnd_, instances_.size());
+    if (dirtyBegin_ < end) {
+      glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin_ * sizeof(InstanceData_),
+          (end - dirtyBegin_) * sizeof(InstanceData_), &instances_[dirtyBegin_]);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  dirtyBegin_ = dirtyEnd_ = 0;
+
+  assert(!checkGLError());
+}
+
+
+size_t InstancedShape::cullInstances_(RenderState* renderState) {
+  getBoundingBox();
+
+  // test instance bounding boxes against view frustum in model coordinates
+  const ViewFrustum frustum(renderState->getMVPMatrix());
+  newVisibleIndices_.clear();
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    unsigned int planeMask = ViewFrustum::ALL_PLANES;
+    if (!frustum.isOutside(instanceBoxes_[i], planeMask, lastPlanes_[i])) {
+      newVisibleIndices_.push_back(static_cast<GLuint>(i));
+    }
+  }
+  if (newVisibleIndices_.size() == instances_.size()) {
+    visibleIndices_.clear();
+    return instances_.size();
+  }
+
+  // compact visible instances, unless unchanged since last frame
+  if (newVisibleIndices_ != visibleIndices_ || visibleInstancesVersion_ != instancesVersion_) {
+    visibleIndices_.swap(newVisibleIndices_);
+    visibleInstances_.resize(visibleIndices_.size());
+    for (size_t i = 0; i < visibleIndices_.size(); ++i) {
+      visibleInstances_[i] = instances_[visibleIndices_[i]];
+    }
+    if (!vboVisible_) {
+      glGenBuffers(1, &vboVisible_);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vboVisible_);
+    if (visibleInstances_.size() > vboVisibleCapacity_) {
+      vboVisibleCapacity_ = std::max(visibleInstances_.size(), 2 * vboVisibleCapacity_);
+    }
+    // orphan buffer to avoid waiting for pending draw calls
+    glBufferData(GL_ARRAY_BUFFER, vboVisibleCapacity_ * sizeof(InstanceData_), nullptr, GL_STREAM_DRAW);
+    if (!visibleInstances_.empty()) {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances_.size() * sizeof(InstanceData_),
+          visibleInstances_.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    visibleInstancesVersion_ = instancesVersion_;
+
+    assert(!checkGLError());
+  }
+  return visibleIndices_.size();
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,236 @@
+/**
+ * \file InstancedShape.h
+ * \brief A shape node that renders many instances of its geometry in a single draw call
+ *    (leaf node).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INSTANCEDSHAPE_H_
+#define INSTANCEDSHAPE_H_
+
+#include <vector>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "Shape.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief A shape node that renders many instances of its geometry in a single draw call
+ *    (leaf node).
+ *
+ * Each instance has a model matrix, applied before the current model-view matrix,
+ * and a color. The geometry cores are drawn by GeometryCore::renderInstanced(), i.e.,
+ * the shader has to read the per-instance attributes OGLConstants::INSTANCE_MATRIX and
+ * OGLConstants::INSTANCE_COLOR (cf. ShaderCoreFactory::createInstancedColorShader(),
+ * phong_instanced_vert.glsl). All other cores are applied once for all instances.
+ *
+ * Instance data is kept in main memory and uploaded to a vertex buffer object when
+ * rendering, transferring only the range of instances modified since the last frame.
+ * If instance culling is enabled, instances outside of the view frustum are skipped and
+ * the remaining ones are compacted into a second buffer, which is only updated if the set
+ * of visible instances or their data change.
+ *
+ * The bounding box of the shape encloses all instances. Picking (cf. BVH::intersect())
+ * reports the index of the instance that has been hit; instanced shapes are not used
+ * as occluders by OcclusionCuller.
+ */
+class InstancedShape: public Shape {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  InstancedShape();
+
+  /**
+   * Constructor with GeometryCore.
+   */
+  InstancedShape(GeometryCoreSP geometryCore);
+
+  /**
+   * Destructor.
+   */
+  virtual ~InstancedShape();
+
+  /**
+   * Create shared pointer.
+   */
+  static InstancedShapeSP create();
+
+  /**
+   * Create shared pointer with GeometryCore.
+   */
+  static InstancedShapeSP create(GeometryCoreSP geometryCore);
+
+  /**
+   * Get number of instances.
+   */
+  size_t getNInstances() const;
+
+  /**
+   * Add instance.
+   * \param matrix model matrix of instance
+   * \param color color of instance
+   * \return index of new instance
+   */
+  size_t addInstance(const glm::mat4& matrix, const glm::vec4& color = glm::vec4(1.0f));
+
+  /**
+   * Remove instance by moving the last instance to its index.
+   */
+  void removeInstance(size_t index);
+
+  /**
+   * Remove all instances.
+   */
+  void clearInstances();
+
+  /**
+   * Get model matrix of instance.
+   */
+  const glm::mat4& getInstanceMatrix(size_t index) const;
+
+  /**
+   * Set model matrix of instance.
+   */
+  void setInstanceMatrix(size_t index, const glm::mat4& matrix);
+
+  /**
+   * Get color of instance.
+   */
+  const glm::vec4& getInstanceColor(size_t index) const;
+
+  /**
+   * Set color of instance.
+   */
+  void setInstanceColor(size_t index, const glm::vec4& color);
+
+  /**
+   * Set model matrices and (optionally) colors of a range of instances, adding instances
+   * if the range exceeds the current number of instances.
+   * \param first index of first instance
+   * \param count number of instances
+   * \param matrices model matrices of the instances
+   * \param colors colors of the instances, or null to keep the current colors
+   *    (white for added instances)
+   */
+  void setInstances(size_t first, size_t count, const glm::mat4* matrices,
+      const glm::vec4* colors = nullptr);
+
+  /**
+   * Check if instances outside of the view frustum are skipped.
+   */
+  bool isInstanceCulling() const;
+
+  /**
+   * Enable or disable culling of instances outside of the view frustum.
+   *
+   * Default: enabled
+   */
+  void setInstanceCulling(bool isInstanceCulling);
+
+  /**
+   * Get number of instances drawn in the last frame.
+   */
+  size_t getNVisibleInstances() const;
+
+  /**
+   * Get bounding box of instance in model coordinates of the shape.
+   */
+  const AABB& getInstanceBoundingBox(size_t index);
+
+  /**
+   * Get bounding box of all instances in model coordinates.
+   */
+  virtual const AABB& getBoundingBox();
+
+  /**
+   * Render instances, i.e., process cores, drawing geometry cores instanced.
+   */
+  virtual void render(RenderState* renderState);
+
+protected:
+
+  /**
+   * \brief Per-instance vertex attributes, cf. GeometryCore::renderInstanced().
+   */
+  struct InstanceData_ {
+    glm::mat4 matrix;
+    glm::vec4 color;
+  };
+
+  /**
+   * Mark range of instances as modified, to be uploaded before next rendering.
+   */
+  void markInstancesModified_(size_t begin, size_t end, bool isMatrixModified);
+
+  /**
+   * Update bounding boxes of modified instances.
+   */
+  void updateInstanceBoxes_();
+
+  /**
+   * Upload modified instances to the vertex buffer object.
+   */
+  void updateBuffer_();
+
+  /**
+   * Determine visible instances and upload them to the buffer of visible instances
+   * if they have changed.
+   * \return number of visible instances
+   */
+  size_t cullInstances_(RenderState* renderState);
+
+protected:
+
+  std::vector<InstanceData_> instances_;
+  unsigned long instancesVersion_;
+  size_t dirtyBegin_;
+  size_t dirtyEnd_;
+  GLuint vbo_;
+  size_t vboCapacity_;
+
+  std::vector<AABB> instanceBoxes_;
+  std::vector<unsigned char> lastPlanes_;
+  AABB geometryBox_;
+  size_t boxDirtyBegin_;
+  size_t boxDirtyEnd_;
+
+  bool isInstanceCulling_;
+  size_t nVisibleInstances_;
+  std::vector<GLuint> visibleIndices_;
+  std::vector<GLuint> newVisibleIndices_;
+  std::vector<InstanceData_> visibleInstances_;
+  unsigned long visibleInstancesVersion_;
+  GLuint vboVisible_;
+  size_t vboVisibleCapacity_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* INSTANCEDSHAPE_H_ */
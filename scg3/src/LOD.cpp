@@ -0,0 +1,187 @@
+/**
+ * \file LOD.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include "scg_glew.h"
+#include <GLFW/glfw3.h>
+#include "BoundingVolume.h"
+#include "LOD.h"
+#include "RenderState.h"
+#include "Shape.h"
+#include "Traverser.h"
+
+namespace scg {
+
+
+LOD::LOD()
+    : hysteresis_(0.1f), fadeDuration_(0.0), level_(0), isLevelSelected_(false),
+      fadeLevel_(0), fadeStartTime_(0.0), fadeAlpha_(0.0f) {
+}
+
+
+LOD::~LOD() {
+}
+
+
+LODSP LOD::create() {
+  return std::make_shared<LOD>();
+}
+
+
+LODSP LOD::create(const std::vector<GeometryCoreSP>& geometryCores, GLfloat minScreenSize) {
+  auto lod = std::make_shared<LOD>();
+  for (size_t i = 0; i < geometryCores.size(); ++i) {
+    lod->addLevel(Shape::create(geometryCores[i]), (i + 1 < geometryCores.size()) ? minScreenSize : 0.0f);
+    minScreenSize *= 0.5f;
+  }
+  return lod;
+}
+
+
+LOD* LOD::addLevel(NodeSP node, GLfloat minScreenSize) {
+  const size_t level = getNLevels();
+  addChild(node);
+  setMinScreenSize(level, minScreenSize);
+  return this;
+}
+
+
+size_t LOD::getNLevels() const {
+  return getNChildren();
+}
+
+
+GLfloat LOD::getMinScreenSize(size_t level) const {
+  return (level < minScreenSizes_.size()) ? minScreenSizes_[level] : 0.0f;
+}
+
+
+void LOD::setMinScreenSize(size_t level, GLfloat minScreenSize) {
+  if (level >= minScreenSizes_.size()) {
+    minScreenSizes_.resize(level + 1, 0.0f);
+  }
+  minScreenSizes_[level] = minScreenSize;
+}
+
+
+GLfloat LOD::getHysteresis() const {
+  return hysteresis_;
+}
+
+
+void LOD::setHysteresis(GLfloat hysteresis) {
+  hysteresis_ = hysteresis;
+}
+
+
+double LOD::getFadeDuration() const {
+  return fadeDuration_;
+}
+
+
+void LOD::setFadeDuration(double fadeDuration) {
+  fadeDuration_ = fadeDuration;
+}
+
+
+size_t LOD::getLevel() const {
+  return std::min(level_, getNLevels());
+}
+
+
+size_t LOD::getFadeLevel() const {
+  return (fadeAlpha_ > 0.0f) ? std::min(fadeLevel_, getNLevels()) : getNLevels();
+}
+
+
+GLfloat LOD::getFadeAlpha() const {
+  return fadeAlpha_;
+}
+
+
+GLfloat LOD::getScreenSize(RenderState* renderState) {
+  const BoundingSphere sphere = getBoundingSphere().transform(renderState->modelViewStack.getMatrix());
+  if (sphere.isEmpty()) {
+    return 0.0f;
+  }
+  const glm::mat4& projection = renderState->projectionStack.getMatrix();
+  const GLfloat size = 2.0f * sphere.radius * projection[1][1] * renderState->getLODScale();
+  if (projection[2][3] == 0.0f) {
+    return size;    // orthographic projection
+  }
+
+  // perspective projection, eye inside of bounding sphere
+  const GLfloat distance = -sphere.center.z;
+  if (distance <= sphere.radius) {
+    return FLT_MAX;
+  }
+  return size / distance;
+}
+
+
+void LOD::selectLevel(RenderState* renderState) {
+  const size_t nLevels = getNLevels();
+  const size_t oldLevel = level_;
+  const bool wasLevelSelected = isLevelSelected_;
+  const GLfloat screenSize = getScreenSize(renderState);
+  if (!isLevelSelected_ || level_ > nLevels) {
+    // initial selection without hysteresis
+    level_ = 0;
+    while (level_ < nLevels && screenSize < getMinScreenSize(level_)) {
+      ++level_;
+    }
+    isLevelSelected_ = true;
+  }
+  else {
+    // change to finer or coarser levels only beyond hysteresis
+    while (level_ > 0 && screenSize >= getMinScreenSize(level_ - 1) * (1.0f + hysteresis_)) {
+      --level_;
+    }
+    while (level_ < nLevels && screenSize < getMinScreenSize(level_) * (1.0f - hysteresis_)) {
+      ++level_;
+    }
+  }
+
+  // fade out previous level
+  const double time = glfwGetTime();
+  if (wasLevelSelected && level_ != oldLevel && fadeDuration_ > 0.0 && oldLevel < nLevels) {
+    fadeLevel_ = oldLevel;
+    fadeStartTime_ = time;
+  }
+  fadeAlpha_ = (fadeDuration_ > 0.0 && fadeLevel_ != level_) ?
+      static_cast<GLfloat>(std::max(1.0 - (time - fadeStartTime_) / fadeDuration_, 0.0)) : 0.0f;
+}
+
+
+void LOD::accept(Traverser* traverser) {
+  traverser->visitLOD(this);
+}
+
+
+void LOD::acceptPost(Traverser* traverser) {
+  traverser->visitPostLOD(this);
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,182 @@
+/**
+ * \file LOD.h
+ * \brief A level-of-detail node that renders one of its children, selected by the
+ *    projected screen size of its bounding sphere (composite node).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOD_H_
+#define LOD_H_
+
+#include <vector>
+#include "scg_glew.h"
+#include "Composite.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief A level-of-detail node that renders one of its children, selected by the
+ *    projected screen size of its bounding sphere (composite node).
+ *
+ * The children are the levels in the order they have been added, from the highest to
+ * the lowest level of detail. Level i is selected if the screen size (cf. getScreenSize())
+ * is at least its minimum screen size, which has to decrease with the level.
+ * No level is rendered if the screen size is below the minimum screen size of the
+ * last level.
+ *
+ * To avoid popping due to small movements, the selected level is only changed if the
+ * screen size leaves the range of the current level by more than the hysteresis
+ * (cf. setHysteresis()). Optionally, the previous level is faded out over the new one
+ * after a change (cf. setFadeDuration()), by rendering it a second time with constant
+ * alpha blending and without depth writes.
+ *
+ * The level is selected by RenderTraverser and CompiledScene, other traversers
+ * (e.g., PreTraverser, InfoTraverser) process all levels. A LOD node does not have
+ * cores, cores to be applied to all levels have to be added to an enclosing Group.
+ */
+class LOD: public Composite {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  LOD();
+
+  /**
+   * Destructor.
+   */
+  virtual ~LOD();
+
+  /**
+   * Create shared pointer.
+   */
+  static LODSP create();
+
+  /**
+   * Create shared pointer with shapes for the given geometry cores, e.g., created by
+   * GeometryCoreFactory::createSphereLODs(). The minimum screen size is halved from level
+   * to level, starting with the given value, and set to 0 for the last level.
+   * \param geometryCores geometry cores from the highest to the lowest level of detail
+   * \param minScreenSize minimum screen size of the first level
+   */
+  static LODSP create(const std::vector<GeometryCoreSP>& geometryCores, GLfloat minScreenSize);
+
+  /**
+   * Add child as next level with given minimum screen size.
+   * \return this pointer for method chaining
+   */
+  LOD* addLevel(NodeSP node, GLfloat minScreenSize);
+
+  /**
+   * Get number of levels, i.e., number of children.
+   */
+  size_t getNLevels() const;
+
+  /**
+   * Get minimum screen size of level, 0 if not defined.
+   */
+  GLfloat getMinScreenSize(size_t level) const;
+
+  /**
+   * Set minimum screen size of level, i.e., of the child at the given position in
+   * the order of getChildren().
+   */
+  void setMinScreenSize(size_t level, GLfloat minScreenSize);
+
+  /**
+   * Get hysteresis.
+   */
+  GLfloat getHysteresis() const;
+
+  /**
+   * Set hysteresis as relative deviation of the screen size from the minimum screen
+   * sizes required to change the level, default: 0.1.
+   */
+  void setHysteresis(GLfloat hysteresis);
+
+  /**
+   * Get fade duration (seconds).
+   */
+  double getFadeDuration() const;
+
+  /**
+   * Set duration (seconds) of fading out the previous level after a change of the level,
+   * 0 to disable fading (default).
+   */
+  void setFadeDuration(double fadeDuration);
+
+  /**
+   * Get level selected in last frame, getNLevels() if no level is rendered.
+   */
+  size_t getLevel() const;
+
+  /**
+   * Get level being faded out, getNLevels() if none.
+   */
+  size_t getFadeLevel() const;
+
+  /**
+   * Get alpha value of level being faded out, in range [0, 1].
+   */
+  GLfloat getFadeAlpha() const;
+
+  /**
+   * Get projected diameter of bounding sphere for the current model-view and projection
+   * matrices, in units defined by RenderState::getLODScale() (e.g., pixels).
+   */
+  GLfloat getScreenSize(RenderState* renderState);
+
+  /**
+   * Select level for the current model-view and projection matrices (cf. getLevel()),
+   * start fading out the previous level if enabled.
+   */
+  void selectLevel(RenderState* renderState);
+
+  /**
+   * Accept traverser (visitor pattern).
+   */
+  virtual void accept(Traverser* traverser);
+
+  /**
+   * Accept traverser after traversing sub-tree (visitor pattern).
+   */
+  virtual void acceptPost(Traverser* traverser);
+
+protected:
+
+  std::vector<GLfloat> minScreenSizes_;
+  GLfloat hysteresis_;
+  double fadeDuration_;
+  size_t level_;
+  bool isLevelSelected_;
+  size_t fadeLevel_;
+  double fadeStartTime_;
+  GLfloat fadeAlpha_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* LOD_H_ */
@@ -34,18 +34,4 @@ Leaf::~Leaf() {
 }
 
 
-void Leaf::traverse(Traverser* traverser) {
-  // check if node is visible
-  if (isVisible_) {
-    // process node
-    accept(traverser);
-  }
-
-  // recursively traverse siblings (if any)
-  if (rightSibling_) {
-    rightSibling_->traverse(traverser);
-  }
-}
-
-
 } /* namespace scg */
@@ -47,11 +47,6 @@ public:
    */
   virtual ~Leaf() = 0;
 
-  /**
-   * Traverse node tree (depth-first, pre-order) with given traverser.
-   */
-  virtual void traverse(Traverser* traverser);
-
 };
 
 
@@ -21,28 +21,23 @@
  * limitations under the License.
  */
 
-#include <cassert>
+#include <cstring>
 #include "Light.h"
 #include "RenderState.h"
 #include "Traverser.h"
-#include "scg_utilities.h"
 
 namespace scg {
 
 
 Light::Light()
-  : ubo_(0), position_(0.f, 0.f, 0.f, 1.f), ambient_(0.f, 0.f, 0.f, 1.f),
+  : position_(0.f, 0.f, 0.f, 1.f), ambient_(0.f, 0.f, 0.f, 1.f),
     diffuse_(0.f, 0.f, 0.f, 1.f), specular_(0.f, 0.f, 0.f, 1.f),
     spotCosCutoff_(0.f), spotExponent_(0.f), modelTransform_(1.0f) {
-  glGenBuffers(1, &ubo_);
-  assert(!checkGLError());
+  memset(data_, 0, BUFFER_SIZE);
 }
 
 
 Light::~Light() {
-  if (isGLContextActive()) {
-    glDeleteBuffers(1, &ubo_);
-  }
 }
 
 
@@ -96,21 +91,12 @@ void Light::setModelTransform(const glm::mat4 modelTransform) {
 }
 
 void Light::init() {
-  GLubyte* buffer = new GLubyte[BUFFER_SIZE];
   // note: position, half vector, and spot direction are updated for each frame in render()
-  memcpy(buffer + AMBIENT_OFFSET, glm::value_ptr(ambient_), VEC4_SIZE);
-  memcpy(buffer + DIFFUSE_OFFSET, glm::value_ptr(diffuse_), VEC4_SIZE);
-  memcpy(buffer + SPECULAR_OFFSET, glm::value_ptr(specular_), VEC4_SIZE);
-  memcpy(buffer + SPOT_COS_CUTOFF_OFFSET, &spotCosCutoff_, FLOAT_SIZE);
-  memcpy(buffer + SPOT_EXPONENT_OFFSET, &spotExponent_, FLOAT_SIZE);
-  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
-  assert(glIsBuffer(ubo_));
-  glBufferData(GL_UNIFORM_BUFFER, BUFFER_SIZE, buffer, GL_DYNAMIC_DRAW);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
-  delete [] buffer;
-  buffer = nullptr;
-
-  assert(!checkGLError());
+  memcpy(data_ + AMBIENT_OFFSET, glm::value_ptr(ambient_), VEC4_SIZE);
+  memcpy(data_ + DIFFUSE_OFFSET, glm::value_ptr(diffuse_), VEC4_SIZE);
+  memcpy(data_ + SPECULAR_OFFSET, glm::value_ptr(specular_), VEC4_SIZE);
+  memcpy(data_ + SPOT_COS_CUTOFF_OFFSET, &spotCosCutoff_, FLOAT_SIZE);
+  memcpy(data_ + SPOT_EXPONENT_OFFSET, &spotExponent_, FLOAT_SIZE);
 }
 
 
@@ -129,12 +115,9 @@ void Light::render(RenderState* renderState) {
   renderState->addLight();
 
   // update light position transformed by model-view transformation
-  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
-  assert(glIsBuffer(ubo_));
   glm::mat4 modelViewTransform = renderState->getViewTransform() * modelTransform_;
   glm::vec4 transfPosition = modelViewTransform * position_;
-  glBufferSubData(GL_UNIFORM_BUFFER, POSITION_OFFSET, VEC4_SIZE,
-      glm::value_ptr(transfPosition));
+  memcpy(data_ + POSITION_OFFSET, glm::value_ptr(transfPosition), VEC4_SIZE);
 
   // check if half vector or spot direction have to be updated
   if (position_.w < 0.001f) {           // directional light
@@ -142,25 +125,17 @@ void Light::render(RenderState* renderState) {
     // in eye coordinates, and normalize vector
     glm::vec4 halfVector = glm::normalize(
         glm::vec4(0.f, 0.f, 1.f, 0.f) + glm::normalize(transfPosition));
-    glBufferSubData(GL_UNIFORM_BUFFER, HALF_VECTOR_OFFSET, VEC4_SIZE,
-        glm::value_ptr(halfVector));
+    memcpy(data_ + HALF_VECTOR_OFFSET, glm::value_ptr(halfVector), VEC4_SIZE);
   }
   else if (spotCosCutoff_ >= 0.001f) {  // spotlight
     // update spot direction transformed by model-view transformation,
     // and normalize vector
     glm::vec4 transfSpotDirection = glm::normalize(modelViewTransform * spotDirection_);
-    glBufferSubData(GL_UNIFORM_BUFFER, SPOT_DIRECTION_OFFSET, VEC4_SIZE,
-        glm::value_ptr(transfSpotDirection));
+    memcpy(data_ + SPOT_DIRECTION_OFFSET, glm::value_ptr(transfSpotDirection), VEC4_SIZE);
   }
 
-  // copy buffer contents to light UBO
-  glBindBuffer(GL_COPY_WRITE_BUFFER, renderState->getLightUBO());
-  glCopyBufferSubData(GL_UNIFORM_BUFFER, GL_COPY_WRITE_BUFFER, 0,
-      (renderState->getNLights() - 1) * BUFFER_SIZE, BUFFER_SIZE);
-  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-  assert(!checkGLError());
+  // pass light properties to render state, written into the light block before drawing
+  renderState->setLight(renderState->getNLights() - 1, data_);
 }
 
 
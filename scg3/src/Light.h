@@ -117,12 +117,13 @@ public:
 
   /**
    * Set model transformation from scene graph location,
-   * to be called by PreTraverser.
+   * to be called by the renderer (cf. StandardRenderer) or PreTraverser.
    */
   void setModelTransform(const glm::mat4 modelTransform);
 
   /**
-   * Initialize light, i.e., create UBO.
+   * Initialize light, i.e., store the light properties in the uniform block data
+   * (cf. RenderState::setLight()).
    */
   void init();
 
@@ -137,7 +138,8 @@ public:
   virtual void acceptPost(Traverser* traverser);
 
   /**
-   * Render light, i.e., add light to render state and bind UBO.
+   * Render light, i.e., add light to render state and pass its transformed position,
+   * half vector, or spot direction with the other properties.
    */
   virtual void render(RenderState* renderState);
 
@@ -148,7 +150,7 @@ public:
 
 public:
 
-  // parameters for uniform buffer object (UBO)
+  // parameters for light uniform block (std140 layout)
   static const size_t FLOAT_SIZE = 4;
   static const size_t VEC4_SIZE = 16;
   static const size_t POSITION_OFFSET = 0;
@@ -163,7 +165,7 @@ public:
 
 protected:
 
-  GLuint ubo_;          // uniform buffer object
+  GLubyte data_[BUFFER_SIZE];   // uniform block data
   glm::vec4 position_;
   glm::vec4 ambient_;
   glm::vec4 diffuse_;
@@ -41,6 +41,7 @@ MaterialCore::MaterialCore()
 
 MaterialCore::~MaterialCore() {
   if (isGLContextActive()) {
+    RenderState::glState.removeBuffer(ubo_);
     glDeleteBuffers(1, &ubo_);
   }
 }
@@ -75,6 +76,11 @@ MaterialCore* MaterialCore::setDiffuse(const glm::vec4& color) {
 }
 
 
+const glm::vec4& MaterialCore::getDiffuse() const {
+  return diffuse_;
+}
+
+
 MaterialCore* MaterialCore::setSpecular(const glm::vec4& color) {
   specular_ = color;
   return this;
@@ -106,8 +112,8 @@ void MaterialCore::init() {
 
 
 void MaterialCore::render(RenderState* renderState) {
-  glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, OGLConstants::MATERIAL.bindingPoint, &uboOld_);
-  glBindBufferBase(GL_UNIFORM_BUFFER, OGLConstants::MATERIAL.bindingPoint, ubo_);
+  uboOld_ = static_cast<GLint>(renderState->glState.getUniformBuffer(OGLConstants::MATERIAL.bindingPoint));
+  renderState->glState.bindUniformBuffer(OGLConstants::MATERIAL.bindingPoint, ubo_);
   assert(glIsBuffer(ubo_));
 
   assert(!checkGLError());
@@ -115,7 +121,7 @@ void MaterialCore::render(RenderState* renderState) {
 
 
 void MaterialCore::renderPost(RenderState* renderState) {
-  glBindBufferBase(GL_UNIFORM_BUFFER, OGLConstants::MATERIAL.bindingPoint, uboOld_);
+  renderState->glState.bindUniformBuffer(OGLConstants::MATERIAL.bindingPoint, uboOld_);
 
   assert(!checkGLError());
 }
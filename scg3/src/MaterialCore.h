@@ -84,6 +84,11 @@ public:
    */
   MaterialCore* setDiffuse(const glm::vec4& color);
 
+  /**
+   * Get diffuse RGBA color.
+   */
+  const glm::vec4& getDiffuse() const;
+
   /**
    * Set specular RGBA color.
    * \return this pointer for method chaining
@@ -0,0 +1,817 @@
+/**
+ * \file MeshSimplifier.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include "BoundingVolume.h"
+#include "MeshSimplifier.h"
+
+namespace scg {
+
+
+namespace {
+
+// maximum number of attribute components per vertex: normal xyz, texture coordinates uv
+const int MAX_ATTRIBUTES = 5;
+
+// minimum cosine of angle between face normals before and after a collapse
+const double MIN_NORMAL_COS = 0.25;
+
+// cost of invalid collapses
+const double INVALID_COST = DBL_MAX;
+
+
+/**
+ * Symmetric quadric error(p) = p^T A p + 2 b^T p + c with accumulated weight w.
+ */
+struct Quadric {
+
+  Quadric()
+      : a00(0.0), a01(0.0), a02(0.0), a11(0.0), a12(0.0), a22(0.0),
+        b0(0.0), b1(0.0), b2(0.0), c(0.0), w(0.0) {
+  }
+
+  /**
+   * Add squared distance to plane n * p + d = 0 (or squared deviation from linear
+   * function n * p + d for non-normalized n), without changing the weight.
+   */
+  void addPlane(const glm::dvec3& n, double d, double weight) {
+    a00 += weight * n.x * n.x;
+    a01 += weight * n.x * n.y;
+    a02 += weight * n.x * n.z;
+    a11 += weight * n.y * n.y;
+    a12 += weight * n.y * n.z;
+    a22 += weight * n.z * n.z;
+    b0 += weight * n.x * d;
+    b1 += weight * n.y * d;
+    b2 += weight * n.z * d;
+    c += weight * d * d;
+  }
+
+  void add(const Quadric& q) {
+    a00 += q.a00; a01 += q.a01; a02 += q.a02;
+    a11 += q.a11; a12 += q.a12; a22 += q.a22;
+    b0 += q.b0; b1 += q.b1; b2 += q.b2;
+    c += q.c;
+    w += q.w;
+  }
+
+  double eval(const glm::dvec3& p) const {
+    return a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+        + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+        + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+  }
+
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+  double w;
+
+};
+
+
+/**
+ * Quadric of squared deviations of attribute values s_j from their linear interpolation
+ * g_j * p + d_j across the faces, i.e., sum of weight * (g_j * p + d_j - s_j)^2
+ * (cf. Hoppe, 1999). The terms quadratic in p are stored in quadric, the mixed terms
+ * in gradients and offsets, the terms quadratic in s_j use the weight of the quadric.
+ */
+struct AttributeQuadric {
+
+  AttributeQuadric() {
+    for (int j = 0; j < MAX_ATTRIBUTES; ++j) {
+      gradients[j] = glm::dvec3(0.0);
+      offsets[j] = 0.0;
+    }
+  }
+
+  void add(const AttributeQuadric& q, int nAttributes) {
+    quadric.add(q.quadric);
+    for (int j = 0; j < nAttributes; ++j) {
+      gradients[j] += q.gradients[j];
+      offsets[j] += q.offsets[j];
+    }
+  }
+
+  double eval(const glm::dvec3& p, const double* values, int nAttributes) const {
+    double error = quadric.eval(p);
+    for (int j = 0; j < nAttributes; ++j) {
+      error += values[j] * (quadric.w * values[j] - 2.0 * (glm::dot(gradients[j], p) + offsets[j]));
+    }
+    return error;
+  }
+
+  Quadric quadric;
+  glm::dvec3 gradients[MAX_ATTRIBUTES];
+  double offsets[MAX_ATTRIBUTES];
+
+};
+
+
+/**
+ * Candidate half-edge collapse of vertex 'from' onto vertex 'to', valid as long as
+ * the version numbers of both vertices are unchanged.
+ */
+struct Collapse {
+
+  bool operator>(const Collapse& other) const {
+    return cost > other.cost;
+  }
+
+  double cost;
+  GLuint from;
+  GLuint to;
+  unsigned int fromVersion;
+  unsigned int toVersion;
+
+};
+
+
+/**
+ * State of the simplification of a single mesh.
+ *
+ * Mesh vertices are called wedges here, vertices are groups of wedges sharing
+ * the same position. Triangles refer to wedges, adjacency and quadrics of positions
+ * refer to vertices, attribute quadrics refer to wedges.
+ */
+class EdgeCollapser {
+
+public:
+
+  EdgeCollapser(const TriangleMesh& mesh, GLfloat normalWeight, GLfloat texCoordWeight,
+      GLfloat boundaryWeight);
+
+  /**
+   * Collapse edges until the target number of triangles or the maximum error is reached.
+   * \return error of the simplified mesh
+   */
+  double run(size_t targetTriangles, double maxError);
+
+  /**
+   * Create mesh of the remaining triangles.
+   */
+  TriangleMesh getResult() const;
+
+private:
+
+  void initQuadrics_(GLfloat boundaryWeight);
+
+  /**
+   * Compute cost of collapsing vertex u onto vertex v, INVALID_COST if the collapse
+   * is not allowed. Stores the mapping of the wedges of u to the wedges of v in wedgeMap_.
+   */
+  double evaluate_(GLuint u, GLuint v);
+
+  /**
+   * Collapse vertex u onto vertex v using the wedge mapping of the last evaluate_() call.
+   */
+  void collapse_(GLuint u, GLuint v);
+
+  /**
+   * Push the cheaper valid direction of edge (u, v) onto the queue.
+   */
+  void pushEdge_(GLuint u, GLuint v);
+
+  /**
+   * Collect vertices adjacent to vertex u via alive triangles.
+   */
+  void collectNeighbors_(GLuint u, std::vector<GLuint>& neighbors) const;
+
+  GLuint getMappedWedge_(GLuint wedge) const;
+
+  const TriangleMesh& mesh_;
+  int nAttributes_;
+  std::vector<double> attributes_;            // nAttributes_ weighted values per wedge
+  std::vector<GLuint> wedgeVertices_;         // vertex of each wedge
+  std::vector<glm::dvec3> positions_;         // normalized position of each vertex
+  std::vector<GLuint> corners_;               // three wedges per triangle
+  std::vector<char> isTriangleAlive_;
+  size_t nAliveTriangles_;
+  std::vector<std::vector<GLuint> > vertexTriangles_;
+  std::vector<Quadric> quadrics_;
+  std::vector<AttributeQuadric> attributeQuadrics_;
+  std::vector<unsigned int> versions_;
+  std::vector<char> isVertexRemoved_;
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > queue_;
+  std::vector<std::pair<GLuint, GLuint> > wedgeMap_;
+  std::vector<GLuint> neighbors_;
+  std::vector<GLuint> otherNeighbors_;
+
+};
+
+
+EdgeCollapser::EdgeCollapser(const TriangleMesh& mesh, GLfloat normalWeight,
+    GLfloat texCoordWeight, GLfloat boundaryWeight)
+    : mesh_(mesh), nAttributes_(0), nAliveTriangles_(0) {
+  const size_t nWedges = mesh.vertices.size();
+  const bool hasNormals = mesh.normals.size() == nWedges && normalWeight > 0.0f;
+  const bool hasTexCoords = mesh.texCoords.size() == nWedges && texCoordWeight > 0.0f;
+  nAttributes_ = (hasNormals ? 3 : 0) + (hasTexCoords ? 2 : 0);
+  attributes_.reserve(nWedges * nAttributes_);
+  for (size_t i = 0; i < nWedges; ++i) {
+    if (hasNormals) {
+      for (int j = 0; j < 3; ++j) {
+        attributes_.push_back(normalWeight * mesh.normals[i][j]);
+      }
+    }
+    if (hasTexCoords) {
+      for (int j = 0; j < 2; ++j) {
+        attributes_.push_back(texCoordWeight * mesh.texCoords[i][j]);
+      }
+    }
+  }
+
+  // group wedges with identical positions into vertices
+  std::vector<GLuint> order(nWedges);
+  for (size_t i = 0; i < nWedges; ++i) {
+    order[i] = static_cast<GLuint>(i);
+  }
+  const auto& vertices = mesh.vertices;
+  std::sort(order.begin(), order.end(), [&vertices](GLuint a, GLuint b) {
+    return std::make_tuple(vertices[a].x, vertices[a].y, vertices[a].z)
+        < std::make_tuple(vertices[b].x, vertices[b].y, vertices[b].z);
+  });
+
+  // normalize positions to unit bounding box diagonal
+  const AABB box = AABB::fromPoints(nWedges ? &vertices[0].x : nullptr, nWedges, 3);
+  const GLfloat diagonal = box.isEmpty() ? 0.0f : glm::length(box.max - box.min);
+  const double scale = (diagonal > 0.0f) ? 1.0 / diagonal : 1.0;
+  wedgeVertices_.resize(nWedges);
+  for (size_t i = 0; i < nWedges; ++i) {
+    if (i == 0 || vertices[order[i]] != vertices[order[i - 1]]) {
+      positions_.push_back(scale * (glm::dvec3(vertices[order[i]]) - glm::dvec3(box.min)));
+    }
+    wedgeVertices_[order[i]] = static_cast<GLuint>(positions_.size() - 1);
+  }
+
+  // set up triangles, skip degenerate ones
+  const size_t nVertices = positions_.size();
+  vertexTriangles_.resize(nVertices);
+  const size_t nTriangles = mesh.getNTriangles();
+  corners_.assign(mesh.indices.begin(), mesh.indices.begin() + 3 * nTriangles);
+  isTriangleAlive_.assign(nTriangles, 0);
+  for (size_t t = 0; t < nTriangles; ++t) {
+    const GLuint* c = &corners_[3 * t];
+    if (c[0] >= nWedges || c[1] >= nWedges || c[2] >= nWedges) {
+      continue;
+    }
+    const GLuint v0 = wedgeVertices_[c[0]];
+    const GLuint v1 = wedgeVertices_[c[1]];
+    const GLuint v2 = wedgeVertices_[c[2]];
+    if (v0 == v1 || v1 == v2 || v2 == v0) {
+      continue;
+    }
+    isTriangleAlive_[t] = 1;
+    ++nAliveTriangles_;
+    for (int k = 0; k < 3; ++k) {
+      vertexTriangles_[wedgeVertices_[c[k]]].push_back(static_cast<GLuint>(t));
+    }
+  }
+
+  quadrics_.resize(nVertices);
+  attributeQuadrics_.resize(nAttributes_ > 0 ? nWedges : 0);
+  versions_.assign(nVertices, 0);
+  isVertexRemoved_.assign(nVertices, 0);
+  initQuadrics_(boundaryWeight);
+}
+
+
+void EdgeCollapser::initQuadrics_(GLfloat boundaryWeight) {
+  // edges between vertices: first triangle, number of triangles, seam flag
+  struct Edge {
+    GLuint triangle;
+    GLuint wedges[2];
+    int nTriangles;
+    bool isSeam;
+  };
+  std::unordered_map<uint64_t, Edge> edges;
+  edges.reserve(corners_.size());
+
+  for (size_t t = 0; t < isTriangleAlive_.size(); ++t) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    const GLuint* c = &corners_[3 * t];
+    const glm::dvec3& p0 = positions_[wedgeVertices_[c[0]]];
+    const glm::dvec3& p1 = positions_[wedgeVertices_[c[1]]];
+    const glm::dvec3& p2 = positions_[wedgeVertices_[c[2]]];
+    const glm::dvec3 e1 = p1 - p0;
+    const glm::dvec3 e2 = p2 - p0;
+    const glm::dvec3 cross = glm::cross(e1, e2);
+    const double length = glm::length(cross);
+    const double area = 0.5 * length;
+
+    // plane quadric weighted by area
+    if (length > 0.0) {
+      const glm::dvec3 normal = cross / length;
+      Quadric q;
+      q.addPlane(normal, -glm::dot(normal, p0), area);
+      q.w = area;
+      for (int k = 0; k < 3; ++k) {
+        quadrics_[wedgeVertices_[c[k]]].add(q);
+      }
+    }
+
+    // attribute quadrics: gradients of linear interpolation within the triangle plane
+    if (nAttributes_ > 0) {
+      const double a = glm::dot(e1, e1);
+      const double b = glm::dot(e1, e2);
+      const double d = glm::dot(e2, e2);
+      const double det = a * d - b * b;
+      if (det > 1e-12 * a * d && det > 0.0) {
+        AttributeQuadric q;
+        const double* s0 = &attributes_[c[0] * nAttributes_];
+        const double* s1 = &attributes_[c[1] * nAttributes_];
+        const double* s2 = &attributes_[c[2] * nAttributes_];
+        for (int j = 0; j < nAttributes_; ++j) {
+          const double ds1 = s1[j] - s0[j];
+          const double ds2 = s2[j] - s0[j];
+          const glm::dvec3 gradient = ((d * ds1 - b * ds2) / det) * e1 + ((a * ds2 - b * ds1) / det) * e2;
+          const double offset = s0[j] - glm::dot(gradient, p0);
+          q.quadric.addPlane(gradient, offset, area);
+          q.gradients[j] = area * gradient;
+          q.offsets[j] = area * offset;
+        }
+        q.quadric.w = area;
+        for (int k = 0; k < 3; ++k) {
+          attributeQuadrics_[c[k]].add(q, nAttributes_);
+        }
+      }
+    }
+
+    // collect edges, detect attribute seams
+    for (int k = 0; k < 3; ++k) {
+      GLuint w0 = c[k];
+      GLuint w1 = c[(k + 1) % 3];
+      if (wedgeVertices_[w0] > wedgeVertices_[w1]) {
+        std::swap(w0, w1);
+      }
+      const uint64_t key = (static_cast<uint64_t>(wedgeVertices_[w0]) << 32) | wedgeVertices_[w1];
+      auto result = edges.insert(std::make_pair(key, Edge()));
+      Edge& edge = result.first->second;
+      if (result.second) {
+        edge.triangle = static_cast<GLuint>(t);
+        edge.wedges[0] = w0;
+        edge.wedges[1] = w1;
+        edge.nTriangles = 1;
+        edge.isSeam = false;
+      }
+      else {
+        ++edge.nTriangles;
+        edge.isSeam = edge.isSeam || edge.wedges[0] != w0 || edge.wedges[1] != w1;
+      }
+    }
+  }
+
+  // border, seam, and non-manifold edges: planes perpendicular to the triangle
+  for (const auto& entry : edges) {
+    const Edge& edge = entry.second;
+    if (edge.nTriangles == 2 && !edge.isSeam) {
+      continue;
+    }
+    const GLuint* c = &corners_[3 * edge.triangle];
+    const glm::dvec3& p0 = positions_[wedgeVertices_[c[0]]];
+    const glm::dvec3 faceNormal = glm::cross(positions_[wedgeVertices_[c[1]]] - p0,
+        positions_[wedgeVertices_[c[2]]] - p0);
+    const GLuint v0 = wedgeVertices_[edge.wedges[0]];
+    const GLuint v1 = wedgeVertices_[edge.wedges[1]];
+    const glm::dvec3 direction = positions_[v1] - positions_[v0];
+    const glm::dvec3 normal = glm::cross(direction, faceNormal);
+    const double length = glm::length(normal);
+    if (length == 0.0) {
+      continue;
+    }
+    Quadric q;
+    const double weight = boundaryWeight * glm::dot(direction, direction);
+    q.addPlane(normal / length, -glm::dot(normal / length, positions_[v0]), weight);
+    q.w = weight;
+    quadrics_[v0].add(q);
+    quadrics_[v1].add(q);
+  }
+
+  // initial collapse candidates
+  for (const auto& entry : edges) {
+    pushEdge_(static_cast<GLuint>(entry.first >> 32), static_cast<GLuint>(entry.first & 0xffffffffu));
+  }
+}
+
+
+double EdgeCollapser::run(size_t targetTriangles, double maxError) {
+  const double maxCost = maxError * maxError;
+  double error = 0.0;
+  while (nAliveTriangles_ > targetTriangles && !queue_.empty()) {
+    const Collapse candidate = queue_.top();
+    queue_.pop();
+    if (isVertexRemoved_[candidate.from] || isVertexRemoved_[candidate.to]
+        || versions_[candidate.from] != candidate.fromVersion
+        || versions_[candidate.to] != candidate.toVersion) {
+      continue;
+    }
+
+    // neighborhood may have changed since the candidate has been queued
+    const double cost = evaluate_(candidate.from, candidate.to);
+    if (cost == INVALID_COST) {
+      continue;
+    }
+    if (cost > candidate.cost * (1.0 + 1e-6) + 1e-15) {
+      Collapse updated = candidate;
+      updated.cost = cost;
+      queue_.push(updated);
+      continue;
+    }
+    if (cost > maxCost) {
+      break;
+    }
+    collapse_(candidate.from, candidate.to);
+    error = std::max(error, cost);
+  }
+  return std::sqrt(error);
+}
+
+
+TriangleMesh EdgeCollapser::getResult() const {
+  TriangleMesh result;
+  const bool hasNormals = mesh_.normals.size() == mesh_.vertices.size();
+  const bool hasTexCoords = mesh_.texCoords.size() == mesh_.vertices.size();
+  std::vector<GLuint> newIndices(mesh_.vertices.size(), ~0u);
+  result.indices.reserve(3 * nAliveTriangles_);
+  for (size_t t = 0; t < isTriangleAlive_.size(); ++t) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      const GLuint wedge = corners_[3 * t + k];
+      if (newIndices[wedge] == ~0u) {
+        newIndices[wedge] = static_cast<GLuint>(result.vertices.size());
+        result.vertices.push_back(mesh_.vertices[wedge]);
+        if (hasNormals) {
+          result.normals.push_back(mesh_.normals[wedge]);
+        }
+        if (hasTexCoords) {
+          result.texCoords.push_back(mesh_.texCoords[wedge]);
+        }
+      }
+      result.indices.push_back(newIndices[wedge]);
+    }
+  }
+  return result;
+}
+
+
+double EdgeCollapser::evaluate_(GLuint u, GLuint v) {
+  wedgeMap_.clear();
+  int nShared = 0;
+
+  // map wedges of u to wedges of v via the triangles of edge (u, v)
+  for (GLuint t : vertexTriangles_[u]) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    const GLuint* c = &corners_[3 * t];
+    int ku = -1;
+    int kv = -1;
+    for (int k = 0; k < 3; ++k) {
+      const GLuint vertex = wedgeVertices_[c[k]];
+      if (vertex == u) {
+        ku = k;
+      }
+      else if (vertex == v) {
+        kv = k;
+      }
+    }
+    if (kv < 0) {
+      continue;
+    }
+    ++nShared;
+    bool isMapped = false;
+    for (const auto& mapping : wedgeMap_) {
+      if (mapping.first == c[ku]) {
+        if (mapping.second != c[kv]) {
+          return INVALID_COST;    // inconsistent attributes across the edge
+        }
+        isMapped = true;
+      }
+    }
+    if (!isMapped) {
+      wedgeMap_.push_back(std::make_pair(c[ku], c[kv]));
+    }
+  }
+  if (nShared == 0) {
+    return INVALID_COST;
+  }
+
+  // link condition: common neighbors only opposite of edge (u, v)
+  collectNeighbors_(u, neighbors_);
+  collectNeighbors_(v, otherNeighbors_);
+  int nCommon = 0;
+  for (GLuint vertex : neighbors_) {
+    if (std::binary_search(otherNeighbors_.begin(), otherNeighbors_.end(), vertex)) {
+      ++nCommon;
+    }
+  }
+  if (nCommon != nShared) {
+    return INVALID_COST;
+  }
+
+  // remaining triangles of u: wedges must be mapped, triangles must not flip
+  const glm::dvec3& pu = positions_[u];
+  const glm::dvec3& pv = positions_[v];
+  for (GLuint t : vertexTriangles_[u]) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    const GLuint* c = &corners_[3 * t];
+    int ku = -1;
+    bool hasV = false;
+    for (int k = 0; k < 3; ++k) {
+      const GLuint vertex = wedgeVertices_[c[k]];
+      if (vertex == u) {
+        ku = k;
+      }
+      else if (vertex == v) {
+        hasV = true;
+      }
+    }
+    if (hasV) {
+      continue;
+    }
+    if (getMappedWedge_(c[ku]) == ~0u) {
+      return INVALID_COST;    // seam vertex moved off its seam
+    }
+    const glm::dvec3& p1 = positions_[wedgeVertices_[c[(ku + 1) % 3]]];
+    const glm::dvec3& p2 = positions_[wedgeVertices_[c[(ku + 2) % 3]]];
+    const glm::dvec3 oldNormal = glm::cross(p1 - pu, p2 - pu);
+    const glm::dvec3 newNormal = glm::cross(p1 - pv, p2 - pv);
+    const double oldLength2 = glm::dot(oldNormal, oldNormal);
+    if (oldLength2 == 0.0) {
+      continue;
+    }
+    const double dot = glm::dot(oldNormal, newNormal);
+    if (dot <= 0.0 || dot * dot < MIN_NORMAL_COS * MIN_NORMAL_COS * oldLength2 * glm::dot(newNormal, newNormal)) {
+      return INVALID_COST;
+    }
+  }
+
+  // accumulated errors at position of v, normalized by accumulated weight
+  Quadric q = quadrics_[u];
+  q.add(quadrics_[v]);
+  double cost = q.eval(pv);
+  if (nAttributes_ > 0) {
+    for (const auto& mapping : wedgeMap_) {
+      AttributeQuadric aq = attributeQuadrics_[mapping.first];
+      aq.add(attributeQuadrics_[mapping.second], nAttributes_);
+      cost += aq.eval(pv, &attributes_[mapping.second * nAttributes_], nAttributes_);
+    }
+  }
+  return (q.w > 0.0) ? std::max(cost, 0.0) / q.w : std::max(cost, 0.0);
+}
+
+
+void EdgeCollapser::collapse_(GLuint u, GLuint v) {
+  std::vector<GLuint>& trianglesV = vertexTriangles_[v];
+  for (GLuint t : vertexTriangles_[u]) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    GLuint* c = &corners_[3 * t];
+    bool hasV = false;
+    for (int k = 0; k < 3; ++k) {
+      hasV = hasV || wedgeVertices_[c[k]] == v;
+    }
+    if (hasV) {
+      isTriangleAlive_[t] = 0;
+      --nAliveTriangles_;
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      if (wedgeVertices_[c[k]] == u) {
+        c[k] = getMappedWedge_(c[k]);
+      }
+    }
+    trianglesV.push_back(t);
+  }
+  std::vector<GLuint>().swap(vertexTriangles_[u]);
+  trianglesV.erase(std::remove_if(trianglesV.begin(), trianglesV.end(),
+      [this](GLuint t) { return !isTriangleAlive_[t]; }), trianglesV.end());
+
+  quadrics_[v].add(quadrics_[u]);
+  if (nAttributes_ > 0) {
+    for (const auto& mapping : wedgeMap_) {
+      attributeQuadrics_[mapping.second].add(attributeQuadrics_[mapping.first], nAttributes_);
+    }
+  }
+  isVertexRemoved_[u] = 1;
+  ++versions_[v];
+
+  // update candidates of all edges of v
+  std::vector<GLuint> neighbors;
+  collectNeighbors_(v, neighbors);
+  for (GLuint neighbor : neighbors) {
+    pushEdge_(v, neighbor);
+  }
+}
+
+
+void EdgeCollapser::pushEdge_(GLuint u, GLuint v) {
+  const double costUV = evaluate_(u, v);
+  const double costVU = evaluate_(v, u);
+  if (costUV == INVALID_COST && costVU == INVALID_COST) {
+    return;
+  }
+  Collapse candidate;
+  candidate.cost = std::min(costUV, costVU);
+  candidate.from = (costUV <= costVU) ? u : v;
+  candidate.to = (costUV <= costVU) ? v : u;
+  candidate.fromVersion = versions_[candidate.from];
+  candidate.toVersion = versions_[candidate.to];
+  queue_.push(candidate);
+}
+
+
+void EdgeCollapser::collectNeighbors_(GLuint u, std::vector<GLuint>& neighbors) const {
+  neighbors.clear();
+  for (GLuint t : vertexTriangles_[u]) {
+    if (!isTriangleAlive_[t]) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      const GLuint vertex = wedgeVertices_[corners_[3 * t + k]];
+      if (vertex != u) {
+        neighbors.push_back(vertex);
+      }
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
+
+
+GLuint EdgeCollapser::getMappedWedge_(GLuint wedge) const {
+  for (const auto& mapping : wedgeMap_) {
+    if (mapping.first == wedge) {
+      return mapping.second;
+    }
+  }
+  return ~0u;
+}
+
+} /* namespace */
+
+
+void TriangleMesh::computeNormals() {
+  normals.assign(vertices.size(), glm::vec3(0.0f));
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    // cross product is proportional to triangle area
+    const glm::vec3& p0 = vertices[indices[i]];
+    const glm::vec3 normal = glm::cross(vertices[indices[i + 1]] - p0, vertices[indices[i + 2]] - p0);
+    for (int k = 0; k < 3; ++k) {
+      normals[indices[i + k]] += normal;
+    }
+  }
+  for (auto& normal : normals) {
+    const GLfloat length = glm::length(normal);
+    if (length > 0.0f) {
+      normal /= length;
+    }
+  }
+}
+
+
+MeshSimplifier::MeshSimplifier()
+    : normalWeight_(0.5f), texCoordWeight_(1.0f), boundaryWeight_(10.0f), nThreads_(1) {
+  setNThreads(static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+
+MeshSimplifier::~MeshSimplifier() {
+}
+
+
+MeshSimplifierSP MeshSimplifier::create() {
+  return std::make_shared<MeshSimplifier>();
+}
+
+
+GLfloat MeshSimplifier::getNormalWeight() const {
+  return normalWeight_;
+}
+
+
+void MeshSimplifier::setNormalWeight(GLfloat normalWeight) {
+  normalWeight_ = normalWeight;
+}
+
+
+GLfloat MeshSimplifier::getTexCoordWeight() const {
+  return texCoordWeight_;
+}
+
+
+void MeshSimplifier::setTexCoordWeight(GLfloat texCoordWeight) {
+  texCoordWeight_ = texCoordWeight;
+}
+
+
+GLfloat MeshSimplifier::getBoundaryWeight() const {
+  return boundaryWeight_;
+}
+
+
+void MeshSimplifier::setBoundaryWeight(GLfloat boundaryWeight) {
+  boundaryWeight_ = boundaryWeight;
+}
+
+
+int MeshSimplifier::getNThreads() const {
+  return nThreads_;
+}
+
+
+void MeshSimplifier::setNThreads(int nThreads) {
+  nThreads_ = std::min(std::max(nThreads, 1), MAX_THREADS);
+}
+
+
+TriangleMesh MeshSimplifier::simplify(const TriangleMesh& mesh, size_t targetTriangles,
+    GLfloat maxError, GLfloat* error) const {
+  EdgeCollapser collapser(mesh, normalWeight_, texCoordWeight_, boundaryWeight_);
+  const double resultError = collapser.run(targetTriangles, maxError);
+  if (error) {
+    *error = static_cast<GLfloat>(resultError);
+  }
+  return collapser.getResult();
+}
+
+
+std::vector<TriangleMesh> MeshSimplifier::simplify(const std::vector<TriangleMesh>& meshes,
+    GLfloat targetRatio, GLfloat maxError) const {
+  std::vector<TriangleMesh> results(meshes.size());
+  std::atomic<size_t> nextMesh(0);
+  auto simplifyMeshes = [&]() {
+    for (size_t i = nextMesh++; i < meshes.size(); i = nextMesh++) {
+      const size_t target = static_cast<size_t>(targetRatio * meshes[i].getNTriangles() + 0.5f);
+      results[i] = simplify(meshes[i], target, maxError);
+    }
+  };
+
+  // process meshes in parallel, largest workload is not known in advance
+  const int nThreads = static_cast<int>(std::min(static_cast<size_t>(nThreads_), meshes.size()));
+  std::vector<std::thread> threads;
+  for (int i = 1; i < nThreads; ++i) {
+    threads.push_back(std::thread(simplifyMeshes));
+  }
+  simplifyMeshes();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+
+std::vector<TriangleMesh> MeshSimplifier::createLODs(const TriangleMesh& mesh, int nLevels,
+    GLfloat reduction) const {
+  std::vector<TriangleMesh> levels;
+  levels.push_back(mesh);
+  for (int level = 1; level < nLevels; ++level) {
+    const size_t nTriangles = levels.back().getNTriangles();
+    TriangleMesh next = simplify(levels.back(),
+        static_cast<size_t>(reduction * nTriangles));
+    if (next.getNTriangles() >= nTriangles || next.indices.empty()) {
+      break;
+    }
+    levels.push_back(std::move(next));
+  }
+  return levels;
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,193 @@
+/**
+ * \file MeshSimplifier.h
+ * \brief Mesh simplification by edge collapses using quadric error metrics.
+ *
+ * Defines struct:
+ *   TriangleMesh
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MESHSIMPLIFIER_H_
+#define MESHSIMPLIFIER_H_
+
+#include <cfloat>
+#include <vector>
+#include "scg_glew.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Indexed triangle mesh stored in main memory, e.g., to be simplified by
+ *    MeshSimplifier (cf. GeometryCoreFactory::loadMeshFromOBJFile(),
+ *    GeometryCoreFactory::createModelFromMesh()).
+ *
+ * Normals and texture coordinates are optional, i.e., either empty or of the same
+ * size as the vertices.
+ */
+struct TriangleMesh {
+
+  size_t getNTriangles() const {
+    return indices.size() / 3;
+  }
+
+  /**
+   * Compute vertex normals as area-weighted averages of the adjacent face normals.
+   */
+  void computeNormals();
+
+  std::vector<glm::vec3> vertices;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+  std::vector<GLuint> indices;
+
+};
+
+
+/**
+ * \brief Mesh simplification by edge collapses using quadric error metrics.
+ *
+ * Edges are collapsed greedily in order of increasing error, each collapse moving one
+ * vertex onto a neighbor (half-edge collapse), such that the remaining vertices are a
+ * subset of the original ones and no attributes have to be interpolated. The error of
+ * a collapse is measured by the accumulated plane quadrics of the adjacent faces
+ * (cf. Garland & Heckbert, 1997), extended by the squared deviations of normals and
+ * texture coordinates from their linear interpolation across the faces (cf. Hoppe, 1999).
+ * Errors are relative to the diagonal of the bounding box of the mesh.
+ *
+ * Vertices sharing a position but differing in attributes form an attribute seam.
+ * Border and seam edges add quadrics of planes perpendicular to their faces, weighted
+ * by the boundary weight, and seam vertices are moved only along their seams, which
+ * preserves the outline of open meshes and of texture charts. Collapses flipping faces
+ * or creating non-manifold edges are rejected.
+ *
+ * Several meshes can be simplified in parallel threads.
+ */
+class MeshSimplifier {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  MeshSimplifier();
+
+  /**
+   * Destructor.
+   */
+  virtual ~MeshSimplifier();
+
+  /**
+   * Create shared pointer.
+   */
+  static MeshSimplifierSP create();
+
+  /**
+   * Get weight of normal deviations relative to position errors.
+   */
+  GLfloat getNormalWeight() const;
+
+  /**
+   * Set weight of normal deviations relative to position errors, default: 0.5.
+   */
+  void setNormalWeight(GLfloat normalWeight);
+
+  /**
+   * Get weight of texture coordinate deviations relative to position errors.
+   */
+  GLfloat getTexCoordWeight() const;
+
+  /**
+   * Set weight of texture coordinate deviations relative to position errors, default: 1.
+   */
+  void setTexCoordWeight(GLfloat texCoordWeight);
+
+  /**
+   * Get weight of border and seam quadrics.
+   */
+  GLfloat getBoundaryWeight() const;
+
+  /**
+   * Set weight of border and seam quadrics, default: 10.
+   */
+  void setBoundaryWeight(GLfloat boundaryWeight);
+
+  /**
+   * Get number of threads used for simplifying several meshes.
+   */
+  int getNThreads() const;
+
+  /**
+   * Set number of threads used for simplifying several meshes, default: number of
+   * hardware threads (at most 8).
+   */
+  void setNThreads(int nThreads);
+
+  /**
+   * Simplify mesh until the number of triangles is reduced to the target number or
+   * the next collapse would exceed the maximum error.
+   * \param mesh mesh to be simplified
+   * \param targetTriangles target number of triangles
+   * \param maxError maximum error relative to the bounding box diagonal
+   * \param error if not null, set to the error of the simplified mesh
+   * \return simplified mesh, containing only the vertices still referenced
+   */
+  TriangleMesh simplify(const TriangleMesh& mesh, size_t targetTriangles,
+      GLfloat maxError = FLT_MAX, GLfloat* error = nullptr) const;
+
+  /**
+   * Simplify several meshes in parallel threads, cf. simplify().
+   * \param meshes meshes to be simplified
+   * \param targetRatio target number of triangles relative to the original number
+   * \param maxError maximum error relative to the bounding box diagonal of each mesh
+   * \return simplified meshes
+   */
+  std::vector<TriangleMesh> simplify(const std::vector<TriangleMesh>& meshes,
+      GLfloat targetRatio, GLfloat maxError = FLT_MAX) const;
+
+  /**
+   * Create levels of detail, each level simplifying the previous one (cf. LOD).
+   * \param mesh original mesh, used as first level
+   * \param nLevels maximum number of levels, fewer levels are created if a mesh
+   *    cannot be simplified any further
+   * \param reduction number of triangles of each level relative to the previous level
+   * \return meshes of all levels
+   */
+  std::vector<TriangleMesh> createLODs(const TriangleMesh& mesh, int nLevels,
+      GLfloat reduction = 0.5f) const;
+
+protected:
+
+  static const int MAX_THREADS = 8;
+
+  GLfloat normalWeight_;
+  GLfloat texCoordWeight_;
+  GLfloat boundaryWeight_;
+  int nThreads_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* MESHSIMPLIFIER_H_ */
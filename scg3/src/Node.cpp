@@ -22,15 +22,27 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include "Composite.h"
 #include "Core.h"
 #include "Node.h"
+#include "Traverser.h"
 
 namespace scg {
 
 
+namespace {
+
+const glm::mat4 IDENTITY_MATRIX(1.0f);
+
+} /* namespace */
+
+
 Node::Node()
-  : parent_(nullptr), isVisible_(true) {
+  : parent_(nullptr), childIndex_(0), isVisible_(true), isComposite_(false),
+    isOccluder_(false), isOccludee_(true),
+    version_(currentVersion_), subtreeVersion_(currentVersion_),
+    boundsVersion_(0), worldBoundsVersion_(0), cullPlane_(0), cullMark_(0) {
 }
 
 
@@ -51,8 +63,7 @@ void Node::destroy() {
     isNodeRemoved = !isNodeRemoved;   // avoid warning (unused variable) in release build
   }
 
-  // clear (smart) pointers
-  rightSibling_.reset();
+  // clear parent pointer
   parent_ = nullptr;
 
   // clear node data (if any)
@@ -75,13 +86,112 @@ void Node::setMetaInfo(const std::string& key, const std::string& value) {
 }
 
 
+Composite* Node::getParent() const {
+  return parent_;
+}
+
+
 bool Node::isVisible() const{
   return isVisible_;
 }
 
 
 void Node::setVisible(bool isVisible) {
-  isVisible_ = isVisible;
+  if (isVisible != isVisible_) {
+    isVisible_ = isVisible;
+    markModified_();
+  }
+}
+
+
+bool Node::isOccluder() const {
+  return isOccluder_;
+}
+
+
+void Node::setOccluder(bool isOccluder) {
+  if (isOccluder != isOccluder_) {
+    isOccluder_ = isOccluder;
+    markModified_();
+  }
+}
+
+
+bool Node::isOccludee() const {
+  return isOccludee_;
+}
+
+
+void Node::setOccludee(bool isOccludee) {
+  isOccludee_ = isOccludee;
+}
+
+
+unsigned long Node::getVersion() const {
+  return version_;
+}
+
+
+unsigned long Node::getSubtreeVersion() const {
+  return subtreeVersion_;
+}
+
+
+unsigned long Node::getCurrentVersion() {
+  return currentVersion_;
+}
+
+
+unsigned long Node::nextVersion() {
+  isCurrentVersionUsed_ = false;
+  return ++currentVersion_;
+}
+
+
+const AABB& Node::getBoundingBox() {
+  return boundingBox_;
+}
+
+
+const BoundingSphere& Node::getBoundingSphere() {
+  getBoundingBox();   // updates both bounding volumes
+  return boundingSphere_;
+}
+
+
+const glm::mat4& Node::getWorldMatrix() {
+  // collect path from root node, using a local vector to be reentrant
+  // and an explicit loop to bound native stack use on deep graphs
+  std::vector<Node*> path;
+  for (Node* node = this; node; node = node->parent_) {
+    path.push_back(node);
+  }
+
+  // update world matrices from root node downwards
+  const glm::mat4* world = &IDENTITY_MATRIX;
+  unsigned long pathVersion = 0;
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    pathVersion = std::max(pathVersion, (*it)->version_);
+    world = (*it)->updateWorldMatrix_(world, pathVersion);
+  }
+  return *world;
+}
+
+
+const AABB& Node::getWorldBoundingBox() {
+  updateWorldBounds_();
+  return worldBoundingBox_;
+}
+
+
+const BoundingSphere& Node::getWorldBoundingSphere() {
+  updateWorldBounds_();
+  return worldBoundingSphere_;
+}
+
+
+void Node::traverse(Traverser* traverser) {
+  traverser->traverse(this);
 }
 
 
@@ -95,34 +205,54 @@ void Node::render(RenderState* renderState) {
 }
 
 
-void Node::addSibling_(NodeSP sibling) {
-  assert(sibling);
-  if (!rightSibling_) {
-    // no right sibling yet, add new sibling
-    rightSibling_ = sibling;
-    sibling->parent_ = parent_;
+void Node::markModified_() {
+  version_ = modificationVersion_();
+  markSubtreeModified_();
+}
+
+
+void Node::markSubtreeModified_() {
+  // ancestors of a node with current sub-tree version are up to date already
+  const unsigned long version = modificationVersion_();
+  for (Node* node = this; node && node->subtreeVersion_ < version; node = node->parent_) {
+    node->subtreeVersion_ = version;
   }
-  else {
-    // add new sibling to right sibling (recursively)
-    rightSibling_->addSibling_(sibling);
+}
+
+
+unsigned long Node::modificationVersion_() {
+  if (isCurrentVersionUsed_) {
+    isCurrentVersionUsed_ = false;
+    ++currentVersion_;
   }
+  return currentVersion_;
 }
 
 
-void Node::removeSibling_(Node* node, bool& result) {
-  assert(node);
-  result = false;
-  if (rightSibling_) {
-    // check if node to remove is right sibling
-    if (node == rightSibling_.get()) {
-      // remove right sibling
-      rightSibling_ = node->rightSibling_;
-      result = true;
-    }
-    else {
-      // search siblings of right sibling for node to remove (recursively)
-      rightSibling_->removeSibling_(node, result);
-    }
+unsigned long Node::validVersion_(unsigned long version) {
+  // subsequent modifications must not reuse the current version stamp
+  if (version >= currentVersion_) {
+    isCurrentVersionUsed_ = true;
+  }
+  return version + 1;
+}
+
+
+const glm::mat4* Node::updateWorldMatrix_(const glm::mat4* parentWorld, unsigned long) {
+  return parentWorld;
+}
+
+
+void Node::updateWorldBounds_() {
+  unsigned long version = subtreeVersion_;
+  for (Node* node = parent_; node; node = node->parent_) {
+    version = std::max(version, node->version_);
+  }
+  if (version >= worldBoundsVersion_) {
+    const glm::mat4& parentWorld = parent_ ? parent_->getWorldMatrix() : IDENTITY_MATRIX;
+    worldBoundingBox_ = getBoundingBox().transform(parentWorld);
+    worldBoundingSphere_ = boundingSphere_.transform(parentWorld);
+    worldBoundsVersion_ = validVersion_(version);
   }
 }
 
@@ -142,4 +272,8 @@ void Node::postProcessCores_(RenderState* renderState) {
 }
 
 
+unsigned long Node::currentVersion_(0);
+bool Node::isCurrentVersionUsed_(false);
+
+
 } /* namespace scg */
@@ -28,6 +28,8 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "BoundingVolume.h"
+#include "scg_glm.h"
 #include "scg_internals.h"
 
 namespace scg {
@@ -36,9 +38,17 @@ namespace scg {
 /**
  * \brief Base class for all nodes (composite pattern, abstract).
  *
- * The node tree of the scene graph is organized as a left-child right-sibling tree.
- * While all nodes may have siblings and a parent, only composite nodes may have
- * children (cf. Composite).
+ * The node tree of the scene graph is organized as a tree whose composite nodes
+ * store their children in contiguous arrays (cf. Composite).
+ * While all nodes may have a parent, only composite nodes may have children.
+ * Each node keeps its index within the parent's child array, which allows
+ * removing it from the parent in constant time.
+ *
+ * Modifications of the node data (e.g., cores, visibility, transformation matrix)
+ * are recorded by version stamps, which are propagated to the ancestors of the node.
+ * Thus consumers that cache scene graph data (cf. CompiledScene) can skip unmodified
+ * sub-trees when synchronizing their data. The nodes use the same version stamps to
+ * validate their cached bounding volumes and world matrices.
  * Certain nodes may possess one or several cores (cf. Core).
  *
  * Note: When the node is rendered, its cores are procesed in the order they
@@ -46,7 +56,16 @@ namespace scg {
  */
 class Node {
 
+  friend class BVH;
+  friend class CompiledScene;
   friend class Composite;
+  friend class CullingRenderTraverser;
+  friend class HardwareOcclusionCuller;
+  friend class OcclusionCuller;
+  friend class RenderQueue;
+  friend class StandardRenderer;
+  friend class StaticBatch;
+  friend class Traverser;
 
 public:
 
@@ -89,6 +108,11 @@ public:
    */
   void setMetaInfo(const std::string& key, const std::string& value);
 
+  /**
+   * Get parent node, or nullptr if node has not been added to a composite node.
+   */
+  Composite* getParent() const;
+
   /**
    * Check if node is visible.
    */
@@ -100,9 +124,92 @@ public:
   void setVisible(bool isVisible = true);
 
   /**
-   * Traverse node tree (depth-first, pre-order) with given traverser.
+   * Check if node is tagged as occluder.
+   */
+  bool isOccluder() const;
+
+  /**
+   * Tag node as occluder, i.e., the shapes of its sub-tree are rasterized into the
+   * depth buffer of OcclusionCuller, default: false.
+   */
+  void setOccluder(bool isOccluder = true);
+
+  /**
+   * Check if node is tagged as occludee.
+   */
+  bool isOccludee() const;
+
+  /**
+   * Tag node as occludee, i.e., it may be skipped together with its sub-tree if its
+   * bounding box is hidden by the occluders (cf. OcclusionCuller), default: true.
+   */
+  void setOccludee(bool isOccludee = true);
+
+  /**
+   * Get version stamp of the last modification of the node data.
+   */
+  unsigned long getVersion() const;
+
+  /**
+   * Get version stamp of the last modification within the sub-tree of this node,
+   * including the node itself.
+   */
+  unsigned long getSubtreeVersion() const;
+
+  /**
+   * Get current version stamp, which is assigned to all subsequent modifications.
+   */
+  static unsigned long getCurrentVersion();
+
+  /**
+   * Increment and return current version stamp, to be called by consumers of
+   * version stamps after synchronizing their data.
+   * All modifications after this call will have a version stamp not less than
+   * the returned value.
+   */
+  static unsigned long nextVersion();
+
+  /**
+   * Get axis-aligned bounding box of the sub-tree in the coordinate system of the
+   * parent node, i.e., including the transformation of this node (if any).
+   * The bounding volumes are cached and only recomputed if the sub-tree has been modified.
+   * Empty by default.
+   *
+   * Note: Modifications of geometry cores after adding them to a shape are not detected.
    */
-  virtual void traverse(Traverser* traverser) = 0;
+  virtual const AABB& getBoundingBox();
+
+  /**
+   * Get bounding sphere of the sub-tree in the coordinate system of the parent node
+   * (cf. getBoundingBox()).
+   */
+  const BoundingSphere& getBoundingSphere();
+
+  /**
+   * Get world matrix, i.e., the product of the matrices of all transformations from
+   * the root node to this node, including this node.
+   * The world matrices of transformations are cached and only recomputed if a
+   * transformation above them or the path to the root node has been modified.
+   */
+  const glm::mat4& getWorldMatrix();
+
+  /**
+   * Get axis-aligned bounding box of the sub-tree in world coordinates, i.e., in the
+   * coordinate system of the root node. It is cached and only recomputed if the sub-tree
+   * or one of its ancestors has been modified.
+   */
+  const AABB& getWorldBoundingBox();
+
+  /**
+   * Get bounding sphere of the sub-tree in world coordinates (cf. getWorldBoundingBox()).
+   */
+  const BoundingSphere& getWorldBoundingSphere();
+
+  /**
+   * Traverse node tree (depth-first, pre-order) with given traverser,
+   * calls Traverser::traverse().
+   */
+  virtual void traverse(Traverser* traverser);
 
   /**
    * Accept traverser (visitor pattern).
@@ -117,18 +224,41 @@ public:
 protected:
 
   /**
-   * Add sibling to this node, i.e., child to its parent (recursively).
-   * Called by Composite::addChild().
+   * Mark node data as modified, i.e., update version stamps of node and ancestors.
+   */
+  void markModified_();
+
+  /**
+   * Update sub-tree version stamps of node and ancestors.
+   */
+  void markSubtreeModified_();
+
+  /**
+   * Get version stamp to be assigned to a modification, i.e., the current version stamp,
+   * or a new one if the current version stamp has been used by validVersion_().
    */
-  void addSibling_(NodeSP sibling);
+  static unsigned long modificationVersion_();
 
   /**
-   * Remove sibling from this node, i.e., child from its parent (recursively).
-   * Called by Composite::removeChild().
-   * \param node pointer to node to be removed
-   * \param result true if node has been found and removed
+   * Get version stamp of cached data that has been computed from node data with the given
+   * maximum version stamp, without incrementing the current version stamp (cf. nextVersion()).
+   * The cached data is valid as long as the node data has lower version stamps.
    */
-  void removeSibling_(Node* node, bool& result);
+  static unsigned long validVersion_(unsigned long version);
+
+  /**
+   * Update world matrix for given parent world matrix, called by getWorldMatrix()
+   * for each node on the path from the root node.
+   * \param parentWorld world matrix of parent node
+   * \param pathVersion maximum version stamp of this node and its ancestors
+   * \return world matrix of this node, i.e., parentWorld by default
+   */
+  virtual const glm::mat4* updateWorldMatrix_(const glm::mat4* parentWorld, unsigned long pathVersion);
+
+  /**
+   * Update world bounding volumes if the sub-tree or one of its ancestors has been modified.
+   */
+  void updateWorldBounds_();
 
   /**
    * Process node cores by calling their render() methods,
@@ -144,12 +274,28 @@ protected:
 
 protected:
 
-  NodeSP rightSibling_;
   Composite* parent_;
+  size_t childIndex_;     // index within parent's child array
   std::vector<CoreSP> cores_;
   bool isVisible_;
+  bool isComposite_;      // set by Composite, avoids dynamic casts during traversal
+  bool isOccluder_;
+  bool isOccludee_;
+  unsigned long version_;
+  unsigned long subtreeVersion_;
+  AABB boundingBox_;
+  BoundingSphere boundingSphere_;
+  unsigned long boundsVersion_;       // version of bounding volumes, valid if sub-tree version is lower
+  AABB worldBoundingBox_;
+  BoundingSphere worldBoundingSphere_;
+  unsigned long worldBoundsVersion_;
+  unsigned char cullPlane_;           // frustum plane the node has been outside of last time
+  unsigned long cullMark_;            // mark of CullingRenderTraverser::setVisibleShapes()
   mutable std::unordered_map<std::string, std::string> metaInfo_;
 
+  static unsigned long currentVersion_;
+  static bool isCurrentVersionUsed_;   // set by validVersion_(), cleared by new version stamps
+
 };
 
 
@@ -0,0 +1,422 @@
+/**
+ * \file OcclusionCuller.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+#include "Composite.h"
+#include "GeometryCore.h"
+#include "InstancedShape.h"
+#include "OcclusionCuller.h"
+#include "Shape.h"
+#include "TriangleBVH.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCG_OCCLUSIONCULLER_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace scg {
+
+
+namespace {
+
+const int MAX_THREADS = 8;
+
+// minimum clip w of vertices, triangles and boxes closer to the eye are not handled
+const GLfloat MIN_W = 1e-5f;
+
+}
+
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : width_(0), height_(0), nTilesX_(0), nTilesY_(0), nThreads_(1),
+      root_(nullptr), collectVersion_(0) {
+  setResolution(width, height);
+  setNThreads(static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+
+OcclusionCuller::~OcclusionCuller() {
+}
+
+
+OcclusionCullerSP OcclusionCuller::create(int width, int height) {
+  return std::make_shared<OcclusionCuller>(width, height);
+}
+
+
+int OcclusionCuller::getWidth() const {
+  return width_;
+}
+
+
+int OcclusionCuller::getHeight() const {
+  return height_;
+}
+
+
+void OcclusionCuller::setResolution(int width, int height) {
+  nTilesX_ = std::max((width + TILE_WIDTH - 1) / TILE_WIDTH, 1);
+  nTilesY_ = std::max((height + TILE_HEIGHT - 1) / TILE_HEIGHT, 1);
+  width_ = nTilesX_ * TILE_WIDTH;
+  height_ = nTilesY_ * TILE_HEIGHT;
+  depthBuffer_.assign(static_cast<size_t>(width_) * height_, 1.0f);
+  tileMaxDepths_.assign(static_cast<size_t>(nTilesX_) * nTilesY_, 1.0f);
+  tileBins_.resize(tileMaxDepths_.size());
+}
+
+
+int OcclusionCuller::getNThreads() const {
+  return nThreads_;
+}
+
+
+void OcclusionCuller::setNThreads(int nThreads) {
+  nThreads_ = std::min(std::max(nThreads, 1), MAX_THREADS);
+}
+
+
+const OcclusionStats& OcclusionCuller::getStats() const {
+  return stats_;
+}
+
+
+GLfloat OcclusionCuller::getDepth(int x, int y) const {
+  assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+  return depthBuffer_[static_cast<size_t>(y) * width_ + x];
+}
+
+
+void OcclusionCuller::renderOccluders(Node* root, const glm::mat4& projectionView) {
+  stats_ = OcclusionStats();
+  if (root != root_ || !root || root->subtreeVersion_ >= collectVersion_) {
+    collectOccluders_(root);
+  }
+
+  // transform and bin triangles of occluders inside of the view frustum
+  triangles_.clear();
+  for (auto& bin : tileBins_) {
+    bin.clear();
+  }
+  const ViewFrustum frustum(projectionView);
+  for (auto shape : occluders_) {
+    if (frustum.isOutside(shape->getWorldBoundingBox())) {
+      continue;
+    }
+    ++stats_.nOccluders;
+    if (!setupTriangles_(shape, projectionView * shape->getWorldMatrix())) {
+      ++stats_.nEmptyOccluders;
+    }
+  }
+  stats_.nOccluderTriangles = triangles_.size();
+
+  // rasterize tiles in parallel
+  const int nThreads = std::min(nThreads_, nTilesX_ * nTilesY_);
+  if (nThreads > 1 && !triangles_.empty()) {
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (int i = 1; i < nThreads; ++i) {
+      threads.push_back(std::thread(&OcclusionCuller::rasterizeTiles_, this, i, nThreads));
+    }
+    rasterizeTiles_(0, nThreads);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  else {
+    rasterizeTiles_(0, 1);
+  }
+}
+
+
+bool OcclusionCuller::isOccluded(const AABB& box, const glm::mat4& matrix) {
+  ++stats_.nTested;
+  if (box.isEmpty()) {
+    return false;
+  }
+
+  // project corners, boxes reaching behind the eye are considered to be visible
+  glm::vec2 minScreen(FLT_MAX);
+  glm::vec2 maxScreen(-FLT_MAX);
+  GLfloat minDepth = FLT_MAX;
+  for (int i = 0; i < 8; ++i) {
+    const glm::vec4 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y,
+        (i & 4) ? box.max.z : box.min.z, 1.0f);
+    const glm::vec4 clip = matrix * corner;
+    if (clip.w <= MIN_W) {
+      return false;
+    }
+    const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    const glm::vec2 screen((0.5f * ndc.x + 0.5f) * width_, (0.5f * ndc.y + 0.5f) * height_);
+    minScreen = glm::min(minScreen, screen);
+    maxScreen = glm::max(maxScreen, screen);
+    minDepth = std::min(minDepth, 0.5f * ndc.z + 0.5f);
+  }
+  if (minDepth <= 0.0f) {
+    return false;
+  }
+
+  // pixel rectangle covered by the projected box, clipped to the screen
+  const int minX = std::max(static_cast<int>(std::floor(minScreen.x)), 0);
+  const int minY = std::max(static_cast<int>(std::floor(minScreen.y)), 0);
+  const int maxX = std::min(static_cast<int>(std::ceil(maxScreen.x)), width_) - 1;
+  const int maxY = std::min(static_cast<int>(std::ceil(maxScreen.y)), height_) - 1;
+  if (minX > maxX || minY > maxY) {
+    return false;
+  }
+
+  // test tile maxima first, then pixels of tiles that are not completely in front of the box
+  for (int tileY = minY / TILE_HEIGHT; tileY <= maxY / TILE_HEIGHT; ++tileY) {
+    for (int tileX = minX / TILE_WIDTH; tileX <= maxX / TILE_WIDTH; ++tileX) {
+      if (tileMaxDepths_[tileY * nTilesX_ + tileX] < minDepth) {
+        continue;
+      }
+      const int x0 = std::max(minX, tileX * TILE_WIDTH);
+      const int x1 = std::min(maxX, (tileX + 1) * TILE_WIDTH - 1);
+      const int y0 = std::max(minY, tileY * TILE_HEIGHT);
+      const int y1 = std::min(maxY, (tileY + 1) * TILE_HEIGHT - 1);
+      for (int y = y0; y <= y1; ++y) {
+        const GLfloat* row = &depthBuffer_[static_cast<size_t>(y) * width_];
+        for (int x = x0; x <= x1; ++x) {
+          if (row[x] >= minDepth) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+  ++stats_.nOccluded;
+  return true;
+}
+
+
+void OcclusionCuller::collectOccluders_(Node* root) {
+  root_ = root;
+  collectVersion_ = Node::nextVersion();
+  occluders_.clear();
+  collectStack_.clear();
+  if (root) {
+    collectStack_.push_back(std::make_pair(root, false));
+  }
+  while (!collectStack_.empty()) {
+    Node* node = collectStack_.back().first;
+    const bool isOccluder = collectStack_.back().second || node->isOccluder_;
+    collectStack_.pop_back();
+    if (!node->isVisible_) {
+      continue;
+    }
+    if (node->isComposite_) {
+      for (auto& child : static_cast<Composite*>(node)->getChildren()) {
+        collectStack_.push_back(std::make_pair(child.get(), isOccluder));
+      }
+    }
+    else if (isOccluder) {
+      // instanced shapes are skipped, their triangles are not transformed per instance
+      Shape* shape = dynamic_cast<Shape*>(node);
+      if (shape && !dynamic_cast<InstancedShape*>(shape)) {
+        // triangles are taken from the picking copies of the geometry cores
+        for (auto& core : shape->cores_) {
+          GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+          if (geometryCore && !geometryCore->isPickable()) {
+            geometryCore->setPickable(true);
+          }
+        }
+        occluders_.push_back(shape);
+      }
+    }
+  }
+}
+
+
+bool OcclusionCuller::setupTriangles_(Shape* shape, const glm::mat4& matrix) {
+  const glm::vec2 scale(0.5f * width_, 0.5f * height_);
+  bool hasTriangles = false;
+  for (auto& core : shape->cores_) {
+    GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+    TriangleBVH* triangleBVH = geometryCore ? geometryCore->getTriangleBVH() : nullptr;
+    if (!triangleBVH) {
+      continue;
+    }
+    const size_t nTriangles = triangleBVH->getNTriangles();
+    hasTriangles = hasTriangles || nTriangles > 0;
+    for (size_t i = 0; i < nTriangles; ++i) {
+      glm::vec3 v[3];
+      triangleBVH->getTriangle(i, v[0], v[1], v[2]);
+
+      // transform to screen coordinates, skip triangles crossing the near plane
+      ScreenTriangle_ triangle;
+      bool isValid = true;
+      for (int k = 0; k < 3; ++k) {
+        const glm::vec4 clip = matrix * glm::vec4(v[k], 1.0f);
+        if (clip.w <= MIN_W) {
+          isValid = false;
+          break;
+        }
+        const GLfloat invW = 1.0f / clip.w;
+        triangle.v[k] = glm::vec3((clip.x * invW + 1.0f) * scale.x, (clip.y * invW + 1.0f) * scale.y,
+            0.5f * clip.z * invW + 0.5f);
+        if (triangle.v[k].z < 0.0f) {
+          isValid = false;
+          break;
+        }
+      }
+      if (!isValid) {
+        continue;
+      }
+
+      // orient counter-clockwise (both faces are occluding), skip degenerate triangles
+      const glm::vec3 e1 = triangle.v[1] - triangle.v[0];
+      const glm::vec3 e2 = triangle.v[2] - triangle.v[0];
+      const GLfloat area = e1.x * e2.y - e2.x * e1.y;
+      if (area == 0.0f) {
+        continue;
+      }
+      if (area < 0.0f) {
+        std::swap(triangle.v[1], triangle.v[2]);
+      }
+
+      // pixel bounds, pixel centers are at (x + 0.5, y + 0.5)
+      const glm::vec3 minV = glm::min(glm::min(triangle.v[0], triangle.v[1]), triangle.v[2]);
+      const glm::vec3 maxV = glm::max(glm::max(triangle.v[0], triangle.v[1]), triangle.v[2]);
+      triangle.minX = std::max(static_cast<int>(std::floor(minV.x)), 0);
+      triangle.minY = std::max(static_cast<int>(std::floor(minV.y)), 0);
+      triangle.maxX = std::min(static_cast<int>(std::ceil(maxV.x)), width_) - 1;
+      triangle.maxY = std::min(static_cast<int>(std::ceil(maxV.y)), height_) - 1;
+      if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY || minV.z > 1.0f) {
+        continue;
+      }
+
+      // sort into tile bins
+      const GLuint index = static_cast<GLuint>(triangles_.size());
+      triangles_.push_back(triangle);
+      for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; ++tileY) {
+        for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; ++tileX) {
+          tileBins_[tileY * nTilesX_ + tileX].push_back(index);
+        }
+      }
+    }
+  }
+  return hasTriangles;
+}
+
+
+void OcclusionCuller::rasterizeTiles_(int first, int step) {
+  const int nTiles = nTilesX_ * nTilesY_;
+  for (int tile = first; tile < nTiles; tile += step) {
+    rasterizeTile_(tile);
+  }
+}
+
+
+void OcclusionCuller::rasterizeTile_(int tile) {
+  const int tileX0 = (tile % nTilesX_) * TILE_WIDTH;
+  const int tileY0 = (tile / nTilesX_) * TILE_HEIGHT;
+  const int tileX1 = tileX0 + TILE_WIDTH - 1;
+  const int tileY1 = tileY0 + TILE_HEIGHT - 1;
+
+  // clear tile
+  for (int y = tileY0; y <= tileY1; ++y) {
+    GLfloat* row = &depthBuffer_[static_cast<size_t>(y) * width_];
+    std::fill(row + tileX0, row + tileX0 + TILE_WIDTH, 1.0f);
+  }
+
+  for (auto index : tileBins_[tile]) {
+    const ScreenTriangle_& triangle = triangles_[index];
+    const glm::vec3& v0 = triangle.v[0];
+    const glm::vec3& v1 = triangle.v[1];
+    const glm::vec3& v2 = triangle.v[2];
+
+    // edge functions e_k(x, y) = a_k * x + b_k * y + c_k, non-negative inside of the triangle,
+    // e_k is the (doubled) area of the sub-triangle opposite to vertex k
+    const GLfloat a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v2.x * v1.y;
+    const GLfloat a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v0.x * v2.y;
+    const GLfloat a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v1.x * v0.y;
+    const GLfloat invArea = 1.0f / (c0 + c1 + c2);
+
+    // depth as linear function of the pixel position
+    const GLfloat dzdx = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+    const GLfloat dzdy = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+    const GLfloat z0 = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+    // x range is aligned to groups of 4 pixels, the tile width is a multiple of 4
+    const int minX = std::max(triangle.minX, tileX0) & ~3;
+    const int maxX = std::min(triangle.maxX, tileX1);
+    const int minY = std::max(triangle.minY, tileY0);
+    const int maxY = std::min(triangle.maxY, tileY1);
+
+#ifdef SCG_OCCLUSIONCULLER_USE_SSE
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 a0x4 = _mm_set1_ps(4.0f * a0);
+    const __m128 a1x4 = _mm_set1_ps(4.0f * a1);
+    const __m128 a2x4 = _mm_set1_ps(4.0f * a2);
+    const __m128 dzdx4 = _mm_set1_ps(4.0f * dzdx);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 startX = _mm_add_ps(_mm_set1_ps(static_cast<GLfloat>(minX)), offsets);
+    for (int y = minY; y <= maxY; ++y) {
+      const GLfloat py = y + 0.5f;
+      __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), startX), _mm_set1_ps(b0 * py + c0));
+      __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), startX), _mm_set1_ps(b1 * py + c1));
+      __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), startX), _mm_set1_ps(b2 * py + c2));
+      __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), startX), _mm_set1_ps(dzdy * py + z0));
+      GLfloat* row = &depthBuffer_[static_cast<size_t>(y) * width_];
+      for (int x = minX; x <= maxX; x += 4) {
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+            _mm_cmpge_ps(e2, zero));
+        const __m128 depth = _mm_load_ps(row + x);
+        const __m128 minDepth = _mm_min_ps(depth, z);
+        _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, minDepth), _mm_andnot_ps(inside, depth)));
+        e0 = _mm_add_ps(e0, a0x4);
+        e1 = _mm_add_ps(e1, a1x4);
+        e2 = _mm_add_ps(e2, a2x4);
+        z = _mm_add_ps(z, dzdx4);
+      }
+    }
+#else
+    for (int y = minY; y <= maxY; ++y) {
+      const GLfloat py = y + 0.5f;
+      GLfloat* row = &depthBuffer_[static_cast<size_t>(y) * width_];
+      for (int x = minX; x <= maxX; ++x) {
+        const GLfloat px = x + 0.5f;
+        if (a0 * px + b0 * py + c0 >= 0.0f && a1 * px + b1 * py + c1 >= 0.0f
+            && a2 * px + b2 * py + c2 >= 0.0f) {
+          row[x] = std::min(row[x], dzdx * px + dzdy * py + z0);
+        }
+      }
+    }
+#endif
+  }
+
+  // update coarse level of hierarchical depth buffer
+  GLfloat maxDepth = 0.0f;
+  for (int y = tileY0; y <= tileY1; ++y) {
+    const GLfloat* row = &depthBuffer_[static_cast<size_t>(y) * width_];
+    maxDepth = std::max(maxDepth, *std::max_element(row + tileX0, row + tileX0 + TILE_WIDTH));
+  }
+  tileMaxDepths_[tile] = maxDepth;
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,210 @@
+/**
+ * \file OcclusionCuller.h
+ * \brief Software occlusion culling using a low-resolution depth buffer rasterized
+ *    on the CPU.
+ *
+ * Defines struct:
+ *   OcclusionStats
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OCCLUSIONCULLER_H_
+#define OCCLUSIONCULLER_H_
+
+#include <utility>
+#include <vector>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Counters of OcclusionCuller for the last frame.
+ */
+struct OcclusionStats {
+
+  OcclusionStats()
+      : nOccluders(0), nEmptyOccluders(0), nOccluderTriangles(0), nTested(0), nOccluded(0) {
+  }
+
+  size_t nOccluders;          // number of occluder shapes inside of the view frustum
+  size_t nEmptyOccluders;     // number of these occluder shapes without triangles
+  size_t nOccluderTriangles;  // number of triangles rasterized
+  size_t nTested;             // number of bounding boxes tested
+  size_t nOccluded;           // number of bounding boxes found to be hidden
+
+};
+
+
+/**
+ * \brief Software occlusion culling using a low-resolution depth buffer rasterized
+ *    on the CPU.
+ *
+ * renderOccluders() rasterizes the triangles of all shapes tagged as occluders
+ * (cf. Node::setOccluder()) into the depth buffer. The triangles are taken from the
+ * CPU-side copies of the geometry cores (cf. GeometryCore::getTriangleBVH()), which
+ * are enabled for the geometry cores of occluders when these are collected
+ * (cf. GeometryCore::setPickable()). Triangles crossing the near plane are skipped,
+ * which makes the occluders smaller and thus keeps the test conservative.
+ *
+ * The depth buffer is divided into tiles that are rasterized in parallel threads,
+ * four pixels at once using SSE instructions if available. The maximum depth of each
+ * tile forms a coarse level of a hierarchical depth buffer: isOccluded() compares the
+ * nearest depth of a bounding box with the tile maxima first and only tests single
+ * pixels of tiles that are not completely in front of the box.
+ *
+ * Does not require an OpenGL context, except for reading back the triangles of
+ * geometry cores that have not been pickable before.
+ */
+class OcclusionCuller {
+
+public:
+
+  /**
+   * Constructor with depth buffer resolution, rounded up to multiples of the tile size.
+   */
+  OcclusionCuller(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+  /**
+   * Destructor.
+   */
+  virtual ~OcclusionCuller();
+
+  /**
+   * Create shared pointer.
+   */
+  static OcclusionCullerSP create(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+  /**
+   * Get width of depth buffer.
+   */
+  int getWidth() const;
+
+  /**
+   * Get height of depth buffer.
+   */
+  int getHeight() const;
+
+  /**
+   * Set depth buffer resolution, rounded up to multiples of the tile size.
+   */
+  void setResolution(int width, int height);
+
+  /**
+   * Get number of threads used for rasterization.
+   */
+  int getNThreads() const;
+
+  /**
+   * Set number of threads used for rasterization, default: number of hardware threads
+   * (at most 8).
+   */
+  void setNThreads(int nThreads);
+
+  /**
+   * Get counters of last frame.
+   */
+  const OcclusionStats& getStats() const;
+
+  /**
+   * Get depth buffer value at given pixel, in range [0, 1] (1 = far plane).
+   */
+  GLfloat getDepth(int x, int y) const;
+
+  /**
+   * Clear depth buffer and rasterize all occluders of the scene graph inside of the
+   * view frustum, reset counters.
+   * \param root root node of the scene graph
+   * \param projectionView product of projection and view transformation
+   */
+  void renderOccluders(Node* root, const glm::mat4& projectionView);
+
+  /**
+   * Check if bounding box is completely hidden by the occluders.
+   * \param box bounding box to be tested
+   * \param matrix matrix that maps the coordinate system of the box to clip coordinates
+   * \return true if box is hidden
+   */
+  bool isOccluded(const AABB& box, const glm::mat4& matrix);
+
+protected:
+
+  /**
+   * \brief Triangle in screen coordinates (x, y in pixels, z = depth).
+   */
+  struct ScreenTriangle_ {
+    glm::vec3 v[3];
+    int minX, minY, maxX, maxY;
+  };
+
+  static const int DEFAULT_WIDTH = 256;
+  static const int DEFAULT_HEIGHT = 128;
+  static const int TILE_WIDTH = 32;
+  static const int TILE_HEIGHT = 16;
+
+  /**
+   * Collect occluder shapes of the scene graph.
+   */
+  void collectOccluders_(Node* root);
+
+  /**
+   * Transform triangles of an occluder shape into screen coordinates and sort them
+   * into the tile bins.
+   * \return false if the shape does not contain triangles
+   */
+  bool setupTriangles_(Shape* shape, const glm::mat4& matrix);
+
+  /**
+   * Rasterize every step-th tile, starting at the given tile.
+   */
+  void rasterizeTiles_(int first, int step);
+
+  /**
+   * Rasterize triangles of tile bin, update tile maximum depth.
+   */
+  void rasterizeTile_(int tile);
+
+protected:
+
+  int width_;
+  int height_;
+  int nTilesX_;
+  int nTilesY_;
+  int nThreads_;
+  std::vector<GLfloat, AlignedAllocator<GLfloat, 16> > depthBuffer_;
+  std::vector<GLfloat> tileMaxDepths_;
+  std::vector<ScreenTriangle_> triangles_;
+  std::vector<std::vector<GLuint> > tileBins_;
+  Node* root_;
+  unsigned long collectVersion_;    // modifications with this or a later version are not collected yet
+  std::vector<Shape*> occluders_;
+  std::vector<std::pair<Node*, bool> > collectStack_;   // node and occluder flag of path
+  OcclusionStats stats_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* OCCLUSIONCULLER_H_ */
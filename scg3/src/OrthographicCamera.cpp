@@ -23,6 +23,7 @@
 
 #include "scg_glm.h"
 #include "OrthographicCamera.h"
+#include "RenderState.h"
 
 namespace scg {
 
@@ -55,7 +56,7 @@ void OrthographicCamera::init(GLfloat left, GLfloat right, GLfloat bottom, GLflo
 
 void OrthographicCamera::updateProjection() {
   GLint viewport[4];
-  glGetIntegerv(GL_VIEWPORT, viewport);
+  RenderState::glState.getViewport(viewport);
   GLfloat aspect = static_cast<GLfloat> (viewport[2] - viewport[0])
       / static_cast<GLfloat> (viewport[3] - viewport[1]);
   GLfloat halfWidth = 0.5f * aspect * (top_ - bottom_);
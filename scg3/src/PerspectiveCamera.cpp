@@ -22,6 +22,7 @@
  */
 
 #include "PerspectiveCamera.h"
+#include "RenderState.h"
 #include "scg_glm.h"
 
 namespace scg {
@@ -51,7 +52,7 @@ void PerspectiveCamera::init(float fovyDeg, float near, float far) {
 
 void PerspectiveCamera::updateProjection() {
   GLint viewport[4];
-  glGetIntegerv(GL_VIEWPORT, viewport);
+  RenderState::glState.getViewport(viewport);
   GLfloat aspect = static_cast<GLfloat> (viewport[2] - viewport[0])
       / static_cast<GLfloat> (viewport[3] - viewport[1]);
   projection_ = glm::perspective(fovyRad_, aspect, near_, far_);
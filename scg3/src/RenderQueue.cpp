@@ -0,0 +1,524 @@
+/**
+ * \file RenderQueue.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <typeinfo>
+#include "ColorCore.h"
+#include "CubeMapCore.h"
+#include "GeometryCore.h"
+#include "IndirectDrawBatch.h"
+#include "MaterialCore.h"
+#include "Node.h"
+#include "RenderQueue.h"
+#include "RenderState.h"
+#include "ShaderCore.h"
+#include "Shape.h"
+#include "TextureCore.h"
+
+namespace scg {
+
+
+namespace {
+
+// sort key layout, from most to least significant bits:
+//   opaque:      pass (2), shader (12), texture (12), material (12), depth (26)
+//   transparent: pass (2), inverted depth (26), shader (12), texture (12), material (12)
+const int PASS_SHIFT = 62;
+const int ID_BITS = 12;
+const int DEPTH_BITS = 26;
+const uint64_t MAX_ID = (uint64_t(1) << ID_BITS) - 1;
+const uint64_t MAX_DEPTH = (uint64_t(1) << DEPTH_BITS) - 1;
+const uint64_t TRANSPARENT_PASS = 1;
+
+// view-space depth as unsigned integer preserving the order of non-negative floats
+uint64_t depthToKey(GLfloat depth) {
+  if (!(depth > 0.0f)) {
+    return 0;
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &depth, sizeof(bits));
+  return static_cast<uint64_t>(bits >> (31 - DEPTH_BITS));
+}
+
+}
+
+
+RenderQueue::RenderQueue()
+    : isSorting_(true), isIndirectDrawing_(false) {
+}
+
+
+RenderQueue::~RenderQueue() {
+}
+
+
+RenderQueueSP RenderQueue::create() {
+  return std::make_shared<RenderQueue>();
+}
+
+
+bool RenderQueue::isSorting() const {
+  return isSorting_;
+}
+
+
+void RenderQueue::setSorting(bool isSorting) {
+  isSorting_ = isSorting;
+}
+
+
+bool RenderQueue::isIndirectDrawing() const {
+  return isIndirectDrawing_;
+}
+
+
+void RenderQueue::setIndirectDrawing(bool isIndirectDrawing) {
+  isIndirectDrawing_ = isIndirectDrawing;
+}
+
+
+const RenderQueueStats& RenderQueue::getStats() const {
+  return stats_;
+}
+
+
+void RenderQueue::reset() {
+  stats_ = RenderQueueStats();
+  path_.clear();
+  pathSizes_.clear();
+  items_.clear();
+  itemCores_.clear();
+  entries_.clear();
+  ids_.clear();
+}
+
+
+void RenderQueue::pushCores(Node* node) {
+  pathSizes_.push_back(path_.size());
+  for (auto& core : node->cores_) {
+    StateCore_ stateCore = { core.get(), getCategory_(core.get()) };
+    path_.push_back(stateCore);
+  }
+}
+
+
+void RenderQueue::popCores() {
+  assert(!pathSizes_.empty());
+  path_.resize(pathSizes_.back());
+  pathSizes_.pop_back();
+}
+
+
+void RenderQueue::addShape(Shape* shape, RenderState* renderState) {
+  // derived shapes render their cores themselves
+  if (typeid(*shape) != typeid(Shape)) {
+    const size_t beginCore = itemCores_.size();
+    const bool isTransparent = resolveState_(nullptr, 0, itemCores_);
+    addItem_(nullptr, shape, beginCore, isTransparent, shape->getBoundingBox(), renderState);
+    return;
+  }
+
+  // one item per geometry core, with the shape cores preceding it
+  shapeCores_.clear();
+  for (auto& core : shape->cores_) {
+    StateCore_ stateCore = { core.get(), getCategory_(core.get()) };
+    if (stateCore.category == GEOMETRY) {
+      GeometryCore* geometryCore = static_cast<GeometryCore*>(stateCore.core);
+      const size_t beginCore = itemCores_.size();
+      const bool isTransparent = resolveState_(shapeCores_.data(), shapeCores_.size(), itemCores_);
+      addItem_(geometryCore, nullptr, beginCore, isTransparent, geometryCore->getBoundingBox(),
+          renderState);
+    }
+    else {
+      shapeCores_.push_back(stateCore);
+    }
+  }
+}
+
+
+void RenderQueue::applyPath(RenderState* renderState) {
+  pathState_.clear();
+  resolveState_(nullptr, 0, pathState_);
+  for (auto& stateCore : pathState_) {
+    stateCore.core->render(renderState);
+  }
+}
+
+
+void RenderQueue::applyPathPost(RenderState* renderState) {
+  for (auto rit = pathState_.rbegin(); rit != pathState_.rend(); ++rit) {
+    rit->core->renderPost(renderState);
+  }
+  pathState_.clear();
+}
+
+
+void RenderQueue::submit(RenderState* renderState) {
+  if (items_.empty()) {
+    return;
+  }
+  if (isSorting_) {
+    sort_();
+  }
+  collectIndirectRuns_();
+
+  renderState->modelViewStack.pushMatrix();
+  bool isBlend = false;
+  GLint blendFunc[4] = { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO };
+  bool isBlendSaved = false;
+  bool isTransparentPass = false;
+  size_t nextRun = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry_& entry = entries_[i];
+    const Item_& item = items_[entry.item];
+    const IndirectRun_* run = (nextRun < indirectRuns_.size()
+        && indirectRuns_[nextRun].beginEntry == i) ? &indirectRuns_[nextRun++] : nullptr;
+    const size_t nRunItems = run ? run->endEntry - run->beginEntry : 1;
+
+    // enable blending and disable depth writes for transparent items,
+    // restore blending state for opaque items (only if not sorted)
+    const bool isTransparent = (entry.key >> PASS_SHIFT) == TRANSPARENT_PASS;
+    if (isTransparent != isTransparentPass) {
+      if (!isBlendSaved) {
+        isBlendSaved = true;
+        isBlend = renderState->glState.isEnabled(GL_BLEND);
+        renderState->glState.getBlendFunc(blendFunc);
+      }
+      isTransparentPass = isTransparent;
+      setBlending_(renderState, isTransparentPass, isBlend, blendFunc);
+    }
+    if (isTransparent) {
+      stats_.nTransparent += nRunItems;
+    }
+
+    // model-view matrix has to be set before applying cores that depend on it
+    renderState->modelViewStack.setMatrix(item.modelView, item.modelViewStamp);
+
+    // restore cores after common prefix, apply remaining cores of item
+    const StateCore_* cores = &itemCores_[item.beginCore];
+    size_t nShared = 0;
+    const size_t maxShared = std::min(appliedCores_.size(), item.nSharedCores);
+    while (nShared < maxShared && appliedCores_[nShared] == cores[nShared].core) {
+      ++nShared;
+    }
+    while (appliedCores_.size() > nShared) {
+      appliedCores_.back()->renderPost(renderState);
+      appliedCores_.pop_back();
+    }
+    for (size_t j = nShared; j < item.nCores; ++j) {
+      cores[j].core->render(renderState);
+      appliedCores_.push_back(cores[j].core);
+      switch (cores[j].category) {
+      case SHADER:
+        ++stats_.nShaderChanges;
+        break;
+      case TEXTURE:
+      case CUBE_MAP:
+        ++stats_.nTextureChanges;
+        break;
+      case MATERIAL:
+        ++stats_.nMaterialChanges;
+        break;
+      default:
+        break;
+      }
+    }
+    stats_.nCoreChanges += item.nCores - nShared;
+
+    // draw, all items of a run share the state of the first one
+    if (run) {
+      indirectBatch_->render(renderState, run->pool, run->firstDraw, nRunItems);
+      stats_.nIndirectItems += nRunItems;
+      ++stats_.nIndirectDraws;
+      i = run->endEntry - 1;
+    }
+    else if (item.geometryCore) {
+      item.geometryCore->render(renderState);
+      item.geometryCore->renderPost(renderState);
+    }
+    else {
+      item.shape->render(renderState);
+    }
+  }
+
+  // restore render state
+  while (!appliedCores_.empty()) {
+    appliedCores_.back()->renderPost(renderState);
+    appliedCores_.pop_back();
+  }
+  if (isTransparentPass) {
+    setBlending_(renderState, false, isBlend, blendFunc);
+  }
+  renderState->modelViewStack.popMatrix();
+
+  stats_.nItems += items_.size();
+  items_.clear();
+  itemCores_.clear();
+  entries_.clear();
+  indirectRuns_.clear();
+}
+
+
+void RenderQueue::setBlending_(RenderState* renderState, bool isTransparent, bool isBlend,
+    const GLint* blendFunc) {
+  GLStateCache& glState = renderState->glState;
+  if (isTransparent) {
+    glState.setEnabled(GL_BLEND, true);
+    glState.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.setDepthMask(false);
+  }
+  else {
+    glState.setDepthMask(true);
+    glState.setBlendFunc(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+    glState.setEnabled(GL_BLEND, isBlend);
+  }
+}
+
+
+RenderQueue::Category_ RenderQueue::getCategory_(Core* core) {
+  if (dynamic_cast<GeometryCore*>(core)) {
+    return GEOMETRY;
+  }
+  if (dynamic_cast<ShaderCore*>(core)) {
+    return SHADER;
+  }
+  if (dynamic_cast<CubeMapCore*>(core)) {
+    return CUBE_MAP;
+  }
+  if (dynamic_cast<TextureCore*>(core)) {
+    return TEXTURE;
+  }
+  if (dynamic_cast<MaterialCore*>(core)) {
+    return MATERIAL;
+  }
+  if (dynamic_cast<ColorCore*>(core)) {
+    return COLOR;
+  }
+  return OTHER;
+}
+
+
+bool RenderQueue::resolveState_(const StateCore_* shapeCores, size_t nShapeCores,
+    std::vector<StateCore_>& state) const {
+  // effective shader, material, and vertex color are the last ones applied
+  const StateCore_* shader = nullptr;
+  const StateCore_* material = nullptr;
+  const ColorCore* color = nullptr;
+  auto findLast = [&](const StateCore_* cores, size_t nCores) {
+    for (size_t i = 0; i < nCores; ++i) {
+      switch (cores[i].category) {
+      case SHADER:
+        shader = &cores[i];
+        break;
+      case MATERIAL:
+        material = &cores[i];
+        break;
+      case COLOR:
+        if (static_cast<ColorCore*>(cores[i].core)->isColorSet()) {
+          color = static_cast<ColorCore*>(cores[i].core);
+        }
+        break;
+      default:
+        break;
+      }
+    }
+  };
+  auto append = [&](const StateCore_* cores, size_t nCores, bool isTexture) {
+    for (size_t i = 0; i < nCores; ++i) {
+      const Category_ category = cores[i].category;
+      if ((category == TEXTURE || category == CUBE_MAP) == isTexture
+          && category != SHADER && category != MATERIAL && category != GEOMETRY) {
+        state.push_back(cores[i]);
+      }
+    }
+  };
+  findLast(path_.data(), path_.size());
+  findLast(shapeCores, nShapeCores);
+
+  // canonical order: shader, textures, material, other cores
+  if (shader) {
+    state.push_back(*shader);
+  }
+  append(path_.data(), path_.size(), true);
+  append(shapeCores, nShapeCores, true);
+  if (material) {
+    state.push_back(*material);
+  }
+  append(path_.data(), path_.size(), false);
+  append(shapeCores, nShapeCores, false);
+
+  return (material && static_cast<MaterialCore*>(material->core)->getDiffuse().a < 1.0f)
+      || (color && color->getColor().a < 1.0f);
+}
+
+
+uint64_t RenderQueue::getID_(Core* core) {
+  if (!core) {
+    return 0;
+  }
+  auto result = ids_.insert(std::make_pair(core, std::min<uint64_t>(ids_.size() + 1, MAX_ID)));
+  return result.first->second;
+}
+
+
+void RenderQueue::addItem_(GeometryCore* geometryCore, Shape* shape, size_t beginCore,
+    bool isTransparent, const AABB& boundingBox, RenderState* renderState) {
+  Item_ item;
+  item.geometryCore = geometryCore;
+  item.shape = shape;
+  item.beginCore = beginCore;
+  item.nCores = itemCores_.size() - beginCore;
+  item.modelView = renderState->modelViewStack.getMatrix();
+  item.modelViewStamp = renderState->modelViewStack.getStamp();
+
+  // sort key from first shader, texture, and material core (in canonical order),
+  // cores from the first cube map core on cannot be shared
+  Core* shader = nullptr;
+  Core* texture = nullptr;
+  Core* material = nullptr;
+  item.nSharedCores = item.nCores;
+  for (size_t i = beginCore; i < itemCores_.size(); ++i) {
+    const StateCore_& stateCore = itemCores_[i];
+    if (stateCore.category == SHADER && !shader) {
+      shader = stateCore.core;
+    }
+    else if ((stateCore.category == TEXTURE || stateCore.category == CUBE_MAP) && !texture) {
+      texture = stateCore.core;
+    }
+    else if (stateCore.category == MATERIAL && !material) {
+      material = stateCore.core;
+    }
+    if (stateCore.category == CUBE_MAP && item.nSharedCores == item.nCores) {
+      item.nSharedCores = i - beginCore;
+    }
+  }
+  const uint64_t stateKey = (getID_(shader) << (2 * ID_BITS)) | (getID_(texture) << ID_BITS)
+      | getID_(material);
+  const GLfloat depth = boundingBox.isEmpty() ? 0.0f
+      : -(item.modelView * glm::vec4(boundingBox.getCenter(), 1.0f)).z;
+  const uint64_t depthKey = depthToKey(depth);
+
+  Entry_ entry;
+  entry.item = items_.size();
+  if (isTransparent) {
+    entry.key = (TRANSPARENT_PASS << PASS_SHIFT) | ((MAX_DEPTH - depthKey) << (3 * ID_BITS))
+        | stateKey;
+  }
+  else {
+    entry.key = (stateKey << DEPTH_BITS) | depthKey;
+  }
+  entries_.push_back(entry);
+  items_.push_back(item);
+}
+
+
+void RenderQueue::collectIndirectRuns_() {
+  indirectRuns_.clear();
+  if (!isIndirectDrawing_ || !IndirectDrawBatch::isSupported()) {
+    return;
+  }
+  if (!indirectBatch_) {
+    indirectBatch_ = IndirectDrawBatch::create();
+  }
+  indirectBatch_->reset();
+
+  // extend current run by consecutive items with the same state and geometry pool
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Item_& item = items_[entries_[i].item];
+    const int pool = getIndirectPool_(item);
+    if (pool < 0) {
+      continue;
+    }
+    if (!indirectRuns_.empty() && indirectRuns_.back().endEntry == i
+        && indirectRuns_.back().pool == pool
+        && isSameState_(items_[entries_[i - 1].item], item)) {
+      ++indirectRuns_.back().endEntry;
+    }
+    else {
+      IndirectRun_ run = { i, i + 1, pool, indirectBatch_->getNDraws() };
+      indirectRuns_.push_back(run);
+    }
+    indirectBatch_->addDraw(item.geometryCore, item.modelView);
+  }
+  indirectBatch_->upload();
+}
+
+
+int RenderQueue::getIndirectPool_(const Item_& item) {
+  // the shader (first core in canonical order) has to read per-draw model-view matrices,
+  // cube map cores depend on the model-view matrix of each item
+  if (!item.geometryCore || item.nCores == 0 || item.nSharedCores < item.nCores) {
+    return -1;
+  }
+  const StateCore_& shader = itemCores_[item.beginCore];
+  if (shader.category != SHADER || !static_cast<ShaderCore*>(shader.core)->isAttributeActive(
+      OGLConstants::INSTANCE_MATRIX)) {
+    return -1;
+  }
+  return indirectBatch_->addGeometry(item.geometryCore);
+}
+
+
+bool RenderQueue::isSameState_(const Item_& item0, const Item_& item1) const {
+  if (item0.nCores != item1.nCores) {
+    return false;
+  }
+  for (size_t i = 0; i < item0.nCores; ++i) {
+    if (itemCores_[item0.beginCore + i].core != itemCores_[item1.beginCore + i].core) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+void RenderQueue::sort_() {
+  // least significant digit radix sort, stable to keep the order of equal keys
+  const int DIGIT_BITS = 8;
+  const size_t N_BUCKETS = size_t(1) << DIGIT_BITS;
+  sortBuffer_.resize(entries_.size());
+  for (int shift = 0; shift < 64; shift += DIGIT_BITS) {
+    size_t counts[N_BUCKETS] = { 0 };
+    for (auto& entry : entries_) {
+      ++counts[(entry.key >> shift) & (N_BUCKETS - 1)];
+    }
+    if (counts[(entries_.front().key >> shift) & (N_BUCKETS - 1)] == entries_.size()) {
+      continue;   // same digit for all keys
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < N_BUCKETS; ++i) {
+      const size_t count = counts[i];
+      counts[i] = offset;
+      offset += count;
+    }
+    for (auto& entry : entries_) {
+      sortBuffer_[counts[(entry.key >> shift) & (N_BUCKETS - 1)]++] = entry;
+    }
+    entries_.swap(sortBuffer_);
+  }
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,313 @@
+/**
+ * \file RenderQueue.h
+ * \brief A queue of draw items collected during traversal, sorted by render state
+ *    and depth before drawing (cf. CullingRenderTraverser::setRenderQueue()).
+ *
+ * Defines struct:
+ *   RenderQueueStats
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Counters of RenderQueue since the last reset.
+ */
+struct RenderQueueStats {
+
+  RenderQueueStats()
+      : nItems(0), nTransparent(0), nShaderChanges(0), nTextureChanges(0),
+        nMaterialChanges(0), nCoreChanges(0), nIndirectItems(0), nIndirectDraws(0) {
+  }
+
+  size_t nItems;            // number of draw items submitted
+  size_t nTransparent;      // number of draw items drawn in the transparent pass
+  size_t nShaderChanges;    // number of shader cores applied
+  size_t nTextureChanges;   // number of texture cores applied
+  size_t nMaterialChanges;  // number of material cores applied
+  size_t nCoreChanges;      // number of cores applied in total
+  size_t nIndirectItems;    // number of draw items drawn indirectly
+  size_t nIndirectDraws;    // number of glMultiDrawElementsIndirect() calls
+
+};
+
+
+/**
+ * \brief A queue of draw items collected during traversal, sorted by render state
+ *    and depth before drawing (cf. CullingRenderTraverser::setRenderQueue()).
+ *
+ * Instead of applying the cores of groups and shapes while traversing the scene graph,
+ * the traverser records the cores of the groups on the current path (cf. pushCores(),
+ * popCores()) and adds each shape (cf. addShape()). Every geometry core of a shape
+ * becomes a draw item that refers to its resolved state, i.e., the cores that would
+ * have been applied to it in graph order, and to a copy of the model-view matrix.
+ * The state is stored in a canonical order: the effective (i.e., last) shader core,
+ * the texture cores, the effective material core, and all other cores, each in the
+ * order of their application.
+ *
+ * submit() sorts the draw items by a 64-bit key (radix sort) and draws them. The key
+ * consists of the pass (opaque before transparent), the shader, texture, and material
+ * cores (by per-frame identifiers), and the view-space depth of the center of the
+ * bounding box. Opaque items are drawn front to back within the same state, transparent
+ * items back to front with alpha blending enabled and depth writes disabled.
+ * Items are considered transparent if the alpha value of their diffuse material color
+ * or vertex color (cf. ColorCore::setColor()) is less than one.
+ *
+ * Between two items, only the cores after their common prefix are restored and applied
+ * (cf. Core::renderPost(), Core::render()), such that consecutive items with the same
+ * shader or texture do not bind it again. Cube map cores depend on the model-view matrix
+ * and are applied again for each item.
+ *
+ * Shapes of classes derived from Shape (e.g., InstancedShape) are drawn by their own
+ * render() function with the state of their path applied.
+ *
+ * With indirect drawing (cf. setIndirectDrawing()), consecutive items with the same
+ * state are drawn by a single glMultiDrawElementsIndirect() call of an IndirectDrawBatch,
+ * if their shader reads the per-draw model-view matrix as OGLConstants::INSTANCE_MATRIX
+ * (e.g., phong_instanced_vert.glsl) and their geometry cores use DrawMode::ELEMENTS.
+ * Items with cube map cores are drawn individually.
+ */
+class RenderQueue {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  RenderQueue();
+
+  /**
+   * Destructor.
+   */
+  virtual ~RenderQueue();
+
+  /**
+   * Create shared pointer.
+   */
+  static RenderQueueSP create();
+
+  /**
+   * Check if draw items are sorted.
+   */
+  bool isSorting() const;
+
+  /**
+   * Enable or disable sorting of draw items, default: enabled.
+   * If disabled, the items are drawn in the order of addShape(), sharing common
+   * cores between consecutive items only.
+   */
+  void setSorting(bool isSorting);
+
+  /**
+   * Check if indirect drawing is enabled.
+   */
+  bool isIndirectDrawing() const;
+
+  /**
+   * Enable or disable indirect drawing, default: disabled.
+   * Ignored if the OpenGL context does not support it (cf. IndirectDrawBatch::isSupported()).
+   */
+  void setIndirectDrawing(bool isIndirectDrawing);
+
+  /**
+   * Get counters since last reset().
+   */
+  const RenderQueueStats& getStats() const;
+
+  /**
+   * Clear draw items, path, and counters, to be called before each traversal.
+   */
+  void reset();
+
+  /**
+   * Append cores of a node to the current path (e.g., when visiting a group).
+   */
+  void pushCores(Node* node);
+
+  /**
+   * Remove cores appended by last pushCores().
+   */
+  void popCores();
+
+  /**
+   * Add draw items for the geometry cores of a shape, using the cores of the current
+   * path, the cores of the shape, and the current model-view matrix of the render state.
+   */
+  void addShape(Shape* shape, RenderState* renderState);
+
+  /**
+   * Apply resolved state of the current path, e.g., to render a static batch or
+   * a sub-tree in graph order. To be followed by applyPathPost().
+   */
+  void applyPath(RenderState* renderState);
+
+  /**
+   * Restore render state after applyPath().
+   */
+  void applyPathPost(RenderState* renderState);
+
+  /**
+   * Sort and draw all draw items added since the last submit, then clear them.
+   * The current path is kept.
+   */
+  void submit(RenderState* renderState);
+
+protected:
+
+  /**
+   * \brief Category of a core, determining its position in the resolved state.
+   */
+  enum Category_ {
+    SHADER,
+    TEXTURE,
+    CUBE_MAP,
+    MATERIAL,
+    COLOR,
+    OTHER,
+    GEOMETRY
+  };
+
+  /**
+   * \brief Core of a resolved state.
+   */
+  struct StateCore_ {
+    Core* core;
+    Category_ category;
+  };
+
+  /**
+   * \brief Draw item, i.e., geometry core or shape with its resolved state.
+   */
+  struct Item_ {
+    GeometryCore* geometryCore;   // null if drawn by shape
+    Shape* shape;
+    size_t beginCore;             // index of first core of resolved state
+    size_t nCores;
+    size_t nSharedCores;          // number of cores that may be shared with the previous item
+    glm::mat4 modelView;
+    unsigned long modelViewStamp;
+  };
+
+  /**
+   * \brief Sort key and item index.
+   */
+  struct Entry_ {
+    uint64_t key;
+    size_t item;
+  };
+
+  /**
+   * \brief Range of sorted entries drawn by a single indirect draw call.
+   */
+  struct IndirectRun_ {
+    size_t beginEntry;
+    size_t endEntry;
+    int pool;                     // geometry pool of IndirectDrawBatch
+    size_t firstDraw;             // index of first draw command
+  };
+
+  /**
+   * Determine category of a core.
+   */
+  static Category_ getCategory_(Core* core);
+
+  /**
+   * Append resolved state of the current path and the given shape cores to the
+   * given vector.
+   * \return true if the state is transparent
+   */
+  bool resolveState_(const StateCore_* shapeCores, size_t nShapeCores,
+      std::vector<StateCore_>& state) const;
+
+  /**
+   * Get per-frame identifier of a core for the sort key, 0 for null.
+   */
+  uint64_t getID_(Core* core);
+
+  /**
+   * Add draw item with resolved state appended to itemCores_ at beginCore.
+   */
+  void addItem_(GeometryCore* geometryCore, Shape* shape, size_t beginCore, bool isTransparent,
+      const AABB& boundingBox, RenderState* renderState);
+
+  /**
+   * Enable blending and disable depth writes for transparent items, or restore the
+   * given blending state.
+   */
+  static void setBlending_(RenderState* renderState, bool isTransparent, bool isBlend,
+      const GLint* blendFunc);
+
+  /**
+   * Sort entries_ by key (LSD radix sort, skipping digits that are equal for all keys).
+   */
+  void sort_();
+
+  /**
+   * Collect runs of sorted entries to be drawn indirectly, add and upload their draws.
+   */
+  void collectIndirectRuns_();
+
+  /**
+   * Get geometry pool of an item if it can be drawn indirectly, -1 otherwise.
+   */
+  int getIndirectPool_(const Item_& item);
+
+  /**
+   * Check if two items have the same resolved state.
+   */
+  bool isSameState_(const Item_& item0, const Item_& item1) const;
+
+protected:
+
+  bool isSorting_;
+  bool isIndirectDrawing_;
+  RenderQueueStats stats_;
+  std::vector<StateCore_> path_;
+  std::vector<size_t> pathSizes_;   // sizes of path before each pushCores()
+  std::vector<Item_> items_;
+  std::vector<StateCore_> itemCores_;
+  std::vector<Entry_> entries_;
+  std::vector<Entry_> sortBuffer_;
+  std::unordered_map<Core*, uint64_t> ids_;
+  std::vector<StateCore_> shapeCores_;
+  std::vector<StateCore_> pathState_;  // state applied by applyPath()
+  std::vector<Core*> appliedCores_;
+  IndirectDrawBatchSP indirectBatch_;
+  std::vector<IndirectRun_> indirectRuns_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* RENDERQUEUE_H_ */
@@ -21,40 +21,66 @@
  * limitations under the License.
  */
 
+#include <cstring>
+#include "scg_glew.h"
+#include <GLFW/glfw3.h>
 #include "scg_internals.h"
 #include "scg_utilities.h"
 #include "Light.h"
 #include "RenderState.h"
+#include "RingBuffer.h"
 #include "ShaderCore.h"
 
 namespace scg {
 
 
+unsigned long MatrixStack::stampCounter_(MatrixStack::IDENTITY_STAMP);
+GLStateCache RenderState::glState;
+
+static_assert(RenderState::LIGHT_BLOCK_SIZE == OGLConstants::MAX_NUMBER_OF_LIGHTS * Light::BUFFER_SIZE,
+    "light block size does not match light buffer size");
+
+
 RenderState::RenderState()
-    : colorCore_(nullptr), shaderCore_(nullptr), projection_(1.0f), viewTransform_(1.0f), tempMatrix_(1.0f),
-      isLightingEnabled_(true), nLights_(0), lightUBO_(0), globalAmbientLight_(0.f, 0.f, 0.f, 1.f) {
+    : colorCore_(nullptr), shaderCore_(nullptr), projection_(1.0f), projectionStamp_(MatrixStack::newStamp()),
+      viewTransform_(1.0f), viewTransformVersion_(1), invViewTransform_(1.0f), isInvViewTransformValid_(true),
+      tempMatrix_(1.0f), mvpMatrix_(1.0f), mvpModelViewStamp_(0), mvpProjectionStamp_(0),
+      normalMatrix_(1.0f), normalMatrixStamp_(0),
+      isLightingEnabled_(true), nLights_(0), globalAmbientLight_(0.f, 0.f, 0.f, 1.f),
+      lodScale_(1.0f), blockAlignment_(1), lightData_(LIGHT_BLOCK_SIZE, 0),
+      isLightBlockValid_(false), lightOffset_(0), lightSectionCount_(0), isFrameBlockValid_(false),
+      frameOffset_(0), frameSectionCount_(0), frameProjectionStamp_(0),
+      frameViewTransformVersion_(0), frameTime_(0.f), objectOffset_(-1), objectSectionCount_(0),
+      objectModelViewStamp_(0), objectTextureStamp_(0), objectColorStamp_(0),
+      objectNLights_(0), objectContents_(0) {
 }
 
 
 RenderState::~RenderState() {
-  if (isGLContextActive()) {
-    glDeleteBuffers(1, &lightUBO_);
-  }
 }
 
 
 void RenderState::init() {
-  glGenBuffers(1, &lightUBO_);
-  const size_t bufferSize = OGLConstants::MAX_NUMBER_OF_LIGHTS * Light::BUFFER_SIZE;
-  GLubyte* buffer = new GLubyte[bufferSize];
-  std::memset(buffer, 0, bufferSize);
-  glBindBuffer(GL_UNIFORM_BUFFER, lightUBO_);
-  assert(glIsBuffer(lightUBO_));
-  glBufferData(GL_UNIFORM_BUFFER, bufferSize, buffer, GL_DYNAMIC_DRAW);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
-  delete [] buffer;
-  buffer = nullptr;
-  glBindBufferBase(GL_UNIFORM_BUFFER, OGLConstants::LIGHT.bindingPoint, lightUBO_);
+  // OpenGL context may have been created or changed
+  glState.invalidate();
+
+  // create ring buffer for the uniform blocks, written by update*Block_(),
+  // blocks aligned as required by glBindBufferRange()
+  ringBuffer_ = RingBuffer::create(RING_BUFFER_SIZE);
+  GLint alignment = 1;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  blockAlignment_ = alignment;
+  isLightBlockValid_ = false;
+  isFrameBlockValid_ = false;
+  objectOffset_ = -1;
+
+  // per-instance attributes of geometry drawn without instance data (i.e., arrays disabled),
+  // such that shaders for instanced or indirect drawing apply to all shapes
+  for (GLuint i = 0; i < 4; ++i) {
+    glVertexAttrib4f(OGLConstants::INSTANCE_MATRIX.location + i, i == 0 ? 1.0f : 0.0f,
+        i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f, i == 3 ? 1.0f : 0.0f);
+  }
+  glVertexAttrib4f(OGLConstants::INSTANCE_COLOR.location, 1.0f, 1.0f, 1.0f, 1.0f);
 
   assert(!checkGLError());
 }
@@ -62,6 +88,7 @@ void RenderState::init() {
 
 void RenderState::setLighting(bool isLightingEnabled) {
   isLightingEnabled_ = isLightingEnabled;
+  isFrameBlockValid_ = false;
 }
 
 
@@ -75,8 +102,15 @@ int RenderState::getNLights() const {
 }
 
 
-GLuint RenderState::getLightUBO() const {
-  return lightUBO_;
+void RenderState::setLight(int index, const GLubyte* data) {
+  assert(index >= 0 && index < nLights_);
+  std::memcpy(lightData_.data() + index * Light::BUFFER_SIZE, data, Light::BUFFER_SIZE);
+  isLightBlockValid_ = false;
+}
+
+
+RingBuffer* RenderState::getRingBuffer() {
+  return ringBuffer_.get();
 }
 
 
@@ -113,38 +147,178 @@ void RenderState::removeLight() {
 
 void RenderState::setGlobalAmbientLight(const glm::vec4& globalAmbientLight) {
   globalAmbientLight_ = globalAmbientLight;
+  isFrameBlockValid_ = false;
 }
 
 
 void RenderState::applyProjectionViewTransform() {
-  projectionStack.setMatrix(projection_);
-  modelViewStack.multMatrix(viewTransform_);
+  projectionStack.setMatrix(projection_, projectionStamp_);
+  modelViewStack.multMatrix(viewTransform_, viewTransformVersion_, viewTransformCache_);
+
+  // new frame: fence uniform blocks of the previous frame, update time
+  if (ringBuffer_) {
+    ringBuffer_->endFrame();
+  }
+  frameTime_ = static_cast<GLfloat>(glfwGetTime());
+  isFrameBlockValid_ = false;
 }
 
 
 void RenderState::passToShader() {
   assert(shaderCore_ != nullptr);
-  shaderCore_->setUniformMatrix4fv(OGLConstants::MODEL_VIEW_MATRIX, 1,
-      glm::value_ptr(modelViewStack.getMatrix()));
-  shaderCore_->setUniformMatrix4fv(OGLConstants::PROJECTION_MATRIX, 1,
-      glm::value_ptr(projectionStack.getMatrix()));
-  shaderCore_->setUniformMatrix4fv(OGLConstants::MVP_MATRIX, 1,
-      glm::value_ptr(projectionStack.getMatrix() * modelViewStack.getMatrix()));
-  // compute 3x3 normal matrix from 4x4 model-view matrix
-  shaderCore_->setUniformMatrix3fv(OGLConstants::NORMAL_MATRIX, 1,
-      glm::value_ptr(glm::transpose(glm::inverse(glm::mat3(modelViewStack.getMatrix())))));
-  shaderCore_->setUniformMatrix4fv(OGLConstants::TEXTURE_MATRIX, 1,
-      glm::value_ptr(textureStack.getMatrix()));
-  shaderCore_->setUniformMatrix4fv(OGLConstants::COLOR_MATRIX, 1,
-      glm::value_ptr(colorStack.getMatrix()));
-  if (isLightingEnabled_) {
-    shaderCore_->setUniform1i(OGLConstants::N_LIGHTS, nLights_);
-    shaderCore_->setUniform4fv(OGLConstants::GLOBAL_AMBIENT_LIGHT, 1, glm::value_ptr(globalAmbientLight_));
-  }
-  else {
+  assert(ringBuffer_);
+  // update and pass only what the shader program consumes
+  const unsigned int uniformMask = shaderCore_->getUniformMask();
+  if (shaderCore_->isUniformBlockActive(OGLConstants::LIGHT)) {
+    updateLightBlock_();
+  }
+  if (shaderCore_->isUniformBlockActive(OGLConstants::FRAME)) {
+    updateFrameBlock_();
+  }
+  if (shaderCore_->isUniformBlockActive(OGLConstants::OBJECT)) {
+    updateObjectBlock_(uniformMask);
+  }
+  if (shaderCore_->hasStandardUniforms()) {
+    passUniforms_(uniformMask);
+  }
+}
+
+
+void RenderState::updateLightBlock_() {
+  if (!isLightBlockValid_ || !ringBuffer_->isValid(lightSectionCount_)) {
+    // lights beyond nLights_ are not read by the shader
+    lightOffset_ = ringBuffer_->write(lightData_.data(), LIGHT_BLOCK_SIZE, blockAlignment_);
+    lightSectionCount_ = ringBuffer_->getSectionCount();
+    isLightBlockValid_ = true;
+  }
+  // binding point is shared with other render states
+  glState.bindUniformBufferRange(OGLConstants::LIGHT.bindingPoint, ringBuffer_->getBuffer(),
+      lightOffset_, LIGHT_BLOCK_SIZE);
+}
+
+
+void RenderState::updateFrameBlock_() {
+  if (!isFrameBlockValid_ || projectionStack.getStamp() != frameProjectionStamp_
+      || viewTransformVersion_ != frameViewTransformVersion_
+      || !ringBuffer_->isValid(frameSectionCount_)) {
+    // std140 layout: projectionMatrix, viewMatrix, globalAmbientLight, time
+    GLfloat* block = reinterpret_cast<GLfloat*>(
+        ringBuffer_->map(FRAME_BLOCK_SIZE, blockAlignment_, frameOffset_));
+    const glm::vec4 globalAmbientLight = isLightingEnabled_ ? globalAmbientLight_ : glm::vec4(0.f, 0.f, 0.f, 1.f);
+    std::memcpy(block, glm::value_ptr(projectionStack.getMatrix()), sizeof(glm::mat4));
+    std::memcpy(block + 16, glm::value_ptr(viewTransform_), sizeof(glm::mat4));
+    std::memcpy(block + 32, glm::value_ptr(globalAmbientLight), sizeof(glm::vec4));
+    block[36] = frameTime_;
+    ringBuffer_->unmap();
+    frameSectionCount_ = ringBuffer_->getSectionCount();
+    frameProjectionStamp_ = projectionStack.getStamp();
+    frameViewTransformVersion_ = viewTransformVersion_;
+    isFrameBlockValid_ = true;
+  }
+  // binding point is shared with other render states
+  glState.bindUniformBufferRange(OGLConstants::FRAME.bindingPoint, ringBuffer_->getBuffer(),
+      frameOffset_, FRAME_BLOCK_SIZE);
+}
+
+
+void RenderState::updateObjectBlock_(unsigned int uniformMask) {
+  const unsigned int modelViewBit = uniformBit_(OGLUniform::MODEL_VIEW_MATRIX)
+      | uniformBit_(OGLUniform::NORMAL_MATRIX);
+  const unsigned int textureBit = uniformBit_(OGLUniform::TEXTURE_MATRIX);
+  const unsigned int colorBit = uniformBit_(OGLUniform::COLOR_MATRIX);
+  const unsigned int nLightsBit = uniformBit_(OGLUniform::N_LIGHTS);
+  const GLint nLights = isLightingEnabled_ ? nLights_ : 0;
+
+  // keep current block if it contains all values used by the program, and these are up to date
+  if (objectOffset_ >= 0 && ringBuffer_->isValid(objectSectionCount_)
+      && (uniformMask & ~objectContents_ & OBJECT_UNIFORMS_) == 0
+      && (!(uniformMask & modelViewBit) || modelViewStack.getStamp() == objectModelViewStamp_)
+      && (!(uniformMask & textureBit) || textureStack.getStamp() == objectTextureStamp_)
+      && (!(uniformMask & colorBit) || colorStack.getStamp() == objectColorStamp_)
+      && (!(uniformMask & nLightsBit) || nLights == objectNLights_)) {
+    glState.bindUniformBufferRange(OGLConstants::OBJECT.bindingPoint, ringBuffer_->getBuffer(),
+        objectOffset_, OBJECT_BLOCK_SIZE);
+    return;
+  }
+
+  // std140 layout: modelViewMatrix, textureMatrix, colorMatrix, normalMatrix (3 x vec4), nLights
+  GLfloat* block = reinterpret_cast<GLfloat*>(
+      ringBuffer_->map(OBJECT_BLOCK_SIZE, blockAlignment_, objectOffset_));
+  std::memcpy(block, glm::value_ptr(modelViewStack.getMatrix()), sizeof(glm::mat4));
+  std::memcpy(block + 16, glm::value_ptr(textureStack.getMatrix()), sizeof(glm::mat4));
+  std::memcpy(block + 32, glm::value_ptr(colorStack.getMatrix()), sizeof(glm::mat4));
+  std::memcpy(block + 60, &nLights, sizeof(GLint));
+  objectContents_ = OBJECT_UNIFORMS_ & ~uniformBit_(OGLUniform::NORMAL_MATRIX);
+  // compute 3x3 normal matrix from 4x4 model-view matrix only if used (or cached)
+  if ((uniformMask & uniformBit_(OGLUniform::NORMAL_MATRIX))
+      || modelViewStack.getStamp() == normalMatrixStamp_) {
+    if (modelViewStack.getStamp() != normalMatrixStamp_) {
+      normalMatrix_ = glm::transpose(glm::inverse(glm::mat3(modelViewStack.getMatrix())));
+      normalMatrixStamp_ = modelViewStack.getStamp();
+    }
+    for (int i = 0; i < 3; ++i) {
+      std::memcpy(block + 48 + 4 * i, glm::value_ptr(normalMatrix_[i]), sizeof(glm::vec3));
+    }
+    objectContents_ = OBJECT_UNIFORMS_;
+  }
+
+  ringBuffer_->unmap();
+  objectSectionCount_ = ringBuffer_->getSectionCount();
+  objectModelViewStamp_ = modelViewStack.getStamp();
+  objectTextureStamp_ = textureStack.getStamp();
+  objectColorStamp_ = colorStack.getStamp();
+  objectNLights_ = nLights;
+  glState.bindUniformBufferRange(OGLConstants::OBJECT.bindingPoint, ringBuffer_->getBuffer(),
+      objectOffset_, OBJECT_BLOCK_SIZE);
+}
+
+
+void RenderState::passUniforms_(unsigned int uniformMask) {
+  // standard uniforms are set by handle to avoid name lookups per draw call,
+  // derived matrices are computed only if used
+  if (uniformMask & uniformBit_(OGLUniform::MODEL_VIEW_MATRIX)) {
+    shaderCore_->setUniformMatrix4fv(shaderCore_->getUniformHandle(OGLUniform::MODEL_VIEW_MATRIX), 1,
+        glm::value_ptr(modelViewStack.getMatrix()));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::PROJECTION_MATRIX)) {
+    shaderCore_->setUniformMatrix4fv(shaderCore_->getUniformHandle(OGLUniform::PROJECTION_MATRIX), 1,
+        glm::value_ptr(projectionStack.getMatrix()));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::MVP_MATRIX)) {
+    // recompute only if model-view or projection matrix have changed
+    if (modelViewStack.getStamp() != mvpModelViewStamp_ || projectionStack.getStamp() != mvpProjectionStamp_) {
+      mvpMatrix_ = projectionStack.getMatrix() * modelViewStack.getMatrix();
+      mvpModelViewStamp_ = modelViewStack.getStamp();
+      mvpProjectionStamp_ = projectionStack.getStamp();
+    }
+    shaderCore_->setUniformMatrix4fv(shaderCore_->getUniformHandle(OGLUniform::MVP_MATRIX), 1,
+        glm::value_ptr(mvpMatrix_));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::NORMAL_MATRIX)) {
+    // compute 3x3 normal matrix from 4x4 model-view matrix
+    if (modelViewStack.getStamp() != normalMatrixStamp_) {
+      normalMatrix_ = glm::transpose(glm::inverse(glm::mat3(modelViewStack.getMatrix())));
+      normalMatrixStamp_ = modelViewStack.getStamp();
+    }
+    shaderCore_->setUniformMatrix3fv(shaderCore_->getUniformHandle(OGLUniform::NORMAL_MATRIX), 1,
+        glm::value_ptr(normalMatrix_));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::TEXTURE_MATRIX)) {
+    shaderCore_->setUniformMatrix4fv(shaderCore_->getUniformHandle(OGLUniform::TEXTURE_MATRIX), 1,
+        glm::value_ptr(textureStack.getMatrix()));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::COLOR_MATRIX)) {
+    shaderCore_->setUniformMatrix4fv(shaderCore_->getUniformHandle(OGLUniform::COLOR_MATRIX), 1,
+        glm::value_ptr(colorStack.getMatrix()));
+  }
+  if (uniformMask & uniformBit_(OGLUniform::N_LIGHTS)) {
+    shaderCore_->setUniform1i(shaderCore_->getUniformHandle(OGLUniform::N_LIGHTS),
+        isLightingEnabled_ ? nLights_ : 0);
+  }
+  if (uniformMask & uniformBit_(OGLUniform::GLOBAL_AMBIENT_LIGHT)) {
     const glm::vec4 black(0.f, 0.f, 0.f, 1.f);
-    shaderCore_->setUniform1i(OGLConstants::N_LIGHTS, 0);
-    shaderCore_->setUniform4fv(OGLConstants::GLOBAL_AMBIENT_LIGHT, 1, glm::value_ptr(black));
+    shaderCore_->setUniform4fv(shaderCore_->getUniformHandle(OGLUniform::GLOBAL_AMBIENT_LIGHT), 1,
+        glm::value_ptr(isLightingEnabled_ ? globalAmbientLight_ : black));
   }
 }
 
@@ -30,65 +30,197 @@
 #define RENDERSTATE_H_
 
 #include <cassert>
-#include <stack>
+#include <vector>
 #include "scg_glew.h"
+#include "GLStateCache.h"
 #include "scg_glm.h"
 #include "scg_internals.h"
 
 namespace scg {
 
 
+/**
+ * \brief Cache for the products of a local matrix (e.g., of a Transformation) with
+ *    the matrices it has been multiplied to on a MatrixStack (cf. MatrixStack::multMatrix()).
+ *
+ * Each entry is identified by the stamp of the parent matrix and the version of the
+ * local matrix. Two entries are used since a scene graph may be traversed
+ * with two different base matrices per frame (e.g., left and right eye of a stereo renderer).
+ */
+struct MatrixProductCache {
+
+  static const size_t N_ENTRIES = 2;
+
+  struct Entry {
+    unsigned long parentStamp;
+    unsigned long matrixVersion;
+    unsigned long stamp;
+    glm::mat4 product;
+  };
+
+  MatrixProductCache()
+      : lastEntry(0) {
+    for (auto& entry : entries) {
+      entry.parentStamp = 0;
+      entry.matrixVersion = 0;
+      entry.stamp = 0;
+    }
+  }
+
+  Entry entries[N_ENTRIES];
+  size_t lastEntry;
+
+};
+
+
 /**
  * \brief Matrix stack to store model-view, projection, texture, and color matrices,
  *    used by RenderState.
  *
+ * The matrices are stored in a contiguous, 16-byte aligned array whose capacity
+ * is reserved in advance and doubled only if the stack depth exceeds it, such that
+ * push and pop operations do not allocate memory in the steady state.
+ *
+ * Each matrix is accompanied by a stamp that changes whenever the matrix is modified,
+ * such that products with unchanged local matrices can be reused from a
+ * MatrixProductCache instead of being recomputed.
  * The member functions are defined in the header file to allow inlining.
  */
 class MatrixStack {
 
 public:
 
-  MatrixStack() {
-    stack_.push(glm::mat4(1.0f));
+  /**
+   * Initial capacity, i.e., stack depth that does not require memory allocation.
+   */
+  static const size_t INITIAL_CAPACITY = 64;
+
+  /**
+   * Stamp of the identity matrix set by setIdentity().
+   */
+  static const unsigned long IDENTITY_STAMP = 1;
+
+  MatrixStack()
+      : stack_(INITIAL_CAPACITY), stamps_(INITIAL_CAPACITY), top_(0) {
+    stack_[0] = glm::mat4(1.0f);
+    stamps_[0] = IDENTITY_STAMP;
   }
 
   const glm::mat4& getMatrix() const {
-    assert(!stack_.empty());
-    return stack_.top();
+    return stack_[top_];
+  }
+
+  /**
+   * Get stamp of current matrix, which changes whenever the matrix is modified.
+   */
+  unsigned long getStamp() const {
+    return stamps_[top_];
   }
 
   void setMatrix(const glm::mat4& matrix) {
-    assert(!stack_.empty());
-    stack_.top() = matrix;
+    stack_[top_] = matrix;
+    stamps_[top_] = newStamp();
+  }
+
+  /**
+   * Set current matrix with a stamp that has been created by newStamp() for this matrix.
+   */
+  void setMatrix(const glm::mat4& matrix, unsigned long stamp) {
+    stack_[top_] = matrix;
+    stamps_[top_] = stamp;
   }
 
   void setIdentity() {
-    assert(!stack_.empty());
-    stack_.top() = glm::mat4(1.0f);
+    stack_[top_] = glm::mat4(1.0f);
+    stamps_[top_] = IDENTITY_STAMP;
   }
 
   void pushMatrix() {
-    assert(!stack_.empty());
-    stack_.push(stack_.top());
+    if (top_ + 1 == stack_.size()) {
+      grow_();
+    }
+    stack_[top_ + 1] = stack_[top_];
+    stamps_[top_ + 1] = stamps_[top_];
+    ++top_;
   }
 
   void pushMatrix(const glm::mat4& matrix) {
-    stack_.push(matrix);
+    if (top_ + 1 == stack_.size()) {
+      grow_();
+    }
+    stack_[++top_] = matrix;
+    stamps_[top_] = newStamp();
   }
 
   void popMatrix() {
-    assert(!stack_.empty());
-    stack_.pop();
+    assert(top_ > 0);
+    --top_;
   }
 
   void multMatrix(const glm::mat4& matrix) {
-    assert(!stack_.empty());
-    stack_.top() *= matrix;
+    stack_[top_] *= matrix;
+    stamps_[top_] = newStamp();
+  }
+
+  /**
+   * Multiply current matrix by given matrix, reusing the product from the cache
+   * if neither the current matrix nor the given matrix have changed since the
+   * product has been computed.
+   * \param matrix matrix to multiply by
+   * \param matrixVersion version of matrix, to be changed by the caller whenever
+   *    the matrix is modified
+   * \param cache cache to be used for this matrix
+   */
+  void multMatrix(const glm::mat4& matrix, unsigned long matrixVersion, MatrixProductCache& cache) {
+    const unsigned long parentStamp = stamps_[top_];
+    for (size_t i = 0; i < MatrixProductCache::N_ENTRIES; ++i) {
+      const MatrixProductCache::Entry& entry = cache.entries[i];
+      if (entry.parentStamp == parentStamp && entry.matrixVersion == matrixVersion) {
+        stack_[top_] = entry.product;
+        stamps_[top_] = entry.stamp;
+        cache.lastEntry = i;
+        return;
+      }
+    }
+
+    // replace least recently used entry
+    cache.lastEntry = (cache.lastEntry + 1) % MatrixProductCache::N_ENTRIES;
+    MatrixProductCache::Entry& entry = cache.entries[cache.lastEntry];
+    stack_[top_] *= matrix;
+    stamps_[top_] = newStamp();
+    entry.parentStamp = parentStamp;
+    entry.matrixVersion = matrixVersion;
+    entry.stamp = stamps_[top_];
+    entry.product = stack_[top_];
+  }
+
+  /**
+   * Get number of pushed matrices, i.e., zero if only the bottom matrix is present.
+   */
+  size_t getDepth() const {
+    return top_;
+  }
+
+  /**
+   * Create new stamp that differs from all stamps previously created.
+   */
+  static unsigned long newStamp() {
+    return ++stampCounter_;
+  }
+
+protected:
+
+  void grow_() {
+    stack_.resize(2 * stack_.size());
+    stamps_.resize(stack_.size());
   }
 
 protected:
 
-  std::stack<glm::mat4> stack_;
+  std::vector<glm::mat4, AlignedAllocator<glm::mat4, 16> > stack_;
+  std::vector<unsigned long> stamps_;
+  size_t top_;
+  static unsigned long stampCounter_;
 
 };
 
@@ -97,7 +229,16 @@ protected:
  * \brief The central render state that collects information about the current
  *    shader, transformations, matrix stacks, light and color properties.
  *
- * The light properties are stored in a uniform buffer object (UBO).
+ * The light properties and the standard uniforms are passed in uniform blocks that are
+ * written into a RingBuffer (cf. getRingBuffer()) and bound by glBindBufferRange()
+ * (cf. passToShader()): the light block (properties of the active lights, cf. setLight())
+ * and the frame block (projection and view matrices, global ambient light, time) are
+ * written only when one of their values changes, the object block (model-view, texture,
+ * color, and normal matrices, number of lights) whenever one of its matrices changes.
+ * Consecutive draws with unchanged matrices (e.g., the geometry cores of a shape) share
+ * the same block. The ring buffer is fenced per frame (cf. applyProjectionViewTransform()),
+ * such that writing the blocks neither copies nor waits in the driver.
+ *
  * A few member functions are defined in the header file to allow inlining.
  * The matrix stacks are public member variables that are accessed as, e.g.,
  *
@@ -119,7 +260,29 @@ public:
   virtual ~RenderState();
 
   /**
-   * Inittailize state, create light uniform buffer object (UBO).
+   * Size of the frame uniform block (std140 layout, cf. OGLConstants::FRAME).
+   */
+  static const GLsizeiptr FRAME_BLOCK_SIZE = 160;
+
+  /**
+   * Size of the object uniform block (std140 layout, cf. OGLConstants::OBJECT).
+   */
+  static const GLsizeiptr OBJECT_BLOCK_SIZE = 256;
+
+  /**
+   * Size of the light uniform block (std140 layout, cf. OGLConstants::LIGHT).
+   */
+  static const GLsizeiptr LIGHT_BLOCK_SIZE = OGLConstants::MAX_NUMBER_OF_LIGHTS * 112;
+
+  /**
+   * Size of the uniform block data that can be written per frame without waiting
+   * for the GPU (cf. RingBuffer).
+   */
+  static const GLsizeiptr RING_BUFFER_SIZE = 1 << 20;
+
+  /**
+   * Inittailize state, create ring buffer for the light, frame, and object uniform blocks,
+   * set default values of per-instance attributes (identity matrix, white color).
    */
   void init();
 
@@ -129,9 +292,17 @@ public:
   int getNLights() const;
 
   /**
-   * Get light uniforma buffer object (UBO).
+   * Set properties of an active light (std140 layout, cf. Light::BUFFER_SIZE),
+   * to be passed to the shader in the light block.
+   * \param index index of the light, less than getNLights()
+   * \param data light properties
    */
-  GLuint getLightUBO() const;
+  void setLight(int index, const GLubyte* data);
+
+  /**
+   * Get ring buffer for dynamic per-frame data, e.g., uniform blocks.
+   */
+  RingBuffer* getRingBuffer();
 
   /**
    * Get color core.
@@ -161,10 +332,14 @@ public:
   }
 
   /**
-   * Get view transformation that is applied before rendering the scene.
+   * Set view transformation that is applied before rendering the scene.
    */
   void setViewTransform(const glm::mat4& viewTransform) {
-    viewTransform_ = viewTransform;
+    if (viewTransform != viewTransform_) {
+      viewTransform_ = viewTransform;
+      ++viewTransformVersion_;
+      isInvViewTransformValid_ = false;
+    }
   }
 
   /**
@@ -178,7 +353,27 @@ public:
    * Set camera projection that is applied before rendering the scene.
    */
   void setProjection(const glm::mat4& projection) {
-    projection_ = projection;
+    if (projection != projection_) {
+      projection_ = projection;
+      projectionStamp_ = MatrixStack::newStamp();
+    }
+  }
+
+  /**
+   * Get scale factor from normalized device coordinates to screen size, e.g., half
+   * of the viewport height in pixels, including the LOD bias of the renderer
+   * (cf. LOD::getScreenSize()).
+   */
+  GLfloat getLODScale() const {
+    return lodScale_;
+  }
+
+  /**
+   * Set scale factor from normalized device coordinates to screen size, to be called
+   * by Renderer, default: 1.
+   */
+  void setLODScale(GLfloat lodScale) {
+    lodScale_ = lodScale;
   }
 
   /**
@@ -192,7 +387,11 @@ public:
    * Get current model matrix.
    */
   const glm::mat4& getModelMatrix() const {
-    return tempMatrix_ = glm::inverse(viewTransform_) * modelViewStack.getMatrix();
+    if (!isInvViewTransformValid_) {
+      invViewTransform_ = glm::inverse(viewTransform_);
+      isInvViewTransformValid_ = true;
+    }
+    return tempMatrix_ = invViewTransform_ * modelViewStack.getMatrix();
   }
 
 
@@ -227,16 +426,51 @@ public:
 
   /**
    * Apply projection and view transformation before rendering the scene,
-   * to be called by Renderer.
+   * to be called by Renderer. Starts a new frame of the ring buffer.
    */
   void applyProjectionViewTransform();
 
   /**
    * Pass current modelview, projection, normal, texture, color matrices to shader,
    * to be called before rendering any geometry.
+   * Updates and binds the frame and object uniform blocks, and sets the standard
+   * uniforms individually only if the shader declares them outside of the blocks
+   * (cf. ShaderCore::hasStandardUniforms()). Blocks and uniforms that are not active
+   * in the shader program are skipped, as are derived matrices (MVP, normal matrix)
+   * that it does not use (cf. ShaderCore::getUniformMask()).
    */
   void passToShader();
 
+protected:
+
+  /**
+   * Write light uniform block if one of the active lights has changed, and bind it.
+   */
+  void updateLightBlock_();
+
+  /**
+   * Write frame uniform block if one of its values has changed, and bind it.
+   */
+  void updateFrameBlock_();
+
+  /**
+   * Write object uniform block if one of its values has changed, and bind it.
+   */
+  void updateObjectBlock_(unsigned int uniformMask);
+
+  /**
+   * Set standard uniforms individually, for shaders declaring them outside of the
+   * uniform blocks.
+   */
+  void passUniforms_(unsigned int uniformMask);
+
+  /**
+   * Get bit of standard uniform in uniform mask (cf. ShaderCore::getUniformMask()).
+   */
+  static unsigned int uniformBit_(OGLUniform uniform) {
+    return 1u << static_cast<unsigned int>(uniform);
+  }
+
 public:
 
   // public member variables are used for efficiency
@@ -245,17 +479,56 @@ public:
   MatrixStack textureStack;
   MatrixStack colorStack;
 
+  // shadow copy of the state of the OpenGL context, shared by all render states
+  static GLStateCache glState;
+
 protected:
 
+  // standard uniforms in the object block
+  static const unsigned int OBJECT_UNIFORMS_ = (1u << static_cast<unsigned int>(OGLUniform::MODEL_VIEW_MATRIX))
+      | (1u << static_cast<unsigned int>(OGLUniform::TEXTURE_MATRIX))
+      | (1u << static_cast<unsigned int>(OGLUniform::COLOR_MATRIX))
+      | (1u << static_cast<unsigned int>(OGLUniform::NORMAL_MATRIX))
+      | (1u << static_cast<unsigned int>(OGLUniform::N_LIGHTS));
+
   ColorCore* colorCore_;
   ShaderCore* shaderCore_;
   glm::mat4 projection_;
+  unsigned long projectionStamp_;
   glm::mat4 viewTransform_;
+  unsigned long viewTransformVersion_;
+  MatrixProductCache viewTransformCache_;
+  mutable glm::mat4 invViewTransform_;
+  mutable bool isInvViewTransformValid_;
   mutable glm::mat4 tempMatrix_;
+  glm::mat4 mvpMatrix_;               // derived matrices passed to shader, cached by matrix stamps
+  unsigned long mvpModelViewStamp_;
+  unsigned long mvpProjectionStamp_;
+  glm::mat3 normalMatrix_;
+  unsigned long normalMatrixStamp_;
   bool isLightingEnabled_;
   GLint nLights_;
-  GLuint lightUBO_;
   glm::vec4 globalAmbientLight_;
+  GLfloat lodScale_;
+  RingBufferSP ringBuffer_;
+  GLintptr blockAlignment_;           // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  std::vector<GLubyte> lightData_;    // light block of the active lights
+  bool isLightBlockValid_;            // false if a light has changed
+  GLintptr lightOffset_;
+  unsigned long lightSectionCount_;   // of the ring buffer when written
+  bool isFrameBlockValid_;            // false if lighting, ambient light, or time have changed
+  GLintptr frameOffset_;
+  unsigned long frameSectionCount_;
+  unsigned long frameProjectionStamp_;
+  unsigned long frameViewTransformVersion_;
+  GLfloat frameTime_;
+  GLintptr objectOffset_;             // offset of the current block, -1 if none
+  unsigned long objectSectionCount_;
+  unsigned long objectModelViewStamp_;
+  unsigned long objectTextureStamp_;
+  unsigned long objectColorStamp_;
+  GLint objectNLights_;
+  unsigned int objectContents_;       // standard uniforms written into the current block
 
 };
 
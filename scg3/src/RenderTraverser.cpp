@@ -23,10 +23,12 @@
 
 #include "Camera.h"
 #include "Group.h"
+#include "LOD.h"
 #include "Light.h"
 #include "RenderState.h"
 #include "RenderTraverser.h"
 #include "Shape.h"
+#include "StaticBatch.h"
 #include "Transformation.h"
 
 namespace scg {
@@ -58,6 +60,11 @@ void RenderTraverser::visitPostCamera(Camera* node) {
 
 void RenderTraverser::visitGroup(Group* node) {
   node->render(renderState_);
+  StaticBatch* batch = node->getBatch();
+  if (batch) {
+    batch->render(renderState_);
+    selectChild_(node->getNChildren());   // skip sub-tree
+  }
 }
 
 
@@ -66,6 +73,34 @@ void RenderTraverser::visitPostGroup(Group* node) {
 }
 
 
+void RenderTraverser::visitLOD(LOD* node) {
+  node->selectLevel(renderState_);
+  selectChild_(node->getLevel());
+}
+
+
+void RenderTraverser::visitPostLOD(LOD* node) {
+  const size_t fadeLevel = node->getFadeLevel();
+  if (fadeLevel >= node->getNLevels()) {
+    return;
+  }
+
+  // blend previous level over selected level, restore blending state afterwards
+  GLStateCache& glState = renderState_->glState;
+  const bool isBlend = glState.isEnabled(GL_BLEND);
+  GLint blendFunc[4];
+  glState.getBlendFunc(blendFunc);
+  glState.setEnabled(GL_BLEND, true);
+  glState.setBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+  glBlendColor(0.0f, 0.0f, 0.0f, node->getFadeAlpha());
+  glState.setDepthMask(false);
+  traverse(node->getChildren()[fadeLevel].get());
+  glState.setDepthMask(true);
+  glState.setBlendFunc(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+  glState.setEnabled(GL_BLEND, isBlend);
+}
+
+
 void RenderTraverser::visitLight(Light* node) {
   node->render(renderState_);
 }
@@ -76,7 +76,8 @@ public:
   virtual void visitPostCamera(Camera* node);
 
   /**
-   * Visit Group node: render cores.
+   * Visit Group node: render cores, render static batches instead of traversing
+   * the sub-tree if the group is batched.
    */
   virtual void visitGroup(Group* node);
 
@@ -85,6 +86,17 @@ public:
    */
   virtual void visitPostGroup(Group* node);
 
+  /**
+   * Visit LOD node: select level to be traversed.
+   */
+  virtual void visitLOD(LOD* node);
+
+  /**
+   * Visit LOD node after traversing sub-tree: render previous level being faded out
+   * (if any) with constant alpha blending and without depth writes.
+   */
+  virtual void visitPostLOD(LOD* node);
+
   /**
    * Visit Light node: enable light.
    */
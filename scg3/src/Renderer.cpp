@@ -21,17 +21,21 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
+#include "BVH.h"
+#include "Camera.h"
 #include "Node.h"
 #include "Renderer.h"
 #include "RenderState.h"
+#include "Viewer.h"
 
 
 namespace scg {
 
 
 Renderer::Renderer()
-    : renderState_(new RenderState) {
+    : renderState_(new RenderState), lodBias_(1.0f) {
 }
 
 
@@ -74,6 +78,47 @@ void Renderer::setCamera(CameraSP camera) {
 }
 
 
+BVHSP Renderer::getBVH() {
+  assert(scene_);
+  if (!bvh_ || bvh_->getRoot() != scene_) {
+    bvh_ = BVH::create(scene_);
+  }
+  bvh_->sync();
+  return bvh_;
+}
+
+
+Ray Renderer::getPickingRay(double x, double y) {
+  assert(viewer_);
+  assert(camera_);
+  int width, height;
+  viewer_->getWindowSize(width, height);
+  const GLfloat ndcX = static_cast<GLfloat>(2.0 * x / std::max(width, 1) - 1.0);
+  const GLfloat ndcY = static_cast<GLfloat>(1.0 - 2.0 * y / std::max(height, 1));
+
+  // unproject points on near and far plane
+  const glm::mat4 invProjectionView = glm::inverse(camera_->getProjection() * renderState_->getViewTransform());
+  const glm::vec4 nearPoint = invProjectionView * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+  const glm::vec4 farPoint = invProjectionView * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+  const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+  return Ray(origin, glm::normalize(glm::vec3(farPoint) / farPoint.w - origin));
+}
+
+
+bool Renderer::pick(double x, double y, RayHit& hit) {
+  hit = RayHit();
+  return getBVH()->intersect(getPickingRay(x, y), hit);
+}
+
+
+void Renderer::pick(const std::vector<Ray>& rays, std::vector<RayHit>& hits) {
+  hits.assign(rays.size(), RayHit());
+  if (!rays.empty()) {
+    getBVH()->intersect(rays.data(), rays.size(), hits.data());
+  }
+}
+
+
 void Renderer::setLighting(bool isLightingEnabled) {
   renderState_->setLighting(isLightingEnabled);
 }
@@ -89,6 +134,16 @@ void Renderer::setGlobalAmbientLight(const glm::vec4& globalAmbientLight) {
 }
 
 
+GLfloat Renderer::getLODBias() const {
+  return lodBias_;
+}
+
+
+void Renderer::setLODBias(GLfloat lodBias) {
+  lodBias_ = lodBias;
+}
+
+
 std::string Renderer::getInfo() {
   // return empty string by default
   return std::string();
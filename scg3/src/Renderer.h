@@ -27,6 +27,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "scg_glm.h"
 #include "scg_internals.h"
 
@@ -34,6 +35,8 @@ namespace scg {
 
 
 struct FrameBufferSize;
+struct Ray;
+struct RayHit;
 class Camera;
 class Node;
 class Viewer;
@@ -114,6 +117,19 @@ public:
    */
   void setGlobalAmbientLight(const glm::vec4& globalAmbientLight);
 
+  /**
+   * Get global level-of-detail bias, cf. setLODBias().
+   */
+  GLfloat getLODBias() const;
+
+  /**
+   * Set global level-of-detail bias, i.e., the factor applied to the projected screen
+   * sizes of all LOD nodes. Values < 1 select coarser levels, values > 1 finer levels.
+   *
+   * Default: 1
+   */
+  void setLODBias(GLfloat lodBias);
+
   /**
    * Get information about the scene graph (e.g., number of triangles).
    */
@@ -124,12 +140,49 @@ public:
    */
   virtual void render() = 0;
 
+  /**
+   * Get bounding volume hierarchy over the shapes of the scene, e.g., for spatial queries.
+   * The hierarchy is created on first call and synchronized with the scene graph on
+   * each call (cf. BVH::sync()).
+   */
+  BVHSP getBVH();
+
+  /**
+   * Get ray in world coordinates through the given window position, starting at the near
+   * plane of the camera, with normalized direction. Uses the camera projection and the
+   * view transformation of the last rendered frame.
+   * \param x,y window position in screen coordinates relative to the upper left corner,
+   *    e.g., cursor position
+   */
+  Ray getPickingRay(double x, double y);
+
+  /**
+   * Find the nearest shape under the given window position, i.e., the nearest
+   * intersection of the picking ray with the triangles of the visible shapes
+   * (cf. getPickingRay(), BVH::intersect()).
+   * \param x,y window position in screen coordinates relative to the upper left corner
+   * \param hit nearest intersection: shape, triangle index, distance from the near plane,
+   *    and barycentric coordinates
+   * \return true if a shape has been hit
+   */
+  bool pick(double x, double y, RayHit& hit);
+
+  /**
+   * Find the nearest intersections of a batch of rays in world coordinates with the
+   * triangles of the visible shapes, processed in packets of four rays.
+   * \param rays rays in world coordinates
+   * \param hits nearest intersections, resized to the number of rays
+   */
+  void pick(const std::vector<Ray>& rays, std::vector<RayHit>& hits);
+
 protected:
 
   Viewer* viewer_;
   NodeSP scene_;
   CameraSP camera_;
   RenderStateUP renderState_;
+  BVHSP bvh_;
+  GLfloat lodBias_;
 
 };
 
@@ -0,0 +1,208 @@
+/**
+ * \file RingBuffer.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstring>
+#include "RenderState.h"
+#include "RingBuffer.h"
+#include "scg_utilities.h"
+
+namespace scg {
+
+
+namespace {
+
+// timeout of a single wait for a fence (nanoseconds)
+const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+const GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+}
+
+
+RingBuffer::RingBuffer(GLsizeiptr sectionSize, GLuint nFrames)
+    : buffer_(0), sectionSize_(sectionSize), nSections_(nFrames), section_(0), head_(0),
+      data_(nullptr), isMapped_(false), fences_(nFrames, nullptr), sectionCount_(0),
+      nWaits_(0) {
+  assert(sectionSize > 0 && nFrames > 0);
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  if (isPersistentSupported()) {
+    // immutable storage, mapped once for the lifetime of the buffer object
+    glBufferStorage(GL_COPY_WRITE_BUFFER, nSections_ * sectionSize_, nullptr, PERSISTENT_FLAGS);
+    data_ = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0,
+        nSections_ * sectionSize_, PERSISTENT_FLAGS));
+  }
+  else {
+    glBufferData(GL_COPY_WRITE_BUFFER, nSections_ * sectionSize_, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  assert(!checkGLError());
+}
+
+
+RingBuffer::~RingBuffer() {
+  if (isGLContextActive()) {
+    for (auto fence : fences_) {
+      if (fence) {
+        glDeleteSync(fence);
+      }
+    }
+    // deleting the buffer object unmaps it
+    RenderState::glState.removeBuffer(buffer_);
+    glDeleteBuffers(1, &buffer_);
+  }
+}
+
+
+RingBufferSP RingBuffer::create(GLsizeiptr sectionSize, GLuint nFrames) {
+  return std::make_shared<RingBuffer>(sectionSize, nFrames);
+}
+
+
+bool RingBuffer::isPersistentSupported() {
+  return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+
+bool RingBuffer::isPersistent() const {
+  return data_ != nullptr;
+}
+
+
+GLuint RingBuffer::getBuffer() const {
+  return buffer_;
+}
+
+
+GLsizeiptr RingBuffer::getSectionSize() const {
+  return sectionSize_;
+}
+
+
+size_t RingBuffer::getNWaits() const {
+  return nWaits_;
+}
+
+
+unsigned long RingBuffer::getSectionCount() const {
+  return sectionCount_;
+}
+
+
+bool RingBuffer::isValid(unsigned long sectionCount) const {
+  if (data_) {
+    // the fence of a section covers only the commands issued while it is current
+    return sectionCount_ == sectionCount;
+  }
+  // the buffer object is orphaned when the first section is started
+  return sectionCount_ / nSections_ == sectionCount / nSections_;
+}
+
+
+GLubyte* RingBuffer::map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset) {
+  assert(size > 0 && alignment > 0);
+  assert(size + alignment - 1 <= sectionSize_);
+  assert(!isMapped_);
+
+  // allocate at the aligned head, continue in the next section if the current one is full
+  offset = (head_ + alignment - 1) / alignment * alignment;
+  if (offset + size > static_cast<GLintptr>(section_ + 1) * sectionSize_) {
+    nextSection_();
+    offset = (head_ + alignment - 1) / alignment * alignment;
+  }
+  head_ = offset + size;
+
+  if (data_) {
+    return data_ + offset;
+  }
+  // the range has not been used since the buffer object was orphaned, no need to synchronize
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  GLubyte* data = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+  assert(data);
+  isMapped_ = true;
+  return data;
+}
+
+
+void RingBuffer::unmap() {
+  if (isMapped_) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    isMapped_ = false;
+  }
+}
+
+
+GLintptr RingBuffer::write(const void* data, GLsizeiptr size, GLsizeiptr alignment) {
+  GLintptr offset;
+  std::memcpy(map(size, alignment, offset), data, size);
+  unmap();
+  return offset;
+}
+
+
+void RingBuffer::endFrame() {
+  // keep current section if nothing has been written into it
+  if (head_ > static_cast<GLintptr>(section_) * sectionSize_) {
+    nextSection_();
+  }
+}
+
+
+void RingBuffer::nextSection_() {
+  if (data_) {
+    fences_[section_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  section_ = (section_ + 1) % nSections_;
+  ++sectionCount_;
+  head_ = static_cast<GLintptr>(section_) * sectionSize_;
+
+  if (data_) {
+    // wait until the GPU has finished reading the section
+    GLsync& fence = fences_[section_];
+    if (fence) {
+      GLenum result = glClientWaitSync(fence, 0, 0);
+      if (result == GL_TIMEOUT_EXPIRED) {
+        ++nWaits_;
+        do {
+          result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        } while (result == GL_TIMEOUT_EXPIRED);
+      }
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  else if (section_ == 0) {
+    // orphan buffer object, the driver keeps the previous storage until it is released
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glBufferData(GL_COPY_WRITE_BUFFER, nSections_ * sectionSize_, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,177 @@
+/**
+ * \file RingBuffer.h
+ * \brief A ring buffer for dynamic per-frame data (e.g., uniform blocks, per-draw data),
+ *    written through a persistently mapped pointer and fenced per frame.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include <vector>
+#include "scg_glew.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief A ring buffer for dynamic per-frame data (e.g., uniform blocks, per-draw data),
+ *    written through a persistently mapped pointer and fenced per frame.
+ *
+ * The buffer object is divided into one section per frame in flight. map() returns a
+ * CPU pointer to write into and the offset of the written range within the buffer
+ * object (getBuffer()), to be used by glBindBufferRange(), glVertexAttribPointer(), etc.
+ * Ranges are allocated consecutively within the current section. endFrame() inserts a
+ * fence after the commands of the current section and moves on to the next one; a
+ * section is reused only after the fence has been signaled, i.e., when the GPU has
+ * finished reading it. A section that runs full before endFrame() is fenced and left
+ * in the same way.
+ *
+ * With OpenGL 4.4 or the extension ARB_buffer_storage, the buffer object is created by
+ * glBufferStorage() and mapped once, persistently and coherently, such that writing
+ * requires no OpenGL calls at all. Otherwise, the written range is mapped by
+ * glMapBufferRange() without synchronization and has to be unmapped by unmap() before
+ * it is used, the buffer object is orphaned whenever the first section is reused.
+ *
+ * Allocations must not exceed the section size (cf. getSectionSize()), owners have to
+ * create a larger ring buffer if they need more.
+ */
+class RingBuffer {
+
+public:
+
+  /**
+   * Default number of frames in flight, i.e., sections of the buffer object.
+   */
+  static const GLuint DEFAULT_N_FRAMES = 3;
+
+  /**
+   * Constructor, to be called with an active OpenGL context.
+   * \param sectionSize size of the data that can be written per frame (bytes)
+   * \param nFrames number of frames in flight
+   */
+  explicit RingBuffer(GLsizeiptr sectionSize, GLuint nFrames = DEFAULT_N_FRAMES);
+
+  /**
+   * Destructor.
+   */
+  virtual ~RingBuffer();
+
+  /**
+   * Create shared pointer.
+   */
+  static RingBufferSP create(GLsizeiptr sectionSize, GLuint nFrames = DEFAULT_N_FRAMES);
+
+  /**
+   * Check if the current OpenGL context supports persistently mapped buffers.
+   */
+  static bool isPersistentSupported();
+
+  /**
+   * Check if the buffer object is mapped persistently.
+   */
+  bool isPersistent() const;
+
+  /**
+   * Get buffer object.
+   */
+  GLuint getBuffer() const;
+
+  /**
+   * Get maximum size of a single allocation.
+   */
+  GLsizeiptr getSectionSize() const;
+
+  /**
+   * Get number of waits for the GPU since construction, i.e., of sections that had not
+   * been released yet when they were reused.
+   */
+  size_t getNWaits() const;
+
+  /**
+   * Get number of sections started since construction, to be stored with written ranges
+   * for isValid().
+   */
+  unsigned long getSectionCount() const;
+
+  /**
+   * Check if ranges allocated while getSectionCount() returned the given value may still
+   * be used by new OpenGL commands, i.e., if their section is still current (persistent
+   * mapping) or the buffer object has not been orphaned since.
+   */
+  bool isValid(unsigned long sectionCount) const;
+
+  /**
+   * Allocate range to be written by the CPU.
+   * \param size size of the range (bytes), at most getSectionSize() - alignment + 1
+   * \param alignment required alignment of the offset (any positive value,
+   *    e.g., GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT or the stride of vertex data)
+   * \param offset returns offset of the range within the buffer object
+   * \return pointer to write into, valid until unmap()
+   */
+  GLubyte* map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+
+  /**
+   * Finish writing the range returned by map(), to be called before the range
+   * is used by OpenGL.
+   */
+  void unmap();
+
+  /**
+   * Copy data into a newly allocated range (cf. map()).
+   * \return offset of the range within the buffer object
+   */
+  GLintptr write(const void* data, GLsizeiptr size, GLsizeiptr alignment);
+
+  /**
+   * Fence the commands using the current section and move on to the next section,
+   * to be called once per frame after all commands have been issued.
+   */
+  void endFrame();
+
+protected:
+
+  /**
+   * Fence current section, move on to next section and wait until it has been released,
+   * or orphan buffer object when starting over without persistent mapping.
+   */
+  void nextSection_();
+
+protected:
+
+  GLuint buffer_;
+  GLsizeiptr sectionSize_;
+  GLuint nSections_;
+  GLuint section_;                  // current section
+  GLintptr head_;                   // next free offset within the buffer object
+  GLubyte* data_;                   // persistently mapped data, null if not persistent
+  bool isMapped_;                   // range mapped by map() without persistent mapping
+  std::vector<GLsync> fences_;      // per section, null if released
+  unsigned long sectionCount_;
+  size_t nWaits_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* RINGBUFFER_H_ */
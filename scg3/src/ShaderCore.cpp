@@ -36,7 +36,8 @@ namespace scg {
 
 
 ShaderCore::ShaderCore(GLuint program, const std::vector<ShaderID>& shaderIDs)
-    : program_(program), shaderIDs_(shaderIDs), shaderCoreOld_(nullptr) {
+    : program_(program), shaderIDs_(shaderIDs), shaderCoreOld_(nullptr), hasStandardUniforms_(false),
+      uniformMask_(0), blockMask_(0), attributeMask_(0) {
 }
 
 
@@ -47,7 +48,7 @@ ShaderCore::~ShaderCore() {
 
 void ShaderCore::clear() {
   if (isGLContextActive()) {
-    glUseProgram(0);
+    RenderState::glState.useProgram(0);
     for (auto shaderID : shaderIDs_) {
       glDeleteShader(shaderID.shader);
     }
@@ -74,6 +75,8 @@ void ShaderCore::init() const {
   glLinkProgram(program_);
   checkLinkError_(program_);
 
+  reflect_();
+
   assert(!checkGLError());
 }
 
@@ -83,22 +86,35 @@ GLuint ShaderCore::getProgram() const {
 }
 
 
+const std::vector<ShaderUniformInfo>& ShaderCore::getActiveUniforms() const {
+  return activeUniforms_;
+}
+
+
+const std::vector<ShaderUniformBlockInfo>& ShaderCore::getActiveUniformBlocks() const {
+  return activeUniformBlocks_;
+}
+
+
 void ShaderCore::render(RenderState* renderState) {
   shaderCoreOld_ = renderState->getShader();
   renderState->setShader(this);
   assert(glIsProgram(program_));
-  glUseProgram(program_);
-  setUniform1f(OGLConstants::TIME, static_cast<GLfloat>(glfwGetTime()));
+  renderState->glState.useProgram(program_);
+  // time is passed in the frame uniform block unless declared individually
+  if (hasStandardUniforms_) {
+    setUniform1f(getUniformHandle(OGLUniform::TIME), static_cast<GLfloat>(glfwGetTime()));
+  }
 }
 
 
 void ShaderCore::renderPost(RenderState* renderState) {
   renderState->setShader(shaderCoreOld_);
   if (shaderCoreOld_) {
-    glUseProgram(shaderCoreOld_->program_);
+    renderState->glState.useProgram(shaderCoreOld_->program_);
   }
   else {
-    glUseProgram(0);
+    renderState->glState.useProgram(0);
   }
 }
 
@@ -134,4 +150,85 @@ void ShaderCore::checkLinkError_(GLuint program) const {
 }
 
 
+void ShaderCore::reflect_() const {
+  // fill table of standard uniform handles
+  // (members of uniform blocks have no location)
+  hasStandardUniforms_ = false;
+  for (size_t i = 0; i < static_cast<size_t>(OGLUniform::COUNT); ++i) {
+    standardUniforms_[i] = UniformHandle(glGetUniformLocation(program_,
+        OGLConstants::getUniformName(static_cast<OGLUniform>(i))));
+    if (standardUniforms_[i].location >= 0) {
+      hasStandardUniforms_ = true;
+    }
+  }
+
+  // active uniforms, including members of uniform blocks
+  activeUniforms_.clear();
+  uniformMask_ = 0;
+  GLint nUniforms = 0;
+  GLint maxLength = 0;
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &nUniforms);
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<GLchar> name(maxLength + 1);
+  for (GLuint i = 0; i < static_cast<GLuint>(nUniforms); ++i) {
+    ShaderUniformInfo info;
+    GLsizei length = 0;
+    glGetActiveUniform(program_, i, static_cast<GLsizei>(name.size()), &length, &info.size,
+        &info.type, name.data());
+    info.name.assign(name.data(), length);
+    glGetActiveUniformsiv(program_, 1, &i, GL_UNIFORM_BLOCK_INDEX, &info.blockIndex);
+    info.location = (info.blockIndex < 0) ? glGetUniformLocation(program_, name.data()) : -1;
+    for (unsigned int j = 0; j < static_cast<unsigned int>(OGLUniform::COUNT); ++j) {
+      if (info.name == OGLConstants::getUniformName(static_cast<OGLUniform>(j))) {
+        uniformMask_ |= 1u << j;
+      }
+    }
+    activeUniforms_.push_back(info);
+  }
+
+  // active uniform blocks
+  activeUniformBlocks_.clear();
+  blockMask_ = 0;
+  const OGLUniformBlock* standardBlocks[] = { &OGLConstants::LIGHT, &OGLConstants::MATERIAL,
+      &OGLConstants::FRAME, &OGLConstants::OBJECT };
+  GLint nBlocks = 0;
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCKS, &nBlocks);
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+  name.resize(maxLength + 1);
+  for (GLuint i = 0; i < static_cast<GLuint>(nBlocks); ++i) {
+    ShaderUniformBlockInfo info;
+    GLsizei length = 0;
+    glGetActiveUniformBlockName(program_, i, static_cast<GLsizei>(name.size()), &length, name.data());
+    info.name.assign(name.data(), length);
+    info.index = i;
+    glGetActiveUniformBlockiv(program_, i, GL_UNIFORM_BLOCK_DATA_SIZE, &info.dataSize);
+    for (auto block : standardBlocks) {
+      if (info.name == block->name) {
+        blockMask_ |= 1u << block->bindingPoint;
+      }
+    }
+    activeUniformBlocks_.push_back(info);
+  }
+
+  // active vertex attributes (first location of matrix attributes)
+  attributeMask_ = 0;
+  GLint nAttributes = 0;
+  glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &nAttributes);
+  glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+  name.resize(maxLength + 1);
+  for (GLuint i = 0; i < static_cast<GLuint>(nAttributes); ++i) {
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveAttrib(program_, i, static_cast<GLsizei>(name.size()), nullptr, &size, &type,
+        name.data());
+    const GLint location = glGetAttribLocation(program_, name.data());
+    if (location >= 0 && location < 32) {
+      attributeMask_ |= 1u << location;
+    }
+  }
+
+  assert(!checkGLError());
+}
+
+
 } /* namespace scg */
@@ -34,6 +34,7 @@
 #include <vector>
 #include "scg_glew.h"
 #include "Core.h"
+#include "RenderState.h"
 #include "scg_internals.h"
 
 namespace scg {
@@ -59,9 +60,61 @@ struct ShaderID {
 };
 
 
+/**
+ * \brief Handle of a uniform variable of a shader program (cf. ShaderCore::getUniformHandle()),
+ * valid for this program only.
+ */
+struct UniformHandle {
+
+  UniformHandle()
+      : location(-1) {
+  }
+
+  explicit UniformHandle(GLint location0)
+      : location(location0) {
+  }
+
+  GLint location;
+
+};
+
+
+/**
+ * \brief Active uniform variable of a linked shader program (cf. ShaderCore::getActiveUniforms()).
+ */
+struct ShaderUniformInfo {
+  std::string name;
+  GLenum type;
+  GLint size;           // array size, 1 for non-array uniforms
+  GLint location;       // -1 for members of uniform blocks
+  GLint blockIndex;     // index of uniform block, -1 for default block
+};
+
+
+/**
+ * \brief Active uniform block of a linked shader program (cf. ShaderCore::getActiveUniformBlocks()).
+ */
+struct ShaderUniformBlockInfo {
+  std::string name;
+  GLuint index;
+  GLint dataSize;       // minimum buffer size in bytes
+};
+
+
 /**
  * \brief A core to set a shader program to be applied to subsequent nodes.
  *
+ * Uniform variables are set by name or by handle. The handles of the standard uniforms
+ * (cf. OGLUniform) are stored in a table when the program is linked, handles of custom
+ * uniforms are looked up by name once (cf. getUniformHandle()). Setting uniforms by
+ * handle avoids hashing the name for each call.
+ *
+ * After linking, the active uniforms and uniform blocks of the program are reflected
+ * (cf. getActiveUniforms(), getActiveUniformBlocks()), and the standard uniforms used by
+ * the program are stored as a bitmask (cf. getUniformMask()), such that RenderState
+ * computes and uploads only what the program consumes. Shaders may declare a prefix of
+ * the standard uniform blocks, e.g., only the model-view matrix of the object block.
+ *
  * A few member functions are defined in the header file to allow inlining.
  * Method chaining (via returning this pointers) is not supported to ensure maximum
  * performance.
@@ -115,13 +168,96 @@ public:
     return it->second;
   }
 
+  /**
+   * Get handle of custom uniform variable, to be looked up once and stored by the
+   * application instead of passing the name for each setUniform*() call.
+   */
+  UniformHandle getUniformHandle(const std::string& name) const {
+    return UniformHandle(getUniformLoc(name));
+  }
+
+  /**
+   * Get handle of standard uniform variable from the table filled by init(),
+   * without any lookup.
+   */
+  UniformHandle getUniformHandle(OGLUniform uniform) const {
+    assert(uniform < OGLUniform::COUNT);
+    return standardUniforms_[static_cast<size_t>(uniform)];
+  }
+
+  /**
+   * Get bitmask of active standard uniforms, in blocks or declared individually,
+   * bit i corresponding to OGLUniform i (cf. isUniformActive()).
+   */
+  unsigned int getUniformMask() const {
+    return uniformMask_;
+  }
+
+  /**
+   * Check if standard uniform is active, i.e., used by the program.
+   */
+  bool isUniformActive(OGLUniform uniform) const {
+    return (uniformMask_ & (1u << static_cast<unsigned int>(uniform))) != 0;
+  }
+
+  /**
+   * Check if standard uniform block is active, i.e., used by the program.
+   */
+  bool isUniformBlockActive(const OGLUniformBlock& block) const {
+    return (blockMask_ & (1u << block.bindingPoint)) != 0;
+  }
+
+  /**
+   * Check if vertex attribute is active, i.e., read by the program
+   * (e.g., OGLConstants::INSTANCE_MATRIX).
+   */
+  bool isAttributeActive(const OGLAttrib& attrib) const {
+    return attrib.location < 32 && (attributeMask_ & (1u << attrib.location)) != 0;
+  }
+
+  /**
+   * Get active uniforms as reflected after linking.
+   */
+  const std::vector<ShaderUniformInfo>& getActiveUniforms() const;
+
+  /**
+   * Get active uniform blocks as reflected after linking.
+   */
+  const std::vector<ShaderUniformBlockInfo>& getActiveUniformBlocks() const;
+
+  /**
+   * Check if the program declares standard uniforms outside of the frame and object
+   * uniform blocks (e.g., a shader written for an earlier version of scg3), which then
+   * have to be set individually (cf. RenderState::passToShader()).
+   */
+  bool hasStandardUniforms() const {
+    return hasStandardUniforms_;
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform1i(UniformHandle uniform, GLint value) const {
+    // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
+    SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
+    glUniform1i(uniform.location, value);
+    SCG_RESTORE_PROGRAM(program_, programOld);
+  }
+
   /**
    * Set uniform variable.
    */
   void setUniform1i(const std::string& name, GLint value) const {
+    setUniform1i(getUniformHandle(name), value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform1iv(UniformHandle uniform, GLsizei count, const GLint* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform1i(getUniformLoc(name), value);
+    glUniform1iv(uniform.location, count, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -129,9 +265,16 @@ public:
    * Set uniform variable.
    */
   void setUniform1iv(const std::string& name, GLsizei count, const GLint* value) const {
+    setUniform1iv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform1f(UniformHandle uniform, GLfloat value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform1iv(getUniformLoc(name), count, value);
+    glUniform1f(uniform.location, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -139,9 +282,16 @@ public:
    * Set uniform variable.
    */
   void setUniform1f(const std::string& name, GLfloat value) const {
+    setUniform1f(getUniformHandle(name), value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform1fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform1f(getUniformLoc(name), value);
+    glUniform1fv(uniform.location, count, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -149,9 +299,16 @@ public:
    * Set uniform variable.
    */
   void setUniform1fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniform1fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform2fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform1fv(getUniformLoc(name), count, value);
+    glUniform2fv(uniform.location, count, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -159,9 +316,16 @@ public:
    * Set uniform variable.
    */
   void setUniform2fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniform2fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform3fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform2fv(getUniformLoc(name), count, value);
+    glUniform3fv(uniform.location, count, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -169,9 +333,16 @@ public:
    * Set uniform variable.
    */
   void setUniform3fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniform3fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniform4fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform3fv(getUniformLoc(name), count, value);
+    glUniform4fv(uniform.location, count, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -179,9 +350,16 @@ public:
    * Set uniform variable.
    */
   void setUniform4fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniform4fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniformMatrix2fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniform4fv(getUniformLoc(name), count, value);
+    glUniformMatrix2fv(uniform.location, count, GL_FALSE, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -189,9 +367,16 @@ public:
    * Set uniform variable.
    */
   void setUniformMatrix2fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniformMatrix2fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniformMatrix3fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniformMatrix2fv(getUniformLoc(name), count, GL_FALSE, value);
+    glUniformMatrix3fv(uniform.location, count, GL_FALSE, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -199,9 +384,16 @@ public:
    * Set uniform variable.
    */
   void setUniformMatrix3fv(const std::string& name, GLsizei count, const GLfloat* value) const {
+    setUniformMatrix3fv(getUniformHandle(name), count, value);
+  }
+
+  /**
+   * Set uniform variable.
+   */
+  void setUniformMatrix4fv(UniformHandle uniform, GLsizei count, const GLfloat* value) const {
     // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
     SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniformMatrix3fv(getUniformLoc(name), count, GL_FALSE, value);
+    glUniformMatrix4fv(uniform.location, count, GL_FALSE, value);
     SCG_RESTORE_PROGRAM(program_, programOld);
   }
 
@@ -209,10 +401,7 @@ public:
    * Set uniform variable.
    */
   void setUniformMatrix4fv(const std::string& name, GLsizei count, const GLfloat* value) const {
-    // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
-    SCG_SAVE_AND_SWITCH_PROGRAM(program_, programOld);
-    glUniformMatrix4fv(getUniformLoc(name), count, GL_FALSE, value);
-    SCG_RESTORE_PROGRAM(program_, programOld);
+    setUniformMatrix4fv(getUniformHandle(name), count, value);
   }
 
   /**
@@ -237,12 +426,25 @@ protected:
    */
   void checkLinkError_(GLuint program) const;
 
+  /**
+   * Reflect active uniforms, uniform blocks, and vertex attributes of the linked program,
+   * fill table of standard uniform handles and bitmasks.
+   */
+  void reflect_() const;
+
 protected:
 
   GLuint program_;
   std::vector<ShaderID> shaderIDs_;
   ShaderCore* shaderCoreOld_;
   mutable std::unordered_map<std::string, GLint> uniformLocMap_;
+  mutable UniformHandle standardUniforms_[static_cast<size_t>(OGLUniform::COUNT)];
+  mutable bool hasStandardUniforms_;
+  mutable unsigned int uniformMask_;
+  mutable unsigned int blockMask_;      // bit i set if block with binding point i is active
+  mutable unsigned int attributeMask_;  // bit i set if attribute with location i is active
+  mutable std::vector<ShaderUniformInfo> activeUniforms_;
+  mutable std::vector<ShaderUniformBlockInfo> activeUniformBlocks_;
 
 };
 
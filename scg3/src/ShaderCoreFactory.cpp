@@ -61,10 +61,15 @@ ShaderCoreSP ShaderCoreFactory::createColorShader() {
       #version 150 \n\
       in vec4 vVertex; \n\
       in vec4 vColor; \n\
-      uniform mat4 mvpMatrix; \n\
+      layout(std140) uniform FrameBlock { \n\
+        mat4 projectionMatrix; \n\
+      }; \n\
+      layout(std140) uniform ObjectBlock { \n\
+        mat4 modelViewMatrix; \n\
+      }; \n\
       smooth out vec4 color; \n\
       void main() { \n\
-        gl_Position = mvpMatrix * vVertex; \n\
+        gl_Position = projectionMatrix * (modelViewMatrix * vVertex); \n\
         color = vColor; \n\
       } \n\
       ";
@@ -96,6 +101,71 @@ ShaderCoreSP ShaderCoreFactory::createColorShader() {
   auto core = ShaderCore::create(program, shaderIDs);
   core ->init();
 
+  // bind standard uniform blocks
+  OGLConstants::bindUniformBlocks(program);
+
+  assert(!checkGLError());
+
+  return core;
+}
+
+
+ShaderCoreSP ShaderCoreFactory::createInstancedColorShader() {
+  // create program and shader vector
+  GLuint program = glCreateProgram();
+  assert(glIsProgram(program));
+  std::vector<ShaderID> shaderIDs;
+
+  // create vertex shader
+  const char* sourceVert = "\
+      #version 150 \n\
+      in vec4 vVertex; \n\
+      in vec4 vColor; \n\
+      in mat4 vInstanceMatrix; \n\
+      in vec4 vInstanceColor; \n\
+      layout(std140) uniform FrameBlock { \n\
+        mat4 projectionMatrix; \n\
+      }; \n\
+      layout(std140) uniform ObjectBlock { \n\
+        mat4 modelViewMatrix; \n\
+      }; \n\
+      smooth out vec4 color; \n\
+      void main() { \n\
+        gl_Position = projectionMatrix * (modelViewMatrix * (vInstanceMatrix * vVertex)); \n\
+        color = vColor * vInstanceColor; \n\
+      } \n\
+      ";
+
+  GLuint shaderVert = glCreateShader(GL_VERTEX_SHADER);
+  assert(glIsShader(shaderVert));
+  shaderIDs.push_back(ShaderID(shaderVert, "instanced color vertex shader"));
+  glShaderSource(shaderVert, 1, &sourceVert, 0);
+
+  // create fragment shader
+  const char* sourceFrag = "\
+      #version 150 \n\
+      smooth in vec4 color; \n\
+      out vec4 fragColor; \n\
+      void main(void) { \n\
+        fragColor = color; \n\
+      } \n\
+      ";
+
+  GLuint shaderFrag = glCreateShader(GL_FRAGMENT_SHADER);
+  assert(glIsShader(shaderFrag));
+  shaderIDs.push_back(ShaderID(shaderFrag, "instanced color fragment shader"));
+  glShaderSource(shaderFrag, 1, &sourceFrag, 0);
+
+  // bind standard attribute and fragment data locations
+  OGLConstants::bindAttribFragDataLocations(program);
+
+  // compile shaders and link program
+  auto core = ShaderCore::create(program, shaderIDs);
+  core ->init();
+
+  // bind standard uniform blocks
+  OGLConstants::bindUniformBlocks(program);
+
   assert(!checkGLError());
 
   return core;
@@ -113,10 +183,19 @@ ShaderCoreSP ShaderCoreFactory::createGouraudShader() {
       #version 150 \n\
       in vec4 vVertex; \n\
       in vec3 vNormal; \n\
-      uniform mat4 modelViewMatrix; \n\
-      uniform mat4 projectionMatrix; \n\
-      uniform mat4 mvpMatrix; \n\
-      uniform mat3 normalMatrix; \n\
+      layout(std140) uniform FrameBlock { \n\
+        mat4 projectionMatrix; \n\
+        mat4 viewMatrix; \n\
+        vec4 globalAmbientLight; \n\
+        float time; \n\
+      }; \n\
+      layout(std140) uniform ObjectBlock { \n\
+        mat4 modelViewMatrix; \n\
+        mat4 textureMatrix; \n\
+        mat4 colorMatrix; \n\
+        mat3 normalMatrix; \n\
+        int nLights; \n\
+      }; \n\
       const int MAX_NUMBER_OF_LIGHTS = 10; \n\
       struct Light { \n\
         vec4 position; \n\
@@ -156,7 +235,7 @@ ShaderCoreSP ShaderCoreFactory::createGouraudShader() {
         if (hDotN > 0.) { \n\
           color += material.specular * lights[0].specular * pow(hDotN, material.shininess); \n\
         } \n\
-        gl_Position = mvpMatrix * vVertex; \n\
+        gl_Position = projectionMatrix * (modelViewMatrix * vVertex); \n\
       } \n\
       ";
 
@@ -87,17 +87,25 @@ public:
    * Create a simple shader program without lighting.
    *
    * attributes: vVertex, vColor\n
-   * uniforms: mvpMatrix
+   * UBOs: FrameBlock, ObjectBlock (projection and model-view matrices only)
    */
   ShaderCoreSP createColorShader();
 
+  /**
+   * Create a simple shader program without lighting for instanced rendering
+   * (cf. InstancedShape), multiplying vertex and instance colors.
+   *
+   * attributes: vVertex, vColor, vInstanceMatrix, vInstanceColor\n
+   * UBOs: FrameBlock, ObjectBlock (projection and model-view matrices only)
+   */
+  ShaderCoreSP createInstancedColorShader();
+
   /**
    * Create a simple shader program with Gouraud shading for a single light
    * without texturing.
    *
    * attributes: vVertex, vNormal\n
-   * uniforms: modelViewMatrix, projectionMatrix, mvpMatrix, normalMatrix\n
-   * UBOs: LightBlock, MaterialBlock
+   * UBOs: FrameBlock, ObjectBlock, LightBlock, MaterialBlock
    */
   ShaderCoreSP createGouraudShader();
 
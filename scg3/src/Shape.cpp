@@ -57,6 +57,7 @@ ShapeSP Shape::create(GeometryCoreSP geometryCore) {
 Shape* Shape::addCore(CoreSP core) {
   // Note: check here for disallowed core types (if any)
   cores_.push_back(core);
+  markModified_();
   return this;
 }
 
@@ -87,6 +88,23 @@ void Shape::accept(Traverser* traverser) {
 }
 
 
+const AABB& Shape::getBoundingBox() {
+  if (version_ >= boundsVersion_) {
+    boundingBox_ = AABB();
+    boundingSphere_ = BoundingSphere();
+    for (auto& core : cores_) {
+      auto geometryCore = std::dynamic_pointer_cast<GeometryCore>(core);
+      if (geometryCore) {
+        boundingBox_.extend(geometryCore->getBoundingBox());
+        boundingSphere_.extend(geometryCore->getBoundingSphere());
+      }
+    }
+    boundsVersion_ = nextVersion();
+  }
+  return boundingBox_;
+}
+
+
 void Shape::render(RenderState* renderState) {
   processCores_(renderState);
 
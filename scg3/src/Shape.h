@@ -90,6 +90,11 @@ public:
    */
   int getNTriangles() const;
 
+  /**
+   * Get bounding box of the geometry cores in model coordinates.
+   */
+  virtual const AABB& getBoundingBox();
+
   /**
    * Accept traverser (visitor pattern).
    */
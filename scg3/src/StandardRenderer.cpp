@@ -23,11 +23,18 @@
 
 #include <sstream>
 #include "Camera.h"
+#include "BVH.h"
+#include "CompiledScene.h"
+#include "Composite.h"
+#include "CullingRenderTraverser.h"
 #include "Node.h"
+#include "HardwareOcclusionCuller.h"
 #include "InfoTraverser.h"
-#include "PreTraverser.h"
+#include "Light.h"
+#include "LightPosition.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
 #include "RenderState.h"
-#include "RenderTraverser.h"
 #include "StandardRenderer.h"
 #include "Viewer.h"
 
@@ -36,8 +43,16 @@ namespace scg {
 
 StandardRenderer::StandardRenderer()
     : infoTraverser_(new InfoTraverser(renderState_.get())),
-      preTraverser_(new PreTraverser(renderState_.get())),
-      renderTraverser_(new RenderTraverser(renderState_.get())) {
+      renderTraverser_(new CullingRenderTraverser(renderState_.get())),
+      isCompiledSceneMode_(false),
+      isBVHCulling_(false),
+      isOcclusionCulling_(false),
+      isOcclusionQueries_(false),
+      isSortedRendering_(false),
+      isIndirectDrawing_(false),
+      cameraWorldMatrix_(1.0f),
+      cameraWorldStamp_(0),
+      lightSyncVersion_(0) {
 }
 
 
@@ -59,7 +74,7 @@ void StandardRenderer::initViewer(Viewer *viewer, FrameBufferSize *fbSize) {
 
 std::string StandardRenderer::getInfo() {
   assert(scene_);
-  scene_->traverse(infoTraverser_.get());
+  infoTraverser_->traverse(scene_.get());
   std::stringstream stream;
   stream << "No. of nodes: " << infoTraverser_->getNNodes() << std::endl
       << "No. of core pointers: " << infoTraverser_->getNCores() << std::endl
@@ -79,23 +94,289 @@ void StandardRenderer::render() {
     camera_->updateProjection();
   }
 
+  // scale from normalized device coordinates to pixels for LOD selection
+  int width, height;
+  viewer_->getWindowSize(width, height);
+  renderState_->setLODScale(0.5f * static_cast<GLfloat>(height) * lodBias_);
+
   // save projection and modelview matrices, set modelview matrix to identity
   renderState_->projectionStack.pushMatrix();
   renderState_->modelViewStack.pushMatrix();
   renderState_->modelViewStack.setIdentity();
 
-  // pass 1: save camera projection and view transformation
-  scene_->traverse(preTraverser_.get());
+  if (isCompiledSceneMode_) {
+    // update flattened scene, recompile if scene has been replaced
+    if (!compiledScene_ || compiledScene_->getRoot() != scene_) {
+      compiledScene_ = CompiledScene::create(scene_);
+    }
+    compiledScene_->sync();
+
+    // save camera projection and view transformation, set light transformations
+    updateCameraAndLights_();
+    renderState_->applyProjectionViewTransform();
 
-  // apply projection and view transformation as determined in previous frame
-  renderState_->applyProjectionViewTransform();
+    // render scene
+    compiledScene_->render(renderState_.get(), renderTraverser_.get());
+  }
+  else {
+    // save camera projection and view transformation, set light transformations
+    updateCameraAndLights_();
+    renderState_->applyProjectionViewTransform();
 
-  // pass 2: render scene
-  scene_->traverse(renderTraverser_.get());
+    // render scene, skipping sub-trees outside of the view frustum
+    renderTraverser_->updateFrustum();
+    if (isBVHCulling_ && renderTraverser_->isCulling()) {
+      visibleShapes_.clear();
+      getBVH()->queryFrustum(renderTraverser_->getFrustum(), visibleShapes_);
+      renderTraverser_->setVisibleShapes(visibleShapes_);
+    }
+    if (isOcclusionCulling_ && renderTraverser_->isCulling()) {
+      getOcclusionCuller()->renderOccluders(scene_.get(),
+          renderState_->getProjection() * renderState_->getViewTransform());
+      renderTraverser_->setOcclusionCuller(occlusionCuller_.get());
+    }
+    else {
+      renderTraverser_->setOcclusionCuller(nullptr);
+    }
+    if (isOcclusionQueries_ && renderTraverser_->isCulling()) {
+      getHardwareOcclusionCuller()->beginFrame();
+      renderTraverser_->setHardwareOcclusionCuller(hardwareOcclusionCuller_.get());
+    }
+    else {
+      renderTraverser_->setHardwareOcclusionCuller(nullptr);
+    }
+    const bool isQueued = isSortedRendering_ || isIndirectDrawing_;
+    if (isQueued) {
+      getRenderQueue()->reset();
+      renderQueue_->setIndirectDrawing(isIndirectDrawing_);
+      renderTraverser_->setRenderQueue(renderQueue_.get());
+    }
+    else {
+      renderTraverser_->setRenderQueue(nullptr);
+    }
+    renderTraverser_->traverse(scene_.get());
+    if (isQueued) {
+      renderQueue_->submit(renderState_.get());
+    }
+  }
 
   // restore projection and modelview matrices
   renderState_->modelViewStack.popMatrix();
   renderState_->projectionStack.popMatrix();
+
+  // unbind vertex array object kept bound by GeometryCore::render()
+  renderState_->glState.bindVertexArray(0);
+}
+
+
+bool StandardRenderer::isCompiledSceneMode() const {
+  return isCompiledSceneMode_;
+}
+
+
+void StandardRenderer::setCompiledSceneMode(bool isCompiledSceneMode) {
+  isCompiledSceneMode_ = isCompiledSceneMode;
+  if (!isCompiledSceneMode_) {
+    compiledScene_.reset();
+  }
+}
+
+
+bool StandardRenderer::isFrustumCulling() const {
+  return renderTraverser_->isCulling();
+}
+
+
+void StandardRenderer::setFrustumCulling(bool isFrustumCulling) {
+  renderTraverser_->setCulling(isFrustumCulling);
+}
+
+
+const CullingStats& StandardRenderer::getCullingStats() const {
+  return renderTraverser_->getStats();
+}
+
+
+bool StandardRenderer::isBVHCulling() const {
+  return isBVHCulling_;
+}
+
+
+void StandardRenderer::setBVHCulling(bool isBVHCulling) {
+  isBVHCulling_ = isBVHCulling;
+}
+
+
+bool StandardRenderer::isOcclusionCulling() const {
+  return isOcclusionCulling_;
+}
+
+
+void StandardRenderer::setOcclusionCulling(bool isOcclusionCulling) {
+  isOcclusionCulling_ = isOcclusionCulling;
+}
+
+
+OcclusionCullerSP StandardRenderer::getOcclusionCuller() {
+  if (!occlusionCuller_) {
+    occlusionCuller_ = OcclusionCuller::create();
+  }
+  return occlusionCuller_;
+}
+
+
+bool StandardRenderer::isOcclusionQueries() const {
+  return isOcclusionQueries_;
+}
+
+
+void StandardRenderer::setOcclusionQueries(bool isOcclusionQueries) {
+  isOcclusionQueries_ = isOcclusionQueries;
+}
+
+
+HardwareOcclusionCullerSP StandardRenderer::getHardwareOcclusionCuller() {
+  if (!hardwareOcclusionCuller_) {
+    hardwareOcclusionCuller_ = HardwareOcclusionCuller::create();
+  }
+  return hardwareOcclusionCuller_;
+}
+
+
+bool StandardRenderer::isSortedRendering() const {
+  return isSortedRendering_;
+}
+
+
+void StandardRenderer::setSortedRendering(bool isSortedRendering) {
+  isSortedRendering_ = isSortedRendering;
+}
+
+
+bool StandardRenderer::isIndirectDrawing() const {
+  return isIndirectDrawing_;
+}
+
+
+void StandardRenderer::setIndirectDrawing(bool isIndirectDrawing) {
+  isIndirectDrawing_ = isIndirectDrawing;
+}
+
+
+RenderQueueSP StandardRenderer::getRenderQueue() {
+  if (!renderQueue_) {
+    renderQueue_ = RenderQueue::create();
+  }
+  return renderQueue_;
+}
+
+
+void StandardRenderer::updateCameraAndLights_() {
+  // view transformation is the inverse of the camera's world matrix,
+  // keep its stamp while the matrix is unchanged such that the camera does not invert it
+  const glm::mat4& cameraWorld = camera_->getWorldMatrix();
+  if (cameraWorldStamp_ == 0 || cameraWorld != cameraWorldMatrix_) {
+    cameraWorldMatrix_ = cameraWorld;
+    cameraWorldStamp_ = MatrixStack::newStamp();
+  }
+  renderState_->modelViewStack.pushMatrix();
+  renderState_->modelViewStack.setMatrix(cameraWorldMatrix_, cameraWorldStamp_);
+  renderState_->setProjection(camera_->getProjection());
+  renderState_->setViewTransform(camera_->getViewTransform(renderState_.get()));
+  renderState_->modelViewStack.popMatrix();
+
+  // model transformation of a light is the world matrix of its position
+  syncLightPositions_();
+  for (auto& lightPosition : lightPositions_) {
+    lightPosition->getLight()->setModelTransform(lightPosition->getWorldMatrix());
+  }
+}
+
+
+void StandardRenderer::syncLightPositions_() {
+  if (lightScene_ != scene_) {
+    // collect light positions of a new scene from scratch
+    lightScene_ = scene_;
+    lightPositions_.clear();
+    lightStamps_.clear();
+    lightSyncVersion_ = 0;
+  }
+  if (!scene_ || (lightSyncVersion_ > 0 && scene_->subtreeVersion_ < lightSyncVersion_)) {
+    return;
+  }
+  const unsigned long stamp = Node::nextVersion();
+  bool isStructureModified = false;
+
+  // walk modified sub-trees, add or remove light positions found there
+  lightWalkStack_.clear();
+  lightWalkStack_.push_back({ &scene_, lightSyncVersion_ == 0, true });
+  while (!lightWalkStack_.empty()) {
+    const LightWalkEntry_ entry = lightWalkStack_.back();
+    lightWalkStack_.pop_back();
+    Node* node = entry.node->get();
+    if (!node || (!entry.isForced && node->subtreeVersion_ < lightSyncVersion_)) {
+      continue;
+    }
+    const bool isForced = entry.isForced || node->version_ >= lightSyncVersion_;
+    const bool isVisible = entry.isVisible && node->isVisible_;
+    if (node->isComposite_) {
+      Composite* composite = static_cast<Composite*>(node);
+      if (composite->getStructureVersion() >= lightSyncVersion_) {
+        isStructureModified = true;
+      }
+      for (auto& child : composite->getChildren()) {
+        lightWalkStack_.push_back({ &child, isForced, isVisible });
+      }
+      continue;
+    }
+    if (!dynamic_cast<LightPosition*>(node)) {
+      continue;
+    }
+    size_t index = 0;
+    while (index < lightPositions_.size() && lightPositions_[index].get() != node) {
+      ++index;
+    }
+    if (!isVisible) {
+      if (index < lightPositions_.size()) {
+        lightPositions_.erase(lightPositions_.begin() + index);
+        lightStamps_.erase(lightStamps_.begin() + index);
+      }
+      continue;
+    }
+    if (index == lightPositions_.size()) {
+      lightPositions_.push_back(std::static_pointer_cast<LightPosition>(*entry.node));
+      lightStamps_.push_back(stamp);
+    }
+    lightStamps_[index] = stamp;
+  }
+
+  // remove light positions that have not been found and are no longer in the scene
+  if (isStructureModified) {
+    size_t count = 0;
+    for (size_t i = 0; i < lightPositions_.size(); ++i) {
+      if (lightStamps_[i] == stamp || isInScene_(lightPositions_[i].get())) {
+        lightPositions_[count] = lightPositions_[i];
+        lightStamps_[count] = lightStamps_[i];
+        ++count;
+      }
+    }
+    lightPositions_.resize(count);
+    lightStamps_.resize(count);
+  }
+  lightSyncVersion_ = stamp;
+}
+
+
+bool StandardRenderer::isInScene_(Node* node) const {
+  for (; node; node = node->getParent()) {
+    if (!node->isVisible()) {
+      return false;
+    }
+    if (node == scene_.get()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 
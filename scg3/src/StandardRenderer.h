@@ -1,7 +1,6 @@
 /**
  * \file StandardRenderer.h
- * \brief A standard renderer that uses a PreTraverser, a RenderTraverser, and an
- *    InfoTraverser.
+ * \brief A standard renderer that uses a CullingRenderTraverser and an InfoTraverser.
  *
  * \author Volker Ahlers\n
  *         volker.ahlers@hs-hannover.de
@@ -26,18 +25,45 @@
 #ifndef STANDARDRENDERER_H_
 #define STANDARDRENDERER_H_
 
+#include <vector>
+#include "CullingRenderTraverser.h"
 #include "Renderer.h"
+#include "scg_glm.h"
 #include "scg_internals.h"
 
 namespace scg {
 
 
 /**
- * \brief A standard renderer that uses a PreTraverser, a RenderTraverser, and an
- *    InfoTraverser.
+ * \brief A standard renderer that uses a CullingRenderTraverser and an InfoTraverser.
+ *
+ * The scene graph is traversed once per frame. Camera and light positions are
+ * evaluated directly before: the view transformation is the inverse of the world
+ * matrix of the camera (cf. Node::getWorldMatrix()), and each light position that is
+ * reachable from the scene root via visible nodes passes its world matrix to its light.
+ * The renderer keeps a list of these light positions, which is synchronized with
+ * the modified sub-trees of the scene graph by means of version stamps (cf. BVH::sync()).
+ * World matrices are cached by the nodes and only recomputed for modified paths.
+ *
+ * Frustum culling is enabled by default (cf. setFrustumCulling()). Software occlusion
+ * culling against the nodes tagged as occluders and hardware occlusion queries can be
+ * enabled additionally (cf. setOcclusionCulling(), setOcclusionQueries()).
  *
  * The stencil buffer is activated for later use in projection shadows and planar
  * reflections.
+ *
+ * In compiled scene mode (cf. setCompiledSceneMode()), the scene graph is flattened into
+ * a CompiledScene, which is synchronized with the scene graph and walked linearly
+ * in each frame instead of traversing the node pointers. Frustum culling is not
+ * applied in compiled scene mode.
+ *
+ * With sorted rendering (cf. setSortedRendering()), the shapes are collected in a
+ * RenderQueue and drawn sorted by shader, texture, material, and depth instead of
+ * in graph order. Sorted rendering is not applied in compiled scene mode.
+ *
+ * With indirect drawing (cf. setIndirectDrawing()), the render queue is used as well,
+ * and shapes with shaders for per-draw matrices are drawn by a few
+ * glMultiDrawElementsIndirect() calls (cf. RenderQueue::setIndirectDrawing()).
  */
 class StandardRenderer: public Renderer {
 
@@ -78,11 +104,156 @@ public:
    */
   virtual void render();
 
+  /**
+   * Check if compiled scene mode is enabled.
+   */
+  bool isCompiledSceneMode() const;
+
+  /**
+   * Enable or disable compiled scene mode, default: disabled.
+   */
+  void setCompiledSceneMode(bool isCompiledSceneMode);
+
+  /**
+   * Check if frustum culling is enabled.
+   */
+  bool isFrustumCulling() const;
+
+  /**
+   * Enable or disable frustum culling, default: enabled.
+   */
+  void setFrustumCulling(bool isFrustumCulling);
+
+  /**
+   * Get frustum culling counters of last frame (cf. CullingStats).
+   */
+  const CullingStats& getCullingStats() const;
+
+  /**
+   * Check if the shapes inside of the view frustum are determined by the bounding
+   * volume hierarchy (cf. getBVH()).
+   */
+  bool isBVHCulling() const;
+
+  /**
+   * Enable or disable determining the shapes inside of the view frustum by the bounding
+   * volume hierarchy instead of testing the scene graph nodes, default: disabled.
+   * Only effective if frustum culling is enabled.
+   */
+  void setBVHCulling(bool isBVHCulling);
+
+  /**
+   * Check if occlusion culling is enabled.
+   */
+  bool isOcclusionCulling() const;
+
+  /**
+   * Enable or disable occlusion culling, i.e., skipping sub-trees hidden by the nodes
+   * tagged as occluders (cf. Node::setOccluder()), default: disabled.
+   * Only effective if frustum culling is enabled.
+   */
+  void setOcclusionCulling(bool isOcclusionCulling);
+
+  /**
+   * Get occlusion culler, e.g., to set its resolution or to get its counters
+   * (cf. OcclusionStats).
+   */
+  OcclusionCullerSP getOcclusionCuller();
+
+  /**
+   * Check if hardware occlusion queries are enabled.
+   */
+  bool isOcclusionQueries() const;
+
+  /**
+   * Enable or disable skipping sub-trees found to be occluded by hardware occlusion
+   * queries in previous frames, default: disabled.
+   * Only effective if frustum culling is enabled.
+   */
+  void setOcclusionQueries(bool isOcclusionQueries);
+
+  /**
+   * Get hardware occlusion culler, e.g., to get its counters (cf. OcclusionQueryStats).
+   * Requires an OpenGL context.
+   */
+  HardwareOcclusionCullerSP getHardwareOcclusionCuller();
+
+  /**
+   * Check if sorted rendering is enabled.
+   */
+  bool isSortedRendering() const;
+
+  /**
+   * Enable or disable sorted rendering, i.e., drawing the shapes sorted by render state
+   * and depth (cf. RenderQueue), default: disabled.
+   */
+  void setSortedRendering(bool isSortedRendering);
+
+  /**
+   * Check if indirect drawing is enabled.
+   */
+  bool isIndirectDrawing() const;
+
+  /**
+   * Enable or disable indirect drawing, i.e., drawing shapes of the same render state by
+   * glMultiDrawElementsIndirect() (cf. IndirectDrawBatch), default: disabled.
+   * Implies drawing via the render queue. Requires an OpenGL 4.3 context (cf. OGLConfig),
+   * otherwise the shapes are drawn individually.
+   */
+  void setIndirectDrawing(bool isIndirectDrawing);
+
+  /**
+   * Get render queue, e.g., to get its counters (cf. RenderQueueStats).
+   */
+  RenderQueueSP getRenderQueue();
+
+protected:
+
+  /**
+   * Set projection and view transformation of the camera and model transformations
+   * of the lights, evaluating their world matrices (replaces a PreTraverser pass).
+   */
+  void updateCameraAndLights_();
+
+  /**
+   * Update list of light positions that are reachable from the scene root via visible
+   * nodes, walking the sub-trees that have been modified since the last call.
+   */
+  void syncLightPositions_();
+
+  /**
+   * Check if node is reachable from the scene root via visible nodes, i.e., would be
+   * visited by a traversal of the scene.
+   */
+  bool isInScene_(Node* node) const;
+
 protected:
 
   InfoTraverserUP infoTraverser_;
-  PreTraverserUP preTraverser_;
-  RenderTraverserUP renderTraverser_;
+  CullingRenderTraverserUP renderTraverser_;
+  bool isCompiledSceneMode_;
+  CompiledSceneSP compiledScene_;
+  bool isBVHCulling_;
+  std::vector<Shape*> visibleShapes_;
+  bool isOcclusionCulling_;
+  OcclusionCullerSP occlusionCuller_;
+  bool isOcclusionQueries_;
+  HardwareOcclusionCullerSP hardwareOcclusionCuller_;
+  bool isSortedRendering_;
+  bool isIndirectDrawing_;
+  RenderQueueSP renderQueue_;
+  glm::mat4 cameraWorldMatrix_;
+  unsigned long cameraWorldStamp_;    // matrix stack stamp of cameraWorldMatrix_, 0 if none
+  NodeSP lightScene_;                 // scene that lightPositions_ refer to
+  std::vector<LightPositionSP> lightPositions_;
+  std::vector<unsigned long> lightStamps_;  // last sync stamp that found each light position
+  unsigned long lightSyncVersion_;
+  struct LightWalkEntry_ {
+    const NodeSP* node;
+    bool isForced;    // node or ancestor modified, sub-tree has to be walked
+    bool isVisible;
+  };
+  std::vector<LightWalkEntry_> lightWalkStack_;
 
 };
 
@@ -0,0 +1,551 @@
+/**
+ * \file StaticBatch.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include "Composite.h"
+#include "Core.h"
+#include "GeometryCore.h"
+#include "Group.h"
+#include "Shape.h"
+#include "StaticBatch.h"
+#include "Transformation.h"
+
+namespace scg {
+
+
+namespace {
+
+/**
+ * Vertex data of a geometry core read back from its buffer objects, with element
+ * indices converted into a list of points, lines, or triangles.
+ */
+struct GeometryData {
+  GLenum primitiveType;       // GL_POINTS, GL_LINES, or GL_TRIANGLES
+  std::vector<GLuint> locations;
+  std::vector<GLint> dims;
+  std::vector<VertexFormat> formats;
+  std::vector<std::vector<GLfloat> > attributes;
+  size_t nVertices;
+  std::vector<GLuint> indices;
+};
+
+/**
+ * Geometry core to be merged into a batch, with transformation relative to the group.
+ */
+struct PendingObject {
+  const GeometryData* data;
+  glm::mat4 matrix;
+  size_t nodeState;
+};
+
+/**
+ * Batches are distinguished by cores, primitive type, and vertex attribute layout.
+ */
+typedef std::pair<std::vector<Core*>, std::vector<GLint> > BatchKey;
+
+/**
+ * Convert primitives into a list of points, lines, or triangles.
+ * \return false if the primitive type is not supported
+ */
+bool convertToList(GLenum primitiveType, const std::vector<GLuint>& elements, GeometryData& data) {
+  const size_t n = elements.size();
+  std::vector<GLuint>& indices = data.indices;
+  indices.clear();
+  switch (primitiveType) {
+  case GL_POINTS:
+    data.primitiveType = GL_POINTS;
+    indices = elements;
+    break;
+  case GL_LINES:
+    data.primitiveType = GL_LINES;
+    indices.assign(elements.begin(), elements.begin() + (n / 2) * 2);
+    break;
+  case GL_LINE_STRIP:
+  case GL_LINE_LOOP:
+    data.primitiveType = GL_LINES;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      indices.push_back(elements[i]);
+      indices.push_back(elements[i + 1]);
+    }
+    if (primitiveType == GL_LINE_LOOP && n > 1) {
+      indices.push_back(elements[n - 1]);
+      indices.push_back(elements[0]);
+    }
+    break;
+  case GL_TRIANGLES:
+    data.primitiveType = GL_TRIANGLES;
+    indices.assign(elements.begin(), elements.begin() + (n / 3) * 3);
+    break;
+  case GL_TRIANGLE_STRIP:
+    // keep orientation of odd triangles by swapping their first two vertices
+    data.primitiveType = GL_TRIANGLES;
+    for (size_t i = 0; i + 2 < n; ++i) {
+      indices.push_back(elements[(i % 2 == 0) ? i : i + 1]);
+      indices.push_back(elements[(i % 2 == 0) ? i + 1 : i]);
+      indices.push_back(elements[i + 2]);
+    }
+    break;
+  case GL_TRIANGLE_FAN:
+    data.primitiveType = GL_TRIANGLES;
+    for (size_t i = 1; i + 1 < n; ++i) {
+      indices.push_back(elements[0]);
+      indices.push_back(elements[i]);
+      indices.push_back(elements[i + 1]);
+    }
+    break;
+  default:
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Read vertex data of geometry core back from its buffer objects.
+ * \return false if the data cannot be read or is inconsistent
+ */
+bool readGeometry(GeometryCore* core, GeometryData& data) {
+  std::vector<GLuint> locations = core->getAttributeLocations();
+  std::sort(locations.begin(), locations.end());
+  locations.erase(std::unique(locations.begin(), locations.end()), locations.end());
+  data.nVertices = 0;
+  bool hasVertices = false;
+  for (auto location : locations) {
+    std::vector<GLfloat> values;
+    GLint dim = 0;
+    if (!core->getAttributeData(location, values, dim) || dim < 1 || dim > 4) {
+      return false;
+    }
+    const size_t nVertices = values.size() / dim;
+    data.nVertices = data.locations.empty() ? nVertices : std::min(data.nVertices, nVertices);
+    data.locations.push_back(location);
+    data.dims.push_back(dim);
+    data.formats.push_back(core->getAttributeFormat(location));
+    data.attributes.push_back(std::move(values));
+    hasVertices |= (location == OGLConstants::VERTEX.location);
+  }
+  if (!hasVertices) {
+    return false;
+  }
+
+  // element indices, vertex indices in drawing order for DrawMode::ARRAYS
+  std::vector<GLuint> elements;
+  const size_t nElements = static_cast<size_t>(std::max(core->getNElements(), 0));
+  if (core->getDrawMode() == DrawMode::ELEMENTS) {
+    if (!core->getElementIndexData(elements)) {
+      return false;
+    }
+    elements.resize(std::min(elements.size(), nElements));
+  }
+  else {
+    elements.resize(nElements);
+    for (size_t i = 0; i < nElements; ++i) {
+      elements[i] = static_cast<GLuint>(i);
+    }
+  }
+  for (auto index : elements) {
+    if (index >= data.nVertices) {
+      return false;
+    }
+  }
+  return convertToList(core->getPrimitiveType(), elements, data);
+}
+
+/**
+ * Append vertex attribute values transformed into the coordinate system of the group,
+ * i.e., positions by the matrix, normals by the normal matrix, tangents and binormals
+ * by the upper left 3x3 matrix. The binormal sign of tangents with four components
+ * (cf. VertexQuantizer::computeSignedTangents()) is flipped by mirroring matrices.
+ * Extend bounding box by the positions.
+ */
+void appendAttribute(GLuint location, GLint dim, GLint outDim, const std::vector<GLfloat>& values,
+    size_t nVertices, const glm::mat4& matrix, const glm::mat3& normalMatrix, bool isIdentity,
+    std::vector<GLfloat>& result, AABB& box) {
+  const bool isVertex = (location == OGLConstants::VERTEX.location);
+  const bool isNormal = (location == OGLConstants::NORMAL.location);
+  const bool isDirection = (location == OGLConstants::TANGENT.location
+      || location == OGLConstants::BINORMAL.location);
+  const GLfloat handedness = (location == OGLConstants::TANGENT.location && !isIdentity
+      && glm::determinant(glm::mat3(matrix)) < 0.0f) ? -1.0f : 1.0f;
+  result.reserve(result.size() + nVertices * outDim);
+  for (size_t i = 0; i < nVertices; ++i) {
+    glm::vec4 value(0.0f, 0.0f, 0.0f, isVertex ? 1.0f : 0.0f);
+    for (GLint k = 0; k < dim; ++k) {
+      value[k] = values[i * dim + k];
+    }
+    if (!isIdentity) {
+      if (isVertex) {
+        value = matrix * value;
+      }
+      else if (isNormal || isDirection) {
+        // not normalized, such that interpolation across faces is unchanged
+        const glm::vec3 direction = isNormal ?
+            normalMatrix * glm::vec3(value) : glm::mat3(matrix) * glm::vec3(value);
+        value = glm::vec4(direction, handedness * value.w);
+      }
+    }
+    if (isVertex) {
+      box.extend((value.w != 0.0f) ? glm::vec3(value) / value.w : glm::vec3(value));
+    }
+    for (GLint k = 0; k < outDim; ++k) {
+      result.push_back(value[k]);
+    }
+  }
+}
+
+} /* namespace */
+
+
+StaticBatch::StaticBatch()
+    : validVersion_(0), nDrawnObjects_(0) {
+}
+
+
+StaticBatch::~StaticBatch() {
+}
+
+
+StaticBatchSP StaticBatch::create() {
+  return std::make_shared<StaticBatch>();
+}
+
+
+bool StaticBatch::build(Group* group) {
+  assert(group);
+  nodeStates_.clear();
+  objects_.clear();
+  batches_.clear();
+
+  // stack frame: composite node, next child, node state, matrix, and number of cores of path
+  struct Frame {
+    Composite* node;
+    size_t nextChild;
+    size_t nodeState;
+    glm::mat4 matrix;
+    size_t nPathCores;
+  };
+
+  // collect geometry cores of the sub-tree in depth-first pre-order, using an explicit stack
+  std::unordered_map<GeometryCore*, GeometryData> geometryData;
+  std::map<BatchKey, size_t> batchIndices;
+  std::vector<std::vector<PendingObject> > pendingObjects;
+  std::vector<CoreSP> pathCores;
+  std::vector<Frame> stack;
+  NodeState_ groupState;
+  groupState.node = group;
+  groupState.parent = -1;
+  groupState.matrix = glm::mat4(1.0f);
+  groupState.isVisible = true;
+  nodeStates_.push_back(groupState);
+  stack.push_back({ group, 0, 0, glm::mat4(1.0f), 0 });
+  bool isBatchable = true;
+  while (!stack.empty() && isBatchable) {
+    Frame& frame = stack.back();
+    const std::vector<NodeSP>& children = frame.node->getChildren();
+    if (frame.nextChild >= children.size()) {
+      pathCores.resize(frame.nPathCores);
+      stack.pop_back();
+      continue;
+    }
+    Node* child = children[frame.nextChild++].get();
+    const size_t parentState = frame.nodeState;
+    const glm::mat4 matrix = frame.matrix;
+
+    // node state to detect modifications
+    const size_t stateIndex = nodeStates_.size();
+    NodeState_ state;
+    state.node = child;
+    state.parent = static_cast<int>(parentState);
+    state.matrix = glm::mat4(1.0f);
+    state.isVisible = child->isVisible_;
+    for (auto& core : child->cores_) {
+      state.cores.push_back(core.get());
+    }
+
+    const std::type_info& type = typeid(*child);
+    if (type == typeid(Group)) {
+      nodeStates_.push_back(state);
+      stack.push_back({ static_cast<Composite*>(child), 0, stateIndex, matrix, pathCores.size() });
+      pathCores.insert(pathCores.end(), child->cores_.begin(), child->cores_.end());
+    }
+    else if (type == typeid(Transformation)) {
+      Transformation* transformation = static_cast<Transformation*>(child);
+      state.matrix = transformation->getMatrix();
+      nodeStates_.push_back(state);
+      stack.push_back({ transformation, 0, stateIndex, matrix * state.matrix, pathCores.size() });
+    }
+    else if (type == typeid(Shape)) {
+      nodeStates_.push_back(state);
+      std::vector<CoreSP> cores = pathCores;
+      for (auto& core : child->cores_) {
+        GeometryCore* geometryCore = dynamic_cast<GeometryCore*>(core.get());
+        if (!geometryCore) {
+          // core is applied to following geometry cores
+          cores.push_back(core);
+          continue;
+        }
+        auto it = geometryData.find(geometryCore);
+        if (it == geometryData.end()) {
+          it = geometryData.insert(std::make_pair(geometryCore, GeometryData())).first;
+          if (!readGeometry(geometryCore, it->second)) {
+            isBatchable = false;
+            break;
+          }
+        }
+        const GeometryData& data = it->second;
+        if (data.indices.empty()) {
+          continue;
+        }
+
+        // find or add batch
+        BatchKey key;
+        for (auto& batchCore : cores) {
+          key.first.push_back(batchCore.get());
+        }
+        key.second.push_back(static_cast<GLint>(data.primitiveType));
+        for (size_t i = 0; i < data.locations.size(); ++i) {
+          key.second.push_back(static_cast<GLint>(data.locations[i]));
+          key.second.push_back(data.dims[i]);
+          key.second.push_back(static_cast<GLint>(data.formats[i]));
+        }
+        auto batchIt = batchIndices.find(key);
+        if (batchIt == batchIndices.end()) {
+          batchIt = batchIndices.insert(std::make_pair(key, batches_.size())).first;
+          Batch_ batch;
+          batch.cores = cores;
+          batch.beginObject = batch.endObject = 0;
+          batches_.push_back(batch);
+          pendingObjects.push_back(std::vector<PendingObject>());
+        }
+        pendingObjects[batchIt->second].push_back({ &data, matrix, stateIndex });
+      }
+    }
+    else {
+      isBatchable = false;
+    }
+  }
+  if (!isBatchable) {
+    nodeStates_.clear();
+    batches_.clear();
+    return false;
+  }
+  updateVisibility_();
+
+  // merge geometry cores of each batch, pre-transforming their vertices
+  const bool isDefaultPickable = GeometryCore::isDefaultPickable();
+  GeometryCore::setDefaultPickable(false);    // shapes of the sub-tree are used for picking
+  for (size_t b = 0; b < batches_.size(); ++b) {
+    const GeometryData& firstData = *pendingObjects[b].front().data;
+    const size_t nAttributes = firstData.locations.size();
+    std::vector<GLint> outDims = firstData.dims;
+    std::vector<std::vector<GLfloat> > attributes(nAttributes);
+    for (size_t k = 0; k < nAttributes; ++k) {
+      if (firstData.locations[k] == OGLConstants::VERTEX.location) {
+        outDims[k] = std::max(outDims[k], 3);
+      }
+    }
+    std::vector<GLuint> indices;
+    size_t nVertices = 0;
+    Batch_& batch = batches_[b];
+    batch.beginObject = objects_.size();
+    for (auto& pending : pendingObjects[b]) {
+      const GeometryData& data = *pending.data;
+      const bool isIdentity = (pending.matrix == glm::mat4(1.0f));
+      const glm::mat3 matrix3(pending.matrix);
+      const glm::mat3 normalMatrix = (glm::determinant(matrix3) != 0.0f) ?
+          glm::transpose(glm::inverse(matrix3)) : matrix3;
+      Object_ object;
+      object.nodeState = pending.nodeState;
+      object.first = static_cast<GLint>(indices.size());
+      object.count = static_cast<GLsizei>(data.indices.size());
+      object.cullPlane = 0;
+      for (size_t k = 0; k < nAttributes; ++k) {
+        appendAttribute(data.locations[k], data.dims[k], outDims[k], data.attributes[k],
+            data.nVertices, pending.matrix, normalMatrix, isIdentity, attributes[k], object.boundingBox);
+      }
+      for (auto index : data.indices) {
+        indices.push_back(static_cast<GLuint>(nVertices + index));
+      }
+      nVertices += data.nVertices;
+      objects_.push_back(object);
+    }
+    batch.endObject = objects_.size();
+
+    batch.geometryCore = GeometryCore::create(firstData.primitiveType, DrawMode::ELEMENTS);
+    std::vector<VertexAttributeStream> streams;
+    for (size_t k = 0; k < nAttributes; ++k) {
+      // keep vertex formats except for transformed attributes, i.e., positions, which may
+      // exceed the precision of half floats, and directions, which are not normalized
+      const GLuint location = firstData.locations[k];
+      const bool isTransformed = location == OGLConstants::VERTEX.location
+          || location == OGLConstants::NORMAL.location || location == OGLConstants::TANGENT.location
+          || location == OGLConstants::BINORMAL.location;
+      const VertexFormat format = isTransformed ? VertexFormat::FLOAT : firstData.formats[k];
+      streams.push_back({ firstData.locations[k], attributes[k].data(), outDims[k], format });
+    }
+    batch.geometryCore->setVertexStreams(streams, static_cast<GLsizei>(nVertices), GL_STATIC_DRAW);
+    batch.geometryCore->setElementIndexData(indices.data(), indices.size() * sizeof(GLuint), GL_STATIC_DRAW);
+  }
+  GeometryCore::setDefaultPickable(isDefaultPickable);
+
+  // subsequent modifications will be detected by update()
+  validVersion_ = Node::nextVersion();
+  return true;
+}
+
+
+bool StaticBatch::update() {
+  if (nodeStates_.empty()) {
+    return false;
+  }
+  if (nodeStates_.front().node->subtreeVersion_ < validVersion_) {
+    return true;
+  }
+
+  // check nodes in pre-order, i.e., a removed node is detected at its parent
+  // before it is accessed itself
+  bool isVisibilityModified = false;
+  for (size_t i = 0; i < nodeStates_.size(); ++i) {
+    NodeState_& state = nodeStates_[i];
+    Node* node = state.node;
+    if (node->isComposite_ && static_cast<Composite*>(node)->structureVersion_ >= validVersion_) {
+      return false;
+    }
+    if (node->version_ < validVersion_ || i == 0) {
+      // cores of the group itself are not part of the batch
+      continue;
+    }
+    if (node->cores_.size() != state.cores.size()) {
+      return false;
+    }
+    for (size_t k = 0; k < state.cores.size(); ++k) {
+      if (node->cores_[k].get() != state.cores[k]) {
+        return false;
+      }
+    }
+    if (typeid(*node) == typeid(Transformation)
+        && static_cast<Transformation*>(node)->getMatrix() != state.matrix) {
+      return false;
+    }
+    if (node->isVisible_ != state.isVisible) {
+      state.isVisible = node->isVisible_;
+      isVisibilityModified = true;
+    }
+  }
+  if (isVisibilityModified) {
+    updateVisibility_();
+  }
+
+  // subsequent modifications will be checked by next call
+  validVersion_ = Node::nextVersion();
+  return true;
+}
+
+
+size_t StaticBatch::getNBatches() const {
+  return batches_.size();
+}
+
+
+size_t StaticBatch::getNObjects() const {
+  return objects_.size();
+}
+
+
+size_t StaticBatch::getNDrawnObjects() const {
+  return nDrawnObjects_;
+}
+
+
+void StaticBatch::render(RenderState* renderState) {
+  render_(renderState, nullptr, 0);
+}
+
+
+void StaticBatch::render(RenderState* renderState, const ViewFrustum& frustum, unsigned int planeMask) {
+  render_(renderState, &frustum, planeMask & ViewFrustum::ALL_PLANES);
+}
+
+
+void StaticBatch::render_(RenderState* renderState, const ViewFrustum* frustum, unsigned int planeMask) {
+  nDrawnObjects_ = 0;
+  for (auto& batch : batches_) {
+    // collect draw ranges of visible objects, merging adjacent ranges
+    firsts_.clear();
+    counts_.clear();
+    size_t nDrawn = 0;
+    for (size_t i = batch.beginObject; i < batch.endObject; ++i) {
+      Object_& object = objects_[i];
+      if (!nodeStates_[object.nodeState].isPathVisible) {
+        continue;
+      }
+      unsigned int objectMask = planeMask;
+      if (planeMask != 0 && frustum->isOutside(object.boundingBox, objectMask, object.cullPlane)) {
+        continue;
+      }
+      if (!counts_.empty() && firsts_.back() + counts_.back() == object.first) {
+        counts_.back() += object.count;
+      }
+      else {
+        firsts_.push_back(object.first);
+        counts_.push_back(object.count);
+      }
+      ++nDrawn;
+    }
+    if (nDrawn == 0) {
+      continue;
+    }
+
+    // apply cores, draw ranges, restore render state
+    for (auto& core : batch.cores) {
+      core->render(renderState);
+    }
+    if (nDrawn == batch.endObject - batch.beginObject) {
+      batch.geometryCore->render(renderState);
+    }
+    else {
+      batch.geometryCore->renderRanges(renderState, firsts_.data(), counts_.data(),
+          static_cast<GLsizei>(counts_.size()));
+    }
+    for (auto it = batch.cores.rbegin(); it != batch.cores.rend(); ++it) {
+      (*it)->renderPost(renderState);
+    }
+    nDrawnObjects_ += nDrawn;
+  }
+}
+
+
+void StaticBatch::updateVisibility_() {
+  // parents precede their children, the visibility of the group itself is ignored
+  for (auto& state : nodeStates_) {
+    state.isPathVisible = (state.parent < 0) ||
+        (state.isVisible && nodeStates_[state.parent].isPathVisible);
+  }
+}
+
+
+} /* namespace scg */
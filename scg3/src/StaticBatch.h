@@ -0,0 +1,182 @@
+/**
+ * \file StaticBatch.h
+ * \brief Static batching: shapes of a sub-tree merged into combined geometry cores
+ *    (cf. Group::batch()).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATICBATCH_H_
+#define STATICBATCH_H_
+
+#include <vector>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Static batching: shapes of a sub-tree merged into combined geometry cores
+ *    (cf. Group::batch()).
+ *
+ * build() collects the geometry cores of all shapes below a group together with the
+ * cores applied to them by the shapes and by the groups in between, i.e., shaders,
+ * materials, textures, etc. Geometry cores sharing the same sequence of cores (compared
+ * by identity), primitive class (points, lines, triangles), and vertex attributes are
+ * merged into one indexed geometry core per batch, their vertices pre-transformed by the
+ * transformations below the group. Strips, fans, and loops are converted into lists.
+ * The vertex data is read back from the vertex buffer objects of the geometry cores.
+ *
+ * Each merged geometry core keeps its own draw range and bounding box (object), such that
+ * objects outside of the view frustum or with an invisible node on their path can be
+ * skipped, drawing the remaining ranges with a single glMultiDrawElements() call per batch.
+ *
+ * update() checks the nodes of the sub-tree for modifications after build(): visibility
+ * changes are applied to the objects, any other modification (cores, transformation
+ * matrices, adding or removing nodes) invalidates the batch.
+ * Modifications of geometry cores are not detected.
+ */
+class StaticBatch {
+
+public:
+
+  /**
+   * Constructor.
+   */
+  StaticBatch();
+
+  /**
+   * Destructor.
+   */
+  virtual ~StaticBatch();
+
+  /**
+   * Create shared pointer.
+   */
+  static StaticBatchSP create();
+
+  /**
+   * Build batches from the shapes of the sub-tree of the given group (excluding the
+   * cores of the group itself).
+   * \return false if the sub-tree contains nodes other than Group, Transformation,
+   *    and Shape, or geometry cores that cannot be read back
+   */
+  bool build(Group* group);
+
+  /**
+   * Check sub-tree for modifications since build() or the last update.
+   * \return false if the batch has become invalid and has to be rebuilt
+   */
+  bool update();
+
+  /**
+   * Get number of batches, i.e., combined geometry cores.
+   */
+  size_t getNBatches() const;
+
+  /**
+   * Get number of objects, i.e., geometry cores merged into the batches.
+   */
+  size_t getNObjects() const;
+
+  /**
+   * Get number of objects drawn by last render().
+   */
+  size_t getNDrawnObjects() const;
+
+  /**
+   * Render batches, skipping invisible objects.
+   */
+  void render(RenderState* renderState);
+
+  /**
+   * Render batches, skipping invisible objects and objects outside of the given
+   * view frustum.
+   * \param renderState current render state
+   * \param frustum view frustum in the coordinate system of the group
+   * \param planeMask planes to be tested (cf. ViewFrustum::isOutside()),
+   *    0 if the group is completely inside of the view frustum
+   */
+  void render(RenderState* renderState, const ViewFrustum& frustum, unsigned int planeMask);
+
+protected:
+
+  /**
+   * \brief Node of the sub-tree as of build(), to detect modifications.
+   */
+  struct NodeState_ {
+    Node* node;
+    int parent;                   // index of parent node state, -1 for the group
+    glm::mat4 matrix;             // local matrix of Transformation nodes
+    std::vector<Core*> cores;
+    bool isVisible;
+    bool isPathVisible;           // all nodes from the group to this node are visible
+  };
+
+  /**
+   * \brief Geometry core merged into a batch.
+   */
+  struct Object_ {
+    size_t nodeState;             // index of node state of shape
+    GLint first;                  // index of first element index
+    GLsizei count;                // number of element indices
+    AABB boundingBox;             // in the coordinate system of the group
+    unsigned char cullPlane;      // frustum plane the object has been outside of last time
+  };
+
+  /**
+   * \brief Combined geometry core with the cores to be applied to it.
+   */
+  struct Batch_ {
+    std::vector<CoreSP> cores;
+    GeometryCoreSP geometryCore;
+    size_t beginObject;
+    size_t endObject;
+  };
+
+  /**
+   * Render batches, testing objects against the frustum if the plane mask is not 0.
+   */
+  void render_(RenderState* renderState, const ViewFrustum* frustum, unsigned int planeMask);
+
+  /**
+   * Update path visibility of node states.
+   */
+  void updateVisibility_();
+
+protected:
+
+  std::vector<NodeState_> nodeStates_;
+  std::vector<Object_> objects_;
+  std::vector<Batch_> batches_;
+  unsigned long validVersion_;    // modifications with this or a later version are not checked yet
+  size_t nDrawnObjects_;
+  std::vector<GLint> firsts_;     // draw ranges, reused by render_()
+  std::vector<GLsizei> counts_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* STATICBATCH_H_ */
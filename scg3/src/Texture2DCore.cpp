@@ -36,6 +36,7 @@ Texture2DCore::Texture2DCore()
 
 Texture2DCore::~Texture2DCore() {
   if (isGLContextActive()) {
+    RenderState::glState.removeTexture(tex_);
     glDeleteTextures(1, &tex_);
   }
 }
@@ -49,9 +50,10 @@ Texture2DCoreSP Texture2DCore::create() {
 void Texture2DCore::setTexture(GLsizei width, GLsizei height, const unsigned char* rgbaData,
     GLenum wrapModeS, GLenum wrapModeT, GLenum minFilter, GLenum magFilter) {
   assert(rgbaData);
+  RenderState::glState.removeTexture(tex_);
   glDeleteTextures(1, &tex_);
   glGenTextures(1, &tex_);
-  glBindTexture(GL_TEXTURE_2D, tex_);
+  RenderState::glState.bindTexture(GL_TEXTURE_2D, tex_);
   assert(glIsTexture(tex_));
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapModeS);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapModeT);
@@ -69,7 +71,7 @@ void Texture2DCore::setTexture(GLsizei width, GLsizei height, const unsigned cha
       minFilter == GL_LINEAR_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_LINEAR) {
     glGenerateMipmap(GL_TEXTURE_2D);
   }
-  glBindTexture(GL_TEXTURE_2D, 0);
+  RenderState::glState.bindTexture(GL_TEXTURE_2D, 0);
 
   assert(!checkGLError());
 }
@@ -90,11 +92,11 @@ void Texture2DCore::render(RenderState* renderState) {
   TextureCore::render(renderState);
 
   // save texture binding
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &texOld_);
+  texOld_ = static_cast<GLint>(renderState->glState.getTexture(GL_TEXTURE_2D));
 
   // bind texture
   assert(glIsTexture(tex_));
-  glBindTexture(GL_TEXTURE_2D, tex_);
+  renderState->glState.bindTexture(GL_TEXTURE_2D, tex_);
 
   assert(!checkGLError());
 }
@@ -102,7 +104,7 @@ void Texture2DCore::render(RenderState* renderState) {
 
 void Texture2DCore::renderPost(RenderState* renderState) {
   // restore texture binding
-  glBindTexture(GL_TEXTURE_2D, texOld_);
+  renderState->glState.bindTexture(GL_TEXTURE_2D, texOld_);
 
   // restore texture matrix
   TextureCore::renderPost(renderState);
@@ -29,7 +29,7 @@ namespace scg {
 
 
 Transformation::Transformation()
-    : matrix_(1.0f) {
+    : matrix_(1.0f), matrixVersion_(1), worldMatrix_(1.0f), worldMatrixVersion_(0) {
 }
 
 
@@ -49,12 +49,14 @@ const glm::mat4& Transformation::getMatrix() const {
 
 Transformation* Transformation::setMatrix(const glm::mat4& matrix) {
   matrix_ = matrix;
+  markMatrixModified_();
   return this;
 }
 
 
 Transformation* Transformation::translate(glm::vec3 translation) {
   matrix_ = glm::translate(matrix_, translation);
+  markMatrixModified_();
   return this;
 }
 
@@ -62,12 +64,14 @@ Transformation* Transformation::translate(glm::vec3 translation) {
 
 Transformation* Transformation::rotateRad(GLfloat angleRad, glm::vec3 axis) {
   matrix_ = glm::rotate(matrix_, angleRad, axis);
+  markMatrixModified_();
   return this;
 }
 
 
 Transformation* Transformation::scale(glm::vec3 scaling) {
   matrix_ = glm::scale(matrix_, scaling);
+  markMatrixModified_();
   return this;
 }
 
@@ -84,7 +88,7 @@ void Transformation::acceptPost(Traverser *traverser) {
 
 void Transformation::render(RenderState* renderState) {
   renderState->modelViewStack.pushMatrix();
-  renderState->modelViewStack.multMatrix(matrix_);
+  renderState->modelViewStack.multMatrix(matrix_, matrixVersion_, matrixCache_);
 }
 
 
@@ -93,4 +97,25 @@ void Transformation::renderPost(RenderState* renderState) {
 }
 
 
+const glm::mat4* Transformation::updateWorldMatrix_(const glm::mat4* parentWorld, unsigned long pathVersion) {
+  if (pathVersion >= worldMatrixVersion_) {
+    worldMatrix_ = *parentWorld * matrix_;
+    worldMatrixVersion_ = validVersion_(pathVersion);
+  }
+  return &worldMatrix_;
+}
+
+
+void Transformation::transformBounds_(AABB& box, BoundingSphere& sphere) const {
+  box = box.transform(matrix_);
+  sphere = sphere.transform(matrix_);
+}
+
+
+void Transformation::markMatrixModified_() {
+  ++matrixVersion_;
+  markModified_();
+}
+
+
 } /* namespace scg */
@@ -27,6 +27,7 @@
 
 #include "scg_glew.h"
 #include "Composite.h"
+#include "RenderState.h"
 #include "scg_glm.h"
 #include "scg_internals.h"
 
@@ -38,6 +39,11 @@ class Traverser;
 
 /**
  * \brief A transformation node to be used to appy a transformation to the sub-tree (composite node).
+ *
+ * The products of the local matrix with the current model-view matrix are cached
+ * (cf. MatrixProductCache) and only recomputed if the local matrix or a matrix
+ * further up the scene graph has been modified, i.e., modifying a transformation
+ * invalidates only the cached matrices of its sub-tree.
  */
 class Transformation: public Composite {
 
@@ -113,7 +119,7 @@ public:
 
   /**
    * Render transformation, i.e., post-multiply current model-view matrix by
-   * local matrix.
+   * local matrix, or reuse the cached product if both are unchanged.
    */
   virtual void render(RenderState* renderState);
 
@@ -122,9 +128,30 @@ public:
    */
   virtual void renderPost(RenderState* renderState);
 
+protected:
+
+  /**
+   * Update cached world matrix if the path from the root node has been modified.
+   */
+  virtual const glm::mat4* updateWorldMatrix_(const glm::mat4* parentWorld, unsigned long pathVersion);
+
+  /**
+   * Transform bounding volumes of the children by the local matrix.
+   */
+  virtual void transformBounds_(AABB& box, BoundingSphere& sphere) const;
+
+  /**
+   * Mark local matrix as modified, to be called by all functions modifying matrix_.
+   */
+  void markMatrixModified_();
+
 protected:
 
   glm::mat4 matrix_;
+  unsigned long matrixVersion_;
+  MatrixProductCache matrixCache_;
+  glm::mat4 worldMatrix_;
+  unsigned long worldMatrixVersion_;  // valid if versions of path from root node are lower
 
 };
 
@@ -21,13 +21,18 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cassert>
+#include "Composite.h"
 #include "Traverser.h"
 
 namespace scg {
 
 
 Traverser::Traverser(RenderState* renderState)
-    : renderState_(renderState) {
+    : renderState_(renderState), isCullingEnabled_(false), cullMask_(~0u),
+      selectedChild_(ALL_CHILDREN) {
+  stack_.reserve(INITIAL_STACK_CAPACITY);
 }
 
 
@@ -35,6 +40,86 @@ Traverser::~Traverser() {
 }
 
 
+void Traverser::traverse(Node* root) {
+  assert(root);
+
+  // process root node
+  if (!root->isVisible_) {
+    return;
+  }
+  unsigned int cullMask = ~0u;
+  if (isCullingEnabled_ && cull_(root, cullMask)) {
+    return;
+  }
+  cullMask_ = cullMask;
+  selectedChild_ = ALL_CHILDREN;
+  root->accept(this);
+  if (!root->isComposite_) {
+    return;
+  }
+
+  // process sub-tree, keep frames of enclosing traversals (if any) untouched
+  const size_t stackBase = stack_.size();
+  pushFrame_(static_cast<Composite*>(root), cullMask);
+  while (stack_.size() > stackBase) {
+    // find next visible child of top composite node, skipping empty slots
+    Frame_& frame = stack_.back();
+    const std::vector<NodeSP>& children = frame.node->children_;
+    Node* child = nullptr;
+    unsigned int cullMask = frame.cullMask;
+    const size_t endChild = std::min(frame.endChild, children.size());
+    while (frame.nextChild < endChild) {
+      Node* node = children[frame.nextChild++].get();
+      if (node && node->isVisible_ &&
+          !(isCullingEnabled_ && cullMask != 0 && cull_(node, cullMask))) {
+        child = node;
+        break;
+      }
+      cullMask = frame.cullMask;
+    }
+
+    if (child) {
+      // process child, descend into its sub-tree (if any)
+      cullMask_ = cullMask;
+      selectedChild_ = ALL_CHILDREN;
+      child->accept(this);
+      if (child->isComposite_) {
+        pushFrame_(static_cast<Composite*>(child), cullMask);
+      }
+    }
+    else {
+      // all children processed: post-process composite node
+      Composite* node = frame.node;
+      stack_.pop_back();
+      node->acceptPost(this);
+    }
+  }
+}
+
+
+bool Traverser::cull_(Node*, unsigned int&) {
+  return false;
+}
+
+
+void Traverser::selectChild_(size_t index) {
+  selectedChild_ = index;
+}
+
+
+void Traverser::pushFrame_(Composite* node, unsigned int cullMask) {
+  if (selectedChild_ == ALL_CHILDREN) {
+    stack_.push_back({ node, 0, ALL_CHILDREN, cullMask });
+    return;
+  }
+
+  // compact child array, such that the index refers to getChildren()
+  node->getChildren();
+  stack_.push_back({ node, selectedChild_, selectedChild_ + 1, cullMask });
+  selectedChild_ = ALL_CHILDREN;
+}
+
+
 void Traverser::visitLightPosition(LightPosition* node) {
   // do nothing by default
 }
@@ -65,6 +150,16 @@ void Traverser::visitPostGroup(Group* node) {
 }
 
 
+void Traverser::visitLOD(LOD* node) {
+  // do nothing by default
+}
+
+
+void Traverser::visitPostLOD(LOD* node) {
+  // do nothing by default
+}
+
+
 void Traverser::visitLight(Light* node) {
   // do nothing by default
 }
@@ -25,6 +25,7 @@
 #ifndef TRAVERSER_H_
 #define TRAVERSER_H_
 
+#include <vector>
 #include "scg_internals.h"
 
 namespace scg {
@@ -32,6 +33,20 @@ namespace scg {
 
 /**
  * \brief Base class for all traversers (visitor pattern, abstract).
+ *
+ * The scene graph is traversed iteratively by traverse(), using an explicit
+ * stack of composite nodes instead of recursive function calls. Thus the native
+ * stack usage is bounded for arbitrarily wide or deep scene graphs, and no heap
+ * memory is allocated once the stack has grown to the maximum tree depth.
+ *
+ * Derived classes may prune sub-trees by enabling culling and overriding cull_(),
+ * which is called before a node is accepted. A bit mask is passed from each node to
+ * its children, e.g., to skip tests that are known to succeed for the whole sub-tree
+ * (cf. CullingRenderTraverser).
+ *
+ * Visit functions may restrict the traversal of the sub-tree of the composite node
+ * being accepted to a single child by selectChild_(), e.g., to render only the
+ * selected level of a LOD node.
  */
 class Traverser {
 
@@ -47,6 +62,13 @@ public:
    */
   virtual ~Traverser() = 0;
 
+  /**
+   * Traverse node tree (depth-first, pre-order) starting at given root node,
+   * calling the nodes' accept() and acceptPost() methods.
+   * Invisible nodes and nodes culled by cull_() are skipped together with their sub-trees.
+   */
+  void traverse(Node* root);
+
   // leaf nodes
 
   /**
@@ -81,6 +103,16 @@ public:
    */
   virtual void visitPostGroup(Group* node);
 
+  /**
+   * Visit LOD node.
+   */
+  virtual void visitLOD(LOD* node);
+
+  /**
+   * Visit LOD node after traversing sub-tree.
+   */
+  virtual void visitPostLOD(LOD* node);
+
   /**
    * Visit Light node.
    */
@@ -101,9 +133,62 @@ public:
    */
   virtual void visitPostTransformation(Transformation* node);
 
+protected:
+
+  /**
+   * Check if node is to be skipped together with its sub-tree, called by traverse()
+   * before accepting the node if culling is enabled and the cull mask is not zero.
+   * Returns false by default.
+   * \param node node to be checked
+   * \param cullMask cull mask of the parent node, to be updated for the node and its sub-tree
+   * \return true if node is to be skipped
+   */
+  virtual bool cull_(Node* node, unsigned int& cullMask);
+
+  /**
+   * Restrict traversal of the sub-tree of the composite node currently being accepted
+   * to the child at the given position (in the order of Composite::getChildren()),
+   * no child is traversed if the index is out of range.
+   */
+  void selectChild_(size_t index);
+
+  /**
+   * Push stack frame of composite node, restricted to the child selected by
+   * selectChild_() (if any).
+   */
+  void pushFrame_(Composite* node, unsigned int cullMask);
+
+protected:
+
+  /**
+   * \brief Stack frame of traverse(): composite node, index of next child to visit,
+   *    index one past the last child to visit, and cull mask to be passed to the children.
+   */
+  struct Frame_ {
+    Composite* node;
+    size_t nextChild;
+    size_t endChild;
+    unsigned int cullMask;
+  };
+
+  /**
+   * Child index if no child is selected, i.e., all children are traversed.
+   */
+  static const size_t ALL_CHILDREN = ~static_cast<size_t>(0);
+
+  /**
+   * Initial capacity of the traversal stack, i.e., tree depth that can be
+   * traversed without allocating memory.
+   */
+  static const size_t INITIAL_STACK_CAPACITY = 64;
+
 protected:
 
   RenderState* renderState_;
+  std::vector<Frame_> stack_;
+  bool isCullingEnabled_;
+  unsigned int cullMask_;   // cull mask of the node currently being accepted
+  size_t selectedChild_;    // child selected for the node currently being accepted
 
 };
 
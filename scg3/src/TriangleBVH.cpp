@@ -0,0 +1,454 @@
+/**
+ * \file TriangleBVH.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "TriangleBVH.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCG_TRIANGLEBVH_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace scg {
+
+
+namespace {
+
+// number of bins of SAH split
+const int N_SAH_BINS = 16;
+
+// maximum tree depth, bounds the traversal stacks
+const int MAX_DEPTH = 60;
+const int STACK_SIZE = MAX_DEPTH + 4;
+
+bool intersectBox(const AABB& box, const glm::vec3& origin, const glm::vec3& invDirection,
+    GLfloat tMax, GLfloat& tNear) {
+  const glm::vec3 t0 = (box.min - origin) * invDirection;
+  const glm::vec3 t1 = (box.max - origin) * invDirection;
+  const glm::vec3 tMinSlab = glm::min(t0, t1);
+  const glm::vec3 tMaxSlab = glm::max(t0, t1);
+  tNear = std::max(std::max(tMinSlab.x, tMinSlab.y), std::max(tMinSlab.z, 0.0f));
+  const GLfloat tFar = std::min(std::min(tMaxSlab.x, tMaxSlab.y), std::min(tMaxSlab.z, tMax));
+  return tNear <= tFar;
+}
+
+}
+
+
+TriangleBVH::TriangleBVH(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices,
+    GLenum primitiveType) {
+  // collect triangles in drawing order, skipping triangles with invalid indices
+  const size_t nVertices = indices.empty() ? positions.size() : indices.size();
+  auto getVertex = [&](size_t i, glm::vec3& vertex) {
+    const size_t index = indices.empty() ? i : indices[i];
+    if (index >= positions.size()) {
+      return false;
+    }
+    vertex = positions[index];
+    return true;
+  };
+  size_t nTriangles = 0;
+  switch (primitiveType) {
+  case GL_TRIANGLES:
+    nTriangles = nVertices / 3;
+    break;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+    nTriangles = nVertices >= 3 ? nVertices - 2 : 0;
+    break;
+  default:
+    break;
+  }
+  std::vector<Triangle_> triangles;
+  triangles.reserve(nTriangles);
+  for (size_t i = 0; i < nTriangles; ++i) {
+    size_t i0, i1, i2;
+    if (primitiveType == GL_TRIANGLES) {
+      i0 = 3 * i;
+      i1 = 3 * i + 1;
+      i2 = 3 * i + 2;
+    }
+    else if (primitiveType == GL_TRIANGLE_STRIP) {
+      // keep orientation of odd triangles
+      i0 = i;
+      i1 = (i % 2 == 0) ? i + 1 : i + 2;
+      i2 = (i % 2 == 0) ? i + 2 : i + 1;
+    }
+    else {
+      i0 = 0;
+      i1 = i + 1;
+      i2 = i + 2;
+    }
+    glm::vec3 v0, v1, v2;
+    if (getVertex(i0, v0) && getVertex(i1, v1) && getVertex(i2, v2)) {
+      triangles.push_back({ v0, v1 - v0, v2 - v0, static_cast<GLuint>(i) });
+    }
+  }
+  build_(triangles);
+}
+
+
+TriangleBVH::~TriangleBVH() {
+}
+
+
+TriangleBVHSP TriangleBVH::create(const std::vector<glm::vec3>& positions,
+    const std::vector<GLuint>& indices, GLenum primitiveType) {
+  return std::make_shared<TriangleBVH>(positions, indices, primitiveType);
+}
+
+
+size_t TriangleBVH::getNTriangles() const {
+  return triangles_.size();
+}
+
+
+AABB TriangleBVH::getBoundingBox() const {
+  return nodes_.empty() ? AABB() : nodes_[0].box;
+}
+
+
+bool TriangleBVH::intersect(const Ray& ray, RayHit& hit) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+  const glm::vec3 invDirection = 1.0f / ray.direction;
+  bool isFound = false;
+
+  // depth-first traversal, nearer child first; stack entries are node index and entry distance
+  std::pair<GLuint, GLfloat> stack[STACK_SIZE];
+  int stackSize = 0;
+  GLfloat tNear;
+  if (intersectBox(nodes_[0].box, ray.origin, invDirection, hit.distance, tNear)) {
+    stack[stackSize++] = std::make_pair(0u, tNear);
+  }
+  while (stackSize > 0) {
+    const GLuint index = stack[stackSize - 1].first;
+    const GLfloat tEntry = stack[--stackSize].second;
+    if (tEntry > hit.distance) {
+      continue;
+    }
+    const Node_& node = nodes_[index];
+    if (node.count == 0) {
+      GLfloat tLeft, tRight;
+      const bool isLeft = intersectBox(nodes_[index + 1].box, ray.origin, invDirection, hit.distance, tLeft);
+      const bool isRight = intersectBox(nodes_[node.offset].box, ray.origin, invDirection, hit.distance, tRight);
+      if (isLeft && isRight) {
+        if (tLeft <= tRight) {
+          stack[stackSize++] = std::make_pair(node.offset, tRight);
+          stack[stackSize++] = std::make_pair(index + 1, tLeft);
+        }
+        else {
+          stack[stackSize++] = std::make_pair(index + 1, tLeft);
+          stack[stackSize++] = std::make_pair(node.offset, tRight);
+        }
+      }
+      else if (isLeft) {
+        stack[stackSize++] = std::make_pair(index + 1, tLeft);
+      }
+      else if (isRight) {
+        stack[stackSize++] = std::make_pair(node.offset, tRight);
+      }
+      continue;
+    }
+
+    // ray-triangle tests (cf. Moeller & Trumbore, 1997)
+    for (GLuint i = node.offset; i < node.offset + node.count; ++i) {
+      const Triangle_& triangle = triangles_[i];
+      const glm::vec3 p = glm::cross(ray.direction, triangle.e2);
+      const GLfloat det = glm::dot(triangle.e1, p);
+      if (det == 0.0f) {
+        continue;
+      }
+      const GLfloat invDet = 1.0f / det;
+      const glm::vec3 s = ray.origin - triangle.v0;
+      const GLfloat u = glm::dot(s, p) * invDet;
+      if (u < 0.0f || u > 1.0f) {
+        continue;
+      }
+      const glm::vec3 q = glm::cross(s, triangle.e1);
+      const GLfloat v = glm::dot(ray.direction, q) * invDet;
+      if (v < 0.0f || u + v > 1.0f) {
+        continue;
+      }
+      const GLfloat t = glm::dot(triangle.e2, q) * invDet;
+      if (t > 0.0f && t < hit.distance) {
+        hit.triangle = static_cast<int>(triangle.index);
+        hit.distance = t;
+        hit.barycentric = glm::vec3(1.0f - u - v, u, v);
+        isFound = true;
+      }
+    }
+  }
+  return isFound;
+}
+
+
+void TriangleBVH::intersect(const Ray* rays, size_t nRays, RayHit* hits) const {
+  for (size_t i = 0; i < nRays; i += 4) {
+    intersectPacket_(rays + i, std::min(nRays - i, static_cast<size_t>(4)), hits + i);
+  }
+}
+
+
+void TriangleBVH::build_(std::vector<Triangle_>& triangles) {
+  nodes_.clear();
+  triangles_.clear();
+  const size_t nTriangles = triangles.size();
+  if (nTriangles == 0) {
+    return;
+  }
+  std::vector<AABB> boxes(nTriangles);
+  std::vector<glm::vec3> centroids(nTriangles);
+  std::vector<GLuint> order(nTriangles);
+  for (size_t i = 0; i < nTriangles; ++i) {
+    const Triangle_& triangle = triangles[i];
+    boxes[i].extend(triangle.v0);
+    boxes[i].extend(triangle.v0 + triangle.e1);
+    boxes[i].extend(triangle.v0 + triangle.e2);
+    centroids[i] = boxes[i].getCenter();
+    order[i] = static_cast<GLuint>(i);
+  }
+  nodes_.reserve(2 * nTriangles / MAX_LEAF_SIZE + 1);
+  triangles_.reserve(nTriangles);
+
+  // build top-down in depth-first order, i.e., left child follows its parent directly
+  struct Task {
+    int parent;
+    int depth;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Task> tasks;
+  tasks.push_back({ -1, 0, 0, nTriangles });
+  while (!tasks.empty()) {
+    const Task task = tasks.back();
+    tasks.pop_back();
+    const GLuint index = static_cast<GLuint>(nodes_.size());
+    if (task.parent >= 0 && index != static_cast<GLuint>(task.parent) + 1) {
+      nodes_[task.parent].offset = index;   // right child
+    }
+    AABB box;
+    AABB centroidBox;
+    for (size_t i = task.begin; i < task.end; ++i) {
+      box.extend(boxes[order[i]]);
+      centroidBox.extend(centroids[order[i]]);
+    }
+    nodes_.push_back({ box, 0, 0 });
+
+    // split along axis of largest centroid extent, using binned SAH
+    const size_t count = task.end - task.begin;
+    size_t mid = task.begin;
+    const glm::vec3 extent = centroidBox.max - centroidBox.min;
+    const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    if (count > MAX_LEAF_SIZE && task.depth < MAX_DEPTH && extent[axis] > 0.0f) {
+      const GLfloat scale = N_SAH_BINS / extent[axis];
+      const GLfloat origin = centroidBox.min[axis];
+      auto getBin = [&](GLuint triangle) {
+        return std::min(static_cast<int>((centroids[triangle][axis] - origin) * scale), N_SAH_BINS - 1);
+      };
+      AABB binBoxes[N_SAH_BINS];
+      size_t binCounts[N_SAH_BINS] = { 0 };
+      for (size_t i = task.begin; i < task.end; ++i) {
+        const int bin = getBin(order[i]);
+        binBoxes[bin].extend(boxes[order[i]]);
+        ++binCounts[bin];
+      }
+      GLfloat rightCosts[N_SAH_BINS];
+      AABB sweepBox;
+      size_t sweepCount = 0;
+      for (int bin = N_SAH_BINS - 1; bin > 0; --bin) {
+        sweepBox.extend(binBoxes[bin]);
+        sweepCount += binCounts[bin];
+        rightCosts[bin - 1] = sweepBox.getSurfaceArea() * sweepCount;
+      }
+      int bestBin = -1;
+      GLfloat bestCost = box.getSurfaceArea() * count;   // cost of leaf
+      sweepBox = AABB();
+      sweepCount = 0;
+      for (int bin = 0; bin < N_SAH_BINS - 1; ++bin) {
+        sweepBox.extend(binBoxes[bin]);
+        sweepCount += binCounts[bin];
+        const GLfloat cost = sweepBox.getSurfaceArea() * sweepCount + rightCosts[bin];
+        if (sweepCount > 0 && sweepCount < count && cost < bestCost) {
+          bestCost = cost;
+          bestBin = bin;
+        }
+      }
+      if (bestBin >= 0) {
+        mid = std::partition(order.begin() + task.begin, order.begin() + task.end,
+            [&](GLuint triangle) { return getBin(triangle) <= bestBin; }) - order.begin();
+      }
+      else {
+        // SAH prefers a leaf, split at median anyway to bound leaf size
+        mid = task.begin + count / 2;
+        std::nth_element(order.begin() + task.begin, order.begin() + mid, order.begin() + task.end,
+            [&](GLuint a, GLuint b) { return centroids[a][axis] < centroids[b][axis]; });
+      }
+    }
+
+    if (mid == task.begin) {
+      // leaf: append triangles in leaf order
+      nodes_[index].offset = static_cast<GLuint>(triangles_.size());
+      nodes_[index].count = static_cast<GLuint>(count);
+      for (size_t i = task.begin; i < task.end; ++i) {
+        triangles_.push_back(triangles[order[i]]);
+      }
+    }
+    else {
+      tasks.push_back({ static_cast<int>(index), task.depth + 1, mid, task.end });
+      tasks.push_back({ static_cast<int>(index), task.depth + 1, task.begin, mid });
+    }
+  }
+}
+
+
+#ifdef SCG_TRIANGLEBVH_USE_SSE
+
+void TriangleBVH::intersectPacket_(const Ray* rays, size_t nRays, RayHit* hits) const {
+  if (nodes_.empty()) {
+    return;
+  }
+  assert(nRays <= 4);
+
+  // load rays in structure-of-arrays layout, unused lanes never hit anything
+  alignas(16) GLfloat data[7][4];
+  for (size_t i = 0; i < 4; ++i) {
+    const bool isUsed = i < nRays;
+    for (int j = 0; j < 3; ++j) {
+      data[j][i] = isUsed ? rays[i].origin[j] : 0.0f;
+      data[3 + j][i] = isUsed ? rays[i].direction[j] : 1.0f;
+    }
+    data[6][i] = isUsed ? hits[i].distance : -1.0f;
+  }
+  const __m128 ox = _mm_load_ps(data[0]);
+  const __m128 oy = _mm_load_ps(data[1]);
+  const __m128 oz = _mm_load_ps(data[2]);
+  const __m128 dx = _mm_load_ps(data[3]);
+  const __m128 dy = _mm_load_ps(data[4]);
+  const __m128 dz = _mm_load_ps(data[5]);
+  __m128 tMax = _mm_load_ps(data[6]);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 idx = _mm_div_ps(one, dx);
+  const __m128 idy = _mm_div_ps(one, dy);
+  const __m128 idz = _mm_div_ps(one, dz);
+  int hitTriangles[4] = { -1, -1, -1, -1 };
+  alignas(16) GLfloat u[4], v[4], hitU[4], hitV[4];
+
+  // depth-first traversal as long as any ray of the packet intersects the node
+  GLuint stack[STACK_SIZE];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0) {
+    const GLuint index = stack[--stackSize];
+    const Node_& node = nodes_[index];
+    const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.min.x), ox), idx);
+    const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.max.x), ox), idx);
+    const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.min.y), oy), idy);
+    const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.max.y), oy), idy);
+    const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.min.z), oz), idz);
+    const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.box.max.z), oz), idz);
+    const __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+        _mm_max_ps(_mm_min_ps(tz0, tz1), zero));
+    const __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+        _mm_min_ps(_mm_max_ps(tz0, tz1), tMax));
+    if (_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) == 0) {
+      continue;
+    }
+    if (node.count == 0) {
+      stack[stackSize++] = node.offset;
+      stack[stackSize++] = index + 1;
+      continue;
+    }
+
+    // ray-triangle tests of four rays at once (cf. Moeller & Trumbore, 1997)
+    for (GLuint i = node.offset; i < node.offset + node.count; ++i) {
+      const Triangle_& triangle = triangles_[i];
+      const __m128 e1x = _mm_set1_ps(triangle.e1.x);
+      const __m128 e1y = _mm_set1_ps(triangle.e1.y);
+      const __m128 e1z = _mm_set1_ps(triangle.e1.z);
+      const __m128 e2x = _mm_set1_ps(triangle.e2.x);
+      const __m128 e2y = _mm_set1_ps(triangle.e2.y);
+      const __m128 e2z = _mm_set1_ps(triangle.e2.z);
+      const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+      const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+      const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+      const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+      const __m128 invDet = _mm_div_ps(one, det);
+      const __m128 sx = _mm_sub_ps(ox, _mm_set1_ps(triangle.v0.x));
+      const __m128 sy = _mm_sub_ps(oy, _mm_set1_ps(triangle.v0.y));
+      const __m128 sz = _mm_sub_ps(oz, _mm_set1_ps(triangle.v0.z));
+      const __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+      const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+      const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+      const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+      const __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+      const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+      const __m128 isValid = _mm_and_ps(
+          _mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_cmpge_ps(uu, zero)),
+              _mm_and_ps(_mm_cmpge_ps(vv, zero), _mm_cmple_ps(_mm_add_ps(uu, vv), one))),
+          _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, tMax)));
+      const int mask = _mm_movemask_ps(isValid);
+      if (mask == 0) {
+        continue;
+      }
+      tMax = _mm_or_ps(_mm_and_ps(isValid, t), _mm_andnot_ps(isValid, tMax));
+      _mm_store_ps(u, uu);
+      _mm_store_ps(v, vv);
+      for (int lane = 0; lane < 4; ++lane) {
+        if (mask & (1 << lane)) {
+          hitTriangles[lane] = static_cast<int>(triangle.index);
+          hitU[lane] = u[lane];
+          hitV[lane] = v[lane];
+        }
+      }
+    }
+  }
+
+  // store nearest intersections
+  _mm_store_ps(data[6], tMax);
+  for (size_t i = 0; i < nRays; ++i) {
+    if (hitTriangles[i] >= 0) {
+      hits[i].triangle = hitTriangles[i];
+      hits[i].distance = data[6][i];
+      hits[i].barycentric = glm::vec3(1.0f - hitU[i] - hitV[i], hitU[i], hitV[i]);
+    }
+  }
+}
+
+#else
+
+void TriangleBVH::intersectPacket_(const Ray* rays, size_t nRays, RayHit* hits) const {
+  for (size_t i = 0; i < nRays; ++i) {
+    intersect(rays[i], hits[i]);
+  }
+}
+
+#endif
+
+
+} /* namespace scg */
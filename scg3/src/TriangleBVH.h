@@ -0,0 +1,186 @@
+/**
+ * \file TriangleBVH.h
+ * \brief A bounding volume hierarchy over the triangles of a mesh, to be used for
+ *    ray intersection tests (picking).
+ *
+ * Defines struct:
+ *   RayHit
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRIANGLEBVH_H_
+#define TRIANGLEBVH_H_
+
+#include <cfloat>
+#include <vector>
+#include "scg_glew.h"
+#include "BoundingVolume.h"
+#include "scg_glm.h"
+#include "scg_internals.h"
+
+namespace scg {
+
+
+/**
+ * \brief Nearest intersection of a ray with a triangle mesh.
+ */
+struct RayHit {
+
+  /**
+   * Constructor, creates hit at infinite distance, i.e., no hit.
+   */
+  RayHit()
+      : shape(nullptr), instance(-1), triangle(-1), distance(FLT_MAX), barycentric(0.0f) {
+  }
+
+  bool isHit() const {
+    return triangle >= 0;
+  }
+
+  Shape* shape;             // shape that has been hit, set by BVH::intersect()
+  int instance;             // index of instance of InstancedShape that has been hit, -1 otherwise
+  int triangle;             // index of triangle in drawing order, -1 if no hit
+  GLfloat distance;         // ray parameter of intersection point
+  glm::vec3 barycentric;    // barycentric coordinates of intersection point w.r.t. triangle vertices
+
+};
+
+
+/**
+ * \brief A bounding volume hierarchy over the triangles of a mesh, to be used for
+ *    ray intersection tests (picking).
+ *
+ * The hierarchy is built once using the surface area heuristic. The nodes are stored
+ * in depth-first order, such that the left child directly follows its parent, and the
+ * triangles are stored in leaf order, each one as a vertex and two edge vectors to be
+ * used by the ray-triangle test.
+ *
+ * Batches of rays are processed in packets of four rays, using SSE instructions
+ * if available.
+ */
+class TriangleBVH {
+
+public:
+
+  /**
+   * Constructor.
+   * \param positions vertex positions
+   * \param indices element indices, empty if vertices are drawn in order (DrawMode::ARRAYS)
+   * \param primitiveType GL_TRIANGLES, GL_TRIANGLE_STRIP, or GL_TRIANGLE_FAN
+   */
+  TriangleBVH(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices,
+      GLenum primitiveType);
+
+  /**
+   * Destructor.
+   */
+  virtual ~TriangleBVH();
+
+  /**
+   * Create shared pointer.
+   */
+  static TriangleBVHSP create(const std::vector<glm::vec3>& positions,
+      const std::vector<GLuint>& indices, GLenum primitiveType);
+
+  /**
+   * Get number of triangles.
+   */
+  size_t getNTriangles() const;
+
+  /**
+   * Get vertices of triangle, triangles are stored in leaf order.
+   * \param index triangle index in [0, getNTriangles())
+   */
+  void getTriangle(size_t index, glm::vec3& v0, glm::vec3& v1, glm::vec3& v2) const {
+    const Triangle_& triangle = triangles_[index];
+    v0 = triangle.v0;
+    v1 = triangle.v0 + triangle.e1;
+    v2 = triangle.v0 + triangle.e2;
+  }
+
+  /**
+   * Get bounding box of all triangles.
+   */
+  AABB getBoundingBox() const;
+
+  /**
+   * Find nearest intersection of ray with the triangles that is closer than hit.distance.
+   * \param ray ray in model coordinates
+   * \param hit updated if a closer intersection has been found (except for hit.shape)
+   * \return true if a closer intersection has been found
+   */
+  bool intersect(const Ray& ray, RayHit& hit) const;
+
+  /**
+   * Find nearest intersections of a batch of rays, processed in packets of four rays.
+   * \param rays rays in model coordinates
+   * \param nRays number of rays
+   * \param hits updated if closer intersections have been found (except for hit.shape)
+   */
+  void intersect(const Ray* rays, size_t nRays, RayHit* hits) const;
+
+protected:
+
+  /**
+   * \brief Tree node, leaf if count > 0.
+   */
+  struct Node_ {
+    AABB box;
+    GLuint offset;      // right child for inner node, first triangle for leaf
+    GLuint count;       // number of triangles, 0 for inner node
+  };
+
+  /**
+   * \brief Triangle prepared for ray-triangle test.
+   */
+  struct Triangle_ {
+    glm::vec3 v0;
+    glm::vec3 e1;       // v1 - v0
+    glm::vec3 e2;       // v2 - v0
+    GLuint index;       // index in drawing order
+  };
+
+  /**
+   * Maximum number of triangles per leaf.
+   */
+  static const GLuint MAX_LEAF_SIZE = 4;
+
+  /**
+   * Build hierarchy over the given triangles.
+   */
+  void build_(std::vector<Triangle_>& triangles);
+
+  /**
+   * Intersect packet of up to four rays.
+   */
+  void intersectPacket_(const Ray* rays, size_t nRays, RayHit* hits) const;
+
+protected:
+
+  std::vector<Node_> nodes_;
+  std::vector<Triangle_> triangles_;
+
+};
+
+
+} /* namespace scg */
+
+#endif /* TRIANGLEBVH_H_ */
@@ -0,0 +1,358 @@
+/**
+ * \file VertexQuantizer.cpp
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "VertexQuantizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCG_VERTEXQUANTIZER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace scg {
+
+
+namespace {
+
+/**
+ * Convert float into half float, rounding to nearest even
+ * (cf. F. Giesen, "float->half variants", 2016).
+ */
+GLushort floatToHalf(GLfloat value) {
+  GLuint u;
+  memcpy(&u, &value, sizeof(u));
+  const GLuint sign = u & 0x80000000u;
+  u ^= sign;
+  GLuint h;
+  if (u >= (127u + 16u) << 23) {
+    // overflow to infinity, keep NaN
+    h = (u > 255u << 23) ? 0x7e00u : 0x7c00u;
+  }
+  else if (u < 113u << 23) {
+    // denormal or zero, let the float addition round the mantissa
+    const GLuint magicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    GLfloat magic, f;
+    memcpy(&magic, &magicBits, sizeof(magic));
+    memcpy(&f, &u, sizeof(f));
+    f += magic;
+    memcpy(&h, &f, sizeof(h));
+    h -= magicBits;
+  }
+  else {
+    // rebias exponent and round mantissa
+    const GLuint mantissaOdd = (u >> 13) & 1u;
+    h = (u + (static_cast<GLuint>(15 - 127) << 23) + 0xfffu + mantissaOdd) >> 13;
+  }
+  return static_cast<GLushort>(h | (sign >> 16));
+}
+
+#ifndef SCG_VERTEXQUANTIZER_USE_SSE2
+
+/**
+ * Convert signed normalized value into 10-bit or 2-bit integer.
+ */
+GLint toSnorm(GLfloat value, GLfloat scale) {
+  return static_cast<GLint>(std::lrint(std::min(std::max(value, -1.0f), 1.0f) * scale));
+}
+
+#endif
+
+/**
+ * Pack 10-10-10-2 components, each in two's complement.
+ */
+GLuint packSnorm1010102(GLint x, GLint y, GLint z, GLint w) {
+  return (static_cast<GLuint>(x) & 0x3ffu) | (static_cast<GLuint>(y) & 0x3ffu) << 10
+      | (static_cast<GLuint>(z) & 0x3ffu) << 20 | (static_cast<GLuint>(w) & 0x3u) << 30;
+}
+
+/**
+ * Unpack component of the given number of bits in two's complement.
+ */
+GLint unpackSnorm(GLuint bits, GLuint nBits) {
+  const GLint value = static_cast<GLint>(bits & ((1u << nBits) - 1u));
+  return value >= (1 << (nBits - 1)) ? value - (1 << nBits) : value;
+}
+
+}
+
+
+bool VertexQuantizer::isSupported(VertexFormat format) {
+  if (format == VertexFormat::SNORM_10_10_10_2) {
+    return GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev;
+  }
+  return true;
+}
+
+
+GLenum VertexQuantizer::getType(VertexFormat format) {
+  switch (format) {
+  case VertexFormat::HALF:
+    return GL_HALF_FLOAT;
+  case VertexFormat::SNORM_10_10_10_2:
+    return GL_INT_2_10_10_10_REV;
+  case VertexFormat::UNORM_8:
+    return GL_UNSIGNED_BYTE;
+  default:
+    return GL_FLOAT;
+  }
+}
+
+
+GLboolean VertexQuantizer::isNormalized(VertexFormat format) {
+  return (format == VertexFormat::SNORM_10_10_10_2 || format == VertexFormat::UNORM_8) ?
+      GL_TRUE : GL_FALSE;
+}
+
+
+GLint VertexQuantizer::getNComponents(VertexFormat format, GLint dim) {
+  return (format == VertexFormat::SNORM_10_10_10_2) ? 4 : dim;
+}
+
+
+GLsizei VertexQuantizer::getSize(VertexFormat format, GLint dim) {
+  switch (format) {
+  case VertexFormat::HALF:
+    return (2 * dim + 3) / 4 * 4;
+  case VertexFormat::SNORM_10_10_10_2:
+    return 4;
+  case VertexFormat::UNORM_8:
+    return (dim + 3) / 4 * 4;
+  default:
+    return dim * static_cast<GLsizei>(sizeof(GLfloat));
+  }
+}
+
+
+void VertexQuantizer::toHalf(const GLfloat* values, size_t n, GLushort* halfs) {
+  size_t i = 0;
+#ifdef SCG_VERTEXQUANTIZER_USE_SSE2
+  // same steps as floatToHalf() for four values, selecting the result by masks
+  const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+  const __m128i halfMax = _mm_set1_epi32(((127 + 16) << 23) - 1);
+  const __m128i floatInf = _mm_set1_epi32(255 << 23);
+  const __m128i halfInf = _mm_set1_epi32(0x7c00);
+  const __m128i halfNaN = _mm_set1_epi32(0x0200);
+  const __m128i normalMin = _mm_set1_epi32(113 << 23);
+  const __m128i magicBits = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+  const __m128i rebias = _mm_set1_epi32(static_cast<int>((static_cast<GLuint>(15 - 127) << 23) + 0xfffu));
+  const __m128i one = _mm_set1_epi32(1);
+  for (; i + 4 <= n; i += 4) {
+    __m128i u = _mm_castps_si128(_mm_loadu_ps(values + i));
+    const __m128i sign = _mm_and_si128(u, signMask);
+    u = _mm_xor_si128(u, sign);
+    const __m128i isInfNaN = _mm_cmpgt_epi32(u, halfMax);
+    const __m128i infNaN = _mm_or_si128(halfInf, _mm_and_si128(_mm_cmpgt_epi32(u, floatInf), halfNaN));
+    const __m128i isDenormal = _mm_cmplt_epi32(u, normalMin);
+    const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(u),
+        _mm_castsi128_ps(magicBits))), magicBits);
+    const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(u, 13), one);
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(u, rebias), mantissaOdd), 13);
+    __m128i h = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+    h = _mm_or_si128(_mm_and_si128(isInfNaN, infNaN), _mm_andnot_si128(isInfNaN, h));
+    h = _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+    // sign-extend to pack 16-bit values without saturation
+    h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(halfs + i), _mm_packs_epi32(h, h));
+  }
+#endif
+  for (; i < n; ++i) {
+    halfs[i] = floatToHalf(values[i]);
+  }
+}
+
+
+void VertexQuantizer::fromHalf(const GLushort* halfs, size_t n, GLfloat* values) {
+  for (size_t i = 0; i < n; ++i) {
+    const GLuint h = halfs[i];
+    const GLuint sign = (h & 0x8000u) << 16;
+    const GLuint exponent = (h >> 10) & 0x1fu;
+    const GLuint mantissa = h & 0x3ffu;
+    if (exponent == 0) {
+      // zero or denormal
+      const GLfloat value = std::ldexp(static_cast<GLfloat>(mantissa), -24);
+      values[i] = sign ? -value : value;
+    }
+    else {
+      const GLuint u = sign | ((exponent == 0x1fu) ? 0x7f800000u : (exponent + 112u) << 23)
+          | mantissa << 13;
+      memcpy(&values[i], &u, sizeof(u));
+    }
+  }
+}
+
+
+void VertexQuantizer::toSnorm1010102(const GLfloat* values, GLint dim, size_t n, GLuint* packed) {
+  assert(dim >= 1 && dim <= 4);
+#ifdef SCG_VERTEXQUANTIZER_USE_SSE2
+  // clamp and round x, y, z, w at once
+  const __m128 minValue = _mm_set1_ps(-1.0f);
+  const __m128 maxValue = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_setr_ps(511.0f, 511.0f, 511.0f, 1.0f);
+  alignas(16) GLfloat vector[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  alignas(16) GLint c[4];
+  for (size_t i = 0; i < n; ++i) {
+    __m128 v;
+    if (dim == 4) {
+      v = _mm_loadu_ps(values + 4 * i);
+    }
+    else {
+      memcpy(vector, values + i * dim, dim * sizeof(GLfloat));
+      v = _mm_load_ps(vector);
+    }
+    v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, minValue), maxValue), scale);
+    _mm_store_si128(reinterpret_cast<__m128i*>(c), _mm_cvtps_epi32(v));
+    packed[i] = packSnorm1010102(c[0], c[1], c[2], c[3]);
+  }
+#else
+  for (size_t i = 0; i < n; ++i) {
+    const GLfloat* v = values + i * dim;
+    packed[i] = packSnorm1010102(toSnorm(v[0], 511.0f), dim > 1 ? toSnorm(v[1], 511.0f) : 0,
+        dim > 2 ? toSnorm(v[2], 511.0f) : 0, dim > 3 ? toSnorm(v[3], 1.0f) : 0);
+  }
+#endif
+}
+
+
+void VertexQuantizer::toUnorm8(const GLfloat* values, GLint dim, size_t n, GLuint* packed) {
+  assert(dim >= 1 && dim <= 4);
+#ifdef SCG_VERTEXQUANTIZER_USE_SSE2
+  // clamp, round, and narrow four components into four bytes
+  const __m128 minValue = _mm_setzero_ps();
+  const __m128 maxValue = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  alignas(16) GLfloat vector[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  for (size_t i = 0; i < n; ++i) {
+    __m128 v;
+    if (dim == 4) {
+      v = _mm_loadu_ps(values + 4 * i);
+    }
+    else {
+      memcpy(vector, values + i * dim, dim * sizeof(GLfloat));
+      v = _mm_load_ps(vector);
+    }
+    const __m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, minValue), maxValue), scale));
+    const __m128i c16 = _mm_packs_epi32(c, c);
+    packed[i] = static_cast<GLuint>(_mm_cvtsi128_si32(_mm_packus_epi16(c16, c16)));
+  }
+#else
+  for (size_t i = 0; i < n; ++i) {
+    GLubyte bytes[4] = { 0, 0, 0, 0 };
+    for (GLint k = 0; k < dim; ++k) {
+      bytes[k] = static_cast<GLubyte>(std::lrint(
+          std::min(std::max(values[i * dim + k], 0.0f), 1.0f) * 255.0f));
+    }
+    memcpy(&packed[i], bytes, sizeof(GLuint));
+  }
+#endif
+}
+
+
+void VertexQuantizer::quantize(VertexFormat format, const GLfloat* values, GLint dim,
+    size_t nVertices, GLubyte* data, GLsizei stride) {
+  switch (format) {
+  case VertexFormat::HALF: {
+    std::vector<GLushort> halfs(nVertices * dim);
+    toHalf(values, halfs.size(), halfs.data());
+    for (size_t i = 0; i < nVertices; ++i) {
+      memcpy(data + i * stride, halfs.data() + i * dim, dim * sizeof(GLushort));
+    }
+    break;
+  }
+  case VertexFormat::SNORM_10_10_10_2:
+  case VertexFormat::UNORM_8: {
+    std::vector<GLuint> packed(nVertices);
+    if (format == VertexFormat::UNORM_8) {
+      toUnorm8(values, dim, nVertices, packed.data());
+    }
+    else {
+      toSnorm1010102(values, dim, nVertices, packed.data());
+    }
+    for (size_t i = 0; i < nVertices; ++i) {
+      memcpy(data + i * stride, &packed[i], sizeof(GLuint));
+    }
+    break;
+  }
+  default:
+    for (size_t i = 0; i < nVertices; ++i) {
+      memcpy(data + i * stride, values + i * dim, dim * sizeof(GLfloat));
+    }
+    break;
+  }
+}
+
+
+void VertexQuantizer::dequantize(VertexFormat format, const GLubyte* data, GLsizei stride,
+    GLint dim, size_t nVertices, GLfloat* values) {
+  for (size_t i = 0; i < nVertices; ++i) {
+    const GLubyte* vertex = data + i * stride;
+    GLfloat* value = values + i * dim;
+    switch (format) {
+    case VertexFormat::HALF: {
+      GLushort halfs[4];
+      memcpy(halfs, vertex, dim * sizeof(GLushort));
+      fromHalf(halfs, dim, value);
+      break;
+    }
+    case VertexFormat::SNORM_10_10_10_2: {
+      GLuint packed;
+      memcpy(&packed, vertex, sizeof(packed));
+      const GLint c[4] = { unpackSnorm(packed, 10), unpackSnorm(packed >> 10, 10),
+          unpackSnorm(packed >> 20, 10), unpackSnorm(packed >> 30, 2) };
+      for (GLint k = 0; k < dim; ++k) {
+        value[k] = std::max(static_cast<GLfloat>(c[k]) / (k < 3 ? 511.0f : 1.0f), -1.0f);
+      }
+      break;
+    }
+    case VertexFormat::UNORM_8:
+      for (GLint k = 0; k < dim; ++k) {
+        value[k] = static_cast<GLfloat>(vertex[k]) / 255.0f;
+      }
+      break;
+    default:
+      memcpy(value, vertex, dim * sizeof(GLfloat));
+      break;
+    }
+  }
+}
+
+
+void VertexQuantizer::computeSignedTangents(const GLfloat* normals, const GLfloat* tangents,
+    const GLfloat* binormals, size_t nVertices, GLfloat* signedTangents) {
+  for (size_t i = 0; i < nVertices; ++i) {
+    const GLfloat* n = normals + 3 * i;
+    const GLfloat* t = tangents + 3 * i;
+    const GLfloat* b = binormals + 3 * i;
+    const GLfloat handedness = (n[1] * t[2] - n[2] * t[1]) * b[0]
+        + (n[2] * t[0] - n[0] * t[2]) * b[1] + (n[0] * t[1] - n[1] * t[0]) * b[2];
+    GLfloat* result = signedTangents + 4 * i;
+    memcpy(result, t, 3 * sizeof(GLfloat));
+    result[3] = (handedness < 0.0f) ? -1.0f : 1.0f;
+  }
+}
+
+
+} /* namespace scg */
@@ -0,0 +1,157 @@
+/**
+ * \file VertexQuantizer.h
+ * \brief Compressed vertex attribute formats and conversion of float values into them.
+ *
+ * Defines enum:
+ *   VertexFormat
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VERTEXQUANTIZER_H_
+#define VERTEXQUANTIZER_H_
+
+#include <cstddef>
+#include "scg_glew.h"
+
+namespace scg {
+
+
+/**
+ * Storage format of a vertex attribute in a vertex buffer object. The values of a vertex
+ * are padded to a multiple of 4 bytes.
+ */
+enum class VertexFormat {
+  FLOAT,              // 32-bit floats (GL_FLOAT), 4 bytes per component
+  HALF,               // 16-bit floats (GL_HALF_FLOAT), 2 bytes per component, e.g., for
+                      //   positions and texture coordinates
+  SNORM_10_10_10_2,   // signed normalized 10-bit x, y, z and 2-bit w (GL_INT_2_10_10_10_REV),
+                      //   4 bytes, e.g., for normals and tangents with binormal sign as w
+  UNORM_8             // unsigned normalized bytes (GL_UNSIGNED_BYTE), 1 byte per component,
+                      //   e.g., for colors
+};
+
+
+/**
+ * \brief Conversion of float vertex attribute values into compressed vertex formats
+ *    and back.
+ *
+ * The conversion functions process four values at a time with SSE2 instructions if
+ * available. Values outside of the range of a normalized format are clamped, signed
+ * normalized values c are converted into max(c / 511, -1) as defined by OpenGL 4.2,
+ * which differs by less than 1/1023 from the conversion of earlier versions.
+ */
+class VertexQuantizer {
+
+public:
+
+  /**
+   * Check if the current OpenGL context supports a vertex format.
+   * VertexFormat::SNORM_10_10_10_2 requires OpenGL 3.3 or the extension
+   * ARB_vertex_type_2_10_10_10_rev.
+   */
+  static bool isSupported(VertexFormat format);
+
+  /**
+   * Get OpenGL type of a vertex format, e.g., to be passed to glVertexAttribPointer().
+   */
+  static GLenum getType(VertexFormat format);
+
+  /**
+   * Check if a vertex format is normalized.
+   */
+  static GLboolean isNormalized(VertexFormat format);
+
+  /**
+   * Get number of components to be passed to glVertexAttribPointer() for the given
+   * number of attribute components, i.e., 4 for VertexFormat::SNORM_10_10_10_2.
+   */
+  static GLint getNComponents(VertexFormat format, GLint dim);
+
+  /**
+   * Get size of the values of a vertex in bytes, padded to a multiple of 4 bytes.
+   */
+  static GLsizei getSize(VertexFormat format, GLint dim);
+
+  /**
+   * Convert floats into half floats, rounding to nearest even.
+   */
+  static void toHalf(const GLfloat* values, size_t n, GLushort* halfs);
+
+  /**
+   * Convert half floats into floats.
+   */
+  static void fromHalf(const GLushort* halfs, size_t n, GLfloat* values);
+
+  /**
+   * Pack vectors into signed normalized 10-10-10-2 values (GL_INT_2_10_10_10_REV).
+   * \param values dim values per vector, w = 0 if dim < 4
+   * \param dim number of components (1 to 4)
+   * \param n number of vectors
+   * \param packed one value per vector
+   */
+  static void toSnorm1010102(const GLfloat* values, GLint dim, size_t n, GLuint* packed);
+
+  /**
+   * Pack vectors into unsigned normalized bytes, e.g., RGBA colors.
+   * \param values dim values per vector, unused bytes are set to 0
+   * \param dim number of components (1 to 4)
+   * \param n number of vectors
+   * \param packed one value per vector
+   */
+  static void toUnorm8(const GLfloat* values, GLint dim, size_t n, GLuint* packed);
+
+  /**
+   * Convert attribute values into a vertex format and write them into interleaved vertices.
+   * \param format vertex format
+   * \param values dim values per vertex
+   * \param dim number of components
+   * \param nVertices number of vertices
+   * \param data address of the attribute of the first vertex
+   * \param stride size of a vertex in bytes
+   */
+  static void quantize(VertexFormat format, const GLfloat* values, GLint dim, size_t nVertices,
+      GLubyte* data, GLsizei stride);
+
+  /**
+   * Read attribute values of a vertex format from interleaved vertices (cf. quantize()).
+   */
+  static void dequantize(VertexFormat format, const GLubyte* data, GLsizei stride, GLint dim,
+      size_t nVertices, GLfloat* values);
+
+  /**
+   * Combine tangents and binormals into tangents with the sign of the binormal as fourth
+   * component, such that binormal = sign * cross(normal, tangent), e.g., to be stored as
+   * VertexFormat::SNORM_10_10_10_2 instead of separate tangents and binormals.
+   * \param normals 3 values per vertex
+   * \param tangents 3 values per vertex
+   * \param binormals 3 values per vertex
+   * \param nVertices number of vertices
+   * \param signedTangents returns 4 values per vertex
+   */
+  static void computeSignedTangents(const GLfloat* normals, const GLfloat* tangents,
+      const GLfloat* binormals, size_t nVertices, GLfloat* signedTangents);
+
+};
+
+
+} /* namespace scg */
+
+#endif /* VERTEXQUANTIZER_H_ */
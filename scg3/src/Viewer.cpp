@@ -35,6 +35,7 @@
 #include "Node.h"
 #include "PerspectiveCamera.h"
 #include "Renderer.h"
+#include "RenderState.h"
 #include "ShaderCore.h"
 #include "ShaderCoreFactory.h"
 #include "StandardRenderer.h"
@@ -277,6 +278,20 @@ void Viewer::startMainLoop() {
 }
 
 
+bool Viewer::pick(double x, double y, RayHit& hit) {
+  assert(renderer_);
+  return renderer_->pick(x, y, hit);
+}
+
+
+bool Viewer::pickAtCursor(RayHit& hit) {
+  assert(window_);
+  double x, y;
+  glfwGetCursorPos(window_, &x, &y);
+  return pick(x, y, hit);
+}
+
+
 void Viewer::createWindow_(const char* title, int width, int height, bool fullscreenMode) {
   if (!renderer_) {
     throw std::runtime_error("Undefined renderer, call Viewer::init() first [Viewer::createWindow_()]");
@@ -356,7 +371,7 @@ void Viewer::errorCB_(int error, const char* description) {
 
 
 void Viewer::framebufferSizeCB_(GLFWwindow* window, int width, int height) {
-  glViewport(0, 0, width, height);
+  RenderState::glState.setViewport(0, 0, width, height);
   isWindowResized_ = true;
 
   assert(!checkGLError());
@@ -100,6 +100,9 @@ struct FrameBufferSize {
 };
 
 
+struct RayHit;
+
+
 /**
  * \brief Central viewer managing window, controllers, animations, and main loop.
  *
@@ -243,6 +246,21 @@ public:
    */
   void startMainLoop();
 
+  /**
+   * Find the nearest shape under the given window position (cf. Renderer::pick()).
+   * \param x,y window position in screen coordinates relative to the upper left corner
+   * \param hit nearest intersection
+   * \return true if a shape has been hit
+   */
+  bool pick(double x, double y, RayHit& hit);
+
+  /**
+   * Find the nearest shape under the mouse cursor (cf. Renderer::pick()).
+   * \param hit nearest intersection
+   * \return true if a shape has been hit
+   */
+  bool pickAtCursor(RayHit& hit);
+
 protected:
 
   /**
@@ -23,6 +23,7 @@
 
 #include <cassert>
 #include <sstream>
+#include "RenderState.h"
 #include "scg_internals.h"
 #include "scg_utilities.h"
 
@@ -36,11 +37,15 @@ const OGLAttrib OGLConstants::TEX_COORD_0 = { "vTexCoord0", 3 };
 const OGLAttrib OGLConstants::TEX_COORD_1 = { "vTexCoord1", 4 };
 const OGLAttrib OGLConstants::TANGENT = { "vTangent", 5 };
 const OGLAttrib OGLConstants::BINORMAL = { "vBinormal", 6 };
+const OGLAttrib OGLConstants::INSTANCE_COLOR = { "vInstanceColor", 7 };
+const OGLAttrib OGLConstants::INSTANCE_MATRIX = { "vInstanceMatrix", 8 };
 
 const OGLFragData OGLConstants::FRAG_COLOR = { "fragColor", 0 };
 
 const OGLUniformBlock OGLConstants::LIGHT = { "LightBlock", 0 };
 const OGLUniformBlock OGLConstants::MATERIAL = { "MaterialBlock", 1 };
+const OGLUniformBlock OGLConstants::FRAME = { "FrameBlock", 2 };
+const OGLUniformBlock OGLConstants::OBJECT = { "ObjectBlock", 3 };
 
 const char* OGLConstants::MODEL_VIEW_MATRIX = "modelViewMatrix";
 const char* OGLConstants::PROJECTION_MATRIX = "projectionMatrix";
@@ -64,6 +69,8 @@ void OGLConstants::bindAttribFragDataLocations(GLuint program) {
   glBindAttribLocation(program, TEX_COORD_1.location, TEX_COORD_1.name);
   glBindAttribLocation(program, TANGENT.location, TANGENT.name);
   glBindAttribLocation(program, BINORMAL.location, BINORMAL.name);
+  glBindAttribLocation(program, INSTANCE_COLOR.location, INSTANCE_COLOR.name);
+  glBindAttribLocation(program, INSTANCE_MATRIX.location, INSTANCE_MATRIX.name);
 
   glBindFragDataLocation(program, FRAG_COLOR.location, FRAG_COLOR.name);
 
@@ -80,11 +87,29 @@ void OGLConstants::bindUniformBlocks(GLuint program) {
   if (materialIndex != GL_INVALID_INDEX) {
     glUniformBlockBinding(program, materialIndex, MATERIAL.bindingPoint);
   }
+  GLuint frameIndex = glGetUniformBlockIndex(program, FRAME.name);
+  if (frameIndex != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, frameIndex, FRAME.bindingPoint);
+  }
+  GLuint objectIndex = glGetUniformBlockIndex(program, OBJECT.name);
+  if (objectIndex != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, objectIndex, OBJECT.bindingPoint);
+  }
 
   assert(!checkGLError());
 }
 
 
+const char* OGLConstants::getUniformName(OGLUniform uniform) {
+  static const char* names[] = { MODEL_VIEW_MATRIX, PROJECTION_MATRIX, MVP_MATRIX, NORMAL_MATRIX,
+      TEXTURE_MATRIX, COLOR_MATRIX, N_LIGHTS, GLOBAL_AMBIENT_LIGHT, TIME };
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(OGLUniform::COUNT),
+      "missing name of standard uniform");
+  assert(uniform < OGLUniform::COUNT);
+  return names[static_cast<size_t>(uniform)];
+}
+
+
 void OGLConstants::bindSamplers(GLuint program) {
   // glProgramUniform() is not used in order to keep OpenGL 3.2 compatibility
   SCG_SAVE_AND_SWITCH_PROGRAM(program, programOld);
@@ -25,10 +25,16 @@
 #ifndef SCG_INTERNALS_H_
 #define SCG_INTERNALS_H_
 
+#include <cstddef>
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <string>
 #include <utility>
 #include "scg_glew.h"
+#if defined _MSC_VER
+#include <malloc.h>
+#endif
 
 namespace scg {
 
@@ -144,38 +150,53 @@ namespace scg {
 
 SCG_DECLARE_CLASS(Animation);
 SCG_DECLARE_CLASS(BumpMapCore);
+SCG_DECLARE_CLASS(BVH);
 SCG_DECLARE_CLASS(Camera);
 SCG_DECLARE_CLASS(CameraController);
 SCG_DECLARE_CLASS(Composite);
 SCG_DECLARE_CLASS(Controller);
 SCG_DECLARE_CLASS(ColorCore);
+SCG_DECLARE_CLASS(CompiledScene);
 SCG_DECLARE_CLASS(Core);
+SCG_DECLARE_CLASS(CullingRenderTraverser);
 SCG_DECLARE_CLASS(CubeMapCore);
+SCG_DECLARE_CLASS(GeometryArena);
 SCG_DECLARE_CLASS(GeometryCore);
 SCG_DECLARE_CLASS(GeometryCoreFactory);
+SCG_DECLARE_CLASS(GLStateCache);
 SCG_DECLARE_CLASS(Group);
+SCG_DECLARE_CLASS(HardwareOcclusionCuller);
+SCG_DECLARE_CLASS(IndirectDrawBatch);
 SCG_DECLARE_CLASS(InfoTraverser);
+SCG_DECLARE_CLASS(InstancedShape);
 SCG_DECLARE_CLASS(KeyboardController);
 SCG_DECLARE_CLASS(Leaf);
 SCG_DECLARE_CLASS(Light);
 SCG_DECLARE_CLASS(LightPosition);
+SCG_DECLARE_CLASS(LOD);
 SCG_DECLARE_CLASS(MaterialCore);
+SCG_DECLARE_CLASS(MeshSimplifier);
 SCG_DECLARE_CLASS(MouseController);
 SCG_DECLARE_CLASS(Node);
+SCG_DECLARE_CLASS(OcclusionCuller);
 SCG_DECLARE_CLASS(OrthographicCamera);
 SCG_DECLARE_CLASS(PerspectiveCamera);
 SCG_DECLARE_CLASS(PreTraverser);
 SCG_DECLARE_CLASS(Renderer);
+SCG_DECLARE_CLASS(RenderQueue);
 SCG_DECLARE_CLASS(RenderState);
 SCG_DECLARE_CLASS(RenderTraverser);
+SCG_DECLARE_CLASS(RingBuffer);
 SCG_DECLARE_CLASS(ShaderCore);
 SCG_DECLARE_CLASS(ShaderCoreFactory);
 SCG_DECLARE_CLASS(Shape);
 SCG_DECLARE_CLASS(StandardRenderer);
+SCG_DECLARE_CLASS(StaticBatch);
 SCG_DECLARE_CLASS(TextureCore);
 SCG_DECLARE_CLASS(Texture2DCore);
 SCG_DECLARE_CLASS(TransformAnimation);
 SCG_DECLARE_CLASS(Transformation);
+SCG_DECLARE_CLASS(TriangleBVH);
 SCG_DECLARE_CLASS(Traverser);
 SCG_DECLARE_CLASS(Viewer);
 SCG_DECLARE_CLASS(ViewState);
@@ -197,16 +218,81 @@ SCG_DECLARE_CLASS(ViewState);
     void operator=(const TypeName&);
 
 
+/**
+ * \brief Allocator for standard containers that aligns memory to a given boundary,
+ * e.g., 16 bytes for SIMD access to vectors and matrices.
+ */
+template <typename T, size_t Alignment>
+class AlignedAllocator {
+
+public:
+
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  AlignedAllocator() {
+  }
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {
+  }
+
+  T* allocate(size_t n) {
+    void* ptr = nullptr;
+#if defined _MSC_VER
+    ptr = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+    if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0) {
+      ptr = nullptr;
+    }
+#endif
+    if (!ptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, size_t) {
+#if defined _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const {
+    return false;
+  }
+
+};
+
+
 /**
  * A macro to save the current shader program in _programOld and switch to a new
  * shader program _program, e.g., to set values of uniform variables;
  * to be used in combination with macro SCG_RESTORE_PROGRAM().
+ * The current program is taken from RenderState::glState (requires RenderState.h).
  */
 #define SCG_SAVE_AND_SWITCH_PROGRAM(_program, _programOld) \
-    GLuint _programOld; \
-    glGetIntegerv(GL_CURRENT_PROGRAM, reinterpret_cast<GLint*>(&_programOld)); \
+    const GLuint _programOld = scg::RenderState::glState.getProgram(); \
     if (_program != _programOld) { \
-      glUseProgram(_program); \
+      scg::RenderState::glState.useProgram(_program); \
     }
 
 
@@ -216,7 +302,7 @@ SCG_DECLARE_CLASS(ViewState);
  */
 #define SCG_RESTORE_PROGRAM(_program, _programOld) \
     if (_program != _programOld) { \
-      glUseProgram(_programOld); \
+      scg::RenderState::glState.useProgram(_programOld); \
     }
 
 
@@ -256,6 +342,24 @@ struct OGLSampler {
 };
 
 
+/**
+ * \brief Standard uniform variables, index into the table of uniform locations that
+ * ShaderCore fills at link time (cf. OGLConstants::getUniformName(), ShaderCore::getUniformHandle()).
+ */
+enum class OGLUniform: unsigned char {
+  MODEL_VIEW_MATRIX,
+  PROJECTION_MATRIX,
+  MVP_MATRIX,
+  NORMAL_MATRIX,
+  TEXTURE_MATRIX,
+  COLOR_MATRIX,
+  N_LIGHTS,
+  GLOBAL_AMBIENT_LIGHT,
+  TIME,
+  COUNT
+};
+
+
 /**
  * \brief OpenGL attribute names and locations, uniform names, etc.,
  * to be used by ShaderCore, ShaderCoreFactory, and GeometryCore.
@@ -282,6 +386,12 @@ public:
    */
   static void bindSamplers(GLuint program);
 
+  /**
+   * Get name of standard uniform variable, e.g., MODEL_VIEW_MATRIX for
+   * OGLUniform::MODEL_VIEW_MATRIX.
+   */
+  static const char* getUniformName(OGLUniform uniform);
+
 public:
 
   // attribute names and locations, defined in internals.cpp
@@ -293,14 +403,22 @@ public:
   static const OGLAttrib TANGENT;
   static const OGLAttrib BINORMAL;
 
+  // per-instance attribute names and locations (cf. InstancedShape), defined in internals.cpp;
+  // the matrix occupies four consecutive locations (one per column)
+  static const OGLAttrib INSTANCE_COLOR;
+  static const OGLAttrib INSTANCE_MATRIX;
+
   // fragment data names and locations, defined in internals.cpp
   static const OGLFragData FRAG_COLOR;
 
   // uniform block names and indices, defined in internals.cpp
   static const OGLUniformBlock LIGHT;
   static const OGLUniformBlock MATERIAL;
+  static const OGLUniformBlock FRAME;     // per-frame uniforms (cf. RenderState::passToShader())
+  static const OGLUniformBlock OBJECT;    // per-object uniforms (cf. RenderState::passToShader())
 
-  // uniform names
+  // uniform names, members of the FRAME and OBJECT uniform blocks
+  // (legacy shaders may declare them as individual uniforms)
   static const char* MODEL_VIEW_MATRIX;
   static const char* PROJECTION_MATRIX;
   static const char* MVP_MATRIX;
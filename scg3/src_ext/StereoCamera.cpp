@@ -84,7 +84,7 @@ const glm::mat4& StereoCamera::getViewTransform(RenderState* renderState) {
 
 void StereoCamera::updateProjection() {
   GLint viewport[4];
-  glGetIntegerv(GL_VIEWPORT, viewport);
+  RenderState::glState.getViewport(viewport);
   GLfloat aspect = static_cast<GLfloat> (viewport[2] - viewport[0])
       / static_cast<GLfloat> (viewport[3] - viewport[1]);
   screenHalfWidth_ = aspect * screenHalfHeight_;
@@ -23,6 +23,7 @@
 
 #include <cassert>
 #include "../src/scg_glew.h"
+#include "../src/RenderState.h"
 #include "../src/scg_utilities.h"
 #include "StereoRendererPassive.h"
 
@@ -49,20 +50,20 @@ void StereoRendererPassive::render() {
 
   // get viewport dimensions
   GLint viewport[4];
-  glGetIntegerv(GL_VIEWPORT, viewport);
+  RenderState::glState.getViewport(viewport);
   GLint viewportHalfWidth = viewport[2] / 2;
   GLint viewportHeight = viewport[3];
 
   // left eye: render scene in left half of viewport using concrete renderer
-  glViewport(0, 0, viewportHalfWidth, viewportHeight);
+  RenderState::glState.setViewport(0, 0, viewportHalfWidth, viewportHeight);
   concreteRenderer_->render();
 
   // right eye: render scene in right half of viewport using concrete renderer
-  glViewport(viewportHalfWidth, 0, viewportHalfWidth, viewportHeight);
+  RenderState::glState.setViewport(viewportHalfWidth, 0, viewportHalfWidth, viewportHeight);
   concreteRenderer_->render();
 
   // restore viewport
-  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  RenderState::glState.setViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 
   assert(!checkGLError());
 }
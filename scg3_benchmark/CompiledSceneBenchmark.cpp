@@ -0,0 +1,178 @@
+/**
+ * \file CompiledSceneBenchmark.cpp
+ * \brief Benchmark of the frame CPU cost of StandardRenderer in compiled scene mode
+ *    against the traversal of the scene graph pointers.
+ *
+ * Usage: CompiledSceneBenchmark [number of nodes ...], default: 10000 100000 1000000
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <scg3.h>
+
+using namespace scg;
+
+
+/**
+ * \brief Generated scene with a given number of nodes: groups of 16 small rectangles,
+ *    each below its own transformation, arranged in a grid in front of the camera.
+ */
+struct BenchmarkScene {
+
+  GroupSP root;
+  CameraSP camera;
+  std::vector<TransformationSP> transformations;
+  size_t nNodes;
+
+};
+
+
+BenchmarkScene createScene(size_t nNodes) {
+  const size_t nShapesPerGroup = 16;
+  BenchmarkScene scene;
+
+  ShaderCoreFactory shaderFactory;
+  auto shader = shaderFactory.createGouraudShader();
+  auto light = Light::create();
+  light->setDiffuseAndSpecular(glm::vec4(1.f, 1.f, 1.f, 1.f))
+       ->setPosition(glm::vec4(0.f, 0.f, 10.f, 1.f))
+       ->init();
+  auto material = MaterialCore::create();
+  material->setAmbientAndDiffuse(glm::vec4(1.f, 0.5f, 0.5f, 1.f))
+          ->init();
+  GeometryCoreFactory geometryFactory;
+  auto rectangle = geometryFactory.createRectangle(glm::vec2(0.002f, 0.002f));
+
+  scene.camera = PerspectiveCamera::create();
+  scene.camera->translate(glm::vec3(0.f, 0.f, 1.5f));
+  scene.root = Group::create();
+  scene.root->addCore(shader)
+            ->addChild(scene.camera)
+            ->addChild(light);
+  scene.nNodes = 4;   // root, camera, light, world
+
+  // grid of rectangles in the square [-1, 1]^2 in the xy plane
+  auto world = Group::create();
+  light->addChild(world);
+  const size_t nShapes = nNodes / (2 * nShapesPerGroup + 1) * nShapesPerGroup;
+  const size_t nColumns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nShapes))));
+  const GLfloat spacing = 2.f / std::max(nColumns, static_cast<size_t>(1));
+  GroupSP group;
+  for (size_t i = 0; i < nShapes; ++i) {
+    if (i % nShapesPerGroup == 0) {
+      group = Group::create();
+      world->addChild(group);
+      ++scene.nNodes;
+    }
+    auto transformation = Transformation::create();
+    transformation->translate(glm::vec3(-1.f + spacing * (i % nColumns),
+        -1.f + spacing * (i / nColumns), 0.f));
+    auto shape = Shape::create();
+    shape->addCore(material)
+         ->addCore(rectangle);
+    transformation->addChild(shape);
+    group->addChild(transformation);
+    scene.transformations.push_back(transformation);
+    scene.nNodes += 2;
+  }
+  return scene;
+}
+
+
+/**
+ * Get average CPU time of StandardRenderer::render() in milliseconds, excluding the
+ * execution of the OpenGL commands, which are finished before each frame.
+ * \param nMoved number of transformations modified before each frame
+ */
+double measureFrameTime(StandardRenderer& renderer, BenchmarkScene& scene, int nFrames,
+    size_t nMoved, std::mt19937& rng) {
+  std::uniform_real_distribution<float> offset(-1e-4f, 1e-4f);
+  double sum = 0.;
+  for (int frame = 0; frame < nFrames; ++frame) {
+    for (size_t i = 0; i < nMoved; ++i) {
+      scene.transformations[rng() % scene.transformations.size()]->translate(
+          glm::vec3(offset(rng), offset(rng), 0.f));
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glFinish();
+    const auto start = std::chrono::steady_clock::now();
+    renderer.render();
+    sum += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  glFinish();
+  return sum / nFrames;
+}
+
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> nNodesList;
+  for (int i = 1; i < argc; ++i) {
+    nNodesList.push_back(static_cast<size_t>(std::atol(argv[i])));
+  }
+  if (nNodesList.empty()) {
+    nNodesList = { 10000, 100000, 1000000 };
+  }
+
+  try {
+    // frustum culling is disabled, since it is not applied in compiled scene mode
+    auto viewer = Viewer::create();
+    auto renderer = StandardRenderer::create();
+    renderer->setFrustumCulling(false);
+    viewer->init(renderer)
+          ->createWindow("s c g 3   benchmark", 640, 480);
+
+    std::mt19937 rng(42);
+    std::printf("%10s %10s %12s %12s %12s\n", "nodes", "mode", "first [ms]", "static [ms]",
+        "1% moved [ms]");
+    for (auto nNodes : nNodesList) {
+      BenchmarkScene scene = createScene(nNodes);
+      renderer->setScene(scene.root);
+      renderer->setCamera(scene.camera);
+      const int nFrames = static_cast<int>(std::max(static_cast<size_t>(3),
+          std::min(static_cast<size_t>(100), 1000000 / std::max(nNodes, static_cast<size_t>(1)))));
+      const size_t nMoved = scene.transformations.size() / 100;
+      for (int mode = 0; mode < 2; ++mode) {
+        // first frame includes compilation of the scene in compiled scene mode
+        renderer->setCompiledSceneMode(mode == 1);
+        const double firstTime = measureFrameTime(*renderer, scene, 1, 0, rng);
+        const double staticTime = measureFrameTime(*renderer, scene, nFrames, 0, rng);
+        const double movedTime = measureFrameTime(*renderer, scene, nFrames, nMoved, rng);
+        std::printf("%10zu %10s %12.2f %12.2f %12.2f\n", scene.nNodes,
+            mode == 1 ? "compiled" : "pointer", firstTime, staticTime, movedTime);
+      }
+      assert(!checkGLError());
+    }
+  }
+  catch (const std::exception& exc) {
+    std::cerr << std::endl << "Exception: " << exc.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
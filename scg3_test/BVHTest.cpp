@@ -0,0 +1,219 @@
+/**
+ * \file BVHTest.cpp
+ * \brief Test of BVH queries against brute force, while shapes are added, moved,
+ *    hidden, and removed.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <scg3.h>
+#include "scg_test.h"
+
+using namespace scg;
+
+
+/**
+ * \brief A shape with a given bounding box instead of geometry cores.
+ */
+class BoxShape: public Shape {
+
+public:
+
+  void setBox(const AABB& box) {
+    boundingBox_ = box;
+    boundingSphere_ = BoundingSphere(box);
+    markModified_();
+  }
+
+  const AABB& getBoundingBox() {
+    return boundingBox_;
+  }
+
+};
+
+
+/**
+ * \brief Scene of box shapes below transformations, with a brute force reference.
+ */
+class Scene {
+
+public:
+
+  Scene()
+      : root(Group::create()), rng(42) {
+  }
+
+  void addShapes(size_t n) {
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 3.0f);
+    for (size_t i = 0; i < n; ++i) {
+      auto transformation = Transformation::create();
+      transformation->translate(glm::vec3(position(rng), position(rng), position(rng)));
+      auto shape = std::make_shared<BoxShape>();
+      const glm::vec3 halfExtent(extent(rng), extent(rng), extent(rng));
+      shape->setBox(AABB(-halfExtent, halfExtent));
+      transformation->addChild(shape);
+      root->addChild(transformation);
+      transformations.push_back(transformation);
+      shapes.push_back(shape.get());
+    }
+  }
+
+  void removeShapes(size_t n) {
+    for (size_t i = 0; i < n && !shapes.empty(); ++i) {
+      const size_t index = rng() % shapes.size();
+      root->removeChild(transformations[index].get());
+      transformations.erase(transformations.begin() + index);
+      shapes.erase(shapes.begin() + index);
+    }
+  }
+
+  void moveShapes(size_t n) {
+    std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+    for (size_t i = 0; i < n; ++i) {
+      transformations[rng() % transformations.size()]->translate(
+          glm::vec3(offset(rng), offset(rng), offset(rng)));
+    }
+  }
+
+  void setShapesVisible(size_t n, bool isVisible) {
+    for (size_t i = 0; i < n; ++i) {
+      transformations[rng() % transformations.size()]->setVisible(isVisible);
+    }
+  }
+
+  std::vector<Shape*> getVisibleShapes() const {
+    std::vector<Shape*> result;
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      if (transformations[i]->isVisible()) {
+        result.push_back(shapes[i]);
+      }
+    }
+    return result;
+  }
+
+  GroupSP root;
+  std::vector<TransformationSP> transformations;
+  std::vector<Shape*> shapes;
+  std::mt19937 rng;
+
+};
+
+
+void checkQueries(Scene& scene, const BVH& bvh) {
+  const std::vector<Shape*> visibleShapes = scene.getVisibleShapes();
+  SCG_CHECK(bvh.getNShapes() == visibleShapes.size());
+
+  std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+  std::uniform_real_distribution<float> extent(0.0f, 20.0f);
+  std::vector<Shape*> result, expected;
+  for (int k = 0; k < 50; ++k) {
+    // range query
+    const glm::vec3 center(position(scene.rng), position(scene.rng), position(scene.rng));
+    const glm::vec3 halfExtent(extent(scene.rng), extent(scene.rng), extent(scene.rng));
+    const AABB range(center - halfExtent, center + halfExtent);
+    result.clear();
+    bvh.queryRange(range, result);
+    expected.clear();
+    for (auto shape : visibleShapes) {
+      if (shape->getWorldBoundingBox().overlaps(range)) {
+        expected.push_back(shape);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    std::sort(expected.begin(), expected.end());
+    SCG_CHECK(result == expected);
+
+    // frustum query
+    const glm::vec3 eye(position(scene.rng), position(scene.rng), position(scene.rng));
+    const ViewFrustum frustum(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 40.0f)
+        * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+    result.clear();
+    bvh.queryFrustum(frustum, result);
+    expected.clear();
+    for (auto shape : visibleShapes) {
+      if (!frustum.isOutside(shape->getWorldBoundingBox())) {
+        expected.push_back(shape);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    std::sort(expected.begin(), expected.end());
+    SCG_CHECK(result == expected);
+
+    // nearest neighbor query, compared by distances to be independent of ties
+    const size_t nNearest = 5;
+    std::vector<GLfloat> distances;
+    result.clear();
+    bvh.queryNearest(center, nNearest, result, &distances);
+    std::vector<GLfloat> expectedDistances;
+    for (auto shape : visibleShapes) {
+      expectedDistances.push_back(std::sqrt(shape->getWorldBoundingBox().getDistance2(center)));
+    }
+    std::sort(expectedDistances.begin(), expectedDistances.end());
+    expectedDistances.resize(std::min(nNearest, expectedDistances.size()));
+    SCG_CHECK(result.size() == expectedDistances.size());
+    SCG_CHECK(distances.size() == expectedDistances.size());
+    for (size_t i = 0; i < distances.size() && i < expectedDistances.size(); ++i) {
+      SCG_CHECK(std::fabs(distances[i] - expectedDistances[i]) < 1e-4f);
+    }
+  }
+}
+
+
+int main() {
+  Scene scene;
+  scene.addShapes(500);
+  BVHSP bvh = BVH::create(scene.root);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+
+  // insert
+  scene.addShapes(100);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+
+  // remove
+  scene.removeShapes(150);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+
+  // refit
+  scene.moveShapes(100);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+
+  // hide and show
+  scene.setShapesVisible(80, false);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+  scene.setShapesVisible(40, true);
+  bvh->sync();
+  checkQueries(scene, *bvh);
+
+  // rebuild
+  bvh->rebuild();
+  checkQueries(scene, *bvh);
+
+  return scg_test::getExitCode("BVHTest");
+}
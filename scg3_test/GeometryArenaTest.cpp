@@ -0,0 +1,252 @@
+/**
+ * \file GeometryArenaTest.cpp
+ * \brief Test of the free-list allocator of GeometryArena and of buffer compaction.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <vector>
+#include <scg3.h>
+#include "scg_test.h"
+
+using namespace scg;
+
+
+/**
+ * \brief Access to the free-list allocator of GeometryArena, which does not require
+ *    an OpenGL context.
+ */
+class FreeListTest: public GeometryArena {
+
+public:
+
+  /**
+   * Check that the free blocks are disjoint, coalesced, and complement the used elements.
+   */
+  static void checkFreeList(const FreeList_& freeList, const std::vector<bool>& isUsed) {
+    GLint nFree = 0;
+    GLint end = -1;
+    std::vector<bool> isFree(isUsed.size(), false);
+    for (auto& block : freeList.blocks) {
+      SCG_CHECK(block.second > 0);
+      SCG_CHECK(block.first > end);   // neither overlapping nor adjacent
+      end = block.first + block.second;
+      SCG_CHECK(end <= freeList.capacity);
+      for (GLint i = block.first; i < end && i < freeList.capacity; ++i) {
+        isFree[i] = true;
+      }
+      nFree += block.second;
+    }
+    SCG_CHECK(nFree == freeList.nFree);
+    for (size_t i = 0; i < isUsed.size(); ++i) {
+      SCG_CHECK(isFree[i] != isUsed[i]);
+    }
+  }
+
+  static void testCoalescing() {
+    FreeList_ freeList;
+    freeList.capacity = 30;
+    freeList.nFree = 30;
+    freeList.blocks[0] = 30;
+    const GLint a = allocateBlock_(freeList, 10);
+    const GLint b = allocateBlock_(freeList, 10);
+    const GLint c = allocateBlock_(freeList, 10);
+    SCG_CHECK(a == 0 && b == 10 && c == 20);
+    SCG_CHECK(freeList.blocks.empty() && freeList.nFree == 0);
+    SCG_CHECK(allocateBlock_(freeList, 1) == -1);
+
+    // merge with next block, with previous block, and with both
+    releaseBlock_(freeList, c, 10);
+    releaseBlock_(freeList, b, 10);
+    SCG_CHECK(freeList.blocks.size() == 1 && freeList.blocks[10] == 20);
+    SCG_CHECK(allocateBlock_(freeList, 20) == 10);
+    releaseBlock_(freeList, a, 10);
+    releaseBlock_(freeList, 10, 5);
+    SCG_CHECK(freeList.blocks.size() == 1 && freeList.blocks[0] == 15);
+    releaseBlock_(freeList, 20, 10);
+    SCG_CHECK(freeList.blocks.size() == 2 && getLargestBlock_(freeList) == 15);
+    releaseBlock_(freeList, 15, 5);
+    SCG_CHECK(freeList.blocks.size() == 1 && freeList.blocks[0] == 30);
+    SCG_CHECK(freeList.nFree == 30);
+  }
+
+  static void testRandom() {
+    const GLint capacity = 1000;
+    FreeList_ freeList;
+    freeList.capacity = capacity;
+    freeList.nFree = capacity;
+    freeList.blocks[0] = capacity;
+    std::vector<bool> isUsed(capacity, false);
+    std::vector<std::pair<GLint, GLint> > allocated;
+    std::mt19937 rng(42);
+    for (int k = 0; k < 5000; ++k) {
+      if (allocated.empty() || rng() % 2 == 0) {
+        const GLint size = 1 + static_cast<GLint>(rng() % 40);
+
+        // best fit: smallest free block that is large enough
+        GLint bestSize = 0;
+        for (auto& block : freeList.blocks) {
+          if (block.second >= size && (bestSize == 0 || block.second < bestSize)) {
+            bestSize = block.second;
+          }
+        }
+        const auto blocks = freeList.blocks;
+        const GLint offset = allocateBlock_(freeList, size);
+        if (bestSize == 0) {
+          SCG_CHECK(offset == -1);
+          continue;
+        }
+        SCG_CHECK(blocks.count(offset) == 1 && blocks.at(offset) == bestSize);
+        if (blocks.count(offset) == 0) {
+          break;
+        }
+        for (GLint i = offset; i < offset + size; ++i) {
+          SCG_CHECK(!isUsed[i]);
+          isUsed[i] = true;
+        }
+        allocated.push_back(std::make_pair(offset, size));
+        const GLint rest = bestSize - size;
+        SCG_CHECK(rest == 0 || freeList.blocks.count(offset + size) == 1);
+      }
+      else {
+        const size_t index = rng() % allocated.size();
+        const GLint offset = allocated[index].first;
+        const GLint size = allocated[index].second;
+        releaseBlock_(freeList, offset, size);
+        for (GLint i = offset; i < offset + size; ++i) {
+          isUsed[i] = false;
+        }
+        allocated[index] = allocated.back();
+        allocated.pop_back();
+      }
+      checkFreeList(freeList, isUsed);
+    }
+  }
+
+};
+
+
+/**
+ * Fill vertex and element index range with values identifying the range.
+ */
+void writeRange(const GeometryArena& arena, size_t range) {
+  const GeometryArena::Range& r = arena.getRange(range);
+  std::vector<GLfloat> vertices(3 * r.nVertices);
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertices[i] = static_cast<GLfloat>(1000 * range + i);
+  }
+  std::vector<GLuint> indices(r.nIndices);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    indices[i] = static_cast<GLuint>(i % r.nVertices);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, arena.getVertexBuffer());
+  glBufferSubData(GL_COPY_WRITE_BUFFER, r.baseVertex * arena.getStride(),
+      vertices.size() * sizeof(GLfloat), vertices.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, arena.getIndexBuffer());
+  glBufferSubData(GL_COPY_WRITE_BUFFER, r.firstIndex * sizeof(GLuint),
+      indices.size() * sizeof(GLuint), indices.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+/**
+ * Check that the vertex and element index range still holds the values of writeRange().
+ */
+void checkRange(const GeometryArena& arena, size_t range) {
+  const GeometryArena::Range& r = arena.getRange(range);
+  std::vector<GLfloat> vertices(3 * r.nVertices);
+  std::vector<GLuint> indices(r.nIndices);
+  glBindBuffer(GL_COPY_READ_BUFFER, arena.getVertexBuffer());
+  glGetBufferSubData(GL_COPY_READ_BUFFER, r.baseVertex * arena.getStride(),
+      vertices.size() * sizeof(GLfloat), vertices.data());
+  glBindBuffer(GL_COPY_READ_BUFFER, arena.getIndexBuffer());
+  glGetBufferSubData(GL_COPY_READ_BUFFER, r.firstIndex * sizeof(GLuint),
+      indices.size() * sizeof(GLuint), indices.data());
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  bool isEqual = true;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    isEqual = isEqual && vertices[i] == static_cast<GLfloat>(1000 * range + i);
+  }
+  for (size_t i = 0; i < indices.size(); ++i) {
+    isEqual = isEqual && indices[i] == static_cast<GLuint>(i % r.nVertices);
+  }
+  SCG_CHECK(isEqual);
+}
+
+
+void testDefragment() {
+  const std::vector<VertexAttribute> attributes = { VertexAttribute(OGLConstants::VERTEX.location, 3, 0) };
+  GeometryArenaSP arena = GeometryArena::create(3 * sizeof(GLfloat), attributes, 128, 384);
+  std::vector<size_t> ranges;
+  for (GLsizei i = 0; i < 12; ++i) {
+    ranges.push_back(arena->allocate(3 + i, 3 * (i + 1)));
+    writeRange(*arena, ranges.back());
+  }
+
+  // release every other range, such that the free space is scattered
+  std::vector<size_t> usedRanges;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (i % 2 == 1) {
+      arena->release(ranges[i]);
+    }
+    else {
+      usedRanges.push_back(ranges[i]);
+    }
+  }
+  SCG_CHECK(arena->getNRanges() == usedRanges.size());
+  SCG_CHECK(arena->getFragmentation() > 0.0f);
+
+  // compaction keeps the contents and leaves a single free block
+  arena->defragment();
+  SCG_CHECK(arena->getFragmentation() == 0.0f);
+  GLsizei nVertices = 0;
+  for (auto range : usedRanges) {
+    checkRange(*arena, range);
+    nVertices += arena->getRange(range).nVertices;
+  }
+  SCG_CHECK(arena->getNFreeVertices() == arena->getVertexCapacity() - nVertices);
+
+  // growing the buffers keeps the contents as well
+  usedRanges.push_back(arena->allocate(2 * arena->getVertexCapacity(), 600));
+  writeRange(*arena, usedRanges.back());
+  SCG_CHECK(arena->getVertexCapacity() >= nVertices + arena->getRange(usedRanges.back()).nVertices);
+  for (auto range : usedRanges) {
+    checkRange(*arena, range);
+  }
+  SCG_CHECK(glGetError() == GL_NO_ERROR);
+}
+
+
+int main() {
+  FreeListTest::testCoalescing();
+  FreeListTest::testRandom();
+  if (!scg_test::createContext()) {
+    // report failed allocator checks, skip test of buffer compaction otherwise
+    if (scg_test::getNFailures() > 0) {
+      return scg_test::getExitCode("GeometryArenaTest");
+    }
+    std::cout << "GeometryArenaTest: skipped, no OpenGL context" << std::endl;
+    return SCG_TEST_SKIPPED;
+  }
+  testDefragment();
+  glfwTerminate();
+  return scg_test::getExitCode("GeometryArenaTest");
+}
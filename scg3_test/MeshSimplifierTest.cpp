@@ -0,0 +1,234 @@
+/**
+ * \file MeshSimplifierTest.cpp
+ * \brief Test of MeshSimplifier on closed and open meshes.
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+#include <scg3.h>
+#include "scg_test.h"
+
+using namespace scg;
+
+
+/**
+ * Create closed unit sphere without attribute seams, i.e., all vertices are shared.
+ */
+TriangleMesh createSphere(int nSlices, int nStacks) {
+  TriangleMesh mesh;
+  mesh.vertices.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+  for (int j = 1; j < nStacks; ++j) {
+    const float theta = glm::pi<float>() * j / nStacks;
+    for (int i = 0; i < nSlices; ++i) {
+      const float phi = 2.0f * glm::pi<float>() * i / nSlices;
+      mesh.vertices.push_back(glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta),
+          std::sin(theta) * std::cos(phi)));
+    }
+  }
+  mesh.vertices.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+  const GLuint south = static_cast<GLuint>(mesh.vertices.size() - 1);
+  auto ring = [nSlices](int j, int i) {
+    return static_cast<GLuint>(1 + (j - 1) * nSlices + (i % nSlices));
+  };
+  for (int i = 0; i < nSlices; ++i) {
+    mesh.indices.insert(mesh.indices.end(), { 0, ring(1, i), ring(1, i + 1) });
+    for (int j = 1; j < nStacks - 1; ++j) {
+      mesh.indices.insert(mesh.indices.end(), { ring(j, i), ring(j + 1, i), ring(j + 1, i + 1) });
+      mesh.indices.insert(mesh.indices.end(), { ring(j, i), ring(j + 1, i + 1), ring(j, i + 1) });
+    }
+    mesh.indices.insert(mesh.indices.end(),
+        { ring(nStacks - 1, i), south, ring(nStacks - 1, i + 1) });
+  }
+  mesh.computeNormals();
+  return mesh;
+}
+
+
+/**
+ * Create open unit square in the xy plane, facing +z.
+ */
+TriangleMesh createGrid(int n) {
+  TriangleMesh mesh;
+  for (int j = 0; j <= n; ++j) {
+    for (int i = 0; i <= n; ++i) {
+      mesh.vertices.push_back(glm::vec3(static_cast<float>(i) / n, static_cast<float>(j) / n, 0.0f));
+    }
+  }
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      const GLuint k = static_cast<GLuint>(j * (n + 1) + i);
+      mesh.indices.insert(mesh.indices.end(), { k, k + 1, k + n + 2 });
+      mesh.indices.insert(mesh.indices.end(), { k, k + n + 2, k + n + 1 });
+    }
+  }
+  mesh.computeNormals();
+  return mesh;
+}
+
+
+glm::vec3 getFaceNormal(const TriangleMesh& mesh, size_t triangle) {
+  const glm::vec3& p0 = mesh.vertices[mesh.indices[3 * triangle]];
+  const glm::vec3& p1 = mesh.vertices[mesh.indices[3 * triangle + 1]];
+  const glm::vec3& p2 = mesh.vertices[mesh.indices[3 * triangle + 2]];
+  return glm::cross(p1 - p0, p2 - p0);
+}
+
+
+/**
+ * Check that the mesh is valid and its vertices are a subset of the original ones.
+ */
+void checkValid(const TriangleMesh& mesh, const TriangleMesh& original) {
+  SCG_CHECK(mesh.indices.size() % 3 == 0);
+  SCG_CHECK(mesh.normals.size() == mesh.vertices.size());
+  for (auto index : mesh.indices) {
+    SCG_CHECK(index < mesh.vertices.size());
+  }
+  for (size_t i = 0; i < mesh.getNTriangles(); ++i) {
+    const GLuint* t = &mesh.indices[3 * i];
+    SCG_CHECK(t[0] != t[1] && t[1] != t[2] && t[2] != t[0]);
+  }
+  for (auto& vertex : mesh.vertices) {
+    bool isFound = false;
+    for (auto& originalVertex : original.vertices) {
+      if (vertex == originalVertex) {
+        isFound = true;
+        break;
+      }
+    }
+    SCG_CHECK(isFound);
+  }
+}
+
+
+/**
+ * Check that each edge of the mesh is shared by exactly two triangles with opposite
+ * orientations.
+ */
+void checkClosed(const TriangleMesh& mesh) {
+  std::map<std::pair<GLuint, GLuint>, int> edges;
+  for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+    for (int k = 0; k < 3; ++k) {
+      ++edges[std::make_pair(mesh.indices[i + k], mesh.indices[i + (k + 1) % 3])];
+    }
+  }
+  for (auto& edge : edges) {
+    SCG_CHECK(edge.second == 1);
+    auto it = edges.find(std::make_pair(edge.first.second, edge.first.first));
+    SCG_CHECK(it != edges.end() && it->second == 1);
+  }
+}
+
+
+void testClosedMesh() {
+  const TriangleMesh sphere = createSphere(32, 16);
+  MeshSimplifier simplifier;
+  const size_t target = sphere.getNTriangles() / 4;
+  GLfloat error = -1.0f;
+  const TriangleMesh result = simplifier.simplify(sphere, target, FLT_MAX, &error);
+  SCG_CHECK(result.getNTriangles() <= target);
+  SCG_CHECK(result.getNTriangles() > target / 2);
+  SCG_CHECK(error > 0.0f && error < 0.1f);
+  checkValid(result, sphere);
+  checkClosed(result);
+
+  // faces keep pointing outwards
+  for (size_t i = 0; i < result.getNTriangles(); ++i) {
+    const glm::vec3 center = result.vertices[result.indices[3 * i]]
+        + result.vertices[result.indices[3 * i + 1]] + result.vertices[result.indices[3 * i + 2]];
+    SCG_CHECK(glm::dot(getFaceNormal(result, i), center) > 0.0f);
+  }
+}
+
+
+void testMaxError() {
+  // every collapse on a curved surface has a positive error
+  const TriangleMesh sphere = createSphere(16, 8);
+  MeshSimplifier simplifier;
+  GLfloat error = -1.0f;
+  const TriangleMesh result = simplifier.simplify(sphere, 0, 1e-7f, &error);
+  SCG_CHECK(result.getNTriangles() == sphere.getNTriangles());
+  SCG_CHECK(error >= 0.0f && error <= 1e-7f);
+}
+
+
+void testOpenMesh() {
+  // collapses within the plane and along straight borders are free, the corners remain
+  const TriangleMesh grid = createGrid(16);
+  MeshSimplifier simplifier;
+  const TriangleMesh result = simplifier.simplify(grid, 0, 1e-5f);
+  SCG_CHECK(result.getNTriangles() < grid.getNTriangles() / 8);
+  checkValid(result, grid);
+  AABB box;
+  for (auto& vertex : result.vertices) {
+    box.extend(vertex);
+  }
+  SCG_CHECK(box.min == glm::vec3(0.0f, 0.0f, 0.0f));
+  SCG_CHECK(box.max == glm::vec3(1.0f, 1.0f, 0.0f));
+  GLfloat area = 0.0f;
+  for (size_t i = 0; i < result.getNTriangles(); ++i) {
+    const glm::vec3 normal = getFaceNormal(result, i);
+    SCG_CHECK(normal.z > 0.0f);
+    area += 0.5f * normal.z;
+  }
+  SCG_CHECK(std::fabs(area - 1.0f) < 1e-4f);
+}
+
+
+void testBatchAndLODs() {
+  const TriangleMesh sphere = createSphere(24, 12);
+  const TriangleMesh grid = createGrid(12);
+  MeshSimplifier simplifier;
+  simplifier.setNThreads(2);
+
+  // parallel simplification matches single meshes
+  const std::vector<TriangleMesh> results = simplifier.simplify({ sphere, grid, sphere }, 0.5f);
+  SCG_CHECK(results.size() == 3);
+  if (results.size() == 3) {
+    const TriangleMesh single = simplifier.simplify(sphere, sphere.getNTriangles() / 2);
+    SCG_CHECK(results[0].indices == single.indices);
+    SCG_CHECK(results[2].indices == single.indices);
+    SCG_CHECK(results[1].getNTriangles() <= grid.getNTriangles() / 2);
+  }
+
+  // levels of detail with decreasing numbers of triangles
+  const std::vector<TriangleMesh> lods = simplifier.createLODs(sphere, 4, 0.5f);
+  SCG_CHECK(!lods.empty() && lods.size() <= 4);
+  if (!lods.empty()) {
+    SCG_CHECK(lods[0].getNTriangles() == sphere.getNTriangles());
+  }
+  for (size_t i = 1; i < lods.size(); ++i) {
+    SCG_CHECK(lods[i].getNTriangles() <= lods[i - 1].getNTriangles() / 2);
+    checkValid(lods[i], sphere);
+    checkClosed(lods[i]);
+  }
+}
+
+
+int main() {
+  testClosedMesh();
+  testMaxError();
+  testOpenMesh();
+  testBatchAndLODs();
+  return scg_test::getExitCode("MeshSimplifierTest");
+}
@@ -0,0 +1,110 @@
+/**
+ * \file RenderQueueTest.cpp
+ * \brief Test of the radix sort of RenderQueue against std::stable_sort().
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <scg3.h>
+#include "scg_test.h"
+
+using namespace scg;
+
+
+/**
+ * \brief Render queue giving access to its sort keys.
+ */
+class SortTestQueue: public RenderQueue {
+
+public:
+
+  /**
+   * Sort keys by RenderQueue::sort_() and by std::stable_sort(), the item indices
+   * identifying the original positions of equal keys.
+   */
+  bool isSortedStably(const std::vector<uint64_t>& keys) {
+    entries_.clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      entries_.push_back({ keys[i], i });
+    }
+    std::vector<Entry_> expected = entries_;
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const Entry_& a, const Entry_& b) { return a.key < b.key; });
+    sort_();
+    if (entries_.size() != expected.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+      if (entries_[i].key != expected[i].key || entries_[i].item != expected[i].item) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+};
+
+
+int main() {
+  SortTestQueue queue;
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> keys;
+
+  // single key, all keys equal (every digit is skipped)
+  SCG_CHECK(queue.isSortedStably({ 7 }));
+  SCG_CHECK(queue.isSortedStably(std::vector<uint64_t>(100, 0x0123456789abcdefull)));
+
+  // random 64-bit keys
+  for (size_t n : { 2, 3, 255, 256, 257, 10000 }) {
+    keys.resize(n);
+    for (auto& key : keys) {
+      key = rng();
+    }
+    SCG_CHECK(queue.isSortedStably(keys));
+  }
+
+  // many duplicates, differing in a single low, middle, or high digit
+  for (int shift : { 0, 28, 56 }) {
+    keys.resize(5000);
+    for (auto& key : keys) {
+      key = (rng() % 16) << shift;
+    }
+    SCG_CHECK(queue.isSortedStably(keys));
+  }
+
+  // layout of render queue keys: few shaders and textures, many depths
+  keys.resize(5000);
+  for (auto& key : keys) {
+    key = (rng() % 4) << 60 | (rng() % 32) << 44 | (rng() % 8) << 32 | (rng() & 0xffffffffull);
+  }
+  SCG_CHECK(queue.isSortedStably(keys));
+
+  // already sorted and reversed keys
+  std::sort(keys.begin(), keys.end());
+  SCG_CHECK(queue.isSortedStably(keys));
+  std::reverse(keys.begin(), keys.end());
+  SCG_CHECK(queue.isSortedStably(keys));
+
+  return scg_test::getExitCode("RenderQueueTest");
+}
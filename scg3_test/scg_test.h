@@ -0,0 +1,105 @@
+/**
+ * \file scg_test.h
+ * \brief Minimal checks for the scg3 unit tests.
+ *
+ * Each test is a program that returns a non-zero exit code if a check has failed,
+ * or SCG_TEST_SKIPPED if it cannot be run, e.g., without an OpenGL context (cf. CTest).
+ *
+ * \author Volker Ahlers\n
+ *         volker.ahlers@hs-hannover.de
+ */
+
+/*
+ * Copyright 2014-2019 Volker Ahlers
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCG_TEST_H_
+#define SCG_TEST_H_
+
+#include <iostream>
+#include "scg_glew.h"
+#include <GLFW/glfw3.h>
+
+/**
+ * Exit code of a test that has been skipped (cf. SKIP_RETURN_CODE in CMakeLists.txt).
+ */
+#define SCG_TEST_SKIPPED 77
+
+/**
+ * Check condition, print file, line, and condition if it does not hold.
+ */
+#define SCG_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+      ++scg_test::getNFailures(); \
+    } \
+  } while (false)
+
+namespace scg_test {
+
+
+/**
+ * Get number of failed checks.
+ */
+inline int& getNFailures() {
+  static int nFailures = 0;
+  return nFailures;
+}
+
+/**
+ * Create OpenGL 3.3 core profile context of a hidden window and initialize GLEW.
+ * \return false if no context can be created, e.g., without a display
+ */
+inline bool createContext() {
+  if (glfwInit() == GL_FALSE) {
+    return false;
+  }
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "scg3 test", nullptr, nullptr);
+  if (!window) {
+    glfwTerminate();
+    return false;
+  }
+  glfwMakeContextCurrent(window);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) {
+    glfwTerminate();
+    return false;
+  }
+  glGetError();   // ignore GL error (invalid enum) in glewInit
+  return true;
+}
+
+/**
+ * Print summary and get exit code of the test program.
+ */
+inline int getExitCode(const char* testName) {
+  if (getNFailures() > 0) {
+    std::cerr << testName << ": " << getNFailures() << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << testName << ": passed" << std::endl;
+  return 0;
+}
+
+
+} /* namespace scg_test */
+
+#endif /* SCG_TEST_H_ */